@@ -15,6 +15,7 @@
 #if defined(CONFIG_BT_ENABLED)
 #include <sstream>
 #include "BLEAdvertisedDevice.h"
+#include "BLEAdvertisementParser.h"
 #include "BLEUtils.h"
 #if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
 #include "esp32-hal-log.h"
@@ -226,138 +227,121 @@ bool BLEAdvertisedDevice::haveTXPower() {
  * [length][type][data...]
  *
  * The length does not include itself but does include everything after it until the next record.  A record
- * with a length value of 0 indicates a terminator.
+ * with a length value of 0 indicates a terminator.  The records are walked in place with a
+ * BLEAdvertisementParser; a record that claims to run past the end of the pay load ends the parse.
+ * Multi-byte values are assembled a byte at a time as the records have no alignment.
  *
  * https://www.bluetooth.com/specifications/assigned-numbers/generic-access-profile
+ *
+ * @param [in] payload The pay load.  It is referenced, not copied, by getPayload().
+ * @param [in] total_len The length of the pay load.
  */
 void BLEAdvertisedDevice::parseAdvertisement(uint8_t* payload, size_t total_len) {
-	uint8_t length;
-	uint8_t ad_type;
-	uint8_t sizeConsumed = 0;
-	bool finished = false;
 	m_payload = payload;
 	m_payloadLength = total_len;
+	m_payloadCopy.clear();
+
+	BLEAdvertisementParser parser(payload, total_len);
+	for (BLEAdvertisementParser::Iterator it = parser.begin(); it != parser.end(); ++it) {
+		const BLEAdField& field = *it;
+		const uint8_t* data   = field.data;
+		uint8_t        length = field.length;
+		ESP_LOGD(LOG_TAG, "Type: 0x%.2x (%s), length: %d", field.type, BLEUtils::advTypeToString(field.type), length);
+
+		switch(field.type) {
+			case ESP_BLE_AD_TYPE_NAME_CMPL: {   // Adv Data Type: 0x09
+				setName(std::string(reinterpret_cast<const char*>(data), length));
+				break;
+			} // ESP_BLE_AD_TYPE_NAME_CMPL
+
+			case ESP_BLE_AD_TYPE_TX_PWR: {      // Adv Data Type: 0x0A
+				if (length >= 1) setTXPower(*data);
+				break;
+			} // ESP_BLE_AD_TYPE_TX_PWR
+
+			case ESP_BLE_AD_TYPE_APPEARANCE: { // Adv Data Type: 0x19
+				if (length >= 2) setAppearance(field.getUint16());
+				break;
+			} // ESP_BLE_AD_TYPE_APPEARANCE
+
+			case ESP_BLE_AD_TYPE_FLAG: {        // Adv Data Type: 0x01
+				if (length >= 1) setAdFlag(*data);
+				break;
+			} // ESP_BLE_AD_TYPE_FLAG
+
+			case ESP_BLE_AD_TYPE_16SRV_CMPL:
+			case ESP_BLE_AD_TYPE_16SRV_PART: {   // Adv Data Type: 0x02
+				for (int var = 0; var < length/2; ++var) {
+					setServiceUUID(BLEUUID(field.getUint16(var * 2)));
+				}
+				break;
+			} // ESP_BLE_AD_TYPE_16SRV_PART
 
-	while(!finished) {
-		length = *payload;          // Retrieve the length of the record.
-		payload++;                  // Skip to type
-		sizeConsumed += 1 + length; // increase the size consumed.
-
-		if (length != 0) { // A length of 0 indicates that we have reached the end.
-			ad_type = *payload;
-			payload++;
-			length--;
-
-			char* pHex = BLEUtils::buildHexData(nullptr, payload, length);
-			ESP_LOGD(LOG_TAG, "Type: 0x%.2x (%s), length: %d, data: %s",
-					ad_type, BLEUtils::advTypeToString(ad_type), length, pHex);
-			free(pHex);
-
-			switch(ad_type) {
-				case ESP_BLE_AD_TYPE_NAME_CMPL: {   // Adv Data Type: 0x09
-					setName(std::string(reinterpret_cast<char*>(payload), length));
-					break;
-				} // ESP_BLE_AD_TYPE_NAME_CMPL
-
-				case ESP_BLE_AD_TYPE_TX_PWR: {      // Adv Data Type: 0x0A
-					setTXPower(*payload);
-					break;
-				} // ESP_BLE_AD_TYPE_TX_PWR
-
-				case ESP_BLE_AD_TYPE_APPEARANCE: { // Adv Data Type: 0x19
-					setAppearance(*reinterpret_cast<uint16_t*>(payload));
-					break;
-				} // ESP_BLE_AD_TYPE_APPEARANCE
-
-				case ESP_BLE_AD_TYPE_FLAG: {        // Adv Data Type: 0x01
-					setAdFlag(*payload);
-					break;
-				} // ESP_BLE_AD_TYPE_FLAG
-
-				case ESP_BLE_AD_TYPE_16SRV_CMPL:
-				case ESP_BLE_AD_TYPE_16SRV_PART: {   // Adv Data Type: 0x02
-					for (int var = 0; var < length/2; ++var) {
-						setServiceUUID(BLEUUID(*reinterpret_cast<uint16_t*>(payload + var * 2)));
-					}
-					break;
-				} // ESP_BLE_AD_TYPE_16SRV_PART
-
-				case ESP_BLE_AD_TYPE_32SRV_CMPL:
-				case ESP_BLE_AD_TYPE_32SRV_PART: {   // Adv Data Type: 0x04
-					for (int var = 0; var < length/4; ++var) {
-						setServiceUUID(BLEUUID(*reinterpret_cast<uint32_t*>(payload + var * 4)));
-					}
-					break;
-				} // ESP_BLE_AD_TYPE_32SRV_PART
-
-				case ESP_BLE_AD_TYPE_128SRV_CMPL: { // Adv Data Type: 0x07
-					setServiceUUID(BLEUUID(payload, 16, false));
-					break;
-				} // ESP_BLE_AD_TYPE_128SRV_CMPL
+			case ESP_BLE_AD_TYPE_32SRV_CMPL:
+			case ESP_BLE_AD_TYPE_32SRV_PART: {   // Adv Data Type: 0x04
+				for (int var = 0; var < length/4; ++var) {
+					setServiceUUID(BLEUUID(field.getUint32(var * 4)));
+				}
+				break;
+			} // ESP_BLE_AD_TYPE_32SRV_PART
 
-				case ESP_BLE_AD_TYPE_128SRV_PART: { // Adv Data Type: 0x06
-					setServiceUUID(BLEUUID(payload, 16, false));
+			case ESP_BLE_AD_TYPE_128SRV_CMPL:   // Adv Data Type: 0x07
+			case ESP_BLE_AD_TYPE_128SRV_PART: { // Adv Data Type: 0x06
+				for (int var = 0; var < length/16; ++var) {
+					setServiceUUID(BLEUUID(const_cast<uint8_t*>(data + var * 16), 16, false));
+				}
+				break;
+			} // ESP_BLE_AD_TYPE_128SRV_PART
+
+			// See CSS Part A 1.4 Manufacturer Specific Data
+			case ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE: {
+				setManufacturerData(std::string(reinterpret_cast<const char*>(data), length));
+				break;
+			} // ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE
+
+			case ESP_BLE_AD_TYPE_SERVICE_DATA: {  // Adv Data Type: 0x16 (Service Data) - 2 byte UUID
+				if (length < 2) {
+					ESP_LOGE(LOG_TAG, "Length too small for ESP_BLE_AD_TYPE_SERVICE_DATA");
 					break;
-				} // ESP_BLE_AD_TYPE_128SRV_PART
+				}
+				setServiceDataUUID(BLEUUID(field.getUint16()));
+				if (length > 2) {
+					setServiceData(std::string(reinterpret_cast<const char*>(data + 2), length - 2));
+				}
+				break;
+			} //ESP_BLE_AD_TYPE_SERVICE_DATA
 
-				// See CSS Part A 1.4 Manufacturer Specific Data
-				case ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE: {
-					setManufacturerData(std::string(reinterpret_cast<char*>(payload), length));
+			case ESP_BLE_AD_TYPE_32SERVICE_DATA: {  // Adv Data Type: 0x20 (Service Data) - 4 byte UUID
+				if (length < 4) {
+					ESP_LOGE(LOG_TAG, "Length too small for ESP_BLE_AD_TYPE_32SERVICE_DATA");
 					break;
-				} // ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE
-
-				case ESP_BLE_AD_TYPE_SERVICE_DATA: {  // Adv Data Type: 0x16 (Service Data) - 2 byte UUID
-					if (length < 2) {
-						ESP_LOGE(LOG_TAG, "Length too small for ESP_BLE_AD_TYPE_SERVICE_DATA");
-						break;
-					}
-					uint16_t uuid = *(uint16_t*)payload;
-					setServiceDataUUID(BLEUUID(uuid));
-					if (length > 2) {
-						setServiceData(std::string(reinterpret_cast<char*>(payload + 2), length - 2));
-					}
-					break;
-				} //ESP_BLE_AD_TYPE_SERVICE_DATA
-
-				case ESP_BLE_AD_TYPE_32SERVICE_DATA: {  // Adv Data Type: 0x20 (Service Data) - 4 byte UUID
-					if (length < 4) {
-						ESP_LOGE(LOG_TAG, "Length too small for ESP_BLE_AD_TYPE_32SERVICE_DATA");
-						break;
-					}
-					uint32_t uuid = *(uint32_t*) payload;
-					setServiceDataUUID(BLEUUID(uuid));
-					if (length > 4) {
-						setServiceData(std::string(reinterpret_cast<char*>(payload + 4), length - 4));
-					}
-					break;
-				} //ESP_BLE_AD_TYPE_32SERVICE_DATA
-
-				case ESP_BLE_AD_TYPE_128SERVICE_DATA: {  // Adv Data Type: 0x21 (Service Data) - 16 byte UUID
-					if (length < 16) {
-						ESP_LOGE(LOG_TAG, "Length too small for ESP_BLE_AD_TYPE_128SERVICE_DATA");
-						break;
-					}
-
-					setServiceDataUUID(BLEUUID(payload, (size_t)16, false));
-					if (length > 16) {
-						setServiceData(std::string(reinterpret_cast<char*>(payload + 16), length - 16));
-					}
-					break;
-				} //ESP_BLE_AD_TYPE_32SERVICE_DATA
+				}
+				setServiceDataUUID(BLEUUID(field.getUint32()));
+				if (length > 4) {
+					setServiceData(std::string(reinterpret_cast<const char*>(data + 4), length - 4));
+				}
+				break;
+			} //ESP_BLE_AD_TYPE_32SERVICE_DATA
 
-				default: {
-					ESP_LOGD(LOG_TAG, "Unhandled type: adType: %d - 0x%.2x", ad_type, ad_type);
+			case ESP_BLE_AD_TYPE_128SERVICE_DATA: {  // Adv Data Type: 0x21 (Service Data) - 16 byte UUID
+				if (length < 16) {
+					ESP_LOGE(LOG_TAG, "Length too small for ESP_BLE_AD_TYPE_128SERVICE_DATA");
 					break;
 				}
-			} // switch
-			payload += length;
-		} // Length <> 0
-
 
-		if (sizeConsumed >= total_len)
-			finished = true;
-
-	} // !finished
+				setServiceDataUUID(BLEUUID(const_cast<uint8_t*>(data), (size_t)16, false));
+				if (length > 16) {
+					setServiceData(std::string(reinterpret_cast<const char*>(data + 16), length - 16));
+				}
+				break;
+			} //ESP_BLE_AD_TYPE_32SERVICE_DATA
+
+			default: {
+				ESP_LOGD(LOG_TAG, "Unhandled type: adType: %d - 0x%.2x", field.type, field.type);
+				break;
+			}
+		} // switch
+	} // for each AD structure
 } // parseAdvertisement
 
 
@@ -397,9 +381,7 @@ void BLEAdvertisedDevice::setAppearance(uint16_t appearance) {
 void BLEAdvertisedDevice::setManufacturerData(std::string manufacturerData) {
 	m_manufacturerData     = manufacturerData;
 	m_haveManufacturerData = true;
-	char* pHex = BLEUtils::buildHexData(nullptr, (uint8_t*) m_manufacturerData.data(), (uint8_t) m_manufacturerData.length());
-	ESP_LOGD(LOG_TAG, "- manufacturer data: %s", pHex);
-	free(pHex);
+	ESP_LOGD(LOG_TAG, "- manufacturer data: %d bytes", m_manufacturerData.length());
 } // setManufacturerData
 
 
@@ -434,6 +416,21 @@ void BLEAdvertisedDevice::setScan(BLEScan* pScan) {
 } // setScan
 
 
+/**
+ * @brief Set everything we know of this device from a stored scan result.
+ * The pay load is copied, so the device remains valid however the result table changes afterwards.
+ * @param [in] result The scan result.
+ */
+void BLEAdvertisedDevice::setScanResult(const BLEScanResult& result) {
+	setAddress(BLEAddress(const_cast<uint8_t*>(result.address)));
+	setAddressType((esp_ble_addr_type_t) result.addressType);
+	setRSSI(result.rssi);
+	parseAdvertisement(const_cast<uint8_t*>(result.payload), result.payloadLength);
+	m_payloadCopy.assign(reinterpret_cast<const char*>(result.payload), result.payloadLength);
+	m_payload = nullptr;
+} // setScanResult
+
+
 /**
  * @brief Set the Service UUID for this device.
  * @param [in] serviceUUID The discovered serviceUUID
@@ -510,6 +507,7 @@ std::string BLEAdvertisedDevice::toString() {
 } // toString
 
 uint8_t* BLEAdvertisedDevice::getPayload() {
+	if (!m_payloadCopy.empty()) return reinterpret_cast<uint8_t*>(&m_payloadCopy[0]);
 	return m_payload;
 }
 
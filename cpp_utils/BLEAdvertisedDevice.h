@@ -15,6 +15,7 @@
 
 #include "BLEAddress.h"
 #include "BLEScan.h"
+#include "BLEScanResultTable.h"
 #include "BLEUUID.h"
 
 
@@ -58,6 +59,7 @@ public:
 
 private:
 	friend class BLEScan;
+	friend class BLEScanResults;
 
 	void parseAdvertisement(uint8_t* payload, size_t total_len=62);
 	void setAddress(BLEAddress address);
@@ -68,6 +70,7 @@ private:
 	void setName(std::string name);
 	void setRSSI(int rssi);
 	void setScan(BLEScan* pScan);
+	void setScanResult(const BLEScanResult& result);
 	void setServiceData(std::string data);
 	void setServiceDataUUID(BLEUUID uuid);
 	void setServiceUUID(const char* serviceUUID);
@@ -97,6 +100,7 @@ private:
 	BLEUUID     m_serviceDataUUID;
 	uint8_t*	m_payload = nullptr;
 	size_t		m_payloadLength = 0;
+	std::string m_payloadCopy;   // The pay load of a device built from a scan result, which we own.
 	esp_ble_addr_type_t m_addressType;
 };
 
@@ -0,0 +1,137 @@
+/*
+ * BLEAdvertisementParser.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "BLEAdvertisementParser.h"
+
+
+/**
+ * @brief Get a little endian 16 bit value from the data.
+ * The data of an AD structure has no particular alignment so it is assembled a byte at a time.
+ * @param [in] offset The offset of the value in the data.
+ * @return The value or 0 if it lies beyond the data.
+ */
+uint16_t BLEAdField::getUint16(size_t offset) const {
+	if (offset + 2 > length) return 0;
+	return data[offset] | (data[offset + 1] << 8);
+} // getUint16
+
+
+/**
+ * @brief Get a little endian 32 bit value from the data.
+ * @param [in] offset The offset of the value in the data.
+ * @return The value or 0 if it lies beyond the data.
+ */
+uint32_t BLEAdField::getUint32(size_t offset) const {
+	if (offset + 4 > length) return 0;
+	return (uint32_t) data[offset] | ((uint32_t) data[offset + 1] << 8) |
+		((uint32_t) data[offset + 2] << 16) | ((uint32_t) data[offset + 3] << 24);
+} // getUint32
+
+
+BLEAdvertisementParser::Iterator::Iterator(const uint8_t* pPos, const uint8_t* pEnd) {
+	m_pPos         = pPos;
+	m_pEnd         = pEnd;
+	m_field.type   = 0;
+	m_field.length = 0;
+	m_field.data   = nullptr;
+	load();
+} // Iterator
+
+
+/**
+ * @brief Decode the structure at the current position or move to the end if there isn't a complete one.
+ */
+void BLEAdvertisementParser::Iterator::load() {
+	if (m_pPos == nullptr) return;
+	if (m_pEnd - m_pPos < 2 || m_pPos[0] == 0 || m_pPos[0] > m_pEnd - m_pPos - 1) {
+		m_pPos = nullptr;   // End of data, early terminator or a truncated structure.
+		return;
+	}
+	m_field.length = m_pPos[0] - 1;
+	m_field.type   = m_pPos[1];
+	m_field.data   = m_pPos + 2;
+} // load
+
+
+const BLEAdField& BLEAdvertisementParser::Iterator::operator*() const {
+	return m_field;
+} // operator*
+
+
+const BLEAdField* BLEAdvertisementParser::Iterator::operator->() const {
+	return &m_field;
+} // operator->
+
+
+BLEAdvertisementParser::Iterator& BLEAdvertisementParser::Iterator::operator++() {
+	if (m_pPos != nullptr) {
+		m_pPos += 1 + m_pPos[0];
+		load();
+	}
+	return *this;
+} // operator++
+
+
+bool BLEAdvertisementParser::Iterator::operator!=(const Iterator& other) const {
+	return m_pPos != other.m_pPos;
+} // operator!=
+
+
+bool BLEAdvertisementParser::Iterator::operator==(const Iterator& other) const {
+	return m_pPos == other.m_pPos;
+} // operator==
+
+
+/**
+ * @brief Create a parser over an advertisement payload.
+ * @param [in] payload The raw payload.  It must remain valid while the parser and its fields are in use.
+ * @param [in] length The length of the payload.
+ */
+BLEAdvertisementParser::BLEAdvertisementParser(const uint8_t* payload, size_t length) {
+	m_payload = payload;
+	m_length  = payload == nullptr ? 0 : length;
+} // BLEAdvertisementParser
+
+
+BLEAdvertisementParser::Iterator BLEAdvertisementParser::begin() const {
+	return Iterator(m_length == 0 ? nullptr : m_payload, m_payload + m_length);
+} // begin
+
+
+BLEAdvertisementParser::Iterator BLEAdvertisementParser::end() const {
+	return Iterator(nullptr, m_payload + m_length);
+} // end
+
+
+/**
+ * @brief Find the first structure of a given type.
+ * @param [in] type The AD type to look for.
+ * @param [out] pField The structure found.
+ * @return True if a structure of the type was found.
+ */
+bool BLEAdvertisementParser::find(uint8_t type, BLEAdField* pField) const {
+	for (Iterator it = begin(); it != end(); ++it) {
+		if (it->type == type) {
+			*pField = *it;
+			return true;
+		}
+	}
+	return false;
+} // find
+
+
+/**
+ * @brief Check that the structures account for the whole payload.
+ * Trailing zero padding after the last structure is allowed.
+ * @return True if no structure is truncated.
+ */
+bool BLEAdvertisementParser::isWellFormed() const {
+	size_t pos = 0;
+	while (pos < m_length && m_payload[pos] != 0) {
+		pos += 1 + m_payload[pos];
+	}
+	return pos <= m_length;
+} // isWellFormed
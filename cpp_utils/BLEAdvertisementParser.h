@@ -0,0 +1,70 @@
+/*
+ * BLEAdvertisementParser.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEADVERTISEMENTPARSER_H_
+#define COMPONENTS_CPP_UTILS_BLEADVERTISEMENTPARSER_H_
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief One AD structure of an advertisement: a type and the data that follows it.
+ * The data refers to the advertisement payload; nothing is copied.
+ */
+struct BLEAdField {
+	uint8_t        type;
+	uint8_t        length;   // Length of the data, not including the type.
+	const uint8_t* data;
+
+	uint16_t getUint16(size_t offset = 0) const;   // Little endian value at offset in the data.
+	uint32_t getUint32(size_t offset = 0) const;   // Little endian value at offset in the data.
+}; // BLEAdField
+
+
+/**
+ * @brief Walk the AD structures of a raw advertisement payload without allocating.
+ *
+ * An advertisement (and a scan response) is a sequence of length / type / data structures.  The parser
+ * iterates over them in place.  A structure with a length of 0 ends the data and a structure that claims
+ * to run past the end of the payload stops the iteration, so a malformed payload is never read beyond its
+ * end.
+ *
+ * @code{.cpp}
+ * for (const BLEAdField& field : BLEAdvertisementParser(payload, length)) {
+ *   if (field.type == ESP_BLE_AD_TYPE_NAME_CMPL) { ... }
+ * }
+ * @endcode
+ */
+class BLEAdvertisementParser {
+public:
+	class Iterator {
+	public:
+		Iterator(const uint8_t* pPos, const uint8_t* pEnd);
+		const BLEAdField& operator*() const;
+		const BLEAdField* operator->() const;
+		Iterator&         operator++();
+		bool              operator!=(const Iterator& other) const;
+		bool              operator==(const Iterator& other) const;
+
+	private:
+		const uint8_t* m_pPos;   // Start of the current structure or nullptr at the end.
+		const uint8_t* m_pEnd;
+		BLEAdField     m_field;
+		void           load();
+	}; // Iterator
+
+	BLEAdvertisementParser(const uint8_t* payload, size_t length);
+	Iterator begin() const;
+	Iterator end() const;
+	bool     find(uint8_t type, BLEAdField* pField) const;   // Find the first structure of a type.
+	bool     isWellFormed() const;                           // Do the structures exactly fill the payload?
+
+private:
+	const uint8_t* m_payload;
+	size_t         m_length;
+
+}; // BLEAdvertisementParser
+
+#endif /* COMPONENTS_CPP_UTILS_BLEADVERTISEMENTPARSER_H_ */
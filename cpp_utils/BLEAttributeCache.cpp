@@ -0,0 +1,241 @@
+/*
+ * BLEAttributeCache.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <string.h>
+#include <sstream>
+#include <iomanip>
+#include "BLEAttributeCache.h"
+#include "BLEClient.h"
+#include "BLERemoteCharacteristic.h"
+#include "BLERemoteDescriptor.h"
+#include "BLERemoteService.h"
+#include "CPPNVS.h"
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#define LOG_TAG ""
+#else
+#include "esp_log.h"
+static const char* LOG_TAG = "BLEAttributeCache";
+#endif
+
+// Layout of a cache entry; all values are little endian.
+//
+// version (1) | database hash (16) | service count (2) | services...
+// service:        instance id (1) | start handle (2) | end handle (2) | uuid | characteristic count (2) | characteristics...
+// characteristic: handle (2) | properties (1) | uuid | descriptor count (1) | descriptors...
+// descriptor:     handle (2) | uuid
+// uuid:           length (1) | 2, 4 or 16 bytes
+static const char*   NVS_NAMESPACE = "bleattr";
+static const uint8_t VERSION       = 1;
+
+
+/**
+ * @brief Reads values from a cache entry, failing rather than reading past its end.
+ */
+class CacheReader {
+public:
+	CacheReader(const std::string& data) : m_data(data) {
+		m_pos = 0;
+		m_ok  = true;
+	}
+
+	bool isOk() const {
+		return m_ok;
+	}
+
+	const uint8_t* getBytes(size_t length) {
+		if (!m_ok || m_data.length() - m_pos < length) {
+			m_ok = false;
+			return nullptr;
+		}
+		const uint8_t* pBytes = (const uint8_t*) m_data.data() + m_pos;
+		m_pos += length;
+		return pBytes;
+	}
+
+	uint8_t getUint8() {
+		const uint8_t* p = getBytes(1);
+		return p == nullptr ? 0 : p[0];
+	}
+
+	uint16_t getUint16() {
+		const uint8_t* p = getBytes(2);
+		return p == nullptr ? 0 : p[0] | (p[1] << 8);
+	}
+
+	BLEUUID getUUID() {
+		esp_bt_uuid_t uuid;
+		::memset(&uuid, 0, sizeof(uuid));
+		uuid.len = getUint8();
+		if (uuid.len != ESP_UUID_LEN_16 && uuid.len != ESP_UUID_LEN_32 && uuid.len != ESP_UUID_LEN_128) {
+			m_ok = false;
+			return BLEUUID();
+		}
+		const uint8_t* p = getBytes(uuid.len);
+		if (p != nullptr) ::memcpy(&uuid.uuid, p, uuid.len);
+		return BLEUUID(uuid);
+	}
+
+private:
+	const std::string& m_data;
+	size_t             m_pos;
+	bool               m_ok;
+}; // CacheReader
+
+
+static void putUint8(std::string& data, uint8_t value) {
+	data.push_back((char) value);
+} // putUint8
+
+
+static void putUint16(std::string& data, uint16_t value) {
+	data.push_back((char) (value & 0xff));
+	data.push_back((char) (value >> 8));
+} // putUint16
+
+
+static void putUUID(std::string& data, BLEUUID uuid) {
+	esp_bt_uuid_t* pUUID = uuid.getNative();
+	putUint8(data, pUUID->len);
+	data.append((const char*) &pUUID->uuid, pUUID->len);
+} // putUUID
+
+
+/**
+ * @brief Forget the cached attributes of a peer.
+ * @param [in] address The address of the peer.
+ */
+void BLEAttributeCache::erase(BLEAddress address) {
+	NVS nvs(NVS_NAMESPACE);
+	nvs.erase(getKey(address));
+	nvs.commit();
+} // erase
+
+
+/**
+ * @brief Get the %NVS key of a peer; its address as 12 hex digits.
+ */
+std::string BLEAttributeCache::getKey(BLEAddress address) {
+	std::ostringstream ss;
+	uint8_t* pAddress = *address.getNative();
+	for (int i = 0; i < 6; i++) {
+		ss << std::hex << std::setfill('0') << std::setw(2) << (int) pAddress[i];
+	}
+	return ss.str();
+} // getKey
+
+
+/**
+ * @brief Build the attribute tree of the client's peer from the cache.
+ * @param [in] pClient The client, which must have no services.
+ * @param [in] hash The Database Hash just read from the peer.
+ * @return True if the cache held the peer's attributes for this hash and the tree was built.
+ */
+bool BLEAttributeCache::load(BLEClient* pClient, const uint8_t* hash) {
+	std::string data;
+	{
+		NVS nvs(NVS_NAMESPACE);
+		if (nvs.get(getKey(pClient->getPeerAddress()), &data, true) != ESP_OK) return false;
+	}
+
+	CacheReader reader(data);
+	if (reader.getUint8() != VERSION) return false;
+	const uint8_t* cachedHash = reader.getBytes(HASH_LENGTH);
+	if (cachedHash == nullptr || ::memcmp(cachedHash, hash, HASH_LENGTH) != 0) {
+		ESP_LOGD(LOG_TAG, "Database Hash of %s has changed", pClient->getPeerAddress().toString().c_str());
+		return false;
+	}
+
+	uint16_t serviceCount = reader.getUint16();
+	for (uint16_t i = 0; i < serviceCount && reader.isOk(); i++) {
+		esp_gatt_id_t srvcId;
+		srvcId.inst_id          = reader.getUint8();
+		uint16_t startHandle    = reader.getUint16();
+		uint16_t endHandle      = reader.getUint16();
+		srvcId.uuid             = *reader.getUUID().getNative();
+		uint16_t characteristicCount = reader.getUint16();
+		if (!reader.isOk()) break;
+
+		BLERemoteService* pService = new BLERemoteService(srvcId, pClient, startHandle, endHandle);
+		pClient->m_servicesMap.insert(std::pair<std::string, BLERemoteService*>(pService->getUUID().toString(), pService));
+		pClient->m_servicesMapByInstID.insert(std::pair<BLERemoteService*, uint16_t>(pService, srvcId.inst_id));
+
+		for (uint16_t j = 0; j < characteristicCount && reader.isOk(); j++) {
+			uint16_t handle          = reader.getUint16();
+			esp_gatt_char_prop_t properties = (esp_gatt_char_prop_t) reader.getUint8();
+			BLEUUID uuid             = reader.getUUID();
+			uint8_t descriptorCount  = reader.getUint8();
+			if (!reader.isOk()) break;
+
+			BLERemoteCharacteristic* pCharacteristic = new BLERemoteCharacteristic(handle, uuid, properties, pService);
+			pService->m_characteristicMap.insert(std::pair<std::string, BLERemoteCharacteristic*>(uuid.toString(), pCharacteristic));
+			pService->m_characteristicMapByHandle.insert(std::pair<uint16_t, BLERemoteCharacteristic*>(handle, pCharacteristic));
+
+			for (uint8_t k = 0; k < descriptorCount && reader.isOk(); k++) {
+				uint16_t descriptorHandle = reader.getUint16();
+				BLEUUID descriptorUUID    = reader.getUUID();
+				if (!reader.isOk()) break;
+				BLERemoteDescriptor* pDescriptor = new BLERemoteDescriptor(descriptorHandle, descriptorUUID, pCharacteristic);
+				pCharacteristic->m_descriptorMap.insert(std::pair<std::string, BLERemoteDescriptor*>(descriptorUUID.toString(), pDescriptor));
+			}
+		}
+		pService->m_haveCharacteristics = true;
+		pClient->indexCharacteristics(pService);
+	}
+
+	if (!reader.isOk()) {
+		ESP_LOGE(LOG_TAG, "Cache entry of %s is corrupt", pClient->getPeerAddress().toString().c_str());
+		pClient->clearServices();
+		erase(pClient->getPeerAddress());
+		return false;
+	}
+	ESP_LOGD(LOG_TAG, "Loaded %d services of %s from the cache", serviceCount, pClient->getPeerAddress().toString().c_str());
+	return true;
+} // load
+
+
+/**
+ * @brief Store the attribute tree of the client's peer in the cache.
+ * The characteristics and descriptors of every service are retrieved first if need be.  These come from the
+ * BLE stack's own record of the discovery, so no requests are made of the peer.
+ * @param [in] pClient The client, whose services have been discovered.
+ * @param [in] hash The Database Hash of the peer.
+ */
+void BLEAttributeCache::save(BLEClient* pClient, const uint8_t* hash) {
+	std::string data;
+	putUint8(data, VERSION);
+	data.append((const char*) hash, HASH_LENGTH);
+	putUint16(data, pClient->m_servicesMap.size());
+	for (auto &servicePair : pClient->m_servicesMap) {
+		BLERemoteService* pService = servicePair.second;
+		if (!pService->m_haveCharacteristics) pService->retrieveCharacteristics();
+
+		putUint8(data, pService->getSrvcId()->inst_id);
+		putUint16(data, pService->getStartHandle());
+		putUint16(data, pService->getEndHandle());
+		putUUID(data, pService->getUUID());
+		putUint16(data, pService->m_characteristicMapByHandle.size());
+		for (auto &characteristicPair : pService->m_characteristicMapByHandle) {
+			BLERemoteCharacteristic* pCharacteristic = characteristicPair.second;
+			putUint16(data, pCharacteristic->getHandle());
+			putUint8(data, pCharacteristic->m_charProp);
+			putUUID(data, pCharacteristic->getUUID());
+			putUint8(data, pCharacteristic->m_descriptorMap.size());
+			for (auto &descriptorPair : pCharacteristic->m_descriptorMap) {
+				putUint16(data, descriptorPair.second->getHandle());
+				putUUID(data, descriptorPair.second->getUUID());
+			}
+		}
+	}
+
+	NVS nvs(NVS_NAMESPACE);
+	nvs.set(getKey(pClient->getPeerAddress()), data, true);
+	nvs.commit();
+	ESP_LOGD(LOG_TAG, "Saved %d bytes of attributes of %s", data.length(), pClient->getPeerAddress().toString().c_str());
+} // save
+
+#endif /* CONFIG_BT_ENABLED */
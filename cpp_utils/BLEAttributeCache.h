@@ -0,0 +1,41 @@
+/*
+ * BLEAttributeCache.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEATTRIBUTECACHE_H_
+#define COMPONENTS_CPP_UTILS_BLEATTRIBUTECACHE_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <string>
+#include "BLEAddress.h"
+
+class BLEClient;
+
+/**
+ * @brief A persistent cache of the attributes (services, characteristics and descriptors) of peers.
+ *
+ * The attribute tree discovered from a peer is stored in %NVS in a compact binary form, keyed by the address
+ * of the peer, together with the peer's Database Hash (the GATT characteristic 0x2B2A).  On a later
+ * connection the client reads the Database Hash, a single request, and if it matches builds the tree from
+ * the cache without any discovery.  A peer without a Database Hash is never cached since there would be no
+ * way of telling that its attributes had changed.
+ *
+ * The address is the key, so the cache is only of use for peers with a stable address such as bonded ones.
+ */
+class BLEAttributeCache {
+public:
+	static const size_t HASH_LENGTH = 16;
+
+	static void erase(BLEAddress address);
+	static bool load(BLEClient* pClient, const uint8_t* hash);
+	static void save(BLEClient* pClient, const uint8_t* hash);
+
+private:
+	static std::string getKey(BLEAddress address);
+
+}; // BLEAttributeCache
+
+#endif /* CONFIG_BT_ENABLED */
+#endif /* COMPONENTS_CPP_UTILS_BLEATTRIBUTECACHE_H_ */
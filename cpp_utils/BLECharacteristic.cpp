@@ -193,6 +193,15 @@ uint8_t* BLECharacteristic::getData() {
 } // getData
 
 
+/**
+ * @brief Refer to the current value of the characteristic without copying it.
+ * @return The current value, valid until the value has been replaced twice.
+ */
+BLEValue::Span BLECharacteristic::getValueSpan() {
+	return m_value.getSpan();
+} // getValueSpan
+
+
 /**
  * Handle a GATT server event.
  */
@@ -371,19 +380,20 @@ void BLECharacteristic::handleGATTServerEvent(
 					esp_gatt_rsp_t rsp;
 
 					if (param->read.is_long) {
-						std::string value = m_value.getValue();
+						BLEValue::Span value = m_value.getPinned();   // The value pinned by the first response.
 
-						if (value.length() - m_value.getReadOffset() < maxOffset) {
+						if (value.length - m_value.getReadOffset() < maxOffset) {
 							// This is the last in the chain
-							rsp.attr_value.len    = value.length() - m_value.getReadOffset();
+							rsp.attr_value.len    = value.length - m_value.getReadOffset();
 							rsp.attr_value.offset = m_value.getReadOffset();
-							memcpy(rsp.attr_value.value, value.data() + rsp.attr_value.offset, rsp.attr_value.len);
+							memcpy(rsp.attr_value.value, value.pData + rsp.attr_value.offset, rsp.attr_value.len);
 							m_value.setReadOffset(0);
+							m_value.unpin();
 						} else {
 							// There will be more to come.
 							rsp.attr_value.len    = maxOffset;
 							rsp.attr_value.offset = m_value.getReadOffset();
-							memcpy(rsp.attr_value.value, value.data() + rsp.attr_value.offset, rsp.attr_value.len);
+							memcpy(rsp.attr_value.value, value.pData + rsp.attr_value.offset, rsp.attr_value.len);
 							m_value.setReadOffset(rsp.attr_value.offset + maxOffset);
 						}
 					} else { // read.is_long == false
@@ -391,19 +401,23 @@ void BLECharacteristic::handleGATTServerEvent(
 						if (m_pCallbacks != nullptr) {  // If is.long is false then this is the first (or only) request to read data, so invoke the callback
 							m_pCallbacks->onRead(this);   // Invoke the read callback.
 						}
-						std::string value = m_value.getValue();
+						BLEValue::Span value = m_value.getSpan();
+						if (value.length + 1 > maxOffset) {
+							value = m_value.pin();   // So that the follow on requests return the rest of this value.
+						}
 
-						if (value.length() + 1 > maxOffset) {
+						if (value.length + 1 > maxOffset) {
 							// Too big for a single shot entry.
 							m_value.setReadOffset(maxOffset);
 							rsp.attr_value.len    = maxOffset;
 							rsp.attr_value.offset = 0;
-							memcpy(rsp.attr_value.value, value.data(), rsp.attr_value.len);
+							memcpy(rsp.attr_value.value, value.pData, rsp.attr_value.len);
 						} else {
 							// Will fit in a single packet with no callbacks required.
-							rsp.attr_value.len    = value.length();
+							m_value.unpin();
+							rsp.attr_value.len    = value.length;
 							rsp.attr_value.offset = 0;
-							memcpy(rsp.attr_value.value, value.data(), rsp.attr_value.len);
+							if (value.length > 0) memcpy(rsp.attr_value.value, value.pData, rsp.attr_value.len);
 						}
 
 						// if (m_pCallbacks != nullptr) {  // If is.long is false then this is the first (or only) request to read data, so invoke the callback
@@ -475,7 +489,7 @@ void BLECharacteristic::handleGATTServerEvent(
  */
 void BLECharacteristic::indicate() {
 
-	ESP_LOGD(LOG_TAG, ">> indicate: length: %d", m_value.getValue().length());
+	ESP_LOGD(LOG_TAG, ">> indicate: length: %d", m_value.getLength());
 	notify(false);
 	ESP_LOGD(LOG_TAG, "<< indicate");
 } // indicate
@@ -488,12 +502,13 @@ void BLECharacteristic::indicate() {
  * @return N/A.
  */
 void BLECharacteristic::notify(bool is_notification) {
-	ESP_LOGD(LOG_TAG, ">> notify: length: %d", m_value.getValue().length());
+	BLEValue::Span value = m_value.getSpan();
+	ESP_LOGD(LOG_TAG, ">> notify: length: %d", value.length);
 
 	assert(getService() != nullptr);
 	assert(getService()->getServer() != nullptr);
 
-	GeneralUtils::hexDump((uint8_t*)m_value.getValue().data(), m_value.getValue().length());
+	GeneralUtils::hexDump(value.pData, value.length);
 
 	if (getService()->getServer()->getConnectedCount() == 0) {
 		ESP_LOGD(LOG_TAG, "<< notify: No connected clients.");
@@ -522,17 +537,17 @@ void BLECharacteristic::notify(bool is_notification) {
 	}
 	for (auto &myPair : getService()->getServer()->getPeerDevices(false)) {
 		uint16_t _mtu = (myPair.second.mtu);
-		if (m_value.getValue().length() > _mtu - 3) {
+		if (value.length > _mtu - 3) {
 			ESP_LOGW(LOG_TAG, "- Truncating to %d bytes (maximum notify size)", _mtu - 3);
 		}
 
-		size_t length = m_value.getValue().length();
+		size_t length = value.length;
 		if(!is_notification)
 			m_semaphoreConfEvt.take("indicate");
 		esp_err_t errRc = ::esp_ble_gatts_send_indicate(
 				getService()->getServer()->getGattsIf(),
 				myPair.first,
-				getHandle(), length, (uint8_t*)m_value.getValue().data(), !is_notification); // The need_confirm = false makes this a notify.
+				getHandle(), length, (uint8_t*)value.pData, !is_notification); // The need_confirm = false makes this a notify.
 		if (errRc != ESP_OK) {
 			ESP_LOGE(LOG_TAG, "<< esp_ble_gatts_send_ %s: rc=%d %s",is_notification?"notify":"indicate", errRc, GeneralUtils::errorToString(errRc));
 			m_semaphoreConfEvt.give();
@@ -545,6 +560,80 @@ void BLECharacteristic::notify(bool is_notification) {
 } // Notify
 
 
+/**
+ * @brief Queue a notification or indication of the current value to every connected client.
+ * Unlike notify(), this doesn't wait for indications to be confirmed.  The value is copied into the
+ * server's notification queue and sent as fast as each connection allows.  In latest value wins mode the
+ * value replaces any value of this characteristic that is still waiting to be sent.
+ *
+ * @code{.cpp}
+ * pCharacteristic->setValue(reading);
+ * pCharacteristic->queueNotify();
+ * @endcode
+ *
+ * @param [in] is_notification True for a notification, false for an indication.
+ * @param [in] latestValueWins True if an older value still waiting should be replaced.
+ * @return True if the value was queued for every client that has enabled it.
+ */
+bool BLECharacteristic::queueNotify(bool is_notification, bool latestValueWins) {
+	assert(getService() != nullptr);
+	assert(getService()->getServer() != nullptr);
+
+	BLE2902* p2902 = (BLE2902*)getDescriptorByUUID((uint16_t)0x2902);
+	if (p2902 == nullptr) {
+		ESP_LOGE(LOG_TAG, "Characteristic without 0x2902 descriptor");
+		return false;
+	}
+	if (is_notification ? !p2902->getNotifications() : !p2902->getIndications()) {
+		return true;   // Nobody wants it, nothing to do.
+	}
+
+	BLEServer* pServer = getService()->getServer();
+	BLEValue::Span value = m_value.getSpan();
+	bool queued = true;
+	for (auto &myPair : pServer->getPeerDevices(false)) {
+		if (!pServer->getNotificationQueue()->queue(myPair.first, getHandle(), value.pData, value.length, !is_notification, latestValueWins)) {
+			queued = false;
+		}
+	}
+	return queued;
+} // queueNotify
+
+
+/**
+ * @brief Make a buffer owned by the application the value of the characteristic without copying it.
+ * Reads and notifications refer to the buffer directly, so it must not be changed until a later value has
+ * replaced it; alternating between two buffers meets this.
+ *
+ * @code{.cpp}
+ * static uint8_t frames[2][512];
+ * fill(frames[n]);
+ * pCharacteristic->publishValue(frames[n], sizeof(frames[n]));
+ * pCharacteristic->queueNotify();
+ * n = 1 - n;
+ * @endcode
+ *
+ * @param [in] data The value.
+ * @param [in] length The length of the value in bytes.
+ */
+void BLECharacteristic::publishValue(const uint8_t* data, size_t length) {
+	if (length > ESP_GATT_MAX_ATTR_LEN) {
+		ESP_LOGE(LOG_TAG, "Size %d too large, must be no bigger than %d", length, ESP_GATT_MAX_ATTR_LEN);
+		return;
+	}
+	m_value.publish(data, length);
+} // publishValue
+
+
+/**
+ * @brief Allocate storage for the value up front so that setting values up to a given length never allocates.
+ * @param [in] capacity The largest value expected.
+ */
+void BLECharacteristic::reserveValue(size_t capacity) {
+	m_value.reserve(capacity);
+} // reserveValue
+
+
 /**
  * @brief Set the permission to broadcast.
  * A characteristics has properties associated with it which define what it is capable of doing.
@@ -38,9 +38,9 @@ public:
 	BLEDescriptor* getFirst();
 	BLEDescriptor* getNext();
 private:
-	std::map<BLEDescriptor*, std::string> m_uuidMap;
+	std::map<BLEDescriptor*, BLEUUID> m_uuidMap;
 	std::map<uint16_t, BLEDescriptor*> m_handleMap;
-	std::map<BLEDescriptor*, std::string>::iterator m_iterator;
+	std::map<BLEDescriptor*, BLEUUID>::iterator m_iterator;
 };
 
 
@@ -61,10 +61,14 @@ public:
 	BLEDescriptor* getDescriptorByUUID(BLEUUID descriptorUUID);
 	BLEUUID        getUUID();
 	std::string    getValue();
+	BLEValue::Span getValueSpan();
 	uint8_t*       getData();
 
 	void indicate();
 	void notify(bool is_notification = true);
+	void publishValue(const uint8_t* data, size_t length);
+	bool queueNotify(bool is_notification = true, bool latestValueWins = true);
+	void reserveValue(size_t capacity);
 	void setBroadcastProperty(bool value);
 	void setCallbacks(BLECharacteristicCallbacks* pCallbacks);
 	void setIndicateProperty(bool value);
@@ -40,13 +40,9 @@ BLECharacteristic* BLECharacteristicMap::getByUUID(const char* uuid) {
  * @return The characteristic.
  */
 BLECharacteristic* BLECharacteristicMap::getByUUID(BLEUUID uuid) {
-	for (auto &myPair : m_uuidMap) {
-		if (myPair.first->getUUID().equals(uuid)) {
-			return myPair.first;
-		}
-	}
-	//return m_uuidMap.at(uuid.toString());
-	return nullptr;
+	auto it = m_uuidMap.lower_bound(uuid);   // The first added of any sharing the UUID.
+	if (it == m_uuidMap.end() || it->first != uuid) return nullptr;
+	return it->second;
 } // getByUUID
 
 
@@ -55,9 +51,9 @@ BLECharacteristic* BLECharacteristicMap::getByUUID(BLEUUID uuid) {
  * @return The first characteristic in the map.
  */
 BLECharacteristic* BLECharacteristicMap::getFirst() {
-	m_iterator = m_uuidMap.begin();
-	if (m_iterator == m_uuidMap.end()) return nullptr;
-	BLECharacteristic* pRet = m_iterator->first;
+	m_iterator = m_characteristics.begin();
+	if (m_iterator == m_characteristics.end()) return nullptr;
+	BLECharacteristic* pRet = *m_iterator;
 	m_iterator++;
 	return pRet;
 } // getFirst
@@ -68,8 +64,8 @@ BLECharacteristic* BLECharacteristicMap::getFirst() {
  * @return The next characteristic in the map.
  */
 BLECharacteristic* BLECharacteristicMap::getNext() {
-	if (m_iterator == m_uuidMap.end()) return nullptr;
-	BLECharacteristic* pRet = m_iterator->first;
+	if (m_iterator == m_characteristics.end()) return nullptr;
+	BLECharacteristic* pRet = *m_iterator;
 	m_iterator++;
 	return pRet;
 } // getNext
@@ -83,8 +79,8 @@ BLECharacteristic* BLECharacteristicMap::getNext() {
  */
 void BLECharacteristicMap::handleGATTServerEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param) {
 	// Invoke the handler for every Service we have.
-	for (auto& myPair : m_uuidMap) {
-		myPair.first->handleGATTServerEvent(event, gatts_if, param);
+	for (auto pCharacteristic : m_characteristics) {
+		pCharacteristic->handleGATTServerEvent(event, gatts_if, param);
 	}
 } // handleGATTServerEvent
 
@@ -107,7 +103,8 @@ void BLECharacteristicMap::setByHandle(uint16_t handle, BLECharacteristic* chara
  * @return N/A.
  */
 void BLECharacteristicMap::setByUUID(BLECharacteristic* pCharacteristic, BLEUUID uuid) {
-	m_uuidMap.insert(std::pair<BLECharacteristic*, std::string>(pCharacteristic, uuid.toString()));
+	m_uuidMap.insert(std::pair<BLEUUID, BLECharacteristic*>(uuid, pCharacteristic));
+	m_characteristics.push_back(pCharacteristic);
 } // setByUUID
 
 
@@ -119,12 +116,12 @@ std::string BLECharacteristicMap::toString() {
 	std::stringstream stringStream;
 	stringStream << std::hex << std::setfill('0');
 	int count = 0;
-	for (auto &myPair: m_uuidMap) {
+	for (auto pCharacteristic : m_characteristics) {
 		if (count > 0) {
 			stringStream << "\n";
 		}
 		count++;
-		stringStream << "handle: 0x" << std::setw(2) << myPair.first->getHandle() << ", uuid: " + myPair.first->getUUID().toString();
+		stringStream << "handle: 0x" << std::setw(2) << pCharacteristic->getHandle() << ", uuid: " + pCharacteristic->getUUID().toString();
 	}
 	return stringStream.str();
 } // toString
@@ -17,7 +17,9 @@
 #include <string>
 #include <sstream>
 #include <unordered_set>
+#include <algorithm>
 #include "BLEDevice.h"
+#include "BLEAttributeCache.h"
 #if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
 #include "esp32-hal-log.h"
 #define LOG_TAG ""
@@ -48,12 +50,14 @@ static const char* LOG_TAG = "BLEClient";
  *
  */
 
-BLEClient::BLEClient() {
+BLEClient::BLEClient() : m_operationQueue(this) {
 	m_pClientCallbacks = nullptr;
 	m_conn_id          = ESP_GATT_IF_NONE;
 	m_gattc_if         = ESP_GATT_IF_NONE;
 	m_haveServices     = false;
 	m_isConnected      = false;  // Initially, we are flagged as not connected.
+	::memset(&m_dispatchStats, 0, sizeof(m_dispatchStats));
+	pthread_mutex_init(&m_indexLock, nullptr);
 
 
 	m_appId = BLEDevice::m_appId++;
@@ -83,6 +87,7 @@ BLEClient::~BLEClient() {
 	BLEDevice::removePeerDevice(m_appId, true);
 	if(m_deleteCallbacks)
 		delete m_pClientCallbacks;
+	pthread_mutex_destroy(&m_indexLock);
 
 } // ~BLEClient
 
@@ -93,7 +98,9 @@ BLEClient::~BLEClient() {
  */
 void BLEClient::clearServices() {
 	ESP_LOGD(LOG_TAG, ">> clearServices");
-	// Delete all the services.
+	// Delete all the services, once the event task can no longer find their characteristics.
+	std::vector<std::pair<uint16_t, BLERemoteCharacteristic*>> index;
+	swapCharacteristicIndex(index);
 	for (auto &myPair : m_servicesMap) {
 	   delete myPair.second;
 	}
@@ -169,6 +176,9 @@ void BLEClient::gattClientEventHandler(
 	ESP_LOGD(LOG_TAG, "gattClientEventHandler [esp_gatt_if: %d] ... %s",
 		gattc_if, BLEUtils::gattClientEventTypeToString(event).c_str());
 
+	// Completions of queued operations are consumed by the queue, which starts the next one straight away.
+	if (m_operationQueue.handleGATTClientEvent(event, gattc_if, evtParam)) return;
+
 	// Execute handler code based on the type of event received.
 	switch(event) {
 
@@ -177,6 +187,7 @@ void BLEClient::gattClientEventHandler(
 				break;
 
 			ESP_LOGI(LOG_TAG, "SERVICE CHANGED");
+			if (m_attributeCache) BLEAttributeCache::erase(m_peerAddress);
 			break;
 
 		case ESP_GATTC_CLOSE_EVT: 
@@ -241,6 +252,7 @@ void BLEClient::gattClientEventHandler(
 			if(m_appId == evtParam->reg.app_id){
 				ESP_LOGI(__func__, "register app id: %d, %d, gattc_if: %d", m_appId, evtParam->reg.app_id, gattc_if);
 				m_gattc_if = gattc_if;
+				m_operationQueue.setGattcIf(gattc_if);
 				m_semaphoreRegEvt.give();
 			}
 			break;
@@ -325,19 +337,116 @@ void BLEClient::gattClientEventHandler(
 		} // ESP_GATTC_SEARCH_RES_EVT
 
 
+		//
+		// ESP_GATTC_READ_CHAR_EVT
+		//
+		// The response to our read by type of the Database Hash; the characteristics are told of any other reads.
+		//
+		case ESP_GATTC_READ_CHAR_EVT: {
+			if (m_gattc_if != gattc_if || !m_readingHash) break;
+			m_readingHash = false;
+			if (evtParam->read.status == ESP_GATT_OK && evtParam->read.value_len == BLEAttributeCache::HASH_LENGTH) {
+				::memcpy(m_databaseHash, evtParam->read.value, BLEAttributeCache::HASH_LENGTH);
+				m_semaphoreReadHashEvt.give(0);
+			} else {
+				m_semaphoreReadHashEvt.give(1);
+			}
+			return;
+		} // ESP_GATTC_READ_CHAR_EVT
+
 		default: {
 			break;
 		}
 	} // Switch
 
-	// Pass the request on to all services.
-	for (auto &myPair : m_servicesMap) {
-	   myPair.second->gattClientEventHandler(event, gattc_if, evtParam);
+	// Events about a characteristic go straight to it through the handle index.  Anything else is passed on
+	// to all services.
+	m_dispatchStats.events++;
+	uint16_t handle;
+	switch(event) {
+		case ESP_GATTC_NOTIFY_EVT:           handle = evtParam->notify.handle;           break;
+		case ESP_GATTC_READ_CHAR_EVT:        handle = evtParam->read.handle;             break;
+		case ESP_GATTC_WRITE_CHAR_EVT:       handle = evtParam->write.handle;            break;
+		case ESP_GATTC_REG_FOR_NOTIFY_EVT:   handle = evtParam->reg_for_notify.handle;   break;
+		case ESP_GATTC_UNREG_FOR_NOTIFY_EVT: handle = evtParam->unreg_for_notify.handle; break;
+		default: {
+			m_dispatchStats.broadcasts++;
+			for (auto &myPair : m_servicesMap) {
+			   myPair.second->gattClientEventHandler(event, gattc_if, evtParam);
+			}
+			return;
+		}
+	} // switch
+	m_dispatchStats.indexed++;
+	BLERemoteCharacteristic* pCharacteristic = findCharacteristic(handle);
+	if (pCharacteristic == nullptr) {
+		m_dispatchStats.misses++;
+		return;
 	}
+	pCharacteristic->gattClientEventHandler(event, gattc_if, evtParam);
 
 } // gattClientEventHandler
 
 
+/**
+ * @brief Read several characteristics of the peer in one request without waiting for the result.
+ * The request is an ATT Read Multiple, which returns the values concatenated, so it is only of use when the
+ * lengths of all but the last value are known.  Where the peer doesn't support Read Multiple, the values are
+ * read one at a time and concatenated in the same way.
+ * @param [in] pCharacteristics The characteristics to read.
+ * @param [in] count The number of characteristics; between 2 and ESP_GATT_MAX_READ_MULTI_HANDLES.
+ * @param [in] callback Invoked from the BLE event task with the values.
+ * @param [in] pArg Passed to the callback.
+ * @return True if the read was queued.
+ */
+bool BLEClient::readValuesAsync(BLERemoteCharacteristic** pCharacteristics, size_t count, read_multiple_callback callback, void* pArg) {
+	if (count > ESP_GATT_MAX_READ_MULTI_HANDLES) count = ESP_GATT_MAX_READ_MULTI_HANDLES + 1;   // Refused by the queue.
+	uint16_t handles[ESP_GATT_MAX_READ_MULTI_HANDLES + 1];
+	for (size_t i = 0; i < count; i++) {
+		handles[i] = pCharacteristics[i]->getHandle();
+	}
+	return m_operationQueue.readMultiple(handles, count, callback, pArg);
+} // readValuesAsync
+
+
+/**
+ * @brief Find a characteristic of the peer by its handle.
+ * Called from the event task while the application may be discovering services, so the index is searched
+ * under its lock.
+ * @param [in] handle The handle of the characteristic.
+ * @return The characteristic or nullptr if it isn't one we know of.
+ */
+BLERemoteCharacteristic* BLEClient::findCharacteristic(uint16_t handle) {
+	BLERemoteCharacteristic* pCharacteristic = nullptr;
+	pthread_mutex_lock(&m_indexLock);
+	size_t low  = 0;
+	size_t high = m_characteristicIndex.size();
+	while (low < high) {   // Binary search for the first entry not less than the handle.
+		m_dispatchStats.probes++;
+		size_t middle = (low + high) / 2;
+		if (m_characteristicIndex[middle].first < handle) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	if (low < m_characteristicIndex.size() && m_characteristicIndex[low].first == handle) {
+		pCharacteristic = m_characteristicIndex[low].second;
+	}
+	pthread_mutex_unlock(&m_indexLock);
+	return pCharacteristic;
+} // findCharacteristic
+
+
+/**
+ * @brief Get counts of how GATT client events have been dispatched.
+ * @return The counts since the client was created.
+ */
+BLEClientDispatchStats BLEClient::getDispatchStats() {
+	return m_dispatchStats;
+} // getDispatchStats
+
+
 uint16_t BLEClient::getConnId() {
 	return m_conn_id;
 } // getConnId
@@ -411,9 +520,8 @@ BLERemoteService* BLEClient::getService(BLEUUID uuid) {
 	if (!m_haveServices) {
 		getServices();
 	}
-	std::string uuidStr = uuid.toString();
 	for (auto &myPair : m_servicesMap) {
-		if (myPair.first == uuidStr) {
+		if (myPair.second->getUUID().equals(uuid)) {
 			ESP_LOGD(LOG_TAG, "<< getService: found the service with uuid: %s", uuid.toString().c_str());
 			return myPair.second;
 		}
@@ -438,9 +546,17 @@ std::map<std::string, BLERemoteService*>* BLEClient::getServices() {
  * and will culminate with an ESP_GATTC_SEARCH_CMPL_EVT when all have been received.
  */
 	ESP_LOGD(LOG_TAG, ">> getServices");
-// TODO implement retrieving services from cache
 	clearServices(); // Clear any services that may exist.
 
+	// If the peer's Database Hash is the one we cached its attributes with, they haven't changed and we
+	// can skip discovery altogether.
+	bool haveHash = m_attributeCache && readDatabaseHash();
+	if (haveHash && BLEAttributeCache::load(this, m_databaseHash)) {
+		m_haveServices = true;
+		ESP_LOGD(LOG_TAG, "<< getServices: from cache");
+		return &m_servicesMap;
+	}
+
 	esp_err_t errRc = esp_ble_gattc_search_service(
 		getGattcIf(),
 		getConnId(),
@@ -454,6 +570,9 @@ std::map<std::string, BLERemoteService*>* BLEClient::getServices() {
 	}
 	// If sucessfull, remember that we now have services.
 	m_haveServices = (m_semaphoreSearchCmplEvt.wait("getServices") == 0);
+	if (m_haveServices && haveHash) {
+		BLEAttributeCache::save(this, m_databaseHash);
+	}
 	ESP_LOGD(LOG_TAG, "<< getServices");
 	return &m_servicesMap;
 } // getServices
@@ -503,6 +622,54 @@ void BLEClient::handleGAPEvent(
 } // handleGAPEvent
 
 
+/**
+ * @brief Read the Database Hash of the peer into m_databaseHash.
+ * The hash is read by type (0x2B2A) since we don't know its handle before discovery.
+ * @return True if the peer has a Database Hash and it was read.
+ */
+bool BLEClient::readDatabaseHash() {
+	esp_bt_uuid_t uuid;
+	uuid.len = ESP_UUID_LEN_16;
+	uuid.uuid.uuid16 = 0x2B2A;
+
+	m_semaphoreReadHashEvt.take("readDatabaseHash");
+	m_readingHash = true;
+	esp_err_t errRc = ::esp_ble_gattc_read_by_type(getGattcIf(), getConnId(), 0x0001, 0xFFFF, &uuid, ESP_GATT_AUTH_REQ_NONE);
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "esp_ble_gattc_read_by_type: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+		m_readingHash = false;
+		m_semaphoreReadHashEvt.give();
+		return false;
+	}
+	bool haveHash = (m_semaphoreReadHashEvt.wait("readDatabaseHash") == 0);
+	ESP_LOGD(LOG_TAG, "readDatabaseHash: %s", haveHash ? "read" : "not available");
+	return haveHash;
+} // readDatabaseHash
+
+
+/**
+ * @brief Add the characteristics of a service to the handle index.
+ * Called once the characteristics of the service have been retrieved.  The new index is built aside and
+ * swapped in whole, so the event task never searches one that is half built.
+ * @param [in] pService The service.
+ */
+void BLEClient::indexCharacteristics(BLERemoteService* pService) {
+	std::vector<std::pair<uint16_t, BLERemoteCharacteristic*>> index;
+	pthread_mutex_lock(&m_indexLock);
+	index.reserve(m_characteristicIndex.size() + pService->m_characteristicMapByHandle.size());
+	for (auto &myPair : m_characteristicIndex) {
+		if (myPair.second->getRemoteService() != pService) index.push_back(myPair);
+	}
+	pthread_mutex_unlock(&m_indexLock);
+
+	for (auto &myPair : pService->m_characteristicMapByHandle) {
+		index.push_back(myPair);
+	}
+	std::sort(index.begin(), index.end());
+	swapCharacteristicIndex(index);
+} // indexCharacteristics
+
+
 /**
  * @brief Are we connected to a partner?
  * @return True if we are connected and false if we are not connected.
@@ -514,6 +681,18 @@ bool BLEClient::isConnected() {
 
 
 
+/**
+ * @brief Cache the attributes of the peer in %NVS.
+ * When enabled, the services, characteristics and descriptors discovered from a peer that has a Database
+ * Hash are saved, and on later connections they are loaded from the cache instead of being discovered as
+ * long as the peer's Database Hash is unchanged.  Only of use for peers with a stable address.
+ * @param [in] enabled True to use the cache.
+ */
+void BLEClient::setAttributeCache(bool enabled) {
+	m_attributeCache = enabled;
+} // setAttributeCache
+
+
 /**
  * @brief Set the callbacks that will be invoked.
  */
@@ -539,6 +718,34 @@ uint16_t BLEClient::getMTU() {
 	return m_mtu;
 }
 
+
+/**
+ * @brief Replace the handle index.
+ * @param [in] index The new index, sorted by handle.  It is left holding the old one.
+ */
+void BLEClient::swapCharacteristicIndex(std::vector<std::pair<uint16_t, BLERemoteCharacteristic*>>& index) {
+	pthread_mutex_lock(&m_indexLock);
+	m_characteristicIndex.swap(index);
+	pthread_mutex_unlock(&m_indexLock);
+} // swapCharacteristicIndex
+
+
+/**
+ * @brief Remove the characteristics of a service from the handle index.
+ * Called before they are deleted; like indexCharacteristics(), the new index is built aside and swapped in.
+ * @param [in] pService The service.
+ */
+void BLEClient::unindexCharacteristics(BLERemoteService* pService) {
+	std::vector<std::pair<uint16_t, BLERemoteCharacteristic*>> index;
+	pthread_mutex_lock(&m_indexLock);
+	for (auto &myPair : m_characteristicIndex) {
+		if (myPair.second->getRemoteService() != pService) index.push_back(myPair);
+	}
+	pthread_mutex_unlock(&m_indexLock);
+	swapCharacteristicIndex(index);
+} // unindexCharacteristics
+
+
 /**
  * @brief Return a string representation of this client.
  * @return A string representation of this client.
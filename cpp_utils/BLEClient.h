@@ -12,19 +12,35 @@
 #if defined(CONFIG_BT_ENABLED)
 
 #include <esp_gattc_api.h>
+#include <pthread.h>
 #include <string.h>
 #include <map>
 #include <string>
+#include <vector>
 #include "BLEExceptions.h"
 #include "BLERemoteService.h"
 #include "BLEService.h"
 #include "BLEAddress.h"
 #include "BLEAdvertisedDevice.h"
+#include "BLERemoteOperationQueue.h"
 
 class BLERemoteService;
 class BLEClientCallbacks;
 class BLEAdvertisedDevice;
 
+/**
+ * @brief Counts of how GATT client events were dispatched.
+ * Events that name an attribute handle are looked up in a sorted index of the characteristics; the number of
+ * probes divided by the number of indexed events is the average cost of a lookup.
+ */
+struct BLEClientDispatchStats {
+	uint32_t events;       // Events received for this client.
+	uint32_t indexed;      // Events dispatched by handle.
+	uint32_t probes;       // Comparisons made looking up handles.
+	uint32_t misses;       // Events with a handle that matched no characteristic.
+	uint32_t broadcasts;   // Events without a handle, passed to every service.
+};
+
 /**
  * @brief A model of a %BLE client.
  */
@@ -41,6 +57,7 @@ public:
 	std::map<std::string, BLERemoteService*>*  getServices();                 // Get a map of the services offered by the remote BLE Server
 	BLERemoteService*                          getService(const char* uuid);  // Get a reference to a specified service offered by the remote BLE server.
 	BLERemoteService*                          getService(BLEUUID uuid);      // Get a reference to a specified service offered by the remote BLE server.
+	BLEClientDispatchStats                     getDispatchStats();            // Get counts of how events were dispatched.
 	std::string                                getValue(BLEUUID serviceUUID, BLEUUID characteristicUUID);   // Get the value of a given characteristic at a given service.
 
 
@@ -49,7 +66,10 @@ public:
                                                 esp_ble_gap_cb_param_t* param);
 
 	bool                                       isConnected();                 // Return true if we are connected.
+	bool                                       readValuesAsync(BLERemoteCharacteristic** pCharacteristics, size_t count,
+		                                            read_multiple_callback callback, void* pArg = nullptr);   // Read several characteristics in one request.
 
+	void                                       setAttributeCache(bool enabled);   // Cache the attributes of the peer in NVS.
 	void                                       setClientCallbacks(BLEClientCallbacks *pClientCallbacks, bool deleteCallbacks = true);
 	void                                       setValue(BLEUUID serviceUUID, BLEUUID characteristicUUID, std::string value);   // Set the value of a given characteristic at a given service.
 
@@ -60,6 +80,7 @@ public:
 
 uint16_t m_appId;
 private:
+	friend class BLEAttributeCache;
 	friend class BLEDevice;
 	friend class BLERemoteService;
 	friend class BLERemoteCharacteristic;
@@ -79,9 +100,22 @@ private:
 	FreeRTOS::Semaphore m_semaphoreOpenEvt       = FreeRTOS::Semaphore("OpenEvt");
 	FreeRTOS::Semaphore m_semaphoreSearchCmplEvt = FreeRTOS::Semaphore("SearchCmplEvt");
 	FreeRTOS::Semaphore m_semaphoreRssiCmplEvt   = FreeRTOS::Semaphore("RssiCmplEvt");
+	FreeRTOS::Semaphore m_semaphoreReadHashEvt   = FreeRTOS::Semaphore("ReadHashEvt");
+	bool                m_attributeCache = false;   // Are the peer's attributes cached?
+	bool                m_readingHash    = false;   // Is a read of the peer's Database Hash in flight?
+	uint8_t             m_databaseHash[16];
 	std::map<std::string, BLERemoteService*> m_servicesMap;
 	std::map<BLERemoteService*, uint16_t> m_servicesMapByInstID;
+	BLERemoteOperationQueue m_operationQueue;   // Asynchronous reads and writes waiting to be run.
+	std::vector<std::pair<uint16_t, BLERemoteCharacteristic*>> m_characteristicIndex;   // Every known characteristic sorted by handle.
+	pthread_mutex_t     m_indexLock;                // Guards m_characteristicIndex, which the event task searches.
+	BLEClientDispatchStats m_dispatchStats;
 	void clearServices();   // Clear any existing services.
+	BLERemoteCharacteristic* findCharacteristic(uint16_t handle);
+	void indexCharacteristics(BLERemoteService* pService);
+	bool readDatabaseHash();
+	void swapCharacteristicIndex(std::vector<std::pair<uint16_t, BLERemoteCharacteristic*>>& index);
+	void unindexCharacteristics(BLERemoteService* pService);
 	uint16_t m_mtu = 23;
 }; // class BLEDevice
 
@@ -58,7 +58,7 @@ BLEDescriptor* BLEDescriptorMap::getByHandle(uint16_t handle) {
  * @return N/A.
  */
 void BLEDescriptorMap::setByUUID(const char* uuid, BLEDescriptor* pDescriptor){
-	m_uuidMap.insert(std::pair<BLEDescriptor*, std::string>(pDescriptor, uuid));
+	m_uuidMap.insert(std::pair<BLEDescriptor*, BLEUUID>(pDescriptor, BLEUUID(uuid)));
 } // setByUUID
 
 
@@ -70,7 +70,7 @@ void BLEDescriptorMap::setByUUID(const char* uuid, BLEDescriptor* pDescriptor){
  * @return N/A.
  */
 void BLEDescriptorMap::setByUUID(BLEUUID uuid, BLEDescriptor* pDescriptor) {
-	m_uuidMap.insert(std::pair<BLEDescriptor*, std::string>(pDescriptor, uuid.toString()));
+	m_uuidMap.insert(std::pair<BLEDescriptor*, BLEUUID>(pDescriptor, uuid));
 } // setByUUID
 
 
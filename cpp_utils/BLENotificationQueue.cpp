@@ -0,0 +1,244 @@
+/*
+ * BLENotificationQueue.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_err.h>
+#include "BLENotificationQueue.h"
+#include "GeneralUtils.h"
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#define LOG_TAG ""
+#else
+#include "esp_log.h"
+static const char* LOG_TAG = "BLENotificationQueue";
+#endif
+
+static const uint16_t DEFAULT_MTU = 23;
+
+
+BLENotificationQueue::BLENotificationQueue() {
+	m_gattsIf    = ESP_GATT_IF_NONE;
+	m_credits    = 8;
+	m_maxPending = 16;
+	pthread_mutex_init(&m_lock, nullptr);
+} // BLENotificationQueue
+
+
+BLENotificationQueue::~BLENotificationQueue() {
+	pthread_mutex_destroy(&m_lock);
+} // ~BLENotificationQueue
+
+
+/**
+ * @brief Get the number of values waiting to be sent on a connection.
+ * @param [in] connId The connection.
+ * @return The number of values waiting; those in flight are not counted.
+ */
+size_t BLENotificationQueue::getPendingCount(uint16_t connId) {
+	pthread_mutex_lock(&m_lock);
+	auto it = m_connections.find(connId);
+	size_t count = it == m_connections.end() ? 0 : it->second.pending.size();
+	pthread_mutex_unlock(&m_lock);
+	return count;
+} // getPendingCount
+
+
+/**
+ * @brief Track connections, their MTU and congestion and return credits as values are confirmed.
+ * @param [in] event The type of event.
+ * @param [in] gatts_if The GATT server interface.
+ * @param [in] param The event parameters.
+ */
+void BLENotificationQueue::handleGATTServerEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param) {
+	switch(event) {
+		case ESP_GATTS_REG_EVT: {
+			m_gattsIf = gatts_if;
+			break;
+		} // ESP_GATTS_REG_EVT
+
+		case ESP_GATTS_CONNECT_EVT: {
+			pthread_mutex_lock(&m_lock);
+			m_gattsIf = gatts_if;
+			Connection& connection = m_connections[param->connect.conn_id];
+			connection.pending.clear();
+			connection.inFlight.clear();
+			connection.mtu        = DEFAULT_MTU;
+			connection.indicating = false;
+			connection.congested  = false;
+			pthread_mutex_unlock(&m_lock);
+			break;
+		} // ESP_GATTS_CONNECT_EVT
+
+		case ESP_GATTS_DISCONNECT_EVT: {
+			pthread_mutex_lock(&m_lock);
+			m_connections.erase(param->disconnect.conn_id);
+			pthread_mutex_unlock(&m_lock);
+			break;
+		} // ESP_GATTS_DISCONNECT_EVT
+
+		case ESP_GATTS_MTU_EVT: {
+			pthread_mutex_lock(&m_lock);
+			auto it = m_connections.find(param->mtu.conn_id);
+			if (it != m_connections.end()) it->second.mtu = param->mtu.mtu;
+			pthread_mutex_unlock(&m_lock);
+			break;
+		} // ESP_GATTS_MTU_EVT
+
+		case ESP_GATTS_CONGEST_EVT: {
+			pthread_mutex_lock(&m_lock);
+			auto it = m_connections.find(param->congest.conn_id);
+			if (it != m_connections.end()) it->second.congested = param->congest.congested;
+			pthread_mutex_unlock(&m_lock);
+			if (!param->congest.congested) send(param->congest.conn_id);
+			break;
+		} // ESP_GATTS_CONGEST_EVT
+
+		// A notification or indication has been handed to the link (or an indication confirmed by the peer);
+		// if we sent it, its credit is returned and the next value can go.
+		case ESP_GATTS_CONF_EVT: {
+			if (confirm(param->conf.conn_id, param->conf.handle)) send(param->conf.conn_id);
+			break;
+		} // ESP_GATTS_CONF_EVT
+
+		default:
+			break;
+	} // switch
+} // handleGATTServerEvent
+
+
+/**
+ * @brief Return the credit of a value we sent once the stack has confirmed it.
+ * The confirmation is matched to the oldest value in flight for its handle.  A confirmation for a value
+ * that we didn't send, such as one a characteristic notified directly, matches nothing and is ignored.
+ * @param [in] connId The connection.
+ * @param [in] handle The handle of the characteristic confirmed.
+ * @return True if the confirmation was for one of our values.
+ */
+bool BLENotificationQueue::confirm(uint16_t connId, uint16_t handle) {
+	bool ours = false;
+	pthread_mutex_lock(&m_lock);
+	auto it = m_connections.find(connId);
+	if (it != m_connections.end()) {
+		std::deque<uint16_t>& inFlight = it->second.inFlight;
+		for (auto handleIt = inFlight.begin(); handleIt != inFlight.end(); ++handleIt) {
+			if (*handleIt == handle) {
+				inFlight.erase(handleIt);
+				ours = true;
+				break;
+			}
+		}
+		if (ours && inFlight.empty()) it->second.indicating = false;
+	}
+	pthread_mutex_unlock(&m_lock);
+	return ours;
+} // confirm
+
+
+/**
+ * @brief Queue a value to be notified or indicated to a peer.
+ * @param [in] connId The connection to the peer.
+ * @param [in] handle The handle of the characteristic.
+ * @param [in] pData The value.  It is copied.
+ * @param [in] length The length of the value.
+ * @param [in] needConfirm True for an indication, false for a notification.
+ * @param [in] latestValueWins True if the value should replace one for the same characteristic still waiting.
+ * @return True if the value was queued; false if the peer isn't connected or its queue is full.
+ */
+bool BLENotificationQueue::queue(uint16_t connId, uint16_t handle, const uint8_t* pData, size_t length, bool needConfirm, bool latestValueWins) {
+	pthread_mutex_lock(&m_lock);
+	auto it = m_connections.find(connId);
+	if (it == m_connections.end()) {
+		pthread_mutex_unlock(&m_lock);
+		return false;
+	}
+	std::deque<Notification>& pending = it->second.pending;
+
+	bool replaced = false;
+	if (latestValueWins) {
+		for (auto& notification : pending) {
+			if (notification.handle == handle && notification.needConfirm == needConfirm) {
+				notification.value.assign((const char*) pData, length);   // Reuses the storage of the value replaced.
+				replaced = true;
+				break;
+			}
+		}
+	}
+	if (!replaced) {
+		if (pending.size() >= m_maxPending) {
+			pthread_mutex_unlock(&m_lock);
+			ESP_LOGW(LOG_TAG, "Queue for connection %d is full; value for handle 0x%.2x dropped", connId, handle);
+			return false;
+		}
+		Notification notification;
+		notification.handle      = handle;
+		notification.needConfirm = needConfirm;
+		notification.value.assign((const char*) pData, length);
+		pending.push_back(notification);
+	}
+	pthread_mutex_unlock(&m_lock);
+
+	send(connId);
+	return true;
+} // queue
+
+
+/**
+ * @brief Hand queued values to the stack while the connection has credits and isn't congested.
+ * The lock is not held while calling the stack since its event handler, which also takes the lock, may be
+ * what we are waiting on to post the request.
+ * @param [in] connId The connection.
+ */
+void BLENotificationQueue::send(uint16_t connId) {
+	while (true) {
+		pthread_mutex_lock(&m_lock);
+		auto it = m_connections.find(connId);
+		if (it == m_connections.end()) break;
+		Connection& connection = it->second;
+		if (connection.pending.empty() || connection.congested || connection.indicating) break;
+		if (connection.inFlight.size() >= m_credits) break;
+		if (connection.pending.front().needConfirm && !connection.inFlight.empty()) break;   // Indications go alone.
+
+		Notification notification;
+		notification.handle      = connection.pending.front().handle;
+		notification.needConfirm = connection.pending.front().needConfirm;
+		notification.value.swap(connection.pending.front().value);
+		connection.pending.pop_front();
+		connection.inFlight.push_back(notification.handle);
+		connection.indicating = notification.needConfirm;
+		size_t length = notification.value.length();
+		if (length > (size_t) (connection.mtu - 3)) length = connection.mtu - 3;
+		esp_gatt_if_t gattsIf = m_gattsIf;
+		pthread_mutex_unlock(&m_lock);
+
+		esp_err_t errRc = ::esp_ble_gatts_send_indicate(gattsIf, connId, notification.handle, length,
+			(uint8_t*) notification.value.data(), notification.needConfirm);
+		if (errRc != ESP_OK) {
+			ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_indicate: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+			confirm(connId, notification.handle);   // It will never be confirmed; take back its credit.
+		}
+	} // while
+	pthread_mutex_unlock(&m_lock);
+} // send
+
+
+/**
+ * @brief Set the number of values that may be in flight on each connection.
+ * @param [in] credits The number of values; at least 1.
+ */
+void BLENotificationQueue::setCredits(uint8_t credits) {
+	m_credits = credits == 0 ? 1 : credits;
+} // setCredits
+
+
+/**
+ * @brief Set the number of values that may wait to be sent on each connection.
+ * @param [in] maxPending The number of values.
+ */
+void BLENotificationQueue::setMaxPending(size_t maxPending) {
+	m_maxPending = maxPending;
+} // setMaxPending
+
+#endif /* CONFIG_BT_ENABLED */
@@ -0,0 +1,73 @@
+/*
+ * BLENotificationQueue.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLENOTIFICATIONQUEUE_H_
+#define COMPONENTS_CPP_UTILS_BLENOTIFICATIONQUEUE_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_gatts_api.h>
+#include <pthread.h>
+#include <deque>
+#include <map>
+#include <string>
+
+/**
+ * @brief Per connection queues of notifications and indications waiting to be sent by a %BLE server.
+ *
+ * Values are queued by the application and handed to the stack as fast as the link takes them rather
+ * than one per application call.  Each connection has a number of credits; sending a notification uses one
+ * and the confirmation event (ESP_GATTS_CONF_EVT) returns it, at which point the next queued value is sent
+ * from the event handler.  Sending stops while the stack reports the connection as congested.  Values are
+ * truncated to the negotiated MTU.  An indication is only sent when nothing else is in flight on its
+ * connection, and nothing else is sent until it is confirmed, so that every confirmation can be accounted
+ * for.  The handles of the values in flight are kept in the order they were sent and a confirmation only
+ * returns a credit if it is for one of them; those for values sent directly by a characteristic are
+ * ignored.
+ *
+ * In latest value wins mode a queued value replaces any value for the same characteristic still waiting
+ * to be sent, so a slow link receives the most recent readings rather than falling further behind.
+ *
+ * The queue belongs to the BLEServer which passes it the GATT server events.
+ */
+class BLENotificationQueue {
+public:
+	BLENotificationQueue();
+	virtual ~BLENotificationQueue();
+
+	size_t getPendingCount(uint16_t connId);
+	void   handleGATTServerEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
+	bool   queue(uint16_t connId, uint16_t handle, const uint8_t* pData, size_t length, bool needConfirm, bool latestValueWins);
+	void   setCredits(uint8_t credits);
+	void   setMaxPending(size_t maxPending);
+
+private:
+	struct Notification {
+		uint16_t    handle;
+		bool        needConfirm;
+		std::string value;
+	};
+
+	struct Connection {
+		std::deque<Notification> pending;
+		std::deque<uint16_t>     inFlight;          // Handles of the values sent but not yet confirmed, oldest first.
+		uint16_t                 mtu;
+		bool                     indicating;        // The value in flight is an indication.
+		bool                     congested;
+	};
+
+	std::map<uint16_t, Connection> m_connections;
+	esp_gatt_if_t                  m_gattsIf;
+	pthread_mutex_t                m_lock;
+	uint8_t                        m_credits;       // Maximum values in flight per connection.
+	size_t                         m_maxPending;    // Maximum values waiting per connection.
+
+	bool confirm(uint16_t connId, uint16_t handle);
+	void send(uint16_t connId);
+
+}; // BLENotificationQueue
+
+#endif /* CONFIG_BT_ENABLED */
+#endif /* COMPONENTS_CPP_UTILS_BLENOTIFICATIONQUEUE_H_ */
@@ -46,8 +46,6 @@ BLERemoteCharacteristic::BLERemoteCharacteristic(
 	m_charProp       = charProp;
 	m_pRemoteService = pRemoteService;
 	m_notifyCallback = nullptr;
-
-	retrieveDescriptors(); // Get the descriptors for this characteristic
 	ESP_LOGD(LOG_TAG, "<< BLERemoteCharacteristic");
 } // BLERemoteCharacteristic
 
@@ -173,34 +171,6 @@ void BLERemoteCharacteristic::gattClientEventHandler(esp_gattc_cb_event_t event,
 			break;
 		} // ESP_GATTC_NOTIFY_EVT
 
-		// ESP_GATTC_READ_CHAR_EVT
-		// This event indicates that the server has responded to the read request.
-		//
-		// read:
-		// - esp_gatt_status_t  status
-		// - uint16_t           conn_id
-		// - uint16_t           handle
-		// - uint8_t*           value
-		// - uint16_t           value_len
-		case ESP_GATTC_READ_CHAR_EVT: {
-			// If this event is not for us, then nothing further to do.
-			if (evtParam->read.handle != getHandle()) break;
-
-			// At this point, we have determined that the event is for us, so now we save the value
-			// and unlock the semaphore to ensure that the requestor of the data can continue.
-			if (evtParam->read.status == ESP_GATT_OK) {
-				m_value = std::string((char*) evtParam->read.value, evtParam->read.value_len);
-				if(m_rawData != nullptr) free(m_rawData);
-				m_rawData = (uint8_t*) calloc(evtParam->read.value_len, sizeof(uint8_t));
-				memcpy(m_rawData, evtParam->read.value, evtParam->read.value_len);
-			} else {
-				m_value = "";
-			}
-
-			m_semaphoreReadCharEvt.give();
-			break;
-		} // ESP_GATTC_READ_CHAR_EVT
-
 		// ESP_GATTC_REG_FOR_NOTIFY_EVT
 		//
 		// reg_for_notify:
@@ -227,23 +197,6 @@ void BLERemoteCharacteristic::gattClientEventHandler(esp_gattc_cb_event_t event,
 			break;
 		} // ESP_GATTC_UNREG_FOR_NOTIFY_EVT:
 
-		// ESP_GATTC_WRITE_CHAR_EVT
-		//
-		// write:
-		// - esp_gatt_status_t status
-		// - uint16_t          conn_id
-		// - uint16_t          handle
-		case ESP_GATTC_WRITE_CHAR_EVT: {
-			// Determine if this event is for us and, if not, pass onwards.
-			if (evtParam->write.handle != getHandle()) break;
-
-			// There is nothing further we need to do here.  This is merely an indication
-			// that the write has completed and we can unlock the caller.
-			m_semaphoreWriteCharEvt.give();
-			break;
-		} // ESP_GATTC_WRITE_CHAR_EVT
-
-
 		default:
 			break;
 	} // End switch
@@ -258,17 +211,17 @@ void BLERemoteCharacteristic::retrieveDescriptors() {
 
 	removeDescriptors();   // Remove any existing descriptors.
 
-	// Loop over each of the descriptors within the service associated with this characteristic.
-	// For each descriptor we find, create a BLERemoteDescriptor instance.
+	// Loop over each of the descriptors within the service associated with this characteristic, fetching them
+	// in batches.  For each descriptor we find, create a BLERemoteDescriptor instance.
 	uint16_t offset = 0;
-	esp_gattc_descr_elem_t result;
+	esp_gattc_descr_elem_t result[BLERemoteService::DISCOVERY_BATCH_SIZE];
 	while(true) {
-		uint16_t count = 1;
+		uint16_t count = BLERemoteService::DISCOVERY_BATCH_SIZE;
 		esp_gatt_status_t status = ::esp_ble_gattc_get_all_descr(
 			getRemoteService()->getClient()->getGattcIf(),
 			getRemoteService()->getClient()->getConnId(),
 			getHandle(),
-			&result,
+			result,
 			&count,
 			offset
 		);
@@ -284,18 +237,21 @@ void BLERemoteCharacteristic::retrieveDescriptors() {
 
 		if (count == 0) break;
 
-		ESP_LOGD(LOG_TAG, "Found a descriptor: Handle: %d, UUID: %s", result.handle, BLEUUID(result.uuid).toString().c_str());
+		for (uint16_t i = 0; i < count; i++) {
+			ESP_LOGD(LOG_TAG, "Found a descriptor: Handle: %d, UUID: %s", result[i].handle, BLEUUID(result[i].uuid).toString().c_str());
 
-		// We now have a new characteristic ... let us add that to our set of known characteristics
-		BLERemoteDescriptor* pNewRemoteDescriptor = new BLERemoteDescriptor(
-			result.handle,
-			BLEUUID(result.uuid),
-			this
-		);
+			// We now have a new characteristic ... let us add that to our set of known characteristics
+			BLERemoteDescriptor* pNewRemoteDescriptor = new BLERemoteDescriptor(
+				result[i].handle,
+				BLEUUID(result[i].uuid),
+				this
+			);
 
-		m_descriptorMap.insert(std::pair<std::string, BLERemoteDescriptor*>(pNewRemoteDescriptor->getUUID().toString(), pNewRemoteDescriptor));
+			m_descriptorMap.insert(std::pair<std::string, BLERemoteDescriptor*>(pNewRemoteDescriptor->getUUID().toString(), pNewRemoteDescriptor));
+		}
 
-		offset++;
+		offset += count;
+		if (count < BLERemoteService::DISCOVERY_BATCH_SIZE) break;   // A short batch is the last.
 	} // while true
 	//m_haveCharacteristics = true; // Remember that we have received the characteristics.
 	ESP_LOGD(LOG_TAG, "<< retrieveDescriptors(): Found %d descriptors.", offset);
@@ -328,9 +284,8 @@ uint16_t BLERemoteCharacteristic::getHandle() {
  */
 BLERemoteDescriptor* BLERemoteCharacteristic::getDescriptor(BLEUUID uuid) {
 	ESP_LOGD(LOG_TAG, ">> getDescriptor: uuid: %s", uuid.toString().c_str());
-	std::string v = uuid.toString();
 	for (auto &myPair : m_descriptorMap) {
-		if (myPair.first == v) {
+		if (myPair.second->getUUID().equals(uuid)) {
 			ESP_LOGD(LOG_TAG, "<< getDescriptor: found");
 			return myPair.second;
 		}
@@ -397,6 +352,32 @@ uint8_t BLERemoteCharacteristic::readUInt8() {
 } // readUInt8
 
 
+/**
+ * @brief Record the value of a blocking read and release the reader.
+ * Invoked by the operation queue from the BLE event task.
+ */
+void BLERemoteCharacteristic::onReadComplete(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length, void* pArg) {
+	if (status == ESP_GATT_OK) {
+		pCharacteristic->m_value = std::string((char*) pData, length);
+		if (pCharacteristic->m_rawData != nullptr) free(pCharacteristic->m_rawData);
+		pCharacteristic->m_rawData = (uint8_t*) calloc(length, sizeof(uint8_t));
+		memcpy(pCharacteristic->m_rawData, pData, length);
+	} else {
+		pCharacteristic->m_value = "";
+	}
+	pCharacteristic->m_semaphoreReadCharEvt.give();
+} // onReadComplete
+
+
+/**
+ * @brief Release the writer of a blocking write with the status of the write.
+ * Invoked by the operation queue from the BLE event task.
+ */
+void BLERemoteCharacteristic::onWriteComplete(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, void* pArg) {
+	pCharacteristic->m_semaphoreWriteCharEvt.give(status);
+} // onWriteComplete
+
+
 /**
  * @brief Read the value of the remote characteristic.
  * @return The value of the remote characteristic.
@@ -412,22 +393,14 @@ std::string BLERemoteCharacteristic::readValue() {
 
 	m_semaphoreReadCharEvt.take("readValue");
 
-	// Ask the BLE subsystem to retrieve the value for the remote hosted characteristic.
-	// This is an asynchronous request which means that we must block waiting for the response
-	// to become available.
-	esp_err_t errRc = ::esp_ble_gattc_read_char(
-		m_pRemoteService->getClient()->getGattcIf(),
-		m_pRemoteService->getClient()->getConnId(),    // The connection ID to the BLE server
-		getHandle(),                                   // The handle of this characteristic
-		ESP_GATT_AUTH_REQ_NONE);                       // Security
-
-	if (errRc != ESP_OK) {
-		ESP_LOGE(LOG_TAG, "esp_ble_gattc_read_char: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+	// Queue the read behind any asynchronous operations on the connection so that only one request is ever
+	// in flight and the response can't be taken for that of another read of this handle.
+	if (!m_pRemoteService->getClient()->m_operationQueue.read(this, getHandle(), onReadComplete, nullptr)) {
+		m_semaphoreReadCharEvt.give();
 		return "";
 	}
 
-	// Block waiting for the event that indicates that the read has completed.  When it has, the std::string found
-	// in m_value will contain our data.
+	// Block waiting for the read to complete.  When it has, the std::string found in m_value will contain our data.
 	m_semaphoreReadCharEvt.wait("readValue");
 
 	ESP_LOGD(LOG_TAG, "<< readValue(): length: %d", m_value.length());
@@ -435,6 +408,27 @@ std::string BLERemoteCharacteristic::readValue() {
 } // readValue
 
 
+/**
+ * @brief Read the value of the remote characteristic without waiting for it.
+ * The read is queued behind any other asynchronous operations on the connection and issued as soon as the
+ * one before it completes.
+ *
+ * @code{.cpp}
+ * static void onRead(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length, void* pArg) {
+ *    ...
+ * }
+ * pCharacteristic->readValueAsync(onRead);
+ * @endcode
+ *
+ * @param [in] callback Invoked from the BLE event task with the value.  It must not block.
+ * @param [in] pArg Passed to the callback.
+ * @return True if the read was queued; false if we are not connected.
+ */
+bool BLERemoteCharacteristic::readValueAsync(read_complete_callback callback, void* pArg) {
+	return getRemoteService()->getClient()->m_operationQueue.read(this, getHandle(), callback, pArg);
+} // readValueAsync
+
+
 /**
  * @brief Register for notifications.
  * @param [in] notifyCallback A callback to be invoked for a notification.  If NULL is provided then we are
@@ -560,28 +554,32 @@ bool BLERemoteCharacteristic::writeValue(uint8_t* data, size_t length, bool resp
 	}
 
 	m_semaphoreWriteCharEvt.take("writeValue");
-	// Invoke the ESP-IDF API to perform the write.
-	esp_err_t errRc = ::esp_ble_gattc_write_char(
-		m_pRemoteService->getClient()->getGattcIf(),
-		m_pRemoteService->getClient()->getConnId(),
-		getHandle(),
-		length,
-		data,
-		response?ESP_GATT_WRITE_TYPE_RSP:ESP_GATT_WRITE_TYPE_NO_RSP,
-		ESP_GATT_AUTH_REQ_NONE
-	);
-
-	if (errRc != ESP_OK) {
-		ESP_LOGE(LOG_TAG, "esp_ble_gattc_write_char: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+	// Queue the write behind any asynchronous operations on the connection.
+	if (!m_pRemoteService->getClient()->m_operationQueue.write(this, getHandle(), data, length, response, onWriteComplete, nullptr)) {
+		m_semaphoreWriteCharEvt.give();
 		return false;
 	}
 
-	m_semaphoreWriteCharEvt.wait("writeValue");
+	esp_gatt_status_t status = (esp_gatt_status_t) m_semaphoreWriteCharEvt.wait("writeValue");
 
-	ESP_LOGD(LOG_TAG, "<< writeValue");
-	return true;
+	ESP_LOGD(LOG_TAG, "<< writeValue: status: %d", status);
+	return status == ESP_GATT_OK;
 } // writeValue
 
+/**
+ * @brief Write the value of the remote characteristic without waiting for the write to complete.
+ * The write is queued behind any other asynchronous operations on the connection.
+ * @param [in] data A pointer to a data buffer.  The data is copied.
+ * @param [in] length The length of the data in the data buffer.
+ * @param [in] response Whether we require a response from the write.
+ * @param [in] callback Invoked from the BLE event task when the write completes.  May be nullptr.
+ * @param [in] pArg Passed to the callback.
+ * @return True if the write was queued; false if we are not connected.
+ */
+bool BLERemoteCharacteristic::writeValueAsync(uint8_t* data, size_t length, bool response, write_complete_callback callback, void* pArg) {
+	return getRemoteService()->getClient()->m_operationQueue.write(this, getHandle(), data, length, response, callback, pArg);
+} // writeValueAsync
+
 /**
  * @brief Read raw data from remote characteristic as hex bytes
  * @return return pointer data read
@@ -16,6 +16,7 @@
 
 #include "BLERemoteService.h"
 #include "BLERemoteDescriptor.h"
+#include "BLERemoteOperationQueue.h"
 #include "BLEUUID.h"
 #include "FreeRTOS.h"
 
@@ -42,6 +43,7 @@ public:
 	uint16_t    getHandle();
 	BLEUUID     getUUID();
 	std::string readValue();
+	bool        readValueAsync(read_complete_callback callback, void* pArg = nullptr);
 	uint8_t     readUInt8();
 	uint16_t    readUInt16();
 	uint32_t    readUInt32();
@@ -49,18 +51,23 @@ public:
 	bool        writeValue(uint8_t* data, size_t length, bool response = false);
 	bool        writeValue(std::string newValue, bool response = false);
 	bool        writeValue(uint8_t newValue, bool response = false);
+	bool        writeValueAsync(uint8_t* data, size_t length, bool response = false,
+		write_complete_callback callback = nullptr, void* pArg = nullptr);
 	std::string toString();
 	uint8_t*	readRawData();
 	BLERemoteService* getRemoteService();
 
 private:
 	BLERemoteCharacteristic(uint16_t handle, BLEUUID uuid, esp_gatt_char_prop_t charProp, BLERemoteService* pRemoteService);
+	friend class BLEAttributeCache;
 	friend class BLEClient;
 	friend class BLERemoteService;
 	friend class BLERemoteDescriptor;
 
 	// Private member functions
 	void gattClientEventHandler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t* evtParam);
+	static void onReadComplete(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length, void* pArg);
+	static void onWriteComplete(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, void* pArg);
 
 	void              removeDescriptors();
 	void              retrieveDescriptors();
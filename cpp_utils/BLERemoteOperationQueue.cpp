@@ -0,0 +1,405 @@
+/*
+ * BLERemoteOperationQueue.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_err.h>
+#include "BLERemoteOperationQueue.h"
+#include "GeneralUtils.h"
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#define LOG_TAG ""
+#else
+#include "esp_log.h"
+static const char* LOG_TAG = "BLERemoteOperationQueue";
+#endif
+
+
+BLERemoteOperationQueue::BLERemoteOperationQueue(BLEClient* pClient) {
+	m_pClient               = pClient;
+	m_gattcIf               = ESP_GATT_IF_NONE;
+	m_connId                = 0;
+	m_connected             = false;
+	m_busy                  = false;
+	m_readMultipleSupported = true;
+	m_nextId                = 1;
+	pthread_mutex_init(&m_lock, nullptr);
+} // BLERemoteOperationQueue
+
+
+BLERemoteOperationQueue::~BLERemoteOperationQueue() {
+	pthread_mutex_destroy(&m_lock);
+} // ~BLERemoteOperationQueue
+
+
+/**
+ * @brief Abandon every queued operation, including the one in flight.
+ * The callback of each operation is invoked with the given status.
+ * @param [in] status The status to report.
+ */
+void BLERemoteOperationQueue::clear(esp_gatt_status_t status) {
+	pthread_mutex_lock(&m_lock);
+	std::deque<Operation> operations;
+	operations.swap(m_operations);
+	m_busy = false;
+	pthread_mutex_unlock(&m_lock);
+
+	for (auto& operation : operations) {
+		report(operation, status, nullptr, 0);
+	}
+} // clear
+
+
+/**
+ * @brief Finish the operation in flight and start the next.
+ * The next operation is issued before the callback of the finished one is invoked so that the link
+ * isn't left idle while the application handles the result.
+ * @param [in] status The status of the operation.
+ * @param [in] pData The value read, if any.
+ * @param [in] length The length of the value read.
+ * @param [in] id The operation to finish, should it still be in flight, or 0 for whichever is.
+ */
+void BLERemoteOperationQueue::complete(esp_gatt_status_t status, uint8_t* pData, size_t length, uint32_t id) {
+	pthread_mutex_lock(&m_lock);
+	if (!m_busy || m_operations.empty() || (id != 0 && m_operations.front().id != id)) {
+		pthread_mutex_unlock(&m_lock);
+		return;
+	}
+	Operation operation = m_operations.front();
+	m_operations.pop_front();
+	m_busy = false;
+	pthread_mutex_unlock(&m_lock);
+
+	start();
+	report(operation, status, pData, length);
+} // complete
+
+
+/**
+ * @brief Get the number of operations queued, including the one in flight.
+ */
+size_t BLERemoteOperationQueue::getPendingCount() {
+	pthread_mutex_lock(&m_lock);
+	size_t count = m_operations.size();
+	pthread_mutex_unlock(&m_lock);
+	return count;
+} // getPendingCount
+
+
+/**
+ * @brief Handle GATT client events.
+ * @param [in] event The type of event.
+ * @param [in] gattc_if The interface on which the event was received.
+ * @param [in] evtParam Payload data for the event.
+ * @return True if the event completed a queued operation and needs no further handling.
+ */
+bool BLERemoteOperationQueue::handleGATTClientEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t* evtParam) {
+	if (gattc_if != m_gattcIf || m_gattcIf == ESP_GATT_IF_NONE) return false;
+
+	switch(event) {
+		case ESP_GATTC_OPEN_EVT: {
+			if (evtParam->open.status == ESP_GATT_OK) {
+				pthread_mutex_lock(&m_lock);
+				m_connId                = evtParam->open.conn_id;
+				m_connected             = true;
+				m_readMultipleSupported = true;   // A new peer may well support it.
+				pthread_mutex_unlock(&m_lock);
+			}
+			return false;
+		} // ESP_GATTC_OPEN_EVT
+
+		case ESP_GATTC_DISCONNECT_EVT: {
+			pthread_mutex_lock(&m_lock);
+			m_connected = false;
+			pthread_mutex_unlock(&m_lock);
+			clear(ESP_GATT_ERROR);
+			return false;
+		} // ESP_GATTC_DISCONNECT_EVT
+
+		case ESP_GATTC_READ_CHAR_EVT: {
+			pthread_mutex_lock(&m_lock);
+			if (!m_busy || m_operations.empty() || evtParam->read.conn_id != m_connId) break;
+			Operation& operation = m_operations.front();
+
+			if (operation.type == OP_READ && evtParam->read.handle == operation.handles[0]) {
+				pthread_mutex_unlock(&m_lock);
+				complete(evtParam->read.status, evtParam->read.value, evtParam->read.value_len);
+				return true;
+			}
+
+			if (operation.type == OP_READ_MULTIPLE && operation.oneByOne && evtParam->read.handle == operation.handles[operation.next]) {
+				if (evtParam->read.status != ESP_GATT_OK) {
+					pthread_mutex_unlock(&m_lock);
+					complete(evtParam->read.status, nullptr, 0);
+					return true;
+				}
+				operation.data.append((char*) evtParam->read.value, evtParam->read.value_len);
+				operation.next++;
+				if (operation.next == operation.handles.size()) {
+					pthread_mutex_unlock(&m_lock);
+					complete(ESP_GATT_OK, nullptr, 0);
+					return true;
+				}
+				Operation next = operation;   // The queue may be cleared once the lock is released.
+				pthread_mutex_unlock(&m_lock);
+				issueNext(next);
+				return true;
+			}
+			break;
+		} // ESP_GATTC_READ_CHAR_EVT
+
+		case ESP_GATTC_READ_MULTIPLE_EVT: {
+			pthread_mutex_lock(&m_lock);
+			if (!m_busy || m_operations.empty() || evtParam->read.conn_id != m_connId) break;
+			Operation& operation = m_operations.front();
+			if (operation.type != OP_READ_MULTIPLE || operation.oneByOne) break;
+
+			if (evtParam->read.status == ESP_GATT_REQ_NOT_SUPPORTED) {
+				ESP_LOGD(LOG_TAG, "Peer doesn't support Read Multiple; reading handles one by one");
+				m_readMultipleSupported = false;
+				operation.oneByOne = true;
+				operation.next     = 0;
+				Operation next = operation;   // The queue may be cleared once the lock is released.
+				pthread_mutex_unlock(&m_lock);
+				issueNext(next);
+				return true;
+			}
+			pthread_mutex_unlock(&m_lock);
+			complete(evtParam->read.status, evtParam->read.value, evtParam->read.value_len);
+			return true;
+		} // ESP_GATTC_READ_MULTIPLE_EVT
+
+		case ESP_GATTC_WRITE_CHAR_EVT: {
+			pthread_mutex_lock(&m_lock);
+			if (!m_busy || m_operations.empty() || evtParam->write.conn_id != m_connId) break;
+			Operation& operation = m_operations.front();
+			if (operation.type != OP_WRITE || evtParam->write.handle != operation.handles[0]) break;
+			pthread_mutex_unlock(&m_lock);
+			complete(evtParam->write.status, nullptr, 0);
+			return true;
+		} // ESP_GATTC_WRITE_CHAR_EVT
+
+		default:
+			return false;
+	} // switch
+
+	pthread_mutex_unlock(&m_lock);   // We get here by breaking out of one of the cases above with the lock held.
+	return false;
+} // handleGATTClientEvent
+
+
+/**
+ * @brief Hand an operation to the BLE stack.
+ * @param [in] operation A copy of the operation in flight, taken under the lock: clear() may destroy the
+ * queued one while the stack is being called.
+ * @return The result of the request.
+ */
+esp_err_t BLERemoteOperationQueue::issue(const Operation& operation) {
+	esp_err_t errRc;
+	switch(operation.type) {
+		case OP_READ:
+			errRc = ::esp_ble_gattc_read_char(m_gattcIf, m_connId, operation.handles[0], ESP_GATT_AUTH_REQ_NONE);
+			break;
+
+		case OP_READ_MULTIPLE:
+			if (operation.oneByOne) {
+				errRc = ::esp_ble_gattc_read_char(m_gattcIf, m_connId,
+					operation.handles[operation.next], ESP_GATT_AUTH_REQ_NONE);
+			} else {
+				esp_gattc_multi_t multi;
+				multi.num_attr = operation.handles.size();
+				for (size_t i = 0; i < operation.handles.size(); i++) {
+					multi.handles[i] = operation.handles[i];
+				}
+				errRc = ::esp_ble_gattc_read_multiple(m_gattcIf, m_connId, &multi, ESP_GATT_AUTH_REQ_NONE);
+			}
+			break;
+
+		case OP_WRITE:
+		default:
+			errRc = ::esp_ble_gattc_write_char(m_gattcIf, m_connId, operation.handles[0],
+				operation.data.length(), (uint8_t*) operation.data.data(),
+				operation.response ? ESP_GATT_WRITE_TYPE_RSP : ESP_GATT_WRITE_TYPE_NO_RSP, ESP_GATT_AUTH_REQ_NONE);
+			break;
+	}
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "issue: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+	}
+	return errRc;
+} // issue
+
+
+/**
+ * @brief Issue the next request of the operation in flight, failing the operation if the stack refuses it.
+ * Should the queue have been cleared meanwhile, a failure is not reported against whatever is in flight now.
+ * @param [in] operation A copy of the operation, taken under the lock.
+ */
+void BLERemoteOperationQueue::issueNext(const Operation& operation) {
+	if (issue(operation) != ESP_OK) {
+		complete(ESP_GATT_ERROR, nullptr, 0, operation.id);   // Which starts the next one.
+	}
+} // issueNext
+
+
+/**
+ * @brief Add an operation to the queue and start it if the connection is idle.
+ * @param [in] operation The operation.
+ * @return False if the client isn't connected.
+ */
+bool BLERemoteOperationQueue::queue(Operation& operation) {
+	pthread_mutex_lock(&m_lock);
+	if (!m_connected) {
+		pthread_mutex_unlock(&m_lock);
+		ESP_LOGE(LOG_TAG, "Disconnected");
+		return false;
+	}
+	operation.id = m_nextId++;
+	if (m_nextId == 0) m_nextId = 1;   // 0 stands for whichever operation is in flight.
+	m_operations.push_back(operation);
+	pthread_mutex_unlock(&m_lock);
+	start();
+	return true;
+} // queue
+
+
+/**
+ * @brief Queue a read of a characteristic.
+ * @param [in] pCharacteristic The characteristic to read, passed to the callback.
+ * @param [in] handle The handle of the characteristic.
+ * @param [in] callback Invoked with the value when the read completes.  May be nullptr.
+ * @param [in] pArg Passed to the callback.
+ * @return False if the client isn't connected.
+ */
+bool BLERemoteOperationQueue::read(BLERemoteCharacteristic* pCharacteristic, uint16_t handle, read_complete_callback callback, void* pArg) {
+	Operation operation;
+	operation.type            = OP_READ;
+	operation.pCharacteristic = pCharacteristic;
+	operation.readCallback    = callback;
+	operation.handles.push_back(handle);
+	operation.next            = 0;
+	operation.oneByOne        = false;
+	operation.response        = true;
+	operation.pArg            = pArg;
+	return queue(operation);
+} // read
+
+
+/**
+ * @brief Queue a read of several characteristics in one request.
+ * The values are returned concatenated, as ATT Read Multiple does, so the lengths of all but the last
+ * must be known to the caller.
+ * @param [in] handles The handles of the characteristics to read.
+ * @param [in] count The number of characteristics; between 2 and ESP_GATT_MAX_READ_MULTI_HANDLES.
+ * @param [in] callback Invoked with the values when the read completes.  May be nullptr.
+ * @param [in] pArg Passed to the callback.
+ * @return False if the client isn't connected or the count is out of range.
+ */
+bool BLERemoteOperationQueue::readMultiple(const uint16_t* handles, size_t count, read_multiple_callback callback, void* pArg) {
+	if (count < 2 || count > ESP_GATT_MAX_READ_MULTI_HANDLES) {
+		ESP_LOGE(LOG_TAG, "readMultiple: count %d not between 2 and %d", count, ESP_GATT_MAX_READ_MULTI_HANDLES);
+		return false;
+	}
+	Operation operation;
+	operation.type                 = OP_READ_MULTIPLE;
+	operation.pCharacteristic      = nullptr;
+	operation.readMultipleCallback = callback;
+	operation.handles.assign(handles, handles + count);
+	operation.next            = 0;
+	operation.oneByOne        = !m_readMultipleSupported;
+	operation.response        = true;
+	operation.pArg            = pArg;
+	return queue(operation);
+} // readMultiple
+
+
+/**
+ * @brief Invoke the callback of a finished operation.
+ * @param [in] operation The operation.
+ * @param [in] status The status of the operation.
+ * @param [in] pData The value read, if any.
+ * @param [in] length The length of the value read.
+ */
+void BLERemoteOperationQueue::report(Operation& operation, esp_gatt_status_t status, uint8_t* pData, size_t length) {
+	switch(operation.type) {
+		case OP_READ:
+			if (operation.readCallback != nullptr) {
+				operation.readCallback(operation.pCharacteristic, status, pData, length, operation.pArg);
+			}
+			break;
+		case OP_READ_MULTIPLE:
+			if (operation.oneByOne && pData == nullptr && status == ESP_GATT_OK) {   // The values were gathered here.
+				pData  = (uint8_t*) operation.data.data();
+				length = operation.data.length();
+			}
+			if (operation.readMultipleCallback != nullptr) {
+				operation.readMultipleCallback(m_pClient, status, pData, length, operation.pArg);
+			}
+			break;
+		case OP_WRITE:
+			if (operation.writeCallback != nullptr) {
+				operation.writeCallback(operation.pCharacteristic, status, operation.pArg);
+			}
+			break;
+	}
+} // report
+
+
+/**
+ * @brief Set the GATT client interface of the client, once it has been registered.
+ * Only events for this interface are handled.
+ * @param [in] gattcIf The interface.
+ */
+void BLERemoteOperationQueue::setGattcIf(esp_gatt_if_t gattcIf) {
+	m_gattcIf = gattcIf;
+} // setGattcIf
+
+
+/**
+ * @brief Issue the operation at the front of the queue if none is in flight.
+ * The stack is called without the lock held as it may need its event task, which takes the lock, to
+ * make room for the request.  It is given a copy of the operation, as a disconnection may clear the queue
+ * meanwhile.
+ */
+void BLERemoteOperationQueue::start() {
+	pthread_mutex_lock(&m_lock);
+	if (m_busy || m_operations.empty()) {
+		pthread_mutex_unlock(&m_lock);
+		return;
+	}
+	m_busy = true;
+	Operation operation = m_operations.front();
+	pthread_mutex_unlock(&m_lock);
+
+	issueNext(operation);
+} // start
+
+
+/**
+ * @brief Queue a write of a characteristic.
+ * @param [in] pCharacteristic The characteristic to write, passed to the callback.
+ * @param [in] handle The handle of the characteristic.
+ * @param [in] data The value.  It is copied.
+ * @param [in] length The length of the value.
+ * @param [in] response True to ask the peer to acknowledge the write.
+ * @param [in] callback Invoked when the write completes.  May be nullptr.
+ * @param [in] pArg Passed to the callback.
+ * @return False if the client isn't connected.
+ */
+bool BLERemoteOperationQueue::write(BLERemoteCharacteristic* pCharacteristic, uint16_t handle, const uint8_t* data, size_t length, bool response,
+		write_complete_callback callback, void* pArg) {
+	Operation operation;
+	operation.type            = OP_WRITE;
+	operation.pCharacteristic = pCharacteristic;
+	operation.writeCallback   = callback;
+	operation.handles.push_back(handle);
+	operation.data.assign((const char*) data, length);
+	operation.next            = 0;
+	operation.oneByOne        = false;
+	operation.response        = response;
+	operation.pArg            = pArg;
+	return queue(operation);
+} // write
+
+#endif /* CONFIG_BT_ENABLED */
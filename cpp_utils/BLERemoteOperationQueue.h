@@ -0,0 +1,95 @@
+/*
+ * BLERemoteOperationQueue.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEREMOTEOPERATIONQUEUE_H_
+#define COMPONENTS_CPP_UTILS_BLEREMOTEOPERATIONQUEUE_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_gattc_api.h>
+#include <pthread.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+class BLEClient;
+class BLERemoteCharacteristic;
+
+typedef void (*read_complete_callback)(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length, void* pArg);
+typedef void (*read_multiple_callback)(BLEClient* pClient, esp_gatt_status_t status, uint8_t* pData, size_t length, void* pArg);
+typedef void (*write_complete_callback)(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, void* pArg);
+
+/**
+ * @brief A queue of GATT client operations on one connection that runs them back to back.
+ *
+ * ATT allows one outstanding request per connection.  Rather than the application task issuing a request and
+ * sleeping until its response arrives, operations are queued and the next one is issued from the event
+ * handler as soon as the previous one completes.  The application learns of completion through a callback,
+ * which is invoked from the BLE event task and must not block.
+ *
+ * Every read and write of a characteristic on the connection, blocking ones included, goes through the
+ * queue.  Only one request is then ever in flight, so each response is matched to the operation that
+ * asked for it and to nothing else.
+ *
+ * A batch read is sent as one ATT Read Multiple request.  If the peer rejects that as not supported, the
+ * batch (and any later one on the connection) is read handle by handle instead, with the values
+ * concatenated just as Read Multiple would have returned them.
+ *
+ * The queue belongs to a BLEClient which passes it the GATT client events and its interface.  It refers to
+ * characteristics only by handle so that it can be exercised on a host against a simulated peer.
+ */
+class BLERemoteOperationQueue {
+public:
+	BLERemoteOperationQueue(BLEClient* pClient);
+	virtual ~BLERemoteOperationQueue();
+
+	void   clear(esp_gatt_status_t status);
+	size_t getPendingCount();
+	bool   handleGATTClientEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t* evtParam);
+	bool   read(BLERemoteCharacteristic* pCharacteristic, uint16_t handle, read_complete_callback callback, void* pArg);
+	bool   readMultiple(const uint16_t* handles, size_t count, read_multiple_callback callback, void* pArg);
+	void   setGattcIf(esp_gatt_if_t gattcIf);
+	bool   write(BLERemoteCharacteristic* pCharacteristic, uint16_t handle, const uint8_t* data, size_t length, bool response,
+		write_complete_callback callback, void* pArg);
+
+private:
+	enum OperationType { OP_READ, OP_READ_MULTIPLE, OP_WRITE };
+
+	struct Operation {
+		OperationType            type;
+		uint32_t                 id;             // Tells the operation from any queued after it.
+		BLERemoteCharacteristic* pCharacteristic;
+		std::vector<uint16_t>    handles;        // The handle of the characteristic or, for OP_READ_MULTIPLE, of each one.
+		std::string              data;           // The value to write or the values read so far.
+		size_t                   next;           // The handle being read when reading one by one.
+		bool                     oneByOne;       // Reading handle by handle as Read Multiple isn't supported.
+		bool                     response;
+		read_complete_callback   readCallback;
+		read_multiple_callback   readMultipleCallback;
+		write_complete_callback  writeCallback;
+		void*                    pArg;
+	};
+
+	BLEClient*            m_pClient;
+	esp_gatt_if_t         m_gattcIf;             // The interface of the client.
+	uint16_t              m_connId;              // The connection, once open.
+	bool                  m_connected;
+	std::deque<Operation> m_operations;          // The front one is in flight when m_busy.
+	bool                  m_busy;
+	bool                  m_readMultipleSupported;
+	uint32_t              m_nextId;
+	pthread_mutex_t       m_lock;
+
+	void      complete(esp_gatt_status_t status, uint8_t* pData, size_t length, uint32_t id = 0);
+	esp_err_t issue(const Operation& operation);
+	void      issueNext(const Operation& operation);
+	bool      queue(Operation& operation);
+	void      report(Operation& operation, esp_gatt_status_t status, uint8_t* pData, size_t length);
+	void      start();
+
+}; // BLERemoteOperationQueue
+
+#endif /* CONFIG_BT_ENABLED */
+#endif /* COMPONENTS_CPP_UTILS_BLEREMOTEOPERATIONQUEUE_H_ */
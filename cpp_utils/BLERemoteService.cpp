@@ -102,9 +102,8 @@ BLERemoteCharacteristic* BLERemoteService::getCharacteristic(BLEUUID uuid) {
 	if (!m_haveCharacteristics) {
 		retrieveCharacteristics();
 	}
-	std::string v = uuid.toString();
 	for (auto &myPair : m_characteristicMap) {
-		if (myPair.first == v) {
+		if (myPair.second->getUUID().equals(uuid)) {
 			return myPair.second;
 		}
 	}
@@ -123,16 +122,17 @@ void BLERemoteService::retrieveCharacteristics() {
 
 	removeCharacteristics(); // Forget any previous characteristics.
 
+	// Fetch the characteristics in batches rather than one per call.
 	uint16_t offset = 0;
-	esp_gattc_char_elem_t result;
+	esp_gattc_char_elem_t result[DISCOVERY_BATCH_SIZE];
 	while (true) {
-		uint16_t count = 1;  // this value is used as in parameter that allows to search max 10 chars with the same uuid
+		uint16_t count = DISCOVERY_BATCH_SIZE;   // In: the room we have.  Out: the number of characteristics returned.
 		esp_gatt_status_t status = ::esp_ble_gattc_get_all_char(
 			getClient()->getGattcIf(),
 			getClient()->getConnId(),
 			m_startHandle,
 			m_endHandle,
-			&result,
+			result,
 			&count,
 			offset
 		);
@@ -150,22 +150,27 @@ void BLERemoteService::retrieveCharacteristics() {
 			break;
 		}
 
-		ESP_LOGD(LOG_TAG, "Found a characteristic: Handle: %d, UUID: %s", result.char_handle, BLEUUID(result.uuid).toString().c_str());
+		for (uint16_t i = 0; i < count; i++) {
+			ESP_LOGD(LOG_TAG, "Found a characteristic: Handle: %d, UUID: %s", result[i].char_handle, BLEUUID(result[i].uuid).toString().c_str());
 
-		// We now have a new characteristic ... let us add that to our set of known characteristics
-		BLERemoteCharacteristic *pNewRemoteCharacteristic = new BLERemoteCharacteristic(
-			result.char_handle,
-			BLEUUID(result.uuid),
-			result.properties,
-			this
-		);
+			// We now have a new characteristic ... let us add that to our set of known characteristics
+			BLERemoteCharacteristic *pNewRemoteCharacteristic = new BLERemoteCharacteristic(
+				result[i].char_handle,
+				BLEUUID(result[i].uuid),
+				result[i].properties,
+				this
+			);
+			pNewRemoteCharacteristic->retrieveDescriptors(); // Get the descriptors for this characteristic
 
-		m_characteristicMap.insert(std::pair<std::string, BLERemoteCharacteristic*>(pNewRemoteCharacteristic->getUUID().toString(), pNewRemoteCharacteristic));
-		m_characteristicMapByHandle.insert(std::pair<uint16_t, BLERemoteCharacteristic*>(result.char_handle, pNewRemoteCharacteristic));
-		offset++;   // Increment our count of number of descriptors found.
+			m_characteristicMap.insert(std::pair<std::string, BLERemoteCharacteristic*>(pNewRemoteCharacteristic->getUUID().toString(), pNewRemoteCharacteristic));
+			m_characteristicMapByHandle.insert(std::pair<uint16_t, BLERemoteCharacteristic*>(result[i].char_handle, pNewRemoteCharacteristic));
+		}
+		offset += count;   // Skip past the characteristics found.
+		if (count < DISCOVERY_BATCH_SIZE) break;   // A short batch is the last.
 	} // Loop forever (until we break inside the loop).
 
 	m_haveCharacteristics = true; // Remember that we have received the characteristics.
+	m_pClient->indexCharacteristics(this);   // So that events reach them by handle.
 	ESP_LOGD(LOG_TAG, "<< retrieveCharacteristics()");
 } // retrieveCharacteristics
 
@@ -265,6 +270,7 @@ std::string BLERemoteService::getValue(BLEUUID characteristicUuid) {
  * @return N/A.
  */
 void BLERemoteService::removeCharacteristics() {
+	m_pClient->unindexCharacteristics(this);
 	m_characteristicMap.clear();   // Clear the map
 	for (auto &myPair : m_characteristicMapByHandle) {
 	   delete myPair.second;
@@ -48,9 +48,12 @@ private:
 	BLERemoteService(esp_gatt_id_t srvcId, BLEClient* pClient, uint16_t startHandle, uint16_t endHandle);
 
 	// Friends
+	friend class BLEAttributeCache;
 	friend class BLEClient;
 	friend class BLERemoteCharacteristic;
 
+	static const uint16_t DISCOVERY_BATCH_SIZE = 8;   // Attributes fetched from the stack per call when retrieving.
+
 	// Private methods
 	void                retrieveCharacteristics(void);   // Retrieve the characteristics from the BLE Server.
 	esp_gatt_id_t*      getSrvcId(void);
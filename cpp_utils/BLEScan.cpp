@@ -9,6 +9,7 @@
 
 
 #include <esp_err.h>
+#include <stdlib.h>
 
 #include <map>
 
@@ -37,6 +38,10 @@ BLEScan::BLEScan() {
 	m_pAdvertisedDeviceCallbacks     = nullptr;
 	m_stopped                        = true;
 	m_wantDuplicates                 = false;
+	m_maxResults                     = 128;
+	m_duplicateInterval              = 0;
+	m_duplicateRSSIDelta             = 0;
+	m_scanResults.m_pScan            = this;
 	setInterval(100);
 	setWindow(100);
 } // BLEScan
@@ -93,43 +98,67 @@ void BLEScan::handleGAPEvent(
 						break;
 					}
 
-// Examine our list of previously scanned addresses and, if we found this one already,
-// ignore it.
-					BLEAddress advertisedAddress(param->scan_rst.bda);
-					bool found = false;
+					// Record the advertisement in the result table.  A device we have already seen is updated in
+					// place with its latest RSSI and pay load; nothing is allocated.  The application may be reading
+					// the table, so this is done under its lock and what we report is a copy made under the lock.
+					size_t payloadLength = param->scan_rst.adv_data_len + param->scan_rst.scan_rsp_len;
+					uint32_t now = FreeRTOS::getTimeSinceStart();
+					BLEScanResult result;
+					m_pResultTable->lock();
+
+					// Drop advertisements that don't meet the filter before doing anything else with them.  A scan
+					// response on its own is kept for a device whose advertisement has already met the filter.
+					bool known = param->scan_rst.adv_data_len == 0 && m_pResultTable->find(param->scan_rst.bda) != nullptr;
+					if (!known && m_pFilter != nullptr &&
+							!m_pFilter->matches(param->scan_rst.bda, param->scan_rst.rssi, param->scan_rst.ble_adv, payloadLength)) {
+						m_pResultTable->unlock();
+						break;
+					}
 
-					if (m_scanResults.m_vectorAdvertisedDevices.count(advertisedAddress.toString()) != 0) {
-						found = true;
+					bool isNew = false;
+					BLEScanResult* pResult = m_pResultTable->update(
+						param->scan_rst.bda,
+						param->scan_rst.ble_addr_type,
+						param->scan_rst.rssi,
+						param->scan_rst.ble_adv,
+						param->scan_rst.adv_data_len,
+						param->scan_rst.scan_rsp_len,
+						now,
+						&isNew);
+					bool recorded = pResult != nullptr;
+					bool report   = !recorded || isNew || isReportDue(pResult, param->scan_rst.rssi, now);
+					bool full     = !recorded && m_pResultTable->getDropCount() == 1;
+					if (recorded && report) {
+						pResult->lastReported = now;
+						pResult->reportedRSSI = param->scan_rst.rssi;
+						result = *pResult;
 					}
+					m_pResultTable->unlock();
 
-					if (found && !m_wantDuplicates) {  // If we found a previous entry AND we don't want duplicates, then we are done.
-						ESP_LOGD(LOG_TAG, "Ignoring %s, already seen it.", advertisedAddress.toString().c_str());
+					if (!report) {  // A duplicate that we don't want reported (yet).
 						vTaskDelay(1);  // <--- allow to switch task in case we scan infinity and dont have new devices to report, or we are blocked here
 						break;
 					}
-
-					// We now construct a model of the advertised device that we have just found for the first
-					// time.
-					// ESP_LOG_BUFFER_HEXDUMP(LOG_TAG, (uint8_t*)param->scan_rst.ble_adv, param->scan_rst.adv_data_len + param->scan_rst.scan_rsp_len, ESP_LOG_DEBUG);
-					// ESP_LOGW(LOG_TAG, "bytes length: %d + %d, addr type: %d", param->scan_rst.adv_data_len, param->scan_rst.scan_rsp_len, param->scan_rst.ble_addr_type);
-					BLEAdvertisedDevice *advertisedDevice = new BLEAdvertisedDevice();
-					advertisedDevice->setAddress(advertisedAddress);
-					advertisedDevice->setRSSI(param->scan_rst.rssi);
-					advertisedDevice->setAdFlag(param->scan_rst.flag);
-					advertisedDevice->parseAdvertisement((uint8_t*)param->scan_rst.ble_adv, param->scan_rst.adv_data_len + param->scan_rst.scan_rsp_len);
-					advertisedDevice->setScan(this);
-					advertisedDevice->setAddressType(param->scan_rst.ble_addr_type);
-
-					if (!found) {   // If we have previously seen this device, don't record it again.
-						m_scanResults.m_vectorAdvertisedDevices.insert(std::pair<std::string, BLEAdvertisedDevice*>(advertisedAddress.toString(), advertisedDevice));
+					if (full) {
+						ESP_LOGW(LOG_TAG, "Result table full (%d devices), not recording further devices", m_pResultTable->getCapacity());
 					}
 
+					// Only build a model of the advertised device if someone wants to be told about it.  If the table
+					// was full we build it from the event, in which case its pay load is only valid during the call.
 					if (m_pAdvertisedDeviceCallbacks) {
+						BLEAdvertisedDevice advertisedDevice;
+						if (recorded) {
+							advertisedDevice.setScanResult(result);
+						} else {
+							advertisedDevice.setAddress(BLEAddress(param->scan_rst.bda));
+							advertisedDevice.setAddressType(param->scan_rst.ble_addr_type);
+							advertisedDevice.setRSSI(param->scan_rst.rssi);
+							advertisedDevice.parseAdvertisement((uint8_t*)param->scan_rst.ble_adv, payloadLength);
+						}
+						advertisedDevice.setScan(this);
+						m_pAdvertisedDeviceCallbacks->onResult(&advertisedDevice);
 						m_pAdvertisedDeviceCallbacks->onResult(advertisedDevice);
-						m_pAdvertisedDeviceCallbacks->onResult(*advertisedDevice);
 					}
-					if(found)
-						delete advertisedDevice;
 
 					break;
 				} // ESP_GAP_SEARCH_INQ_RES_EVT
@@ -150,6 +179,22 @@ void BLEScan::handleGAPEvent(
 } // gapEventHandler
 
 
+/**
+ * @brief Should an advertisement from a device that has already been reported be reported again?
+ * @param [in] pResult The result for the device.
+ * @param [in] rssi The RSSI of the new advertisement.
+ * @param [in] now The time of the new advertisement.
+ * @return True if the device should be reported again.
+ */
+bool BLEScan::isReportDue(BLEScanResult* pResult, int rssi, uint32_t now) {
+	if (!m_wantDuplicates) return false;
+	if (m_duplicateInterval == 0 && m_duplicateRSSIDelta == 0) return true;   // Every duplicate is wanted.
+	if (m_duplicateInterval != 0 && now - pResult->lastReported >= m_duplicateInterval) return true;
+	if (m_duplicateRSSIDelta != 0 && ::abs(rssi - pResult->reportedRSSI) >= m_duplicateRSSIDelta) return true;
+	return false;
+} // isReportDue
+
+
 /**
  * @brief Should we perform an active or passive scan?
  * The default is a passive scan.  An active scan means that we will wish a scan response.
@@ -176,6 +221,38 @@ void BLEScan::setAdvertisedDeviceCallbacks(BLEAdvertisedDeviceCallbacks* pAdvert
 } // setAdvertisedDeviceCallbacks
 
 
+/**
+ * @brief Limit how often a device is reported again when duplicates are wanted.
+ * When the call backs have been set to want duplicates, a device that has already been reported is
+ * reported again only once the interval has passed since it was last reported or its RSSI has changed
+ * by at least rssiDelta since then.  Setting both to 0 reports every advertisement.
+ *
+ * @code{.cpp}
+ * pBLEScan->setAdvertisedDeviceCallbacks(&callbacks, true);
+ * pBLEScan->setDuplicateFilter(1000, 6);   // At most once a second unless the RSSI moves by 6dB.
+ * @endcode
+ *
+ * @param [in] intervalMSecs The minimum interval between reports of the same device or 0 for no limit.
+ * @param [in] rssiDelta The change in RSSI that causes a device to be reported before the interval has
+ * passed or 0 to ignore changes in RSSI.
+ */
+void BLEScan::setDuplicateFilter(uint32_t intervalMSecs, uint8_t rssiDelta) {
+	m_duplicateInterval  = intervalMSecs;
+	m_duplicateRSSIDelta = rssiDelta;
+} // setDuplicateFilter
+
+
+/**
+ * @brief Set the filter that advertisements must pass to be recorded and reported.
+ * The filter is applied to the raw advertisement before anything is stored or built.  The filter is
+ * not copied; it must remain valid while scanning.
+ * @param [in] pFilter The filter or nullptr to accept every advertisement.
+ */
+void BLEScan::setFilter(BLEScanFilter* pFilter) {
+	m_pFilter = pFilter;
+} // setFilter
+
+
 /**
  * @brief Set the interval to scan.
  * @param [in] The interval in msecs.
@@ -209,11 +286,11 @@ bool BLEScan::start(uint32_t duration, void (*scanCompleteCB)(BLEScanResults), b
 
 	//  if we are connecting to devices that are advertising even after being connected, multiconnecting peripherals
 	//  then we should not clear map or we will connect the same device few times
-	if(!is_continue) {  
-		for(auto _dev : m_scanResults.m_vectorAdvertisedDevices){
-			delete _dev.second;
-		}
-		m_scanResults.m_vectorAdvertisedDevices.clear();
+	if (m_pResultTable == nullptr) {
+		m_pResultTable = std::make_shared<BLEScanResultTable>(m_maxResults);
+		m_scanResults.m_pTable = m_pResultTable;
+	} else if (!is_continue) {
+		clearResults();
 	}
 
 	esp_err_t errRc = ::esp_ble_gap_set_scan_params(&m_scan_params);
@@ -275,9 +352,11 @@ void BLEScan::stop() {
 // delete peer device from cache after disconnecting, it is required in case we are connecting to devices with not public address
 void BLEScan::erase(BLEAddress address) {
 	ESP_LOGI(LOG_TAG, "erase device: %s", address.toString().c_str());
-	BLEAdvertisedDevice *advertisedDevice = m_scanResults.m_vectorAdvertisedDevices.find(address.toString())->second;
-	m_scanResults.m_vectorAdvertisedDevices.erase(address.toString());
-	delete advertisedDevice;
+	if (m_pResultTable != nullptr) {
+		m_pResultTable->lock();
+		m_pResultTable->erase(*address.getNative());
+		m_pResultTable->unlock();
+	}
 }
 
 
@@ -297,7 +376,11 @@ void BLEScanResults::dump() {
  * @return The number of devices found in the last scan.
  */
 int BLEScanResults::getCount() {
-	return m_vectorAdvertisedDevices.size();
+	if (m_pTable == nullptr) return 0;
+	m_pTable->lock();
+	int count = m_pTable->getCount();
+	m_pTable->unlock();
+	return count;
 } // getCount
 
 
@@ -308,25 +391,64 @@ int BLEScanResults::getCount() {
  * @return The device at the specified index.
  */
 BLEAdvertisedDevice BLEScanResults::getDevice(uint32_t i) {
-	uint32_t x = 0;
-	BLEAdvertisedDevice dev = *m_vectorAdvertisedDevices.begin()->second;
-	for (auto it = m_vectorAdvertisedDevices.begin(); it != m_vectorAdvertisedDevices.end(); it++) {
-		dev = *it->second;
-		if (x==i)	break;
-		x++;
+	BLEAdvertisedDevice dev;
+	BLEScanResult result;
+	if (getResult(i, &result)) {
+		dev.setScanResult(result);
+		dev.setScan(m_pScan);
 	}
 	return dev;
-}
+} // getDevice
+
+
+/**
+ * @brief Copy the raw result at the given index.
+ * This gives access to the address, RSSI and pay load of a device without parsing the pay load or
+ * allocating.  The pay load can be walked with a BLEAdvertisementParser.
+ * @param [in] i The index of the result, between 0 and getCount()-1.
+ * @param [out] pResult The copy of the result.
+ * @return False if the index is out of range.
+ */
+bool BLEScanResults::getResult(uint32_t i, BLEScanResult* pResult) {
+	if (m_pTable == nullptr) return false;
+	m_pTable->lock();
+	BLEScanResult* pFound = m_pTable->getResult(i);
+	if (pFound != nullptr) *pResult = *pFound;
+	m_pTable->unlock();
+	return pFound != nullptr;
+} // getResult
+
 
 BLEScanResults BLEScan::getResults() {
 	return m_scanResults;
 }
 
 void BLEScan::clearResults() {
-	for(auto _dev : m_scanResults.m_vectorAdvertisedDevices){
-		delete _dev.second;
+	if (m_pResultTable != nullptr) {
+		m_pResultTable->lock();
+		m_pResultTable->clear();
+		m_pResultTable->unlock();
 	}
-	m_scanResults.m_vectorAdvertisedDevices.clear();
 }
 
+
+/**
+ * @brief Set the maximum number of devices recorded by a scan.
+ * The memory for the results is allocated once when scanning first starts.  Once the table is full,
+ * further devices are still reported to the callbacks but are not recorded.  Changing the size starts
+ * a new table; results already handed out keep the old one.  The size can't be changed while scanning.
+ * @param [in] maxResults The maximum number of devices.
+ */
+void BLEScan::setMaxResults(size_t maxResults) {
+	if (!m_stopped) {
+		ESP_LOGW(LOG_TAG, "setMaxResults: Not changed while scanning");
+		return;
+	}
+	if (m_pResultTable != nullptr && m_pResultTable->getCapacity() != maxResults) {
+		m_pResultTable.reset();
+		m_scanResults.m_pTable.reset();
+	}
+	m_maxResults = maxResults;
+} // setMaxResults
+
 #endif /* CONFIG_BT_ENABLED */
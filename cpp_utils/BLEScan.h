@@ -12,9 +12,12 @@
 #include <esp_gap_ble_api.h>
 
 // #include <vector>
+#include <memory>
 #include <string>
 #include "BLEAdvertisedDevice.h"
 #include "BLEClient.h"
+#include "BLEScanFilter.h"
+#include "BLEScanResultTable.h"
 #include "FreeRTOS.h"
 
 class BLEAdvertisedDevice;
@@ -29,16 +32,23 @@ class BLEScan;
  * by a BLEAdvertisedDevice object.  The number of items in the set is given by
  * getCount().  We can retrieve a device by calling getDevice() passing in the
  * index (starting at 0) of the desired device.
+ *
+ * The results are a view of the result table of the scan, so they are cheap to copy and reflect
+ * later scans.  Devices are built from the stored raw advertisements when they are asked for and are
+ * copies, so they remain valid while the scan goes on.  The table is shared by the copies and the scan,
+ * and lives as long as any of them; a copy taken before setMaxResults() keeps the old results.
  */
 class BLEScanResults {
 public:
 	void                dump();
 	int                 getCount();
 	BLEAdvertisedDevice getDevice(uint32_t i);
+	bool                getResult(uint32_t i, BLEScanResult* pResult);   // Copy the raw result at an index without building a device.
 
 private:
 	friend BLEScan;
-	std::map<std::string, BLEAdvertisedDevice*> m_vectorAdvertisedDevices;
+	std::shared_ptr<BLEScanResultTable> m_pTable;   // The table of the scan.
+	BLEScan*            m_pScan  = nullptr;
 };
 
 /**
@@ -60,6 +70,9 @@ public:
 	void 		   erase(BLEAddress address);
 	BLEScanResults getResults();
 	void			clearResults();
+	void           setDuplicateFilter(uint32_t intervalMSecs, uint8_t rssiDelta = 0);
+	void           setFilter(BLEScanFilter* pFilter);
+	void           setMaxResults(size_t maxResults);
 
 private:
 	BLEScan();   // One doesn't create a new instance instead one asks the BLEDevice for the singleton.
@@ -68,6 +81,7 @@ private:
 		esp_gap_ble_cb_event_t  event,
 		esp_ble_gap_cb_param_t* param);
 	void parseAdvertisement(BLEClient* pRemoteDevice, uint8_t *payload);
+	bool isReportDue(BLEScanResult* pResult, int rssi, uint32_t now);
 
 
 	esp_ble_scan_params_t         m_scan_params;
@@ -75,6 +89,11 @@ private:
 	bool                          m_stopped = true;
 	FreeRTOS::Semaphore           m_semaphoreScanEnd = FreeRTOS::Semaphore("ScanEnd");
 	BLEScanResults                m_scanResults;
+	std::shared_ptr<BLEScanResultTable> m_pResultTable;       // Devices found, allocated on first use.
+	size_t                        m_maxResults;               // Capacity of the result table.
+	BLEScanFilter*                m_pFilter = nullptr;        // Criteria an advertisement must meet to be recorded.
+	uint32_t                      m_duplicateInterval;        // Minimum time between reports of the same device.
+	uint8_t                       m_duplicateRSSIDelta;       // Change in RSSI that causes a device to be reported early.
 	bool                          m_wantDuplicates;
 	void                        (*m_scanCompleteCB)(BLEScanResults scanResults);
 }; // BLEScan
@@ -0,0 +1,185 @@
+/*
+ * BLEScanFilter.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <string.h>
+#include <esp_gap_ble_api.h>
+#include "BLEScanFilter.h"
+#include "BLEAdvertisementParser.h"
+
+// The Bluetooth base UUID 00000000-0000-1000-8000-00805F9B34FB in little endian order.  Short UUIDs
+// occupy bytes 12 to 15.
+static const uint8_t BASE_UUID[16] = {
+	0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+
+BLEScanFilter::BLEScanFilter() {
+	clear();
+} // BLEScanFilter
+
+
+/**
+ * @brief Accept advertisements from a device.
+ * Once any address has been added, advertisements from other devices are ignored.
+ * @param [in] address The address of the device.
+ */
+void BLEScanFilter::addAddress(BLEAddress address) {
+	uint8_t* pAddress = *address.getNative();
+	m_addresses.insert(m_addresses.end(), pAddress, pAddress + 6);
+} // addAddress
+
+
+/**
+ * @brief Accept advertisements that name a service.
+ * The service may appear in any of the service UUID lists or as the UUID of service data.  Once any
+ * UUID has been added, advertisements that name none of them are ignored.
+ * @param [in] uuid The UUID of the service.
+ */
+void BLEScanFilter::addServiceUUID(BLEUUID uuid) {
+	uint8_t* pUUID = uuid.to128().getNative()->uuid.uuid128;
+	m_serviceUUIDs.insert(m_serviceUUIDs.end(), pUUID, pUUID + 16);
+} // addServiceUUID
+
+
+void BLEScanFilter::clear() {
+	m_addresses.clear();
+	m_serviceUUIDs.clear();
+	m_manufacturerPrefix.clear();
+	m_namePrefix.clear();
+	m_haveManufacturerPrefix = false;
+	m_minRSSI                = -128;
+} // clear
+
+
+bool BLEScanFilter::hasAddress(const uint8_t* address) const {
+	for (size_t i = 0; i < m_addresses.size(); i += 6) {
+		if (::memcmp(&m_addresses[i], address, 6) == 0) return true;
+	}
+	return false;
+} // hasAddress
+
+
+/**
+ * @brief Is a UUID from an advertisement one of those we accept?
+ * @param [in] pData The UUID as found in the advertisement; little endian.
+ * @param [in] length The length of the UUID; 2, 4 or 16.
+ */
+bool BLEScanFilter::hasServiceUUID(const uint8_t* pData, size_t length) const {
+	uint8_t uuid[16];
+	if (length == 16) {
+		::memcpy(uuid, pData, 16);
+	} else {
+		::memcpy(uuid, BASE_UUID, 16);
+		::memcpy(uuid + 12, pData, length);
+	}
+	for (size_t i = 0; i < m_serviceUUIDs.size(); i += 16) {
+		if (::memcmp(&m_serviceUUIDs[i], uuid, 16) == 0) return true;
+	}
+	return false;
+} // hasServiceUUID
+
+
+/**
+ * @brief Does an advertisement meet the criteria?
+ * The cheap tests on the RSSI and address are made first.  The pay load is then walked once, stopping
+ * as soon as every criterion on its content has been met.
+ * @param [in] address The 6 byte address of the advertiser.
+ * @param [in] rssi The signal strength of the advertisement.
+ * @param [in] payload The raw advertisement (and scan response) data.
+ * @param [in] length The length of the pay load.
+ * @return True if the advertisement should be recorded and reported.
+ */
+bool BLEScanFilter::matches(const uint8_t* address, int rssi, const uint8_t* payload, size_t length) const {
+	if (rssi < m_minRSSI) return false;
+	if (!m_addresses.empty() && !hasAddress(address)) return false;
+
+	bool needName         = !m_namePrefix.empty();
+	bool needUUID         = !m_serviceUUIDs.empty();
+	bool needManufacturer = m_haveManufacturerPrefix;
+	if (!needName && !needUUID && !needManufacturer) return true;
+
+	BLEAdvertisementParser parser(payload, length);
+	for (BLEAdvertisementParser::Iterator it = parser.begin(); it != parser.end(); ++it) {
+		const BLEAdField& field = *it;
+		switch (field.type) {
+			case ESP_BLE_AD_TYPE_NAME_CMPL:
+			case ESP_BLE_AD_TYPE_NAME_SHORT: {
+				if (field.length >= m_namePrefix.length() && ::memcmp(field.data, m_namePrefix.data(), m_namePrefix.length()) == 0) {
+					needName = false;
+				}
+				break;
+			}
+
+			case ESP_BLE_AD_TYPE_16SRV_PART:
+			case ESP_BLE_AD_TYPE_16SRV_CMPL:
+			case ESP_BLE_AD_TYPE_32SRV_PART:
+			case ESP_BLE_AD_TYPE_32SRV_CMPL:
+			case ESP_BLE_AD_TYPE_128SRV_PART:
+			case ESP_BLE_AD_TYPE_128SRV_CMPL: {
+				size_t size = (field.type == ESP_BLE_AD_TYPE_16SRV_PART || field.type == ESP_BLE_AD_TYPE_16SRV_CMPL) ? 2 :
+					(field.type == ESP_BLE_AD_TYPE_32SRV_PART || field.type == ESP_BLE_AD_TYPE_32SRV_CMPL) ? 4 : 16;
+				for (size_t i = 0; needUUID && i + size <= field.length; i += size) {
+					if (hasServiceUUID(field.data + i, size)) needUUID = false;
+				}
+				break;
+			}
+
+			case ESP_BLE_AD_TYPE_SERVICE_DATA:
+			case ESP_BLE_AD_TYPE_32SERVICE_DATA:
+			case ESP_BLE_AD_TYPE_128SERVICE_DATA: {
+				size_t size = field.type == ESP_BLE_AD_TYPE_SERVICE_DATA ? 2 : field.type == ESP_BLE_AD_TYPE_32SERVICE_DATA ? 4 : 16;
+				if (needUUID && field.length >= size && hasServiceUUID(field.data, size)) needUUID = false;
+				break;
+			}
+
+			case ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE: {
+				if (field.length >= m_manufacturerPrefix.length() &&
+						::memcmp(field.data, m_manufacturerPrefix.data(), m_manufacturerPrefix.length()) == 0) {
+					needManufacturer = false;
+				}
+				break;
+			}
+
+			default:
+				break;
+		} // switch
+		if (!needName && !needUUID && !needManufacturer) return true;
+	} // for each AD structure
+	return false;
+} // matches
+
+
+/**
+ * @brief Accept only advertisements whose manufacturer data starts with a prefix.
+ * The manufacturer data starts with the 16 bit company identifier in little endian order, so a prefix of
+ * two bytes selects a manufacturer and a longer prefix can select a kind of beacon.
+ * @param [in] prefix The prefix.  An empty prefix accepts any advertisement with manufacturer data.
+ */
+void BLEScanFilter::setManufacturerPrefix(std::string prefix) {
+	m_manufacturerPrefix     = prefix;
+	m_haveManufacturerPrefix = true;
+} // setManufacturerPrefix
+
+
+/**
+ * @brief Ignore advertisements received with a signal weaker than this.
+ * @param [in] rssi The minimum RSSI in dBm.
+ */
+void BLEScanFilter::setMinRSSI(int rssi) {
+	m_minRSSI = rssi;
+} // setMinRSSI
+
+
+/**
+ * @brief Accept only advertisements whose complete or shortened local name starts with a prefix.
+ * @param [in] prefix The prefix.  An empty prefix removes the criterion.
+ */
+void BLEScanFilter::setNamePrefix(std::string prefix) {
+	m_namePrefix = prefix;
+} // setNamePrefix
+
+#endif /* CONFIG_BT_ENABLED */
@@ -0,0 +1,56 @@
+/*
+ * BLEScanFilter.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANFILTER_H_
+#define COMPONENTS_CPP_UTILS_BLESCANFILTER_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <string>
+#include <vector>
+#include "BLEAddress.h"
+#include "BLEUUID.h"
+
+/**
+ * @brief Criteria that an advertisement must meet to be recorded and reported by a scan.
+ *
+ * The filter is applied to the raw advertisement before anything is stored or any object is built, so
+ * advertisements of no interest cost only a pass over their pay load.  Every criterion that has been set
+ * must be met.  Where several addresses or service UUIDs are given, any one of them will do.
+ *
+ * @code{.cpp}
+ * BLEScanFilter filter;
+ * filter.addServiceUUID(BLEUUID((uint16_t) 0x180f));
+ * filter.setMinRSSI(-80);
+ * pBLEScan->setFilter(&filter);
+ * @endcode
+ */
+class BLEScanFilter {
+public:
+	BLEScanFilter();
+
+	void addAddress(BLEAddress address);                      // Accept advertisements from this device.
+	void addServiceUUID(BLEUUID uuid);                        // Accept advertisements naming this service.
+	void clear();                                             // Remove all the criteria.
+	bool matches(const uint8_t* address, int rssi, const uint8_t* payload, size_t length) const;
+	void setManufacturerPrefix(std::string prefix);           // Manufacturer data must start with this (company id first, little endian).
+	void setMinRSSI(int rssi);                                // Ignore weaker advertisements.
+	void setNamePrefix(std::string prefix);                   // The local name must start with this.
+
+private:
+	std::vector<uint8_t> m_addresses;            // 6 bytes per address.
+	std::vector<uint8_t> m_serviceUUIDs;         // 16 bytes per UUID in the little endian 128 bit form.
+	std::string          m_manufacturerPrefix;
+	std::string          m_namePrefix;
+	bool                 m_haveManufacturerPrefix;
+	int                  m_minRSSI;
+
+	bool hasAddress(const uint8_t* address) const;
+	bool hasServiceUUID(const uint8_t* pData, size_t length) const;
+
+}; // BLEScanFilter
+
+#endif /* CONFIG_BT_ENABLED */
+#endif /* COMPONENTS_CPP_UTILS_BLESCANFILTER_H_ */
@@ -0,0 +1,223 @@
+/*
+ * BLEScanResultTable.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include <string.h>
+#include "BLEScanResultTable.h"
+
+static const size_t MAX_CAPACITY = 0x7fff;   // Result numbers + 1 must fit in the 16 bit index.
+
+
+/**
+ * @brief Create a table.
+ * @param [in] capacity The maximum number of devices the table can hold.
+ */
+BLEScanResultTable::BLEScanResultTable(size_t capacity) {
+	if (capacity == 0) capacity = 1;
+	if (capacity > MAX_CAPACITY) capacity = MAX_CAPACITY;
+	size_t indexSize = 1;
+	while (indexSize < capacity * 2) indexSize <<= 1;   // Keep the index at most half full.
+
+	m_capacity  = capacity;
+	m_indexMask = indexSize - 1;
+	m_results   = new BLEScanResult[capacity];
+	m_index     = new uint16_t[indexSize];
+	::pthread_mutex_init(&m_lock, nullptr);
+	clear();
+} // BLEScanResultTable
+
+
+BLEScanResultTable::~BLEScanResultTable() {
+	::pthread_mutex_destroy(&m_lock);
+	delete[] m_index;
+	delete[] m_results;
+} // ~BLEScanResultTable
+
+
+/**
+ * @brief Remove all the results.
+ */
+void BLEScanResultTable::clear() {
+	::memset(m_index, 0, (m_indexMask + 1) * sizeof(m_index[0]));
+	m_count     = 0;
+	m_dropCount = 0;
+} // clear
+
+
+/**
+ * @brief Remove the result for a device.
+ * The last result in the table is moved into the place of the removed one, so the index of results and
+ * pointers previously returned for that last result change.
+ * @param [in] address The 6 byte address of the device.
+ * @return True if the device was in the table.
+ */
+bool BLEScanResultTable::erase(const uint8_t* address) {
+	size_t slot = findSlot(address);
+	if (m_index[slot] == 0) return false;
+	size_t number = m_index[slot] - 1;
+
+	// Backward shift deletion: close the gap by moving later entries of the probe sequence into it if their
+	// home slot allows, so that no tombstones are needed.
+	m_index[slot] = 0;
+	size_t hole = slot;
+	size_t next = slot;
+	while (true) {
+		next = (next + 1) & m_indexMask;
+		if (m_index[next] == 0) break;
+		size_t home = hash(m_results[m_index[next] - 1].address);
+		if (((next - home) & m_indexMask) >= ((next - hole) & m_indexMask)) {
+			m_index[hole] = m_index[next];
+			m_index[next] = 0;
+			hole = next;
+		}
+	}
+
+	// Keep the results dense by moving the last one into the vacated place.
+	size_t last = m_count - 1;
+	if (number != last) {
+		m_results[number] = m_results[last];
+		m_index[findSlot(m_results[last].address)] = number + 1;
+	}
+	m_count--;
+	return true;
+} // erase
+
+
+/**
+ * @brief Find the result for a device.
+ * @param [in] address The 6 byte address of the device.
+ * @return The result or nullptr if the device isn't in the table.
+ */
+BLEScanResult* BLEScanResultTable::find(const uint8_t* address) {
+	uint16_t entry = m_index[findSlot(address)];
+	return entry == 0 ? nullptr : &m_results[entry - 1];
+} // find
+
+
+/**
+ * @brief Find the index slot holding a device or the empty slot where it would be placed.
+ */
+size_t BLEScanResultTable::findSlot(const uint8_t* address) const {
+	size_t slot = hash(address);
+	while (m_index[slot] != 0 && ::memcmp(m_results[m_index[slot] - 1].address, address, 6) != 0) {
+		slot = (slot + 1) & m_indexMask;
+	}
+	return slot;
+} // findSlot
+
+
+size_t BLEScanResultTable::getCapacity() const {
+	return m_capacity;
+} // getCapacity
+
+
+size_t BLEScanResultTable::getCount() const {
+	return m_count;
+} // getCount
+
+
+uint32_t BLEScanResultTable::getDropCount() const {
+	return m_dropCount;
+} // getDropCount
+
+
+/**
+ * @brief Get a result by its position in the table.
+ * @param [in] index The position, between 0 and getCount()-1.
+ * @return The result or nullptr if the index is out of range.
+ */
+BLEScanResult* BLEScanResultTable::getResult(size_t index) {
+	return index < m_count ? &m_results[index] : nullptr;
+} // getResult
+
+
+/**
+ * @brief Get the home slot of an address.
+ * The address is taken as a 48 bit integer and spread over the index with a multiplicative hash.
+ */
+size_t BLEScanResultTable::hash(const uint8_t* address) const {
+	uint64_t key = 0;
+	for (int i = 0; i < 6; i++) {
+		key = (key << 8) | address[i];
+	}
+	return (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & m_indexMask;
+} // hash
+
+
+/**
+ * @brief Take the lock guarding the table against use by another task.
+ */
+void BLEScanResultTable::lock() {
+	::pthread_mutex_lock(&m_lock);
+} // lock
+
+
+void BLEScanResultTable::unlock() {
+	::pthread_mutex_unlock(&m_lock);
+} // unlock
+
+
+/**
+ * @brief Record an advertisement or a scan response from a device.
+ * A device already in the table has its RSSI and counters updated in place.  The advertisement and the
+ * scan response are replaced independently, so a scan response doesn't lose the advertisement that
+ * preceded it and a later advertisement keeps the scan response.
+ * @param [in] address The 6 byte address of the device.
+ * @param [in] addressType The type of the address.
+ * @param [in] rssi The signal strength of the advertisement.
+ * @param [in] payload The advertisement data followed by any scan response data.
+ * @param [in] advLength The length of the advertisement data, 0 for a scan response on its own.
+ * @param [in] scanResponseLength The length of the scan response data, 0 if there is none.  Anything of
+ * either beyond BLEScanResult::MAX_PART is dropped.
+ * @param [in] now The time of the advertisement in whatever units the caller chooses.
+ * @param [out] pIsNew Set to true if the device was added to the table.  May be nullptr.
+ * @return The result for the device or nullptr if it is new and the table is full.
+ */
+BLEScanResult* BLEScanResultTable::update(const uint8_t* address, uint8_t addressType, int8_t rssi,
+		const uint8_t* payload, size_t advLength, size_t scanResponseLength, uint32_t now, bool* pIsNew) {
+	if (pIsNew != nullptr) *pIsNew = false;
+	const uint8_t* pScanResponse = payload + advLength;
+	if (advLength > BLEScanResult::MAX_PART) advLength = BLEScanResult::MAX_PART;
+	if (scanResponseLength > BLEScanResult::MAX_PART) scanResponseLength = BLEScanResult::MAX_PART;
+
+	size_t slot = findSlot(address);
+	BLEScanResult* pResult;
+	if (m_index[slot] != 0) {
+		pResult = &m_results[m_index[slot] - 1];
+		if (pResult->seenCount != UINT16_MAX) pResult->seenCount++;
+	} else {
+		if (m_count == m_capacity) {
+			m_dropCount++;
+			return nullptr;
+		}
+		pResult = &m_results[m_count];
+		::memcpy(pResult->address, address, 6);
+		pResult->seenCount     = 1;
+		pResult->reportedRSSI  = 0;
+		pResult->lastReported  = 0;
+		pResult->advLength     = 0;
+		pResult->payloadLength = 0;
+		m_index[slot] = ++m_count;
+		if (pIsNew != nullptr) *pIsNew = true;
+	}
+	pResult->addressType = addressType;
+	pResult->rssi        = rssi;
+	pResult->lastSeen    = now;
+
+	uint8_t scanResponse[BLEScanResult::MAX_PART];   // The new scan response or the one we already have.
+	if (scanResponseLength > 0) {
+		::memcpy(scanResponse, pScanResponse, scanResponseLength);
+	} else {
+		scanResponseLength = pResult->payloadLength - pResult->advLength;
+		::memcpy(scanResponse, pResult->payload + pResult->advLength, scanResponseLength);
+	}
+	if (advLength > 0) {
+		::memcpy(pResult->payload, payload, advLength);
+		pResult->advLength = advLength;
+	}
+	::memcpy(pResult->payload + pResult->advLength, scanResponse, scanResponseLength);
+	pResult->payloadLength = pResult->advLength + scanResponseLength;
+	return pResult;
+} // update
@@ -0,0 +1,89 @@
+/*
+ * BLEScanResultTable.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANRESULTTABLE_H_
+#define COMPONENTS_CPP_UTILS_BLESCANRESULTTABLE_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/**
+ * @brief What we know of one advertising device found by a scan.
+ */
+struct BLEScanResult {
+	static const size_t MAX_PART    = 31;             // Largest advertisement or scan response.
+	static const size_t MAX_PAYLOAD = 2 * MAX_PART;   // Advertisement followed by scan response.
+
+	uint8_t  address[6];
+	uint8_t  addressType;
+	int8_t   rssi;
+	uint8_t  advLength;       // Length of the advertisement at the start of the payload.
+	uint8_t  payloadLength;   // Length of the advertisement and the scan response that follows it.
+	uint8_t  payload[MAX_PAYLOAD];
+	int8_t   reportedRSSI;    // RSSI when the device was last reported to the application.
+	uint16_t seenCount;       // Number of advertisements received from the device.
+	uint32_t lastSeen;        // Time of the last advertisement as given by the caller.
+	uint32_t lastReported;    // Time the device was last reported to the application.
+}; // BLEScanResult
+
+
+/**
+ * @brief A fixed capacity table of scan results keyed by the 48 bit device address.
+ *
+ * All the memory is allocated when the table is created.  Results are held in a dense array, which makes
+ * them cheap to iterate by index, and are found by address through an open addressed (linear probing)
+ * index of twice the capacity.  An advertisement from a device already in the table updates its RSSI and
+ * payload in place; an advertisement and a scan response, which arrive separately, are kept side by side.
+ * When the table is full, advertisements from new devices are counted and dropped.
+ *
+ * The table doesn't lock itself.  When it is updated by one task and read by another, every access, and
+ * every use of a result pointer it returns, is made between lock() and unlock().  A result pointer is only
+ * valid until the table is next changed.
+ *
+ * The table has no dependencies on the ESP-IDF so it can be exercised on a host with recorded captures.
+ *
+ * @code{.cpp}
+ * BLEScanResultTable table(128);
+ * bool isNew;
+ * table.lock();
+ * BLEScanResult* pResult = table.update(bda, addrType, rssi, adv, advLength, scanRspLength, millis, &isNew);
+ * table.unlock();
+ * @endcode
+ */
+class BLEScanResultTable {
+public:
+	BLEScanResultTable(size_t capacity);
+	virtual ~BLEScanResultTable();
+
+	void           clear();
+	bool           erase(const uint8_t* address);
+	BLEScanResult* find(const uint8_t* address);
+	size_t         getCapacity() const;
+	size_t         getCount() const;
+	uint32_t       getDropCount() const;    // Number of new devices refused because the table was full.
+	BLEScanResult* getResult(size_t index);
+	void           lock();
+	void           unlock();
+	BLEScanResult* update(const uint8_t* address, uint8_t addressType, int8_t rssi,
+		const uint8_t* payload, size_t advLength, size_t scanResponseLength, uint32_t now, bool* pIsNew);
+
+private:
+	pthread_mutex_t m_lock;
+	BLEScanResult* m_results;     // Dense array of results; the first m_count are in use.
+	uint16_t*      m_index;       // Open addressed index; result number + 1 or 0 for an empty slot.
+	size_t         m_capacity;
+	size_t         m_indexMask;
+	size_t         m_count;
+	uint32_t       m_dropCount;
+
+	BLEScanResultTable(const BLEScanResultTable&);             // Not copyable, we own the arrays.
+	BLEScanResultTable& operator=(const BLEScanResultTable&);
+	size_t findSlot(const uint8_t* address) const;
+	size_t hash(const uint8_t* address) const;
+
+}; // BLEScanResultTable
+
+#endif /* COMPONENTS_CPP_UTILS_BLESCANRESULTTABLE_H_ */
@@ -136,6 +136,15 @@ uint32_t BLEServer::getConnectedCount() {
 } // getConnectedCount
 
 
+/**
+ * @brief Get the queue through which characteristics send queued notifications and indications.
+ * @return The notification queue.
+ */
+BLENotificationQueue* BLEServer::getNotificationQueue() {
+	return &m_notificationQueue;
+} // getNotificationQueue
+
+
 uint16_t BLEServer::getGattsIf() {
 	return m_gatts_if;
 }
@@ -275,6 +284,9 @@ void BLEServer::handleGATTServerEvent(esp_gatts_cb_event_t event, esp_gatt_if_t
 			break;
 	}
 
+	// Keep the notification queue up to date with connections and confirmations.
+	m_notificationQueue.handleGATTServerEvent(event, gatts_if, param);
+
 	// Invoke the handler for every Service we have.
 	m_serviceMap.handleGATTServerEvent(event, gatts_if, param);
 
@@ -11,13 +11,16 @@
 #if defined(CONFIG_BT_ENABLED)
 #include <esp_gatts_api.h>
 
+#include <map>
 #include <string>
 #include <string.h>
+#include <vector>
 // #include "BLEDevice.h"
 
 #include "BLEUUID.h"
 #include "BLEAdvertising.h"
 #include "BLECharacteristic.h"
+#include "BLENotificationQueue.h"
 #include "BLEService.h"
 #include "BLESecurity.h"
 #include "FreeRTOS.h"
@@ -52,8 +55,9 @@ public:
 
 private:
 	std::map<uint16_t, BLEService*>    m_handleMap;
-	std::map<BLEService*, std::string> m_uuidMap;
-	std::map<BLEService*, std::string>::iterator m_iterator;
+	std::multimap<BLEUUID, BLEService*> m_uuidMap;           // Services may share a UUID.
+	std::vector<BLEService*>           m_services;          // In the order they were created.
+	std::vector<BLEService*>::iterator m_iterator;
 };
 
 
@@ -84,6 +88,7 @@ public:
 	void updatePeerMTU(uint16_t connId, uint16_t mtu);
 	uint16_t getPeerMTU(uint16_t conn_id);
 	uint16_t        getConnId();
+	BLENotificationQueue* getNotificationQueue();
 
 
 private:
@@ -102,6 +107,7 @@ private:
 	FreeRTOS::Semaphore m_semaphoreCreateEvt 		= FreeRTOS::Semaphore("CreateEvt");
 	FreeRTOS::Semaphore m_semaphoreOpenEvt   		= FreeRTOS::Semaphore("OpenEvt");
 	BLEServiceMap       m_serviceMap;
+	BLENotificationQueue m_notificationQueue;
 	BLEServerCallbacks* m_pServerCallbacks = nullptr;
 
 	void            createApp(uint16_t appId);
@@ -11,6 +11,8 @@
 #if defined(CONFIG_BT_ENABLED)
 
 #include <esp_gatts_api.h>
+#include <map>
+#include <vector>
 
 #include "BLECharacteristic.h"
 #include "BLEServer.h"
@@ -36,9 +38,10 @@ public:
 	void handleGATTServerEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
 
 private:
-	std::map<BLECharacteristic*, std::string> m_uuidMap;
+	std::multimap<BLEUUID, BLECharacteristic*> m_uuidMap;   // Characteristics may share a UUID.
 	std::map<uint16_t, BLECharacteristic*> m_handleMap;
-	std::map<BLECharacteristic*, std::string>::iterator m_iterator;
+	std::vector<BLECharacteristic*> m_characteristics;      // In the order they were added.
+	std::vector<BLECharacteristic*>::iterator m_iterator;
 };
 
 
@@ -6,6 +6,7 @@
  */
 #include "sdkconfig.h"
 #if defined(CONFIG_BT_ENABLED)
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include "BLEService.h"
@@ -26,13 +27,9 @@ BLEService* BLEServiceMap::getByUUID(const char* uuid) {
  * @return The characteristic.
  */
 BLEService* BLEServiceMap::getByUUID(BLEUUID uuid, uint8_t inst_id) {
-	for (auto &myPair : m_uuidMap) {
-		if (myPair.first->getUUID().equals(uuid)) {
-			return myPair.first;
-		}
-	}
-	//return m_uuidMap.at(uuid.toString());
-	return nullptr;
+	auto it = m_uuidMap.lower_bound(uuid);   // The first added of any sharing the UUID.
+	if (it == m_uuidMap.end() || it->first != uuid) return nullptr;
+	return it->second;
 } // getByUUID
 
 
@@ -53,7 +50,8 @@ BLEService* BLEServiceMap::getByHandle(uint16_t handle) {
  * @return N/A.
  */
 void BLEServiceMap::setByUUID(BLEUUID uuid, BLEService* service) {
-	m_uuidMap.insert(std::pair<BLEService*, std::string>(service, uuid.toString()));
+	m_uuidMap.insert(std::pair<BLEUUID, BLEService*>(uuid, service));
+	m_services.push_back(service);
 } // setByUUID
 
 
@@ -86,8 +84,8 @@ void BLEServiceMap::handleGATTServerEvent(
 		esp_gatt_if_t             gatts_if,
 		esp_ble_gatts_cb_param_t* param) {
 	// Invoke the handler for every Service we have.
-	for (auto &myPair : m_uuidMap) {
-		myPair.first->handleGATTServerEvent(event, gatts_if, param);
+	for (auto pService : m_services) {
+		pService->handleGATTServerEvent(event, gatts_if, param);
 	}
 }
 
@@ -96,9 +94,9 @@ void BLEServiceMap::handleGATTServerEvent(
  * @return The first service in the map.
  */
 BLEService* BLEServiceMap::getFirst() {
-	m_iterator = m_uuidMap.begin();
-	if (m_iterator == m_uuidMap.end()) return nullptr;
-	BLEService* pRet = m_iterator->first;
+	m_iterator = m_services.begin();
+	if (m_iterator == m_services.end()) return nullptr;
+	BLEService* pRet = *m_iterator;
 	m_iterator++;
 	return pRet;
 } // getFirst
@@ -108,8 +106,8 @@ BLEService* BLEServiceMap::getFirst() {
  * @return The next service in the map.
  */
 BLEService* BLEServiceMap::getNext() {
-	if (m_iterator == m_uuidMap.end()) return nullptr;
-	BLEService* pRet = m_iterator->first;
+	if (m_iterator == m_services.end()) return nullptr;
+	BLEService* pRet = *m_iterator;
 	m_iterator++;
 	return pRet;
 } // getNext
@@ -120,7 +118,14 @@ BLEService* BLEServiceMap::getNext() {
  */
 void BLEServiceMap::removeService(BLEService* service) {
 	m_handleMap.erase(service->getHandle());
-	m_uuidMap.erase(service);
+	auto range = m_uuidMap.equal_range(service->getUUID());
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == service) {
+			m_uuidMap.erase(it);
+			break;
+		}
+	}
+	m_services.erase(std::remove(m_services.begin(), m_services.end(), service), m_services.end());
 } // removeService
 
 /**
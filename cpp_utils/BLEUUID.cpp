@@ -54,6 +54,21 @@ static void memrcpy(uint8_t* target, uint8_t* source, uint32_t size) {
 } // memrcpy
 
 
+// The Bluetooth Base UUID 00000000-0000-1000-8000-00805f9b34fb, least significant byte first.  A 16 or 32
+// bit UUID is this with its value in the top four bytes.
+static const uint8_t BASE_UUID[12] = { 0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00 };
+
+
+/**
+ * @brief Fold the low 12 bytes of a 128 bit UUID into 32 bits.
+ */
+static uint32_t fold(const uint8_t* pUUID128) {
+	uint32_t word[3];
+	memcpy(word, pUUID128, sizeof(word));
+	return word[0] ^ ((word[1] << 11) | (word[1] >> 21)) ^ ((word[2] << 22) | (word[2] >> 10));
+} // fold
+
+
 /**
  * @brief Create a UUID from a string.
  *
@@ -72,13 +87,36 @@ static void memrcpy(uint8_t* target, uint8_t* source, uint32_t size) {
  * @param [in] value The string to build a UUID from.
  */
 BLEUUID::BLEUUID(std::string value) {
+	parse(value.data(), value.length());
+} // BLEUUID(std::string)
+
+
+/**
+ * @brief Create a UUID from a null terminated string.
+ *
+ * The string takes any of the forms accepted by BLEUUID(std::string) but is parsed in place.
+ *
+ * @param [in] value The string to build a UUID from.
+ */
+BLEUUID::BLEUUID(const char* value) {
+	parse(value, strlen(value));
+} // BLEUUID(const char*)
+
+
+/**
+ * @brief Set the UUID from a string.
+ *
+ * @param [in] value The string to parse.
+ * @param [in] length The length of the string.
+ */
+void BLEUUID::parse(const char* value, size_t length) {
 	m_valueSet = true;
-	if (value.length() == 4) {
+	if (length == 4) {
 		m_uuid.len         = ESP_UUID_LEN_16;
 		m_uuid.uuid.uuid16 = 0;
-		for(int i=0;i<value.length();){
-			uint8_t MSB = value.c_str()[i];
-			uint8_t LSB = value.c_str()[i+1];
+		for(size_t i=0;i<length;){
+			uint8_t MSB = value[i];
+			uint8_t LSB = value[i+1];
 			
 			if(MSB > '9') MSB -= 7;
 			if(LSB > '9') LSB -= 7;
@@ -86,12 +124,12 @@ BLEUUID::BLEUUID(std::string value) {
 			i+=2;	
 		}
 	}
-	else if (value.length() == 8) {
+	else if (length == 8) {
 		m_uuid.len         = ESP_UUID_LEN_32;
 		m_uuid.uuid.uuid32 = 0;
-		for(int i=0;i<value.length();){
-			uint8_t MSB = value.c_str()[i];
-			uint8_t LSB = value.c_str()[i+1];
+		for(size_t i=0;i<length;){
+			uint8_t MSB = value[i];
+			uint8_t LSB = value[i+1];
 			
 			if(MSB > '9') MSB -= 7; 
 			if(LSB > '9') LSB -= 7;
@@ -99,20 +137,20 @@ BLEUUID::BLEUUID(std::string value) {
 			i+=2;
 		}		
 	}
-	else if (value.length() == 16) {  // how we can have 16 byte length string reprezenting 128 bit uuid??? needs to be investigated (lack of time)
+	else if (length == 16) {  // how we can have 16 byte length string reprezenting 128 bit uuid??? needs to be investigated (lack of time)
 		m_uuid.len = ESP_UUID_LEN_128;
-		memrcpy(m_uuid.uuid.uuid128, (uint8_t*)value.data(), 16);
+		memrcpy(m_uuid.uuid.uuid128, (uint8_t*) value, 16);
 	}
-	else if (value.length() == 36) {
+	else if (length == 36) {
 		// If the length of the string is 36 bytes then we will assume it is a long hex string in
 		// UUID format.
 		m_uuid.len = ESP_UUID_LEN_128;
 		int n = 0;
-		for(int i=0;i<value.length();){
-			if(value.c_str()[i] == '-')
+		for(size_t i=0;i<length;){
+			if(value[i] == '-')
 				i++;
-			uint8_t MSB = value.c_str()[i];
-			uint8_t LSB = value.c_str()[i+1];
+			uint8_t MSB = value[i];
+			uint8_t LSB = value[i+1];
 			
 			if(MSB > '9') MSB -= 7; 
 			if(LSB > '9') LSB -= 7;
@@ -124,7 +162,8 @@ BLEUUID::BLEUUID(std::string value) {
 		ESP_LOGE(LOG_TAG, "ERROR: UUID value not 2, 4, 16 or 36 bytes");
 		m_valueSet = false;
 	}
-} //BLEUUID(std::string)
+	setHash();
+} // parse
 
 
 /**
@@ -146,18 +185,7 @@ BLEUUID::BLEUUID(uint8_t* pData, size_t size, bool msbFirst) {
 		memcpy(m_uuid.uuid.uuid128, pData, 16);
 	}
 	m_valueSet = true;
-} // BLEUUID
-
-
-/**
- * @brief Create a UUID from the 16bit value.
- *
- * @param [in] uuid The 16bit short form UUID.
- */
-BLEUUID::BLEUUID(uint16_t uuid) {
-	m_uuid.len         = ESP_UUID_LEN_16;
-	m_uuid.uuid.uuid16 = uuid;
-	m_valueSet         = true;
+	setHash();
 } // BLEUUID
 
 
@@ -170,6 +198,7 @@ BLEUUID::BLEUUID(uint32_t uuid) {
 	m_uuid.len         = ESP_UUID_LEN_32;
 	m_uuid.uuid.uuid32 = uuid;
 	m_valueSet         = true;
+	m_hash             = uuid;
 } // BLEUUID
 
 
@@ -181,6 +210,7 @@ BLEUUID::BLEUUID(uint32_t uuid) {
 BLEUUID::BLEUUID(esp_bt_uuid_t uuid) {
 	m_uuid     = uuid;
 	m_valueSet = true;
+	setHash();
 } // BLEUUID
 
 
@@ -202,7 +232,7 @@ BLEUUID::BLEUUID() {
  * @brief Get the number of bits in this uuid.
  * @return The number of bits in the UUID.  One of 16, 32 or 128.
  */
-uint8_t BLEUUID::bitSize() {
+uint8_t BLEUUID::bitSize() const {
 	if (!m_valueSet) return 0;
 	switch (m_uuid.len) {
 		case ESP_UUID_LEN_16:
@@ -221,15 +251,21 @@ uint8_t BLEUUID::bitSize() {
 /**
  * @brief Compare a UUID against this UUID.
  *
+ * A 16 or 32 bit UUID is equal to its 128 bit form.
+ *
  * @param [in] uuid The UUID to compare against.
  * @return True if the UUIDs are equal and false otherwise.
  */
-bool BLEUUID::equals(BLEUUID uuid) {
-	//ESP_LOGD(TAG, "Comparing: %s to %s", toString().c_str(), uuid.toString().c_str());
+bool BLEUUID::equals(const BLEUUID& uuid) const {
 	if (!m_valueSet || !uuid.m_valueSet) return false;
+	if (uuid.m_hash != m_hash) return false;  // The hashes of equal UUIDs are equal whatever their forms.
 
 	if (uuid.m_uuid.len != m_uuid.len) {
-		return uuid.toString() == toString();
+		uint8_t uuid128[16];
+		uint8_t other128[16];
+		get128(uuid128);
+		uuid.get128(other128);
+		return memcmp(uuid128, other128, 16) == 0;
 	}
 
 	if (uuid.m_uuid.len == ESP_UUID_LEN_16) {
@@ -273,6 +309,84 @@ BLEUUID BLEUUID::fromString(std::string _uuid) {
 } // fromString
 
 
+/**
+ * @brief Get the 128 bit form of the UUID.
+ *
+ * @param [out] pUUID128 The 16 bytes of the UUID, least significant first.
+ */
+void BLEUUID::get128(uint8_t* pUUID128) const {
+	if (m_uuid.len == ESP_UUID_LEN_128) {
+		memmove(pUUID128, m_uuid.uuid.uuid128, 16);
+		return;
+	}
+	uint32_t value = m_uuid.len == ESP_UUID_LEN_16 ? m_uuid.uuid.uuid16 : m_uuid.uuid.uuid32;
+	memcpy(pUUID128, BASE_UUID, sizeof(BASE_UUID));
+	pUUID128[12] = value & 0xff;
+	pUUID128[13] = (value >> 8) & 0xff;
+	pUUID128[14] = (value >> 16) & 0xff;
+	pUUID128[15] = (value >> 24) & 0xff;
+} // get128
+
+
+/**
+ * @brief Get the hash of the UUID.
+ *
+ * Equal UUIDs have equal hashes whether they are held in their short or 128 bit forms.
+ *
+ * @return The hash of the UUID.
+ */
+size_t BLEUUID::hash() const {
+	return m_hash;
+} // hash
+
+
+/**
+ * @brief Order UUIDs by their hashes and then by their 128 bit forms, most significant byte first; a UUID
+ * without a value comes first.
+ *
+ * Equal UUIDs have equal hashes, so ordering on the hash first is consistent with equals() and leaves the
+ * 128 bit forms to be compared only when the hashes collide.
+ *
+ * @param [in] uuid The UUID to compare against.
+ * @return True if this UUID is ordered before the other.
+ */
+bool BLEUUID::operator<(const BLEUUID& uuid) const {
+	if (!uuid.m_valueSet) return false;
+	if (!m_valueSet) return true;
+	if (m_hash != uuid.m_hash) return m_hash < uuid.m_hash;
+
+	uint8_t uuid128[16];
+	uint8_t other128[16];
+	get128(uuid128);
+	uuid.get128(other128);
+	for (int i = 15; i >= 0; i--) {
+		if (uuid128[i] != other128[i]) return uuid128[i] < other128[i];
+	}
+	return false;
+} // operator<
+
+
+/**
+ * @brief Compute the hash of the UUID.
+ *
+ * The hash of a 128 bit UUID is its top 32 bits combined with its folded low 12 bytes, with the fold
+ * of the Base UUID cancelled out.  The hash of a 16 or 32 bit UUID is therefore just its value.
+ */
+void BLEUUID::setHash() {
+	if (!m_valueSet) {
+		m_hash = 0;
+	} else if (m_uuid.len == ESP_UUID_LEN_16) {
+		m_hash = m_uuid.uuid.uuid16;
+	} else if (m_uuid.len == ESP_UUID_LEN_32) {
+		m_hash = m_uuid.uuid.uuid32;
+	} else {
+		uint32_t value;
+		memcpy(&value, m_uuid.uuid.uuid128 + 12, sizeof(value));
+		m_hash = value ^ fold(m_uuid.uuid.uuid128) ^ fold(BASE_UUID);
+	}
+} // setHash
+
+
 /**
  * @brief Get the native UUID value.
  *
@@ -303,39 +417,8 @@ BLEUUID BLEUUID::to128() {
 		return *this;
 	}
 
-	// If we are 16 bit or 32 bit, then set the 4 bytes of the variable part of the UUID.
-	if (m_uuid.len == ESP_UUID_LEN_16) {
-		uint16_t temp = m_uuid.uuid.uuid16;
-		m_uuid.uuid.uuid128[15] = 0;
-		m_uuid.uuid.uuid128[14] = 0;
-		m_uuid.uuid.uuid128[13] = (temp >> 8) & 0xff;
-		m_uuid.uuid.uuid128[12] = temp & 0xff;
-
-	}
-	else if (m_uuid.len == ESP_UUID_LEN_32) {
-		uint32_t temp = m_uuid.uuid.uuid32;
-		m_uuid.uuid.uuid128[15] = (temp >> 24) & 0xff;
-		m_uuid.uuid.uuid128[14] = (temp >> 16) & 0xff;
-		m_uuid.uuid.uuid128[13] = (temp >> 8) & 0xff;
-		m_uuid.uuid.uuid128[12] = temp & 0xff;
-	}
-
-	// Set the fixed parts of the UUID.
-	m_uuid.uuid.uuid128[11] = 0x00;
-	m_uuid.uuid.uuid128[10] = 0x00;
-
-	m_uuid.uuid.uuid128[9]  = 0x10;
-	m_uuid.uuid.uuid128[8]  = 0x00;
-
-	m_uuid.uuid.uuid128[7]  = 0x80;
-	m_uuid.uuid.uuid128[6]  = 0x00;
-
-	m_uuid.uuid.uuid128[5]  = 0x00;
-	m_uuid.uuid.uuid128[4]  = 0x80;
-	m_uuid.uuid.uuid128[3]  = 0x5f;
-	m_uuid.uuid.uuid128[2]  = 0x9b;
-	m_uuid.uuid.uuid128[1]  = 0x34;
-	m_uuid.uuid.uuid128[0]  = 0xfb;
+	// If we are 16 bit or 32 bit, then place the value in the Base UUID.  The hash is unchanged.
+	get128(m_uuid.uuid.uuid128);
 
 	m_uuid.len = ESP_UUID_LEN_128;
 	//ESP_LOGD(TAG, "<< toFull <-  %s", toString().c_str());
@@ -355,7 +438,7 @@ BLEUUID BLEUUID::to128() {
  *
  * @return A string representation of the UUID.
  */
-std::string BLEUUID::toString() {
+std::string BLEUUID::toString() const {
 	if (!m_valueSet) return "<NULL>";   // If we have no value, nothing to format.
 
 	// If the UUIDs are 16 or 32 bit, pad correctly.
@@ -10,30 +10,67 @@
 #include "sdkconfig.h"
 #if defined(CONFIG_BT_ENABLED)
 #include <esp_gatt_defs.h>
+#include <stddef.h>
+#include <functional>
 #include <string>
 
 /**
  * @brief A model of a %BLE UUID.
+ *
+ * A %BLEUUID is a small, trivially copyable value.  A UUID held in its 16 or 32 bit short form is equal to
+ * the same UUID held as 128 bits; comparison, ordering and hashing all work on the full 128 bit form without
+ * converting either side to a string, so a %BLEUUID can be used directly as the key of a `std::map` or
+ * `std::unordered_map`.  The hash is computed once on construction.
  */
 class BLEUUID {
 public:
 	BLEUUID(std::string uuid);
-	BLEUUID(uint16_t uuid);
+	BLEUUID(const char* uuid);
+	/**
+	 * @brief Create a UUID from the 16bit value.
+	 *
+	 * This constructor is `constexpr` so a 16 bit UUID constant needs no initialization at run time.
+	 * @param [in] uuid The 16bit short form UUID.
+	 */
+	constexpr BLEUUID(uint16_t uuid) : m_uuid{ESP_UUID_LEN_16, {uuid}}, m_valueSet(true), m_hash(uuid) {}
 	BLEUUID(uint32_t uuid);
 	BLEUUID(esp_bt_uuid_t uuid);
 	BLEUUID(uint8_t* pData, size_t size, bool msbFirst);
 	BLEUUID(esp_gatt_id_t gattId);
 	BLEUUID();
-	uint8_t        bitSize();   // Get the number of bits in this uuid.
-	bool           equals(BLEUUID uuid);
+	uint8_t        bitSize() const;   // Get the number of bits in this uuid.
+	bool           equals(const BLEUUID& uuid) const;
 	esp_bt_uuid_t* getNative();
+	size_t         hash() const;
 	BLEUUID        to128();
-	std::string    toString();
+	std::string    toString() const;
 	static BLEUUID fromString(std::string uuid);  // Create a BLEUUID from a string
 
+	bool operator==(const BLEUUID& uuid) const { return equals(uuid); }
+	bool operator!=(const BLEUUID& uuid) const { return !equals(uuid); }
+	bool operator<(const BLEUUID& uuid) const;
+
 private:
 	esp_bt_uuid_t m_uuid;       		// The underlying UUID structure that this class wraps.
 	bool          m_valueSet = false;   // Is there a value set for this instance.
+	uint32_t      m_hash     = 0;       // Hash of the 128 bit form; the 32 bit value for a short form UUID.
+
+	void     get128(uint8_t* pUUID128) const;
+	void     parse(const char* value, size_t length);
+	void     setHash();
 }; // BLEUUID
+
+
+namespace std {
+/**
+ * @brief Hash a %BLEUUID for use as the key of an unordered container.
+ */
+template<> struct hash<BLEUUID> {
+	size_t operator()(const BLEUUID& uuid) const {
+		return uuid.hash();
+	}
+};
+} // namespace std
+
 #endif /* CONFIG_BT_ENABLED */
 #endif /* COMPONENTS_CPP_UTILS_BLEUUID_H_ */
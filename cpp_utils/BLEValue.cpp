@@ -6,6 +6,8 @@
  */
 #include "sdkconfig.h"
 #if defined(CONFIG_BT_ENABLED)
+#include <stdlib.h>
+#include <string.h>
 #include "BLEValue.h"
 
 #if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
@@ -17,22 +19,44 @@ static const char* LOG_TAG="BLEValue";
 #endif
 
 
+std::atomic<uint32_t> BLEValue::m_allocations(0);
+std::atomic<uint32_t> BLEValue::m_bytesCopied(0);
+
 
 BLEValue::BLEValue() {
-	m_accumulation = "";
-	m_value        = "";
-	m_readOffset   = 0;
+	for (int i = 0; i < 2; i++) {
+		m_buffers[i].pStorage = nullptr;
+		m_buffers[i].capacity = 0;
+		m_buffers[i].pData    = nullptr;
+		m_buffers[i].length   = 0;
+	}
+	m_pCurrent             = &m_buffers[0];
+	m_pAccumulation        = nullptr;
+	m_accumulationCapacity = 0;
+	m_accumulationLength   = 0;
+	m_readOffset           = 0;
+	m_pSnapshot            = nullptr;
+	m_snapshotCapacity     = 0;
+	m_snapshotLength       = 0;
+	m_pinned               = false;
 } // BLEValue
 
 
+BLEValue::~BLEValue() {
+	free(m_buffers[0].pStorage);
+	free(m_buffers[1].pStorage);
+	free(m_pAccumulation);
+	free(m_pSnapshot);
+} // ~BLEValue
+
+
 /**
  * @brief Add a message part to the accumulation.
  * The accumulation is a growing set of data that is added to until a commit or cancel.
  * @param [in] part A message part being added.
  */
 void BLEValue::addPart(std::string part) {
-	ESP_LOGD(LOG_TAG, ">> addPart: length=%d", part.length());
-	m_accumulation += part;
+	addPart((uint8_t*) part.data(), part.length());
 } // addPart
 
 
@@ -44,7 +68,10 @@ void BLEValue::addPart(std::string part) {
  */
 void BLEValue::addPart(uint8_t* pData, size_t length) {
 	ESP_LOGD(LOG_TAG, ">> addPart: length=%d", length);
-	m_accumulation += std::string((char*) pData, length);
+	if (!grow(&m_pAccumulation, &m_accumulationCapacity, m_accumulationLength + length)) return;
+	memcpy(m_pAccumulation + m_accumulationLength, pData, length);
+	m_accumulationLength += length;
+	m_bytesCopied += length;
 } // addPart
 
 
@@ -53,8 +80,8 @@ void BLEValue::addPart(uint8_t* pData, size_t length) {
  */
 void BLEValue::cancel() {
 	ESP_LOGD(LOG_TAG, ">> cancel");
-	m_accumulation = "";
-	m_readOffset   = 0;
+	m_accumulationLength = 0;
+	m_readOffset         = 0;
 } // cancel
 
 
@@ -62,25 +89,61 @@ void BLEValue::cancel() {
  * @brief Commit the current accumulation.
  * When writing a value, we may find that we write it in "parts" meaning that the writes come in in pieces
  * of the overall message.  After the last part has been received, we may perform a commit which means that
- * we now have the complete message and commit the change as a unit.
+ * we now have the complete message and commit the change as a unit.  The accumulation buffer itself becomes
+ * the value, so nothing is copied.
  */
 void BLEValue::commit() {
 	ESP_LOGD(LOG_TAG, ">> commit");
 	// If there is nothing to commit, do nothing.
-	if (m_accumulation.length() == 0) return;
-	setValue(m_accumulation);
-	m_accumulation = "";
-	m_readOffset   = 0;
+	if (m_accumulationLength == 0) return;
+	Buffer* pBack = getBack();
+	uint8_t* pStorage = pBack->pStorage;
+	size_t capacity   = pBack->capacity;
+	pBack->pStorage   = m_pAccumulation;
+	pBack->capacity   = m_accumulationCapacity;
+	pBack->pData      = m_pAccumulation;
+	pBack->length     = m_accumulationLength;
+	m_pAccumulation        = pStorage;
+	m_accumulationCapacity = capacity;
+	m_accumulationLength   = 0;
+	m_pCurrent   = pBack;
+	m_readOffset = 0;
 } // commit
 
 
+/**
+ * @brief Get the number of buffer allocations made by all values, including strings returned by getValue().
+ * @return The number of allocations.
+ */
+uint32_t BLEValue::getAllocationCount() {
+	return m_allocations;
+} // getAllocationCount
+
+
+/**
+ * @brief Get the buffer that isn't current, in which a new value can be built.
+ */
+BLEValue::Buffer* BLEValue::getBack() {
+	return m_pCurrent == &m_buffers[0] ? &m_buffers[1] : &m_buffers[0];
+} // getBack
+
+
+/**
+ * @brief Get the number of bytes copied into or out of all values.
+ * @return The number of bytes copied.
+ */
+uint32_t BLEValue::getBytesCopied() {
+	return m_bytesCopied;
+} // getBytesCopied
+
+
 /**
  * @brief Get a pointer to the data.
  * @return A pointer to the data.
  */
 uint8_t* BLEValue::getData() {
-	return (uint8_t*) m_value.data();
-}
+	return (uint8_t*) m_pCurrent.load()->pData;
+} // getData
 
 
 /**
@@ -88,10 +151,23 @@ uint8_t* BLEValue::getData() {
  * @return The length of the data in bytes.
  */
 size_t BLEValue::getLength() {
-	return m_value.length();
+	return m_pCurrent.load()->length;
 } // getLength
 
 
+/**
+ * @brief Get the value pinned for a long read.
+ * @return The pinned value or, if none is pinned, the current value.
+ */
+BLEValue::Span BLEValue::getPinned() {
+	if (!m_pinned) return getSpan();
+	Span span;
+	span.pData  = m_pSnapshot;
+	span.length = m_snapshotLength;
+	return span;
+} // getPinned
+
+
 /**
  * @brief Get the read offset.
  * @return The read offset into the read.
@@ -102,13 +178,108 @@ uint16_t BLEValue::getReadOffset() {
 
 
 /**
- * @brief Get the current value.
+ * @brief Refer to the current value without copying it.
+ * The span stays valid until the value has been replaced twice.
+ * @return The current value.
+ */
+BLEValue::Span BLEValue::getSpan() {
+	Buffer* pCurrent = m_pCurrent;
+	Span span;
+	span.pData  = pCurrent->pData;
+	span.length = pCurrent->length;
+	return span;
+} // getSpan
+
+
+/**
+ * @brief Get a copy of the current value.
  */
 std::string BLEValue::getValue() {
-	return m_value;
+	Span span = getSpan();
+	if (span.length == 0) return "";
+	m_allocations++;
+	m_bytesCopied += span.length;
+	return std::string((const char*) span.pData, span.length);
 } // getValue
 
 
+/**
+ * @brief Make a buffer large enough to hold a given length, preserving its content.
+ * @param [in,out] ppStorage The buffer.
+ * @param [in,out] pCapacity The size of the buffer.
+ * @param [in] length The length needed.
+ * @return False if the memory could not be allocated.
+ */
+bool BLEValue::grow(uint8_t** ppStorage, size_t* pCapacity, size_t length) {
+	if (length <= *pCapacity) return true;
+	uint8_t* pStorage = (uint8_t*) realloc(*ppStorage, length);
+	if (pStorage == nullptr) {
+		ESP_LOGE(LOG_TAG, "Unable to allocate %d bytes for a value", length);
+		return false;
+	}
+	*ppStorage = pStorage;
+	*pCapacity = length;
+	m_allocations++;
+	return true;
+} // grow
+
+
+/**
+ * @brief Copy the current value aside for a long read.
+ * The copy is unaffected by later writes, so every response of the read comes from the same value.  The
+ * storage for the copy is kept for the next long read.
+ * @return The pinned value.
+ */
+BLEValue::Span BLEValue::pin() {
+	Span span = getSpan();
+	if (!grow(&m_pSnapshot, &m_snapshotCapacity, span.length)) {
+		m_pinned = false;
+		return span;
+	}
+	if (span.length > 0) memcpy(m_pSnapshot, span.pData, span.length);
+	m_snapshotLength = span.length;
+	m_bytesCopied += span.length;
+	m_pinned = true;
+	return getPinned();
+} // pin
+
+
+/**
+ * @brief Make a buffer owned by the caller the current value without copying it.
+ * The buffer must not be changed or freed until a later value has replaced it and any read of it that
+ * was under way has finished; alternating between two buffers owned by the caller meets this.
+ * @param [in] pData The value.
+ * @param [in] length The length of the value.
+ */
+void BLEValue::publish(const uint8_t* pData, size_t length) {
+	Buffer* pBack = getBack();
+	pBack->pData  = pData;
+	pBack->length = length;
+	m_pCurrent    = pBack;
+} // publish
+
+
+/**
+ * @brief Allocate the buffers up front so that values of up to a given length can be set without allocation.
+ * @param [in] capacity The largest value expected.
+ */
+void BLEValue::reserve(size_t capacity) {
+	grow(&m_buffers[0].pStorage, &m_buffers[0].capacity, capacity);
+	grow(&m_buffers[1].pStorage, &m_buffers[1].capacity, capacity);
+	grow(&m_pAccumulation, &m_accumulationCapacity, capacity);
+	grow(&m_pSnapshot, &m_snapshotCapacity, capacity);
+} // reserve
+
+
+/**
+ * @brief Reset the copy and allocation counters.
+ */
+void BLEValue::resetCounters() {
+	m_allocations = 0;
+	m_bytesCopied = 0;
+} // resetCounters
+
+
 /**
  * @brief Set the read offset
  * @param [in] readOffset The offset into the read.
@@ -122,18 +293,33 @@ void BLEValue::setReadOffset(uint16_t readOffset) {
  * @brief Set the current value.
  */
 void BLEValue::setValue(std::string value) {
-	m_value = value;
+	setValue((uint8_t*) value.data(), value.length());
 } // setValue
 
 
 /**
  * @brief Set the current value.
+ * The data is copied into the buffer that isn't current, which then becomes current.
  * @param [in] pData The data for the current value.
  * @param [in] The length of the new current value.
  */
 void BLEValue::setValue(uint8_t* pData, size_t length) {
-	m_value = std::string((char*) pData, length);
+	Buffer* pBack = getBack();
+	if (!grow(&pBack->pStorage, &pBack->capacity, length)) return;
+	if (length > 0) memcpy(pBack->pStorage, pData, length);
+	pBack->pData  = pBack->pStorage;
+	pBack->length = length;
+	m_bytesCopied += length;
+	m_pCurrent = pBack;
 } // setValue
 
 
+/**
+ * @brief Release the value pinned for a long read, once its last response has been sent.
+ */
+void BLEValue::unpin() {
+	m_pinned = false;
+} // unpin
+
+
 #endif // CONFIG_BT_ENABLED
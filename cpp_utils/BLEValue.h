@@ -9,14 +9,39 @@
 #define COMPONENTS_CPP_UTILS_BLEVALUE_H_
 #include "sdkconfig.h"
 #if defined(CONFIG_BT_ENABLED)
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
 #include <string>
 
 /**
  * @brief The model of a %BLE value.
+ *
+ * The value is double buffered.  A new value is built in the buffer that isn't current and then made current
+ * by swapping a pointer, so a read that fits in one response sees a complete value without taking a lock or
+ * copying it.  Reads use getSpan() to refer to the current value in place.  A long read, answered over
+ * several responses, may outlast two writes, so it pins a copy of the value with pin() at its first response
+ * and answers the rest from getPinned(); only values too long for one response are copied.  A value can
+ * also be published from a buffer owned by the caller, which is then used without any copy at all; the
+ * caller must leave that buffer unchanged until a later value replaces it.  A value has one writer at a
+ * time.
+ *
+ * Buffers grow as needed and are kept, so once they are big enough (or reserve() has been called) setting a
+ * value performs no allocation.  The class keeps count of the bytes it copies and the allocations it makes
+ * across all values.
  */
 class BLEValue {
 public:
+	/**
+	 * @brief A reference to bytes held elsewhere.
+	 */
+	struct Span {
+		const uint8_t* pData;
+		size_t         length;
+	};
+
 	BLEValue();
+	~BLEValue();
 	void		addPart(std::string part);
 	void		addPart(uint8_t* pData, size_t length);
 	void		cancel();
@@ -24,15 +49,45 @@ public:
 	uint8_t*	getData();
 	size_t	  getLength();
 	uint16_t	getReadOffset();
+	Span        getPinned();
+	Span        getSpan();
 	std::string getValue();
+	Span        pin();
+	void        publish(const uint8_t* pData, size_t length);
+	void        reserve(size_t capacity);
 	void        setReadOffset(uint16_t readOffset);
 	void        setValue(std::string value);
 	void        setValue(uint8_t* pData, size_t length);
+	void        unpin();
+
+	static uint32_t getAllocationCount();
+	static uint32_t getBytesCopied();
+	static void     resetCounters();
 
 private:
-	std::string m_accumulation;
-	uint16_t    m_readOffset;
-	std::string m_value;
+	struct Buffer {
+		uint8_t*       pStorage;       // Storage owned by the value.
+		size_t         capacity;
+		const uint8_t* pData;          // The value; either pStorage or a buffer owned by the caller.
+		size_t         length;
+	};
+
+	Buffer               m_buffers[2];
+	std::atomic<Buffer*> m_pCurrent;
+	uint8_t*             m_pAccumulation;
+	size_t               m_accumulationCapacity;
+	size_t               m_accumulationLength;
+	uint16_t             m_readOffset;
+	uint8_t*             m_pSnapshot;            // The value pinned for a long read.
+	size_t               m_snapshotCapacity;
+	size_t               m_snapshotLength;
+	bool                 m_pinned;
+
+	static std::atomic<uint32_t> m_allocations;
+	static std::atomic<uint32_t> m_bytesCopied;
+
+	Buffer*     getBack();
+	static bool grow(uint8_t** ppStorage, size_t* pCapacity, size_t length);
 
 };
 #endif // CONFIG_BT_ENABLED
@@ -0,0 +1,185 @@
+/*
+ * BufferedSocketReader.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include "BufferedSocketReader.h"
+
+#include <esp_log.h>
+
+static const char* LOG_TAG = "BufferedSocketReader";
+
+
+/**
+ * @brief Create a buffered reader over a socket.
+ * @param [in] socket The socket from which data will be read.
+ * @param [in] bufferSize The size of the read-ahead buffer.
+ */
+BufferedSocketReader::BufferedSocketReader(Socket socket, size_t bufferSize) {
+	m_socket     = socket;
+	m_bufferSize = bufferSize;
+	m_buffer     = new uint8_t[bufferSize];
+	m_start      = 0;
+	m_end        = 0;
+} // BufferedSocketReader
+
+
+BufferedSocketReader::~BufferedSocketReader() {
+	delete[] m_buffer;
+} // ~BufferedSocketReader
+
+
+/**
+ * @brief Get the number of bytes that have been received but not yet consumed.
+ * @return The number of bytes held in the read-ahead buffer.
+ */
+size_t BufferedSocketReader::available() {
+	return m_end - m_start;
+} // available
+
+
+/**
+ * @brief Discard data from the front of the buffer.
+ * @param [in] length The number of bytes to discard.  This is limited to the amount of data available.
+ */
+void BufferedSocketReader::consume(size_t length) {
+	if (length > m_end - m_start) length = m_end - m_start;
+	m_start += length;
+	if (m_start == m_end) {   // Nothing left, start again at the front of the buffer.
+		m_start = 0;
+		m_end   = 0;
+	}
+} // consume
+
+
+/**
+ * @brief Receive more data from the socket into the free space at the end of the buffer.
+ * Any unconsumed data is first moved to the start of the buffer to make as much room as possible, so
+ * pointers previously returned by peek() are no longer valid after this call.
+ * @return True if data was received (or the buffer is already full), false if the partner closed the
+ * connection or there was an error.
+ */
+bool BufferedSocketReader::fill() {
+	if (m_start > 0) {
+		::memmove(m_buffer, m_buffer + m_start, m_end - m_start);
+		m_end  -= m_start;
+		m_start = 0;
+	}
+	if (m_end == m_bufferSize) return true;   // Buffer is full, nothing to do.
+
+	int rc = (int) m_socket.receive(m_buffer + m_end, m_bufferSize - m_end);
+	if (rc <= 0) {
+		ESP_LOGD(LOG_TAG, "fill: receive returned %d", rc);
+		return false;
+	}
+	m_end += rc;
+	return true;
+} // fill
+
+
+/**
+ * @brief Get the size of the read-ahead buffer.
+ * @return The size of the read-ahead buffer.
+ */
+size_t BufferedSocketReader::getBufferSize() {
+	return m_bufferSize;
+} // getBufferSize
+
+
+/**
+ * @brief Get the underlying socket.
+ * @return The socket being read.
+ */
+Socket BufferedSocketReader::getSocket() {
+	return m_socket;
+} // getSocket
+
+
+/**
+ * @brief Get the data held in the buffer.
+ * The data remains in the buffer until it is consumed.
+ * @return A pointer to the first of available() bytes of buffered data.
+ */
+const uint8_t* BufferedSocketReader::peek() {
+	return m_buffer + m_start;
+} // peek
+
+
+/**
+ * @brief Read data.
+ * Data already held in the read-ahead buffer is returned first.  If more data is needed, large requests are
+ * received directly into the caller's storage while small requests go through the read-ahead buffer.
+ * @param [in] data The storage into which the data will be written.
+ * @param [in] length The maximum number of bytes to read.
+ * @param [in] exact If true, block until exactly length bytes have been read or there is no more data.
+ * @return The number of bytes read.
+ */
+size_t BufferedSocketReader::read(uint8_t* data, size_t length, bool exact) {
+	size_t total = 0;
+	while (total < length) {
+		if (m_start == m_end) {   // Buffer is empty.
+			if (total > 0 && !exact) break;
+			if (length - total >= m_bufferSize) {
+				int rc = (int) m_socket.receive(data + total, length - total);
+				if (rc <= 0) break;
+				total += rc;
+				continue;
+			}
+			if (!fill()) break;
+		}
+		size_t amount = std::min(length - total, m_end - m_start);
+		::memcpy(data + total, m_buffer + m_start, amount);
+		m_start += amount;
+		total   += amount;
+	} // while
+	return total;
+} // read
+
+
+/**
+ * @brief Read data until we find the delimiter.
+ * The delimiter is consumed but is not part of the returned data.  If the partner closes the connection
+ * before the delimiter is seen, whatever was read is returned.  Should the delimiter be longer than the
+ * read-ahead buffer, the buffer is enlarged to hold it.
+ * @param [in] delim The delimiter that terminates the read.
+ * @return The data read up to but excluding the delimiter.
+ */
+std::string BufferedSocketReader::readToDelim(const std::string& delim) {
+	std::string ret;
+	if (delim.empty()) return ret;
+	if (delim.length() > m_bufferSize) {   // Otherwise the bytes kept back below would fill the buffer.
+		uint8_t* buffer = new uint8_t[delim.length()];
+		::memcpy(buffer, m_buffer + m_start, m_end - m_start);
+		m_end       -= m_start;
+		m_start      = 0;
+		delete[] m_buffer;
+		m_buffer     = buffer;
+		m_bufferSize = delim.length();
+	}
+	while (true) {
+		uint8_t* pStart = m_buffer + m_start;
+		uint8_t* pEnd   = m_buffer + m_end;
+		uint8_t* pFound = std::search(pStart, pEnd, delim.begin(), delim.end());
+		if (pFound != pEnd) {
+			ret.append((char*) pStart, pFound - pStart);
+			m_start = (pFound - m_buffer) + delim.length();
+			return ret;
+		}
+
+		// We didn't find the delimiter.  Keep back enough bytes that a delimiter split across two
+		// receives will still be found and move the rest into the result.
+		size_t keep = std::min(delim.length() - 1, m_end - m_start);
+		ret.append((char*) pStart, (m_end - m_start) - keep);
+		m_start = m_end - keep;
+
+		if (!fill()) {
+			ret.append((char*) m_buffer + m_start, m_end - m_start);
+			m_start = m_end;
+			return ret;
+		}
+	} // while
+} // readToDelim
@@ -0,0 +1,58 @@
+/*
+ * BufferedSocketReader.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BUFFEREDSOCKETREADER_H_
+#define COMPONENTS_CPP_UTILS_BUFFEREDSOCKETREADER_H_
+#include <stdint.h>
+#include <string>
+#include "Socket.h"
+
+/**
+ * @brief Read data from a socket through a read-ahead buffer.
+ *
+ * Reading a line of text from a socket one byte at a time costs a full lwip (or mbedtls) read call for
+ * every byte.  This class instead receives as much data as is available into a buffer and then scans the
+ * buffer in memory.  Any data that is left over after a read is kept for the next read request so that,
+ * for example, the body of an HTTP request that arrived in the same segment as the headers is not lost.
+ *
+ * Parsers that work directly on the received bytes can use peek() to see the buffered data without copying
+ * it, consume() to discard what they have processed and fill() to receive more.
+ *
+ * An instance should be owned by whoever owns the connection and be used for all reads on that connection.
+ * Mixing reads through the reader with direct reads on the underlying socket will lose buffered data.
+ *
+ * @code{.cpp}
+ * BufferedSocketReader reader(clientSocket);
+ * std::string requestLine = reader.readToDelim("\r\n");
+ * @endcode
+ */
+class BufferedSocketReader {
+public:
+	BufferedSocketReader(Socket socket, size_t bufferSize = 1024);
+	virtual ~BufferedSocketReader();
+
+	size_t         available();                                            // Number of bytes held in the buffer.
+	void           consume(size_t length);                                 // Discard data from the front of the buffer.
+	bool           fill();                                                 // Receive more data into the buffer.
+	size_t         getBufferSize();                                        // Get the size of the read-ahead buffer.
+	Socket         getSocket();                                            // Get the underlying socket.
+	const uint8_t* peek();                                                 // Get the data held in the buffer.
+	size_t         read(uint8_t* data, size_t length, bool exact = false); // Read data, draining the buffer first.
+	std::string    readToDelim(const std::string& delim);                  // Read up to (and consume) a delimiter.
+
+private:
+	Socket   m_socket;      // The socket we are reading from.
+	uint8_t* m_buffer;      // The read-ahead buffer.
+	size_t   m_bufferSize;  // The size of the read-ahead buffer.
+	size_t   m_start;       // Index of the first unconsumed byte in the buffer.
+	size_t   m_end;         // Index one past the last valid byte in the buffer.
+
+	BufferedSocketReader(const BufferedSocketReader&);             // Not copyable, we own the buffer.
+	BufferedSocketReader& operator=(const BufferedSocketReader&);
+
+}; // BufferedSocketReader
+
+#endif /* COMPONENTS_CPP_UTILS_BUFFEREDSOCKETREADER_H_ */
@@ -91,7 +91,7 @@ int NVS::get(std::string key, std::string* result, bool isBlob) {
 	} else {
 		::nvs_get_str(m_handle, key.c_str(), data, &length);
 	}
-	*result = std::string(data);
+	*result = isBlob ? std::string(data, length) : std::string(data);   // A blob may hold zeros.
 	free(data);
 	return ESP_OK;
 } // get
@@ -0,0 +1,202 @@
+/*
+ * DoubleBuffer.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "DoubleBuffer.h"
+
+#include <esp_log.h>
+
+static const char* LOG_TAG = "DoubleBuffer";
+
+
+/**
+ * @brief Create a double buffer.
+ * @param [in] bufferSize The size of each of the two buffers.
+ * @param [in] stackSize The size of the stack of the thread that runs the producer.
+ */
+DoubleBuffer::DoubleBuffer(size_t bufferSize, size_t stackSize) {
+	m_bufferSize       = bufferSize > 0 ? bufferSize : 1;
+	m_stackSize        = stackSize;
+	m_buffers[0]       = new uint8_t[m_bufferSize];
+	m_buffers[1]       = new uint8_t[m_bufferSize];
+	m_lengths[0]       = m_lengths[1] = 0;
+	m_full[0]          = m_full[1] = false;
+	m_aborted          = false;
+	m_producing        = false;
+	m_exit             = false;
+	m_threadStarted    = false;
+	m_producer         = nullptr;
+	m_pProducerContext = nullptr;
+	::pthread_mutex_init(&m_mutex, nullptr);
+	::pthread_cond_init(&m_changed, nullptr);
+} // DoubleBuffer
+
+
+DoubleBuffer::~DoubleBuffer() {
+	if (m_threadStarted) {
+		::pthread_mutex_lock(&m_mutex);
+		m_exit = true;
+		::pthread_cond_broadcast(&m_changed);
+		::pthread_mutex_unlock(&m_mutex);
+		::pthread_join(m_thread, nullptr);
+	}
+	::pthread_cond_destroy(&m_changed);
+	::pthread_mutex_destroy(&m_mutex);
+	delete[] m_buffers[1];
+	delete[] m_buffers[0];
+} // ~DoubleBuffer
+
+
+size_t DoubleBuffer::getBufferSize() {
+	return m_bufferSize;
+} // getBufferSize
+
+
+/**
+ * @brief Fill buffers alternately until the producer reports the end of the data, an error or the
+ * consumer abandons the transfer.
+ */
+void DoubleBuffer::produce() {
+	int index = 0;
+	while (true) {
+		::pthread_mutex_lock(&m_mutex);
+		while (m_full[index] && !m_aborted) {
+			::pthread_cond_wait(&m_changed, &m_mutex);
+		}
+		bool aborted = m_aborted;
+		::pthread_mutex_unlock(&m_mutex);
+		if (aborted) return;
+
+		int length = m_producer(m_buffers[index], m_bufferSize, m_pProducerContext);
+
+		::pthread_mutex_lock(&m_mutex);
+		m_lengths[index] = length;
+		m_full[index]    = true;
+		::pthread_cond_broadcast(&m_changed);
+		::pthread_mutex_unlock(&m_mutex);
+		if (length <= 0) return;
+		index ^= 1;
+	}
+} // produce
+
+
+/**
+ * @brief Run each transfer's producer as it is handed over until the DoubleBuffer is deleted.
+ */
+void DoubleBuffer::produceLoop() {
+	::pthread_mutex_lock(&m_mutex);
+	while (true) {
+		while (!m_producing && !m_exit) {
+			::pthread_cond_wait(&m_changed, &m_mutex);
+		}
+		if (m_exit) break;
+		::pthread_mutex_unlock(&m_mutex);
+		produce();
+		::pthread_mutex_lock(&m_mutex);
+		m_producing = false;
+		::pthread_cond_broadcast(&m_changed);
+	}
+	::pthread_mutex_unlock(&m_mutex);
+} // produceLoop
+
+
+void* DoubleBuffer::produceThread(void* pDoubleBuffer) {
+	((DoubleBuffer*) pDoubleBuffer)->produceLoop();
+	return nullptr;
+} // produceThread
+
+
+/**
+ * @brief Create the producer thread if it isn't already running.
+ * @return False if the thread could not be created.
+ */
+bool DoubleBuffer::startProducer() {
+	if (m_threadStarted) return true;
+	pthread_attr_t attr;
+	::pthread_attr_init(&attr);
+	::pthread_attr_setstacksize(&attr, m_stackSize);
+	m_threadStarted = ::pthread_create(&m_thread, &attr, produceThread, this) == 0;
+	::pthread_attr_destroy(&attr);
+	return m_threadStarted;
+} // startProducer
+
+
+/**
+ * @brief Move all the data from the producer to the consumer.
+ * The producer runs on the helper thread of the DoubleBuffer, created by the first transfer that needs it,
+ * so that it fills one buffer while the consumer works on the other.  When the caller knows that the data
+ * fits in a single buffer the hand-over to the helper thread is not worth its cost and the transfer runs
+ * entirely on the calling task.
+ * @param [in] producer The function that fills a buffer.
+ * @param [in] pProducerContext Passed to the producer.
+ * @param [in] consumer The function that takes the content of a buffer.
+ * @param [in] pConsumerContext Passed to the consumer.
+ * @param [in] lengthHint The number of bytes expected or 0 if unknown.
+ * @return The number of bytes consumed or -1 if the producer failed or the consumer abandoned the transfer.
+ */
+int64_t DoubleBuffer::transfer(Producer producer, void* pProducerContext, Consumer consumer, void* pConsumerContext, size_t lengthHint) {
+	int64_t total = 0;
+	bool threaded = lengthHint == 0 || lengthHint > m_bufferSize;
+
+	if (threaded && !startProducer()) {
+		ESP_LOGW(LOG_TAG, "transfer: Unable to create producer thread, transferring sequentially");
+		threaded = false;
+	}
+	if (threaded) {   // Hand the transfer to the producer thread.
+		::pthread_mutex_lock(&m_mutex);
+		m_producer         = producer;
+		m_pProducerContext = pProducerContext;
+		m_full[0]          = m_full[1] = false;
+		m_aborted          = false;
+		m_producing        = true;
+		::pthread_cond_broadcast(&m_changed);
+		::pthread_mutex_unlock(&m_mutex);
+	}
+
+	if (!threaded) {
+		while (true) {
+			int length = producer(m_buffers[0], m_bufferSize, pProducerContext);
+			if (length < 0) return -1;
+			if (length == 0) return total;
+			if (!consumer(m_buffers[0], length, pConsumerContext)) return -1;
+			total += length;
+		}
+	}
+
+	int index = 0;
+	while (true) {
+		::pthread_mutex_lock(&m_mutex);
+		while (!m_full[index]) {
+			::pthread_cond_wait(&m_changed, &m_mutex);
+		}
+		int length = m_lengths[index];
+		::pthread_mutex_unlock(&m_mutex);
+		if (length <= 0) {
+			if (length < 0) total = -1;
+			break;
+		}
+
+		bool ok = consumer(m_buffers[index], length, pConsumerContext);
+
+		::pthread_mutex_lock(&m_mutex);
+		m_full[index] = false;
+		if (!ok) m_aborted = true;
+		::pthread_cond_broadcast(&m_changed);
+		::pthread_mutex_unlock(&m_mutex);
+		if (!ok) {
+			total = -1;
+			break;
+		}
+		total += length;
+		index ^= 1;
+	}
+
+	::pthread_mutex_lock(&m_mutex);   // Wait for the producer to finish with this transfer.
+	while (m_producing) {
+		::pthread_cond_wait(&m_changed, &m_mutex);
+	}
+	::pthread_mutex_unlock(&m_mutex);
+	return total;
+} // transfer
@@ -0,0 +1,69 @@
+/*
+ * DoubleBuffer.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_DOUBLEBUFFER_H_
+#define COMPONENTS_CPP_UTILS_DOUBLEBUFFER_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/**
+ * @brief Move data from a producer to a consumer through a pair of buffers so that the two overlap.
+ *
+ * While the consumer is working on one buffer (for example sending it over a socket) the producer is
+ * filling the other (for example reading the next chunk of a file from flash).  The producer runs on a
+ * helper thread and the consumer on the calling task.  The buffers and the helper thread are created once
+ * and reused for any number of transfers, one at a time; the thread ends when the DoubleBuffer is deleted.
+ * The producer must fit in the stack of the helper thread, DEFAULT_STACK_SIZE bytes unless another size is
+ * given to the constructor.
+ *
+ * A producer returns the number of bytes it placed in the buffer, 0 at the end of the data or -1 on an
+ * error.  A consumer returns false to abandon the transfer.
+ *
+ * @code{.cpp}
+ * DoubleBuffer buffer(4096);
+ * int64_t sent = buffer.transfer(readFile, &fd, sendSocket, &socket, fileLength);
+ * @endcode
+ */
+class DoubleBuffer {
+public:
+	typedef int  (*Producer)(uint8_t* pBuffer, size_t length, void* pContext);
+	typedef bool (*Consumer)(const uint8_t* pData, size_t length, void* pContext);
+
+	static const size_t DEFAULT_STACK_SIZE = 8192;
+
+	DoubleBuffer(size_t bufferSize, size_t stackSize = DEFAULT_STACK_SIZE);
+	virtual ~DoubleBuffer();
+
+	size_t  getBufferSize();
+	int64_t transfer(Producer producer, void* pProducerContext, Consumer consumer, void* pConsumerContext, size_t lengthHint = 0);
+
+private:
+	uint8_t*        m_buffers[2];
+	int             m_lengths[2];     // Bytes in each full buffer, 0 for end of data, -1 for an error.
+	bool            m_full[2];        // Is the buffer waiting to be consumed?
+	size_t          m_bufferSize;
+	size_t          m_stackSize;      // The stack of the producer thread.
+	bool            m_aborted;        // Has the consumer abandoned the transfer?
+	bool            m_producing;      // Is the producer thread working on a transfer?
+	bool            m_exit;           // Should the producer thread end?
+	bool            m_threadStarted;  // Has the producer thread been created?
+	Producer        m_producer;
+	void*           m_pProducerContext;
+	pthread_t       m_thread;
+	pthread_mutex_t m_mutex;
+	pthread_cond_t  m_changed;
+
+	DoubleBuffer(const DoubleBuffer&);             // Not copyable, we own the buffers.
+	DoubleBuffer& operator=(const DoubleBuffer&);
+	void        produce();
+	void        produceLoop();
+	static void* produceThread(void* pDoubleBuffer);
+	bool        startProducer();
+
+}; // DoubleBuffer
+
+#endif /* COMPONENTS_CPP_UTILS_DOUBLEBUFFER_H_ */
@@ -1,7 +1,12 @@
 #include "FTPServer.h"
 #include <stdint.h>
 #include <fstream>
+#include <algorithm>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
 #include <esp_log.h>
 
 static const char* LOG_TAG = "FTPCallbacks";
@@ -26,7 +31,7 @@ size_t FTPFileCallbacks::onStoreData(uint8_t* data, size_t size) {
 	ESP_LOGD(LOG_TAG,">> FTPFileCallbacks::onStoreData: size=%d", size);
 	m_storeFile.write((char*) data, size);							   // Store data received.
 	ESP_LOGD(LOG_TAG,"<< FTPFileCallbacks::onStoreData: size=%d", size);
-	return size;
+	return m_storeFile.fail() ? 0 : size;
 } // FTPFileCallbacks#onStoreData
 
 
@@ -103,16 +108,198 @@ std::string FTPFileCallbacks::onDir() {
 /// ---- END OF FTPFileCallbacks
 
 
+/**
+ * Write all of a buffer to a file.
+ * @return True if all the data was written.
+ */
+static bool writeAll(int fd, const uint8_t* data, size_t size) {
+	while (size > 0) {
+		int rc = ::write(fd, data, size);
+		if (rc <= 0) {
+			ESP_LOGE(LOG_TAG, "write: %s", strerror(errno));
+			return false;
+		}
+		data += rc;
+		size -= rc;
+	}
+	return true;
+} // writeAll
+
+
+/**
+ * @param blockSize The size of each write.  Use a multiple of the flash page or sector size of the file system.
+ */
+FTPBulkFileCallbacks::FTPBulkFileCallbacks(size_t blockSize) {
+	m_blockSize   = blockSize;
+	m_pBlock      = nullptr;
+	m_blockLength = 0;
+	m_storeFd     = -1;
+	m_retrieveFd  = -1;
+	m_storeFailed = false;
+} // FTPBulkFileCallbacks#FTPBulkFileCallbacks
+
+
+FTPBulkFileCallbacks::~FTPBulkFileCallbacks() {
+	if (m_storeFd != -1) ::close(m_storeFd);
+	if (m_retrieveFd != -1) ::close(m_retrieveFd);
+	delete[] m_pBlock;
+} // FTPBulkFileCallbacks#~FTPBulkFileCallbacks
+
+
+/**
+ * Called at the start of a STOR request.  Create or truncate the file.
+ */
+void FTPBulkFileCallbacks::onStoreStart(std::string fileName) {
+	ESP_LOGD(LOG_TAG, ">> FTPBulkFileCallbacks::onStoreStart: fileName=%s", fileName.c_str());
+	m_storeFd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (m_storeFd == -1) {
+		ESP_LOGD(LOG_TAG, "<< FTPBulkFileCallbacks::onStoreStart: ***FileException***");
+		throw FTPServer::FileException();
+	}
+	if (m_pBlock == nullptr) {
+		m_pBlock = new uint8_t[m_blockSize];
+	}
+	m_blockLength = 0;
+	m_storeFailed = false;
+	ESP_LOGD(LOG_TAG, "<< FTPBulkFileCallbacks::onStoreStart");
+} // FTPBulkFileCallbacks#onStoreStart
+
+
+/**
+ * Called when the client presents a new chunk of data to be saved.  Whole blocks are written; the rest is
+ * kept until the next chunk completes it.
+ * @return The size of the data, or 0 if it could not be written.
+ */
+size_t FTPBulkFileCallbacks::onStoreData(uint8_t* data, size_t size) {
+	ESP_LOGD(LOG_TAG, ">> FTPBulkFileCallbacks::onStoreData: size=%d", size);
+	if (m_storeFailed) return 0;
+	uint8_t* pData     = data;
+	size_t   remaining = size;
+
+	// First complete a block left over from the last chunk.
+	if (m_blockLength > 0) {
+		size_t count = std::min(remaining, m_blockSize - m_blockLength);
+		::memcpy(m_pBlock + m_blockLength, pData, count);
+		m_blockLength += count;
+		pData         += count;
+		remaining     -= count;
+		if (m_blockLength == m_blockSize) {
+			m_blockLength = 0;
+			if (!writeAll(m_storeFd, m_pBlock, m_blockSize)) {
+				m_storeFailed = true;
+				ESP_LOGD(LOG_TAG, "<< FTPBulkFileCallbacks::onStoreData: failed");
+				return 0;   // The rest of the chunk may be more than a block, so don't keep it.
+			}
+		}
+	}
+
+	// Then write as many whole blocks as we have straight from the chunk.
+	size_t wholeBlocks = remaining - remaining % m_blockSize;
+	if (wholeBlocks > 0) {
+		if (!writeAll(m_storeFd, pData, wholeBlocks)) {
+			m_storeFailed = true;
+			ESP_LOGD(LOG_TAG, "<< FTPBulkFileCallbacks::onStoreData: failed");
+			return 0;
+		}
+		pData     += wholeBlocks;
+		remaining -= wholeBlocks;
+	}
+
+	// And keep the rest, now less than a block, for later.
+	::memcpy(m_pBlock + m_blockLength, pData, remaining);
+	m_blockLength += remaining;
+	ESP_LOGD(LOG_TAG, "<< FTPBulkFileCallbacks::onStoreData");
+	return size;
+} // FTPBulkFileCallbacks#onStoreData
+
+
+/**
+ * Called at the end of a STOR request.  Write the last partial block and close the file.  Throws
+ * FTPServer::FileException if any of the data could not be written.
+ */
+void FTPBulkFileCallbacks::onStoreEnd() {
+	ESP_LOGD(LOG_TAG, ">> FTPBulkFileCallbacks::onStoreEnd");
+	if (m_storeFd == -1) return;
+	if (!m_storeFailed && m_blockLength > 0) {
+		m_storeFailed = !writeAll(m_storeFd, m_pBlock, m_blockLength);
+	}
+	m_blockLength = 0;
+	if (::close(m_storeFd) != 0) {
+		m_storeFailed = true;
+	}
+	m_storeFd = -1;
+	if (m_storeFailed) {
+		ESP_LOGD(LOG_TAG, "<< FTPBulkFileCallbacks::onStoreEnd: ***FileException***");
+		throw FTPServer::FileException();
+	}
+	ESP_LOGD(LOG_TAG, "<< FTPBulkFileCallbacks::onStoreEnd");
+} // FTPBulkFileCallbacks#onStoreEnd
+
+
+/**
+ * Called when the client requests retrieval of a file.
+ */
+void FTPBulkFileCallbacks::onRetrieveStart(std::string fileName) {
+	ESP_LOGD(LOG_TAG, ">> FTPBulkFileCallbacks::onRetrieveStart: fileName=%s", fileName.c_str());
+	m_retrieveFd = ::open(fileName.c_str(), O_RDONLY);
+	if (m_retrieveFd == -1) {
+		ESP_LOGD(LOG_TAG, "<< FTPBulkFileCallbacks::onRetrieveStart: ***FileException***");
+		throw FTPServer::FileException();
+	}
+	ESP_LOGD(LOG_TAG, "<< FTPBulkFileCallbacks::onRetrieveStart");
+} // FTPBulkFileCallbacks#onRetrieveStart
+
+
+/**
+ * Called when the client is ready to receive the next piece of the file.  The buffer is filled straight
+ * from the file.
+ * @return The size of data being returned.  0 indicates that there is no more data to return.
+ */
+size_t FTPBulkFileCallbacks::onRetrieveData(uint8_t* data, size_t size) {
+	size_t readSize = 0;
+	while (readSize < size) {
+		int rc = ::read(m_retrieveFd, data + readSize, size - readSize);
+		if (rc < 0) {
+			ESP_LOGE(LOG_TAG, "read: %s", strerror(errno));
+		}
+		if (rc <= 0) break;
+		readSize += rc;
+	}
+	ESP_LOGD(LOG_TAG, "<< FTPBulkFileCallbacks::onRetrieveData: sizeRead=%d", readSize);
+	return readSize;
+} // FTPBulkFileCallbacks#onRetrieveData
+
+
+/**
+ * Called when the retrieval has been completed.
+ */
+void FTPBulkFileCallbacks::onRetrieveEnd() {
+	ESP_LOGD(LOG_TAG, ">> FTPBulkFileCallbacks::onRetrieveEnd");
+	if (m_retrieveFd != -1) {
+		::close(m_retrieveFd);
+		m_retrieveFd = -1;
+	}
+	ESP_LOGD(LOG_TAG, "<< FTPBulkFileCallbacks::onRetrieveEnd");
+} // FTPBulkFileCallbacks#onRetrieveEnd
+
+
+/// ---- END OF FTPBulkFileCallbacks
+
+
 void FTPCallbacks::onStoreStart(std::string fileName) {
 	ESP_LOGD(LOG_TAG,">> FTPCallbacks::onStoreStart: fileName=%s", fileName.c_str());
 	ESP_LOGD(LOG_TAG,"<< FTPCallbacks::onStoreStart");
 } // FTPCallbacks#onStoreStart
 
 
+/**
+ * Called when the client presents a new chunk of data to be saved.
+ * @return The number of bytes accepted.  Anything less than the size aborts the transfer.
+ */
 size_t FTPCallbacks::onStoreData(uint8_t* data, size_t size) {
 	ESP_LOGD(LOG_TAG,">> FTPCallbacks::onStoreData: size=%d", size);
 	ESP_LOGD(LOG_TAG,"<< FTPCallbacks::onStoreData");
-	return 0;
+	return size;
 } // FTPCallbacks#onStoreData
 
 
@@ -17,9 +17,12 @@
 #include <cctype>
 #include <unistd.h>
 #include <esp_log.h>
+#include "FreeRTOS.h"
 
 static const char* LOG_TAG = "FTPServer";
 
+static const size_t MIN_CHUNK_SIZE = 512;   // Smaller chunks cost more in calls than they save in memory.
+
 // trim from start (in place)
 static void ltrim(std::string &s) {
 	s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](int ch) {
@@ -43,6 +46,71 @@ static void trim(std::string &s) {
 } // trim
 
 
+/**
+ * @brief Fill a buffer with data from the client's data connection for receiveFile.
+ * We keep reading until the buffer is full so that the callbacks see whole chunks, however the data
+ * was split into segments on the network.
+ */
+static int receiveData(uint8_t* pBuffer, size_t length, void* pContext) {
+	int    dataSocket = *(int*) pContext;
+	size_t received   = 0;
+	while (received < length) {
+		int rc = recv(dataSocket, pBuffer + received, length - received, 0);
+		if (rc < 0) {
+			ESP_LOGE(LOG_TAG, "receiveData: recv(): %s", strerror(errno));
+			return -1;
+		}
+		if (rc == 0) break;   // The client has sent the whole file.
+		received += rc;
+	}
+	return received;
+} // receiveData
+
+
+/**
+ * @brief Pass a buffer of data received to the store callback for receiveFile.
+ */
+static bool storeData(const uint8_t* pData, size_t length, void* pContext) {
+	return ((FTPCallbacks*) pContext)->onStoreData((uint8_t*) pData, length) == length;
+} // storeData
+
+
+/**
+ * @brief Fill a buffer from the retrieve callback for onRetr.
+ */
+static int retrieveData(uint8_t* pBuffer, size_t length, void* pContext) {
+	return ((FTPCallbacks*) pContext)->onRetrieveData(pBuffer, length);
+} // retrieveData
+
+
+/**
+ * @brief Send a buffer of data to the client's data connection for onRetr.
+ */
+static bool sendSocket(const uint8_t* pData, size_t length, void* pContext) {
+	int dataSocket = *(int*) pContext;
+	while (length > 0) {
+		int rc = send(dataSocket, pData, length, 0);
+		if (rc < 0) {
+			ESP_LOGE(LOG_TAG, "sendSocket: send(): %s", strerror(errno));
+			return false;
+		}
+		pData  += rc;
+		length -= rc;
+	}
+	return true;
+} // sendSocket
+
+
+/**
+ * @brief Log the size and speed of a file transfer.
+ */
+static void logTransfer(const char* what, std::string fileName, int64_t bytes, uint32_t startTime) {
+	uint32_t duration = FreeRTOS::getTimeSinceStart() - startTime;
+	ESP_LOGI(LOG_TAG, "%s %s: %lld bytes in %u ms (%u bytes/sec)", what, fileName.c_str(), (long long) bytes, duration,
+		duration == 0 ? 0 : (uint32_t) (bytes * 1000 / duration));
+} // logTransfer
+
+
 FTPServer::FTPServer() {
 	ESP_LOGD(LOG_TAG,">> FTPServer()");
 
@@ -54,9 +122,11 @@ FTPServer::FTPServer() {
 	m_serverSocket  = -1;
 
 	m_callbacks       = nullptr;
+	m_pDataBuffer     = nullptr;
 	m_isPassive       = false;
 	m_isImage         = true;
 	m_chunkSize       = 4096;
+	m_retrieveStackSize = DoubleBuffer::DEFAULT_STACK_SIZE;
 	m_port            = 21; // The default Server-PI port
 	m_loginRequired   = false;
 	m_isAuthenticated = false;
@@ -68,7 +138,7 @@ FTPServer::FTPServer() {
 
 
 FTPServer::~FTPServer() {
-	// Nothing to do here by default.
+	delete m_pDataBuffer;
 } // FTPServer#~FTPServer
 
 
@@ -352,13 +422,13 @@ void FTPServer::onQuit(std::istringstream& ss) {
 void FTPServer::onRetr(std::istringstream& ss) {
 	// We open a data connection back to the client.  We then invoke the callback to indicate that we have
 	// started a retrieve operation.  We call the retrieve callback to request the next chunk of data and
-	// transmit this down the data connection.  We repeat this until there is no more data to send at which
+	// transmit this down the data connection.  The retrieve callback fills one buffer on a helper thread
+	// while the previous one is being sent.  We repeat this until there is no more data to send at which
 	// point we close the data connection and we are done.
 	ESP_LOGD(LOG_TAG, ">> onRetr");
 	std::string fileName;
 
 	ss >> fileName;
-	uint8_t data[m_chunkSize];
 
 	if (m_callbacks != nullptr) {
 		try {
@@ -372,15 +442,20 @@ void FTPServer::onRetr(std::istringstream& ss) {
 
 	sendResponse(FTPServer::RESPONSE_150_ABOUT_TO_OPEN_DATA_CONNECTION); // File status okay; about to open data connection.
 	openData();
+	int64_t sent = 0;
 	if (m_callbacks != nullptr) {
-		int readSize = m_callbacks->onRetrieveData(data, m_chunkSize);
-		while (readSize > 0) {
-			sendData(data, readSize);
-			readSize = m_callbacks->onRetrieveData(data, m_chunkSize);
+		uint32_t startTime = FreeRTOS::getTimeSinceStart();
+		sent = getDataBuffer()->transfer(retrieveData, m_callbacks, sendSocket, &m_dataSocket);
+		if (sent >= 0) {
+			logTransfer("Sent", fileName, sent, startTime);
 		}
 	}
 	closeData();
-	sendResponse(FTPServer::RESPONSE_226_CLOSING_DATA_CONNECTION); // Closing data connection.
+	if (sent < 0) {
+		sendResponse(FTPServer::RESPONSE_426_TRANSFER_ABORTED); // Connection closed; transfer aborted.
+	} else {
+		sendResponse(FTPServer::RESPONSE_226_CLOSING_DATA_CONNECTION); // Closing data connection.
+	}
 	if (m_callbacks != nullptr) {
 		m_callbacks->onRetrieveEnd();
 	}
@@ -471,6 +546,17 @@ void FTPServer::onXrmd(std::istringstream &ss) {
 } // FTPServer#onXrmd
 
 
+/**
+ * Get the buffers used to move file data, allocating them on first use.
+ */
+DoubleBuffer* FTPServer::getDataBuffer() {
+	if (m_pDataBuffer == nullptr) {
+		m_pDataBuffer = new DoubleBuffer(m_chunkSize, m_retrieveStackSize);
+	}
+	return m_pDataBuffer;
+} // FTPServer#getDataBuffer
+
+
 /**
  * Open a data connection with the client.
  * We will use closeData() to close the connection.
@@ -604,7 +690,8 @@ void FTPServer::processCommand() {
 
 /**
  * Receive a file from the FTP client (STOR).  The name of the file to be created is passed as a
- * parameter.
+ * parameter.  The data is received into one buffer while the store callback works on the other, so
+ * the network and the file system are kept busy at the same time.
  */
 void FTPServer::receiveFile(std::string fileName) {
 	ESP_LOGD(LOG_TAG, ">> receiveFile: %s", fileName.c_str());
@@ -619,22 +706,30 @@ void FTPServer::receiveFile(std::string fileName) {
 	}
 	openData();
 	sendResponse(FTPServer::RESPONSE_150_ABOUT_TO_OPEN_DATA_CONNECTION); // File status okay; about to open data connection.
-	uint8_t buf[m_chunkSize];
-	uint32_t totalSizeRead = 0;
-	while (true) {
-		int rc = recv(m_dataSocket, &buf, m_chunkSize, 0);
-		if (rc <= 0) break;
-		if (m_callbacks != nullptr) {
-			m_callbacks->onRetrieveData(buf, rc);
+	int64_t totalSizeRead = 0;
+	if (m_callbacks != nullptr) {
+		uint32_t startTime = FreeRTOS::getTimeSinceStart();
+		totalSizeRead = getDataBuffer()->transfer(receiveData, &m_dataSocket, storeData, m_callbacks);
+		if (totalSizeRead >= 0) {
+			logTransfer("Received", fileName, totalSizeRead, startTime);
 		}
-		totalSizeRead += rc;
 	}
-	sendResponse(FTPServer::RESPONSE_226_CLOSING_DATA_CONNECTION); // Closing data connection.
 	closeData();
+	bool stored = true;
 	if (m_callbacks != nullptr) {
-		m_callbacks->onRetrieveEnd();
+		try {
+			m_callbacks->onStoreEnd();
+		} catch(FTPServer::FileException& e) {
+			ESP_LOGD(LOG_TAG, "Caught a file exception!");
+			stored = false;
+		}
+	}
+	if (totalSizeRead < 0 || !stored) {
+		sendResponse(FTPServer::RESPONSE_451_LOCAL_ERROR); // Requested action aborted: local error in processing.
+	} else {
+		sendResponse(FTPServer::RESPONSE_226_CLOSING_DATA_CONNECTION); // Closing data connection.
 	}
-	ESP_LOGD(LOG_TAG, "<< receiveFile: totalSizeRead=%d", totalSizeRead);
+	ESP_LOGD(LOG_TAG, "<< receiveFile: totalSizeRead=%lld", (long long) totalSizeRead);
 } // FTPServer#receiveFile
 
 
@@ -699,6 +794,12 @@ void FTPServer::sendResponse(int code) {
 		case RESPONSE_331_PASSWORD_REQUIRED:
 			text = "Password required.";
 			break;
+		case RESPONSE_426_TRANSFER_ABORTED:
+			text = "Connection closed; transfer aborted.";
+			break;
+		case RESPONSE_451_LOCAL_ERROR:
+			text = "Requested action aborted: local error in processing.";
+			break;
 		case RESPONSE_500_COMMAND_UNRECOGNIZED:
 			text = "Syntax error, command unrecognized.";
 			break;
@@ -730,6 +831,34 @@ void FTPServer::setCallbacks(FTPCallbacks* pCallbacks) {
 } // FTPServer#setCallbacks
 
 
+/**
+ * Set the size of the chunks in which file data is passed to and from the callbacks.  Two buffers of this
+ * size are allocated for the first transfer and kept for the following ones.
+ * @param chunkSize The size of a chunk in bytes, at least 512.  The default is 4096.
+ */
+void FTPServer::setChunkSize(size_t chunkSize) {
+	chunkSize = std::max(chunkSize, MIN_CHUNK_SIZE);
+	if (chunkSize == m_chunkSize) return;
+	m_chunkSize = chunkSize;
+	delete m_pDataBuffer;   // Allocated again at the new size when next needed.
+	m_pDataBuffer = nullptr;
+} // FTPServer#setChunkSize
+
+
+/**
+ * Set the size of the stack of the thread that calls FTPCallbacks::onRetrieveData().  Callbacks that need
+ * more than the default of 8192 bytes, for example to log or decode what they read, should set it before
+ * the first transfer.
+ * @param stackSize The size of the stack in bytes.
+ */
+void FTPServer::setRetrieveStackSize(size_t stackSize) {
+	if (stackSize == m_retrieveStackSize) return;
+	m_retrieveStackSize = stackSize;
+	delete m_pDataBuffer;   // Its thread is started again with the new stack when next needed.
+	m_pDataBuffer = nullptr;
+} // FTPServer#setRetrieveStackSize
+
+
 void FTPServer::setCredentials(std::string userid, std::string password) {
 	ESP_LOGD(LOG_TAG, ">> setCredentials: userid=%s", userid.c_str());
 	m_loginRequired = true;
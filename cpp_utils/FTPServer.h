@@ -12,8 +12,16 @@
 #include <fstream>
 #include <string>
 #include <exception>
+#include "DoubleBuffer.h"
 
 
+/**
+ * The callbacks through which an FTPServer stores and retrieves files.  They are called on the task running
+ * the server, except onRetrieveData().  That one is called on the helper thread of the server's DoubleBuffer,
+ * so that the next chunk is read while the last one is sent, and must fit in its stack: see
+ * FTPServer::setRetrieveStackSize().  onStoreStart() and onStoreEnd() throw FTPServer::FileException when
+ * the file can't be opened or the end of its data can't be written.
+ */
 class FTPCallbacks {
 public:
 	virtual void        onStoreStart(std::string fileName);
@@ -48,6 +56,36 @@ private:
 };
 
 
+/**
+ * An implementation of FTPCallbacks that moves file data with Posix I/O in large blocks.  Data stored is
+ * written in whole blocks, so that each write to SPIFFS or FAT covers whole pages or sectors.  A block
+ * handed over in one piece is written straight from the server's buffer; only a remainder is copied, to be
+ * completed by the next chunk.  Data retrieved is read straight into the server's buffer.
+ */
+class FTPBulkFileCallbacks : public FTPFileCallbacks {
+public:
+	FTPBulkFileCallbacks(size_t blockSize = 4096);
+	virtual ~FTPBulkFileCallbacks();
+	void        onStoreStart(std::string fileName) override;
+	size_t      onStoreData(uint8_t* data, size_t size) override;
+	void        onStoreEnd() override;
+	void        onRetrieveStart(std::string fileName) override;
+	size_t      onRetrieveData(uint8_t* data, size_t size) override;
+	void        onRetrieveEnd() override;
+
+private:
+	size_t   m_blockSize;     // The size of each write.
+	uint8_t* m_pBlock;        // A partial block waiting for the rest of its data.
+	size_t   m_blockLength;   // Bytes in m_pBlock.
+	int      m_storeFd;       // File used to store data from the client.
+	int      m_retrieveFd;    // File used to retrieve data for the client.
+	bool     m_storeFailed;   // Has a write failed?
+
+	FTPBulkFileCallbacks(const FTPBulkFileCallbacks&);             // Not copyable, we own the block.
+	FTPBulkFileCallbacks& operator=(const FTPBulkFileCallbacks&);
+};
+
+
 class FTPServer {
 public:
 	FTPServer();
@@ -56,6 +94,8 @@ public:
 	void start();
 	void setPort(uint16_t port);
 	void setCallbacks(FTPCallbacks* pFTPCallbacks);
+	void setChunkSize(size_t chunkSize);
+	void setRetrieveStackSize(size_t stackSize);
 	static std::string getCurrentDirectory();
 	class FileException: public std::exception {
 	};
@@ -74,6 +114,8 @@ public:
 	static const int RESPONSE_227_ENTERING_PASSIVE_MODE		 = 227;
 	static const int RESPONSE_331_PASSWORD_REQUIRED			 = 331;
 	static const int RESPONSE_332_NEED_ACCOUNT				  = 332;
+	static const int RESPONSE_426_TRANSFER_ABORTED			  = 426;
+	static const int RESPONSE_451_LOCAL_ERROR				   = 451;
 	static const int RESPONSE_500_COMMAND_UNRECOGNIZED		  = 500;
 	static const int RESPONSE_502_COMMAND_NOT_IMPLEMENTED	   = 502;
 	static const int RESPONSE_503_BAD_SEQUENCE				  = 503;
@@ -92,6 +134,7 @@ private:
 	bool        m_isPassive;      // Are we in passive mode?  If not, then we are in active mode.
 	bool        m_isImage;        // Are we in image mode?
 	size_t      m_chunkSize;      // The maximum chunk size.
+	size_t      m_retrieveStackSize; // The stack of the thread that calls onRetrieveData().
 	std::string m_userid;         // The required userid.
 	std::string m_password;       // The required password.
 	std::string m_suppliedUserid; // The userid supplied from the USER command.
@@ -100,6 +143,7 @@ private:
 	std::string m_lastCommand;    // The last command that was processed.
 
 	FTPCallbacks*    m_callbacks;  // The callbacks for processing.
+	DoubleBuffer*    m_pDataBuffer; // Buffers for file data, allocated on first use and reused for every transfer.
 
 	void closeConnection();
 	void closeData();
@@ -124,6 +168,7 @@ private:
 	void onXrmd(std::istringstream& ss);
 
 	bool openData();
+	DoubleBuffer* getDataBuffer();
 
 	void receiveFile(std::string fileName);
 	void sendResponse(int code);
@@ -35,9 +35,10 @@ void FreeRTOS::sleep(uint32_t ms) {
  * @param[in] taskName A string identifier for the task.
  * @param[in] param An optional parameter to be passed to the started task.
  * @param[in] stackSize An optional paremeter supplying the size of the stack in which to run the task.
+ * @return True if the task was created, false if there wasn't the memory for it.
  */
-void FreeRTOS::startTask(void task(void*), std::string taskName, void* param, uint32_t stackSize) {
-	::xTaskCreate(task, taskName.data(), stackSize, param, 5, NULL);
+bool FreeRTOS::startTask(void task(void*), std::string taskName, void* param, uint32_t stackSize) {
+	return ::xTaskCreate(task, taskName.data(), stackSize, param, 5, NULL) == pdPASS;
 } // startTask
 
 
@@ -8,6 +8,7 @@
 #include <string>
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
 #include "HttpParser.h"
 #include "HttpRequest.h"
 #include "GeneralUtils.h"
@@ -108,18 +109,40 @@ std::pair<std::string, std::string> parseHeader(std::string& line) {
 
 
 HttpParser::HttpParser() {
+	m_pReader      = nullptr;
+	m_bodyRead     = false;
+	m_headTooLarge = false;
 }
 
 HttpParser::~HttpParser() {
 }
 
 
+/**
+ * @brief Read and discard whatever remains of the request body.
+ * This leaves the reader positioned at the start of whatever follows the request.
+ */
+void HttpParser::discardBody() {
+	uint8_t data[128];
+	while (readBody(data, sizeof(data)) > 0) {
+	}
+} // discardBody
+
+
 /**
  * @brief Dump the outcome of the parse.
  *
  */
 void HttpParser::dump() {
 	ESP_LOGD(LOG_TAG, "Method: %s, URL: \"%s\", Version: %s", m_method.c_str(), m_url.c_str(), m_version.c_str());
+	if (m_requestParser.isHeadComplete()) {
+		for (size_t i = 0; i < m_requestParser.getHeaderCount(); i++) {
+			HttpStringView name  = m_requestParser.getHeaderName(i);
+			HttpStringView value = m_requestParser.getHeaderValue(i);
+			ESP_LOGD(LOG_TAG, "name=\"%.*s\", value=\"%.*s\"", (int) name.length(), name.data(), (int) value.length(), value.data());
+		}
+		return;
+	}
 	auto it2 = m_headers.begin();
 	for (; it2 != m_headers.end(); ++it2) {
 		ESP_LOGD(LOG_TAG, "name=\"%s\", value=\"%s\"", it2->first.c_str(), it2->second.c_str());
@@ -128,9 +151,36 @@ void HttpParser::dump() {
 } // dump
 
 
+/**
+ * @brief Get the body of the message.
+ * If the body of a request has not yet been read, the remainder of it is read now.  For large bodies
+ * prefer readBody() which does not need to hold the whole body in RAM.
+ * @return The body of the message.
+ */
 std::string HttpParser::getBody() {
+	if (!m_bodyRead && m_pReader != nullptr) {
+		m_bodyRead = true;
+		m_body.reserve(m_requestParser.getContentLength());
+		uint8_t data[512];
+		size_t rc;
+		while ((rc = readBody(data, sizeof(data))) > 0) {
+			m_body.append((char*) data, rc);
+		}
+	}
 	return m_body;
-}
+} // getBody
+
+
+/**
+ * @brief Get the HTTP status with which a request that could not be parsed should be answered.
+ * A failure in the body (for example a malformed chunk) is reported once readBody() has come across it.
+ * @return The status or 0 if the request was parsed or there is nothing to answer, such as when the
+ * client closed the connection.
+ */
+int HttpParser::getErrorStatus() {
+	if (m_requestParser.isError()) return m_requestParser.getErrorStatus();
+	return m_headTooLarge ? 431 : 0;   // 431 Request Header Fields Too Large.
+} // getErrorStatus
 
 
 /**
@@ -139,6 +189,9 @@ std::string HttpParser::getBody() {
  * @return The value of the named header or null if not present.
  */
 std::string HttpParser::getHeader(const std::string& name) {
+	if (m_requestParser.isHeadComplete()) {
+		return m_requestParser.getHeader(name.c_str()).toString();
+	}
 	// We normalize the header name to be lower case.
 	std::string localName = name;
 	GeneralUtils::toLower(localName);
@@ -147,7 +200,32 @@ std::string HttpParser::getHeader(const std::string& name) {
 } // getHeader
 
 
+/**
+ * @brief Retrieve the value of the named header of a request without copying it.
+ * The name is compared ignoring case.
+ * @param [in] name The name of the header to retrieve.
+ * @return A view of the value of the header which is empty if the header is not present.
+ */
+HttpStringView HttpParser::getHeaderView(const char* name) {
+	return m_requestParser.getHeader(name);
+} // getHeaderView
+
+
+/**
+ * @brief Get all the headers.
+ * The header names are normalized to lower case.
+ * @return A map of header names to values.
+ */
 std::map<std::string, std::string> HttpParser::getHeaders() {
+	if (m_requestParser.isHeadComplete()) {
+		std::map<std::string, std::string> headers;
+		for (size_t i = 0; i < m_requestParser.getHeaderCount(); i++) {
+			std::string name = m_requestParser.getHeaderName(i).toString();
+			GeneralUtils::toLower(name);
+			headers.insert(std::pair<std::string, std::string>(name, m_requestParser.getHeaderValue(i).toString()));
+		}
+		return headers;
+	}
 	return m_headers;
 } // getHeaders
 
@@ -162,6 +240,15 @@ std::string HttpParser::getURL() {
 } // getURL
 
 
+/**
+ * @brief Get the URL without copying it.
+ * @return A view of the URL which remains valid as long as the parser.
+ */
+HttpStringView HttpParser::getURLView() {
+	return HttpStringView(m_url.data(), m_url.length());
+} // getURLView
+
+
 std::string HttpParser::getVersion() {
 	return m_version;
 } // getVersion
@@ -180,49 +267,83 @@ std::string HttpParser::getReason() {
  * @return True if the header is present and false otherwise.
  */
 bool HttpParser::hasHeader(const std::string& name) {
+	if (m_requestParser.isHeadComplete()) {
+		for (size_t i = 0; i < m_requestParser.getHeaderCount(); i++) {
+			if (m_requestParser.getHeaderName(i).equalsIgnoreCase(name.c_str())) return true;
+		}
+		return false;
+	}
 	// We normalize the header name to be lower case.
 	std::string localName = name;
 	return m_headers.find(GeneralUtils::toLower(localName)) != m_headers.end();
 } // hasHeader
 
 
+/**
+ * @brief Determine if a request was successfully parsed.
+ * @return True if we have a complete and well formed request head.
+ */
+bool HttpParser::isValid() {
+	return m_requestParser.isHeadComplete() && !m_requestParser.isError();
+} // isValid
+
+
 /**
  * @brief Parse socket data.
+ * The body is read in full before returning as the reader does not outlive this call.
  * @param [in] s The socket from which to retrieve data.
  */
 void HttpParser::parse(Socket s) {
-	ESP_LOGD(LOG_TAG, ">> parse: socket: %s", s.toString().c_str());
-	std::string line;
-	line = s.readToDelim(lineTerminator);
-	parseRequestLine(line);
-	line = s.readToDelim(lineTerminator);
-	while (!line.empty()) {
-		m_headers.insert(parseHeader(line));
-		line = s.readToDelim(lineTerminator);
-	}
-	// Only PUT and POST requests have a body
-	if (getMethod() != "POST" && getMethod() != "PUT") {
-		ESP_LOGD(LOG_TAG, "<< parse");
-		return;
-	}
+	BufferedSocketReader reader(s, DEFAULT_MAX_HEAD_SIZE);
+	parse(reader);
+	getBody();
+	m_pReader = nullptr;
+} // parse
 
-	// We have now parsed up to and including the separator ... we are now at the point where we
-	// want to read the body.  There are two stories here.  The first is that we know the exact length
-	// of the body or we read until we can't read anymore.
-	if (hasHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH)) {
-		std::string val = getHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH);
-		int length = std::atoi(val.c_str());
-		uint8_t data[length];
-		s.receive(data, length, true);
-		m_body = std::string((char*) data, length);
-	} else {
-		uint8_t data[512];
-		int rc = s.receive(data, sizeof(data));
-		if (rc > 0) {
-			m_body = std::string((char*) data, rc);
+
+/**
+ * @brief Parse socket data read through a buffered reader.
+ * The head of the request is parsed in place in the receive buffer of the reader and then copied once so
+ * that the buffer can be reused for the body.  The size of the buffer is therefore the largest head we
+ * accept; a larger one fails the parse with getErrorStatus() returning 431.  The body is left in the reader
+ * to be read on demand through readBody() or getBody(), so the reader must remain valid while the request
+ * is being processed.
+ * @param [in] reader The reader from which to retrieve data.
+ */
+void HttpParser::parse(BufferedSocketReader& reader) {
+	ESP_LOGD(LOG_TAG, ">> parse: socket: %s", reader.getSocket().toString().c_str());
+	m_requestParser.reset();
+	m_pReader      = nullptr;
+	m_bodyRead     = false;
+	m_headTooLarge = false;
+	while (true) {
+		int rc = m_requestParser.parseHead((const char*) reader.peek(), reader.available());
+		if (rc > 0) break;
+		if (rc < 0) {
+			ESP_LOGE(LOG_TAG, "<< parse: %s", m_requestParser.getError());
+			return;
 		}
-	}
-	ESP_LOGD(LOG_TAG, "<< parse: Size of body: %d", m_body.length());
+		if (reader.available() == reader.getBufferSize()) {
+			ESP_LOGE(LOG_TAG, "<< parse: Request head larger than the %d byte receive buffer", reader.getBufferSize());
+			m_headTooLarge = true;
+			return;
+		}
+		if (!reader.fill()) {
+			ESP_LOGD(LOG_TAG, "<< parse: Connection closed before the request head was complete");
+			return;
+		}
+	} // while
+
+	// Take a single copy of the head and release the receive buffer for the body.
+	m_head.assign((const char*) reader.peek(), m_requestParser.getHeadLength());
+	m_requestParser.setBuffer(m_head.data());
+	reader.consume(m_requestParser.getHeadLength());
+
+	m_method  = m_requestParser.getMethod().toString();
+	m_url     = m_requestParser.getTarget().toString();
+	m_version = m_requestParser.getVersion().toString();
+	m_pReader = &reader;
+	ESP_LOGD(LOG_TAG, "<< parse: method: %s, url: %s, body: %d", m_method.c_str(), m_url.c_str(), m_requestParser.hasBody());
 } // parse
 
 
@@ -307,3 +428,29 @@ void HttpParser::parseStatusLine(std::string& line) {
 
 	ESP_LOGD(LOG_TAG, "<< ParseStatusLine: method: %s, version: %s, status: %s", m_method.c_str(), m_version.c_str(), m_status.c_str());
 } // parseRequestLine
+
+
+/**
+ * @brief Read the next part of the body of a request.
+ * The body is decoded (Content-Length or chunked) as it is read so only the caller's buffer and the
+ * receive buffer of the reader are needed no matter how large the body is.
+ * @param [out] data The storage into which the body data is written.
+ * @param [in] length The size of the storage.
+ * @return The number of bytes of body written.  0 means we have reached the end of the body.
+ */
+size_t HttpParser::readBody(uint8_t* data, size_t length) {
+	size_t total = 0;
+	while (total < length && m_pReader != nullptr && isValid() && !m_requestParser.isComplete()) {
+		if (m_pReader->available() == 0 && !m_pReader->fill()) break;
+		const uint8_t* pBody;
+		size_t bodyLength;
+		size_t consumed = m_requestParser.parseBody(m_pReader->peek(), m_pReader->available(), length - total, &pBody, &bodyLength);
+		::memcpy(data + total, pBody, bodyLength);
+		total += bodyLength;
+		m_pReader->consume(consumed);
+	} // while
+	if (m_requestParser.isError()) {
+		ESP_LOGE(LOG_TAG, "readBody: %s", m_requestParser.getError());
+	}
+	return total;
+} // readBody
@@ -10,23 +10,42 @@
 #include <string>
 #include <map>
 #include "Socket.h"
+#include "BufferedSocketReader.h"
+#include "HttpRequestParser.h"
 
+/**
+ * @brief Parse HTTP messages.
+ *
+ * A request read from a socket is parsed by an HttpRequestParser directly over the receive buffer of a
+ * BufferedSocketReader.  The head is then held as a single copy with the method, URL and headers referring
+ * into it, so no per-header strings or maps are built.  The body is not read as part of the parse.  It can
+ * be streamed in chunks with readBody() or read as a whole with getBody().
+ */
 class HttpParser {
 public:
+	static const size_t DEFAULT_MAX_HEAD_SIZE = 8 * 1024;   // Largest request head accepted by default.
+
 	HttpParser();
 	virtual ~HttpParser();
-	std::string getBody();
-	std::string getHeader(const std::string& name);
+	void           discardBody();
+	std::string    getBody();
+	int            getErrorStatus();
+	std::string    getHeader(const std::string& name);
+	HttpStringView getHeaderView(const char* name);
 	std::map<std::string, std::string> getHeaders();
-	std::string getMethod();
-	std::string getURL();
-	std::string getVersion();
-	std::string getStatus();
-	std::string getReason();
-	bool hasHeader(const std::string& name);
-	void parse(std::string message);
-	void parse(Socket s);
-	void parseResponse(std::string message);
+	std::string    getMethod();
+	std::string    getURL();
+	HttpStringView getURLView();
+	std::string    getVersion();
+	std::string    getStatus();
+	std::string    getReason();
+	bool           hasHeader(const std::string& name);
+	bool           isValid();
+	void           parse(std::string message);
+	void           parse(Socket s);
+	void           parse(BufferedSocketReader& reader);
+	void           parseResponse(std::string message);
+	size_t         readBody(uint8_t* data, size_t length);
 
 private:
 	std::string m_method;
@@ -35,7 +54,12 @@ private:
 	std::string m_body;
 	std::string m_status;
 	std::string m_reason;
-	std::map<std::string, std::string> m_headers;
+	std::map<std::string, std::string> m_headers;    // Headers of a parsed response.
+	std::string           m_head;                    // Copy of the request head that the request parser refers to.
+	HttpRequestParser     m_requestParser;           // Parser for a request read from a socket.
+	BufferedSocketReader* m_pReader;                 // Reader from which the body of a request is read.
+	bool                  m_bodyRead;                // Has the body been read into m_body?
+	bool                  m_headTooLarge;            // Did the request head overflow the receive buffer?
 	void dump();
 	void parseRequestLine(std::string& line);
 	void parseStatusLine(std::string& line);
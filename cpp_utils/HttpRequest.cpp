@@ -49,20 +49,32 @@ static const char* LOG_TAG="HttpRequest";
 //static std::string lineTerminator = "\r\n";
 
 const char HttpRequest::HTTP_HEADER_ACCEPT[]         = "Accept";
+const char HttpRequest::HTTP_HEADER_ACCEPT_ENCODING[] = "Accept-Encoding";
+const char HttpRequest::HTTP_HEADER_ACCEPT_RANGES[]  = "Accept-Ranges";
 const char HttpRequest::HTTP_HEADER_ALLOW[]          = "Allow";
 const char HttpRequest::HTTP_HEADER_CONNECTION[]     = "Connection";
+const char HttpRequest::HTTP_HEADER_CONTENT_ENCODING[] = "Content-Encoding";
 const char HttpRequest::HTTP_HEADER_CONTENT_LENGTH[] = "Content-Length";
+const char HttpRequest::HTTP_HEADER_CONTENT_RANGE[]  = "Content-Range";
 const char HttpRequest::HTTP_HEADER_CONTENT_TYPE[]   = "Content-Type";
 const char HttpRequest::HTTP_HEADER_COOKIE[]         = "Cookie";
+const char HttpRequest::HTTP_HEADER_ETAG[]           = "ETag";
 const char HttpRequest::HTTP_HEADER_HOST[]           = "Host";
+const char HttpRequest::HTTP_HEADER_IF_MODIFIED_SINCE[] = "If-Modified-Since";
+const char HttpRequest::HTTP_HEADER_IF_NONE_MATCH[]  = "If-None-Match";
+const char HttpRequest::HTTP_HEADER_IF_RANGE[]       = "If-Range";
 const char HttpRequest::HTTP_HEADER_LAST_MODIFIED[]  = "Last-Modified";
 const char HttpRequest::HTTP_HEADER_ORIGIN[]         = "Origin";
+const char HttpRequest::HTTP_HEADER_RANGE[]          = "Range";
 const char HttpRequest::HTTP_HEADER_SEC_WEBSOCKET_ACCEPT[]   = "Sec-WebSocket-Accept";
+const char HttpRequest::HTTP_HEADER_SEC_WEBSOCKET_EXTENSIONS[] = "Sec-WebSocket-Extensions";
 const char HttpRequest::HTTP_HEADER_SEC_WEBSOCKET_PROTOCOL[] = "Sec-WebSocket-Protocol";
 const char HttpRequest::HTTP_HEADER_SEC_WEBSOCKET_KEY[]      = "Sec-WebSocket-Key";
 const char HttpRequest::HTTP_HEADER_SEC_WEBSOCKET_VERSION[]  = "Sec-WebSocket-Version";
+const char HttpRequest::HTTP_HEADER_TRANSFER_ENCODING[] = "Transfer-Encoding";
 const char HttpRequest::HTTP_HEADER_UPGRADE[]        = "Upgrade";
 const char HttpRequest::HTTP_HEADER_USER_AGENT[]     = "User-Agent";
+const char HttpRequest::HTTP_HEADER_VARY[]           = "Vary";
 
 const char HttpRequest::HTTP_METHOD_CONNECT[] = "CONNECT";
 const char HttpRequest::HTTP_METHOD_DELETE[]  = "DELETE";
@@ -93,12 +105,73 @@ std::string buildWebsocketKeyResponseHash(std::string requestKey) {
  * @brief Create an HTTP Request instance.
  */
 HttpRequest::HttpRequest(Socket clientSocket) {
-	m_clientSocket = clientSocket;
-	m_pWebSocket   = nullptr;
+	m_clientSocket   = clientSocket;
+	m_pWebSocket     = nullptr;
+	m_pDeflateConfig = nullptr;
 	m_isClosed     = false;
+	m_keepAlive    = false;   // The reader does not outlive the constructor so nothing further can be read.
 
 	m_parser.parse(clientSocket); // Parse the socket stream to build the HTTP data.
+	checkWebsocket();
+} // HttpRequest
+
+
+/**
+ * @brief Create an HTTP Request instance from data read through a buffered reader.
+ * The reader belongs to the connection and any data following this request remains buffered within it.
+ * @param [in] reader The reader for the client connection.
+ * @param [in] pDeflateConfig How permessage-deflate is offered if the request is a WebSocket upgrade.
+ */
+HttpRequest::HttpRequest(BufferedSocketReader& reader, const WebSocketDeflateConfig* pDeflateConfig) {
+	m_clientSocket   = reader.getSocket();
+	m_pWebSocket     = nullptr;
+	m_pDeflateConfig = pDeflateConfig;
+	m_isClosed     = false;
+	m_keepAlive    = false;
+
+	m_parser.parse(reader); // Parse the socket stream to build the HTTP data.
+	checkKeepAlive();
+	checkWebsocket();
+} // HttpRequest
+
+
+/**
+ * @brief Determine if the Connection header contains the given option.
+ * The Connection header is a comma separated list of options which are compared ignoring case.
+ * @param [in] connection The value of the Connection header.
+ * @param [in] option The option to look for.
+ * @return True if the option is present.
+ */
+static bool hasConnectionOption(const std::string& connection, const char* option) {
+	std::vector<std::string> parts = GeneralUtils::split(connection, ',');
+	for (auto it = parts.begin(); it != parts.end(); ++it) {
+		std::string part = GeneralUtils::trim(*it);
+		if (HttpStringView(part.data(), part.length()).equalsIgnoreCase(option)) return true;
+	}
+	return false;
+} // hasConnectionOption
 
+
+/**
+ * @brief Determine if the client wants to keep the connection open after this request.
+ * An HTTP/1.1 connection is persistent unless the client asks for it to be closed.  An HTTP/1.0 connection
+ * is only persistent if the client asks for keep-alive (RFC7230 section 6.3).
+ */
+void HttpRequest::checkKeepAlive() {
+	if (!isValid()) return;
+	std::string connection = getHeader(HTTP_HEADER_CONNECTION);
+	if (getVersion() == "HTTP/1.1") {
+		m_keepAlive = !hasConnectionOption(connection, "close");
+	} else {
+		m_keepAlive = hasConnectionOption(connection, "keep-alive");
+	}
+} // checkKeepAlive
+
+
+/**
+ * @brief Determine if the request is a WebSocket upgrade and, if it is, switch protocols.
+ */
+void HttpRequest::checkWebsocket() {
 	// We have to take some special action on the Connection header.  We want to know if it contains "Upgrade"
 	// however it has come to light that the Connection header can contain multiple parts.  For example, it has
 	// been reported that it can contain "keep-alive,Upgrade".  Because of this we can't simply examine the string
@@ -130,12 +203,24 @@ HttpRequest::HttpRequest(Socket clientSocket) {
 		response.addHeader(HTTP_HEADER_CONNECTION, "Upgrade");
 		response.addHeader(HTTP_HEADER_SEC_WEBSOCKET_ACCEPT,
 			buildWebsocketKeyResponseHash(getHeader(HTTP_HEADER_SEC_WEBSOCKET_KEY)));
+
+		WebSocketDeflate* pDeflate = nullptr;
+		std::string extensions = getHeader(HTTP_HEADER_SEC_WEBSOCKET_EXTENSIONS);
+		if (m_pDeflateConfig != nullptr && !extensions.empty()) {
+			std::string accepted;
+			pDeflate = WebSocketDeflate::negotiate(extensions, *m_pDeflateConfig, &accepted);
+			if (pDeflate != nullptr) {
+				response.addHeader(HTTP_HEADER_SEC_WEBSOCKET_EXTENSIONS, accepted);
+			}
+		}
 		response.sendData("");
 
 		// Now that we have converted the request into a WebSocket, create the new WebSocket entry.
-		m_pWebSocket = new WebSocket(clientSocket);
+		m_pWebSocket = new WebSocket(m_clientSocket);
+		m_pWebSocket->m_pDeflate = pDeflate;
+		m_keepAlive  = false;   // The connection now belongs to the WebSocket.
 	} // if this is a web socket ...
-} // HttpRequest
+} // checkWebsocket
 
 
 HttpRequest::~HttpRequest() {
@@ -154,6 +239,14 @@ void HttpRequest::close() {
 } // close_cpp
 
 
+/**
+ * @brief Read and discard whatever remains of the body of the request.
+ */
+void HttpRequest::discardBody() {
+	m_parser.discardBody();
+} // discardBody
+
+
 /**
  * @brief Dump the HttpRequest for debugging purposes.
  */
@@ -164,7 +257,6 @@ void HttpRequest::dump() {
 	for (; it2 != headers.end(); ++it2) {
 		ESP_LOGD(LOG_TAG, "name=\"%s\", value=\"%s\"", it2->first.c_str(), it2->second.c_str());
 	}
-	ESP_LOGD(LOG_TAG, "Body: \"%s\"", getBody().c_str());
 } // dump
 
 
@@ -201,6 +293,17 @@ std::string HttpRequest::getPath() {
 } // getPath
 
 
+/**
+ * @brief Get a parameter extracted from the path by the route that matched the request.
+ * For example, with a route of /api/sensor/{id} and a path of /api/sensor/7, getPathParam("id") is "7".
+ * @param [in] name The name of the parameter as written in the route.
+ * @return A view of the value of the parameter or an empty view if there is no such parameter.
+ */
+HttpStringView HttpRequest::getPathParam(const char* name) {
+	return m_routeParams.get(name);
+} // getPathParam
+
+
 /**
  * @brief Get the query part of the request.
  * The query is a set of name = value pairs.  The return is a map keyed by the name items.
@@ -287,6 +390,24 @@ bool HttpRequest::isClosed() {
 } // isClosed
 
 
+/**
+ * @brief Determine if the request was successfully parsed.
+ * @return True if a well formed request was read from the client.
+ */
+bool HttpRequest::isValid() {
+	return m_parser.isValid();
+} // isValid
+
+
+/**
+ * @brief Determine if the connection can be used for further requests once this one is complete.
+ * @return True if the connection is persistent.
+ */
+bool HttpRequest::isKeepAlive() {
+	return m_keepAlive && !m_isClosed;
+} // isKeepAlive
+
+
 /**
  * @brief Determine if this request represents a WebSocket
  * @return True if the request creates a web socket.
@@ -358,6 +479,28 @@ std::vector<std::string> HttpRequest::pathSplit() {
 } // pathSplit
 
 
+/**
+ * @brief Read the next part of the body of the request.
+ * Use this rather than getBody() to process a large body a piece at a time without holding all of it in RAM.
+ * @param [out] data The storage into which the body data is written.
+ * @param [in] length The size of the storage.
+ * @return The number of bytes written.  0 means the end of the body has been reached.
+ */
+size_t HttpRequest::readBody(uint8_t* data, size_t length) {
+	return m_parser.readBody(data, length);
+} // readBody
+
+
+/**
+ * @brief Set whether the connection can be used for further requests.
+ * Keep alive can only be turned off.  It is never turned on for a client that did not ask for it.
+ * @param [in] keepAlive False to have the connection closed once the response is complete.
+ */
+void HttpRequest::setKeepAlive(bool keepAlive) {
+	m_keepAlive = m_keepAlive && keepAlive;
+} // setKeepAlive
+
+
 /**
  * @brief Decode a URL/form
  * @param [in] str
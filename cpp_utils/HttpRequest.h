@@ -12,29 +12,45 @@
 #include <vector>
 #include "Socket.h"
 #include "WebSocket.h"
+#include "WebSocketDeflate.h"
 #include "HttpParser.h"
+#include "BufferedSocketReader.h"
+#include "HttpRouter.h"
 
 #undef close
 
 class HttpRequest {
 public:
 	HttpRequest(Socket s);
+	HttpRequest(BufferedSocketReader& reader, const WebSocketDeflateConfig* pDeflateConfig = nullptr);
 	virtual ~HttpRequest();
 	static const char HTTP_HEADER_ACCEPT[];
+	static const char HTTP_HEADER_ACCEPT_ENCODING[];
+	static const char HTTP_HEADER_ACCEPT_RANGES[];
 	static const char HTTP_HEADER_ALLOW[];
 	static const char HTTP_HEADER_CONNECTION[];
+	static const char HTTP_HEADER_CONTENT_ENCODING[];
 	static const char HTTP_HEADER_CONTENT_LENGTH[];
+	static const char HTTP_HEADER_CONTENT_RANGE[];
 	static const char HTTP_HEADER_CONTENT_TYPE[];
 	static const char HTTP_HEADER_COOKIE[];
+	static const char HTTP_HEADER_ETAG[];
 	static const char HTTP_HEADER_HOST[];
+	static const char HTTP_HEADER_IF_MODIFIED_SINCE[];
+	static const char HTTP_HEADER_IF_NONE_MATCH[];
+	static const char HTTP_HEADER_IF_RANGE[];
 	static const char HTTP_HEADER_LAST_MODIFIED[];
 	static const char HTTP_HEADER_ORIGIN[];
+	static const char HTTP_HEADER_RANGE[];
 	static const char HTTP_HEADER_SEC_WEBSOCKET_ACCEPT[];
+	static const char HTTP_HEADER_SEC_WEBSOCKET_EXTENSIONS[];
 	static const char HTTP_HEADER_SEC_WEBSOCKET_PROTOCOL[];
 	static const char HTTP_HEADER_SEC_WEBSOCKET_KEY[];
 	static const char HTTP_HEADER_SEC_WEBSOCKET_VERSION[];
+	static const char HTTP_HEADER_TRANSFER_ENCODING[];
 	static const char HTTP_HEADER_UPGRADE[];
 	static const char HTTP_HEADER_USER_AGENT[];
+	static const char HTTP_HEADER_VARY[];
 
 	static const char HTTP_METHOD_CONNECT[];
 	static const char HTTP_METHOD_DELETE[];
@@ -46,26 +62,38 @@ public:
 	static const char HTTP_METHOD_PUT[];
 
 	void                               close();                      // Close the connection to the client.
+	void                               discardBody();                // Read and discard any remaining body.
 	void                               dump();                       // Diagnostic dump of the Http request.
 	std::string                        getBody();                    // Get the body of the request.
 	std::string                        getHeader(std::string name);  // Get the value of a named header.
 	std::map<std::string, std::string> getHeaders();                 // Get all the headers.
 	std::string                        getMethod();                  // Get the request method.
 	std::string                        getPath();                    // Get the request path.
+	HttpStringView                     getPathParam(const char* name); // Get a parameter extracted from the path by a route.
 	std::map<std::string, std::string> getQuery();                   // Get the query part of the request.
 	Socket                             getSocket();                  // Get the underlying TCP/IP socket.
 	std::string                        getVersion();                 // Get the HTTP version.
 	WebSocket*                         getWebSocket();               // Get the WebSocket reference if this is a web socket.
 	bool                               isClosed();                   // Has the connection been closed?
+	bool                               isKeepAlive();                // Can the connection be used for further requests?
+	bool                               isValid();                    // Was the request successfully parsed?
 	bool                               isWebsocket();                // Is this request to create a web socket?
 	std::map<std::string, std::string> parseForm();                  // Parse the body as a form.
 	std::vector<std::string>           pathSplit();
+	size_t                             readBody(uint8_t* data, size_t length); // Read the next part of the body.
+	void                               setKeepAlive(bool keepAlive); // Set whether the connection can be kept open.
 	std::string                        urlDecode(std::string str);   // Decode a URL.
 private:
+	friend class HttpServerWorker;
 	Socket	  m_clientSocket; // The socket connected to the client.
 	bool		m_isClosed;	 // Is the client connection closed?
+	bool        m_keepAlive;    // Can the client connection be used for further requests?
+	HttpRouteParams m_routeParams; // Parameters extracted from the path by the matching route.
 	HttpParser  m_parser;	   // The parse to parse HTTP data.
 	WebSocket*  m_pWebSocket;   // A possible reference to a WebSocket object instance.
+	const WebSocketDeflateConfig* m_pDeflateConfig; // How permessage-deflate is offered to a WebSocket, if at all.
+	void        checkWebsocket();  // Perform the WebSocket upgrade if this request asks for one.
+	void        checkKeepAlive();  // Determine if the client wants a persistent connection.
 
 };
 
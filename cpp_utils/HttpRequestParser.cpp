@@ -0,0 +1,579 @@
+/*
+ * HttpRequestParser.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+/**
+ * RFC7230 - Hypertext Transfer Protocol (HTTP/1.1): Message Syntax and Routing
+ *
+ * request-line   = method SP request-target SP HTTP-version CRLF
+ * header-field   = field-name ":" OWS field-value OWS
+ * chunked-body   = *chunk last-chunk trailer-part CRLF
+ * chunk          = chunk-size [ chunk-ext ] CRLF chunk-data CRLF
+ *
+ * We also accept a bare LF as a line terminator as recommended by RFC7230 section 3.5.
+ */
+#include <cstring>
+#include <cstdlib>
+#include "HttpRequestParser.h"
+
+// Parser states.
+static const uint8_t STATE_REQUEST_LINE = 0;
+static const uint8_t STATE_HEADERS      = 1;
+static const uint8_t STATE_BODY         = 2;  // Content-Length delimited body.
+static const uint8_t STATE_CHUNK_START  = 3;  // Expecting the first hex digit of a chunk size.
+static const uint8_t STATE_CHUNK_SIZE   = 4;  // Reading the hex digits of a chunk size.
+static const uint8_t STATE_CHUNK_EXT    = 5;  // Skipping a chunk extension up to the end of the line.
+static const uint8_t STATE_CHUNK_DATA   = 6;  // Delivering chunk data.
+static const uint8_t STATE_CHUNK_END    = 7;  // Expecting the CRLF that follows chunk data.
+static const uint8_t STATE_TRAILER      = 8;  // At the start of a trailer line.
+static const uint8_t STATE_TRAILER_LINE = 9;  // Skipping a trailer field up to the end of the line.
+static const uint8_t STATE_COMPLETE     = 10;
+static const uint8_t STATE_ERROR        = 11;
+
+// Statuses with which a request that fails to parse is answered.
+static const int STATUS_BAD_REQUEST             = 400;
+static const int STATUS_PAYLOAD_TOO_LARGE       = 413;
+static const int STATUS_HEADERS_TOO_LARGE       = 431;
+static const int STATUS_NOT_IMPLEMENTED         = 501;
+static const int STATUS_VERSION_NOT_SUPPORTED   = 505;
+
+static const size_t   MAX_HEAD_LENGTH = 0xffff;      // Offsets are held in 16 bits.
+static const uint32_t MAX_CHUNK_SIZE  = 0x0fffffff;  // Guard against overflow when accumulating hex digits.
+
+
+static inline char toLowerChar(char c) {
+	return (c >= 'A' && c <= 'Z') ? (char) (c + ('a' - 'A')) : c;
+} // toLowerChar
+
+
+static inline bool isWhitespace(char c) {
+	return c == ' ' || c == '\t';
+} // isWhitespace
+
+
+static int hexValue(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+} // hexValue
+
+
+HttpStringView::HttpStringView() {
+	m_data   = "";
+	m_length = 0;
+} // HttpStringView
+
+
+HttpStringView::HttpStringView(const char* data, size_t length) {
+	m_data   = data;
+	m_length = length;
+} // HttpStringView
+
+
+const char* HttpStringView::data() const {
+	return m_data;
+} // data
+
+
+bool HttpStringView::empty() const {
+	return m_length == 0;
+} // empty
+
+
+/**
+ * @brief Compare the view with a NULL terminated string.
+ * @param [in] str The string to compare against.
+ * @return True if the view and the string hold the same characters.
+ */
+bool HttpStringView::equals(const char* str) const {
+	return ::strlen(str) == m_length && ::memcmp(m_data, str, m_length) == 0;
+} // equals
+
+
+/**
+ * @brief Compare the view with a NULL terminated string ignoring the case of ASCII letters.
+ * No copy of either string is made.
+ * @param [in] str The string to compare against.
+ * @return True if the view and the string hold the same characters ignoring case.
+ */
+bool HttpStringView::equalsIgnoreCase(const char* str) const {
+	for (size_t i = 0; i < m_length; i++) {
+		if (str[i] == '\0' || toLowerChar(m_data[i]) != toLowerChar(str[i])) return false;
+	}
+	return str[m_length] == '\0';
+} // equalsIgnoreCase
+
+
+size_t HttpStringView::length() const {
+	return m_length;
+} // length
+
+
+/**
+ * @brief Copy the view into a string.
+ * @return A string holding a copy of the characters.
+ */
+std::string HttpStringView::toString() const {
+	return std::string(m_data, m_length);
+} // toString
+
+
+HttpRequestParser::HttpRequestParser() {
+	reset();
+} // HttpRequestParser
+
+
+/**
+ * @brief Record that the parse has failed.
+ * @param [in] error A description of the failure.
+ * @param [in] status The HTTP status with which the request should be answered.
+ */
+void HttpRequestParser::fail(const char* error, int status) {
+	m_state       = STATE_ERROR;
+	m_error       = error;
+	m_errorStatus = status;
+} // fail
+
+
+/**
+ * @brief Get the value of the Content-Length header.
+ * @return The length of the body or 0 if no Content-Length was supplied.
+ */
+uint32_t HttpRequestParser::getContentLength() const {
+	return m_contentLength;
+} // getContentLength
+
+
+/**
+ * @brief Get a description of why the parse failed.
+ * @return A description of the failure or nullptr if there has been no failure.
+ */
+const char* HttpRequestParser::getError() const {
+	return m_error;
+} // getError
+
+
+/**
+ * @brief Get the HTTP status with which a request that failed to parse should be answered.
+ * @return The status (for example 400 or 431) or 0 if there has been no failure.
+ */
+int HttpRequestParser::getErrorStatus() const {
+	return m_errorStatus;
+} // getErrorStatus
+
+
+/**
+ * @brief Get the value of the named header.
+ * Header names are compared ignoring case and without making a copy of either name.  If the header
+ * appears more than once, the first occurrence is returned.
+ * @param [in] name The name of the header to find.
+ * @return The value of the header or an empty view if the header is not present.
+ */
+HttpStringView HttpRequestParser::getHeader(const char* name) const {
+	for (size_t i = 0; i < m_headerCount; i++) {
+		if (toView(m_headers[i].name).equalsIgnoreCase(name)) {
+			return toView(m_headers[i].value);
+		}
+	}
+	return HttpStringView();
+} // getHeader
+
+
+size_t HttpRequestParser::getHeaderCount() const {
+	return m_headerCount;
+} // getHeaderCount
+
+
+HttpStringView HttpRequestParser::getHeaderName(size_t index) const {
+	if (index >= m_headerCount) return HttpStringView();
+	return toView(m_headers[index].name);
+} // getHeaderName
+
+
+HttpStringView HttpRequestParser::getHeaderValue(size_t index) const {
+	if (index >= m_headerCount) return HttpStringView();
+	return toView(m_headers[index].value);
+} // getHeaderValue
+
+
+/**
+ * @brief Get the length of the head.
+ * @return The number of bytes of the head including the terminating blank line or 0 if the head is not yet complete.
+ */
+size_t HttpRequestParser::getHeadLength() const {
+	return m_headLength;
+} // getHeadLength
+
+
+HttpStringView HttpRequestParser::getMethod() const {
+	return toView(m_method);
+} // getMethod
+
+
+HttpStringView HttpRequestParser::getTarget() const {
+	return toView(m_target);
+} // getTarget
+
+
+HttpStringView HttpRequestParser::getVersion() const {
+	return toView(m_version);
+} // getVersion
+
+
+/**
+ * @brief Determine whether the request carries a body.
+ * Per RFC7230 section 3.3.3, a request without Content-Length or Transfer-Encoding has no body.
+ * @return True if there is a body.
+ */
+bool HttpRequestParser::hasBody() const {
+	return m_chunked || m_contentLength > 0;
+} // hasBody
+
+
+bool HttpRequestParser::isChunked() const {
+	return m_chunked;
+} // isChunked
+
+
+bool HttpRequestParser::isComplete() const {
+	return m_state == STATE_COMPLETE;
+} // isComplete
+
+
+bool HttpRequestParser::isError() const {
+	return m_state == STATE_ERROR;
+} // isError
+
+
+bool HttpRequestParser::isHeadComplete() const {
+	return m_headLength > 0;
+} // isHeadComplete
+
+
+/**
+ * @brief Work out how the body is framed once all the headers have been seen.
+ */
+void HttpRequestParser::onHeadComplete() {
+	HttpStringView transferEncoding = getHeader("Transfer-Encoding");
+	if (!transferEncoding.empty()) {
+		// The value is a comma separated list of codings (RFC7230 section 3.3.1).  We can only undo chunked,
+		// and it must be applied exactly once.
+		size_t chunkedCount = 0;
+		const char* pCoding = transferEncoding.data();
+		const char* pEnd    = transferEncoding.data() + transferEncoding.length();
+		while (pCoding < pEnd) {
+			const char* pComma = (const char*) ::memchr(pCoding, ',', pEnd - pCoding);
+			if (pComma == nullptr) pComma = pEnd;
+			const char* pStart = pCoding;
+			const char* pStop  = pComma;
+			while (pStart < pStop && isWhitespace(*pStart)) pStart++;
+			while (pStop > pStart && isWhitespace(pStop[-1])) pStop--;
+			if (pStop > pStart) {   // Empty list elements are allowed and ignored.
+				if (!HttpStringView(pStart, pStop - pStart).equalsIgnoreCase("chunked")) {
+					fail("Unsupported Transfer-Encoding", STATUS_NOT_IMPLEMENTED);
+					return;
+				}
+				chunkedCount++;
+			}
+			pCoding = pComma + 1;
+		}
+		if (chunkedCount != 1) {
+			fail("Invalid Transfer-Encoding", STATUS_BAD_REQUEST);
+			return;
+		}
+		m_chunked = true;
+		m_state   = STATE_CHUNK_START;
+		return;
+	}
+
+	HttpStringView contentLength = getHeader("Content-Length");
+	if (!contentLength.empty()) {
+		uint64_t value = 0;
+		for (size_t i = 0; i < contentLength.length(); i++) {
+			char c = contentLength.data()[i];
+			if (c < '0' || c > '9') {
+				fail("Invalid Content-Length", STATUS_BAD_REQUEST);
+				return;
+			}
+			value = value * 10 + (c - '0');
+			if (value > 0xffffffff) {
+				fail("Content-Length too large", STATUS_PAYLOAD_TOO_LARGE);
+				return;
+			}
+		}
+		m_contentLength = (uint32_t) value;
+		m_bodyRemaining = m_contentLength;
+	}
+	m_state = m_bodyRemaining > 0 ? STATE_BODY : STATE_COMPLETE;
+} // onHeadComplete
+
+
+/**
+ * @brief Decode body data.
+ * The input is examined and the body data it contains is handed back as a span of the input; nothing is copied.
+ * At most one span is returned per call so the caller should loop until all of its input has been consumed.
+ * Chunk framing and trailers are consumed without producing body data.
+ * @param [in] data The input data following the head.
+ * @param [in] length The length of the input data.
+ * @param [in] maxBody The maximum amount of body data to return.
+ * @param [out] ppBody Set to the start of the body data within the input.
+ * @param [out] pBodyLength Set to the length of the body data (may be 0).
+ * @return The number of bytes of input consumed.
+ */
+size_t HttpRequestParser::parseBody(const uint8_t* data, size_t length, size_t maxBody, const uint8_t** ppBody, size_t* pBodyLength) {
+	*ppBody      = data;
+	*pBodyLength = 0;
+	size_t pos = 0;
+	while (pos < length) {
+		char c = (char) data[pos];
+		switch (m_state) {
+			case STATE_BODY:
+			case STATE_CHUNK_DATA: {
+				size_t amount = length - pos;
+				if (amount > m_bodyRemaining) amount = m_bodyRemaining;
+				if (amount > maxBody) amount = maxBody;
+				*ppBody      = data + pos;
+				*pBodyLength = amount;
+				m_bodyRemaining -= amount;
+				pos += amount;
+				if (m_bodyRemaining == 0) {
+					m_state = (m_state == STATE_BODY) ? STATE_COMPLETE : STATE_CHUNK_END;
+				}
+				return pos;   // Hand back the span before looking at any more framing.
+			}
+
+			case STATE_CHUNK_START: {
+				// A chunk size needs at least one digit; an empty line would otherwise read as the last chunk.
+				int digit = hexValue(c);
+				if (digit < 0) {
+					fail("Invalid chunk size", STATUS_BAD_REQUEST);
+					return pos;
+				}
+				m_bodyRemaining = digit;
+				m_state = STATE_CHUNK_SIZE;
+				break;
+			}
+
+			case STATE_CHUNK_SIZE: {
+				int digit = hexValue(c);
+				if (digit >= 0) {
+					if (m_bodyRemaining > (MAX_CHUNK_SIZE >> 4)) {
+						fail("Chunk size too large", STATUS_PAYLOAD_TOO_LARGE);
+						return pos;
+					}
+					m_bodyRemaining = (m_bodyRemaining << 4) | digit;
+				} else if (c == '\n') {
+					m_state = m_bodyRemaining > 0 ? STATE_CHUNK_DATA : STATE_TRAILER;
+				} else if (c == ';' || c == '\r' || isWhitespace(c)) {
+					m_state = STATE_CHUNK_EXT;  // An extension, whitespace before one or the CR.
+				} else {
+					fail("Invalid chunk size", STATUS_BAD_REQUEST);
+					return pos;
+				}
+				break;
+			}
+
+			case STATE_CHUNK_EXT: {
+				if (c == '\n') {
+					m_state = m_bodyRemaining > 0 ? STATE_CHUNK_DATA : STATE_TRAILER;
+				}
+				break;
+			}
+
+			case STATE_CHUNK_END: {
+				if (c == '\n') {
+					m_state = STATE_CHUNK_START;
+				} else if (c != '\r') {
+					fail("Missing CRLF after chunk data", STATUS_BAD_REQUEST);
+					return pos;
+				}
+				break;
+			}
+
+			case STATE_TRAILER: {
+				if (c == '\n') {
+					m_state = STATE_COMPLETE;
+				} else if (c != '\r') {
+					m_state = STATE_TRAILER_LINE;
+				}
+				break;
+			}
+
+			case STATE_TRAILER_LINE: {
+				if (c == '\n') m_state = STATE_TRAILER;
+				break;
+			}
+
+			default:  // Complete, error or the head has not been parsed.
+				return pos;
+		} // switch
+		pos++;
+	} // while
+	return pos;
+} // parseBody
+
+
+/**
+ * @brief Parse a header field line.
+ * @param [in] start The offset of the start of the line.
+ * @param [in] end The offset of the end of the line (excluding the line terminator).
+ * @return True if the line was parsed.
+ */
+bool HttpRequestParser::parseHeaderLine(size_t start, size_t end) {
+	if (isWhitespace(m_pBuffer[start])) {
+		fail("Obsolete line folding is not supported", STATUS_BAD_REQUEST);
+		return false;
+	}
+	const char* pColon = (const char*) ::memchr(m_pBuffer + start, ':', end - start);
+	if (pColon == nullptr || pColon == m_pBuffer + start) {
+		fail("Malformed header", STATUS_BAD_REQUEST);
+		return false;
+	}
+	size_t colon = pColon - m_pBuffer;
+	if (isWhitespace(m_pBuffer[colon - 1])) {   // No whitespace is allowed between the name and the colon.
+		fail("Malformed header name", STATUS_BAD_REQUEST);
+		return false;
+	}
+	if (m_headerCount == MAX_HEADERS) {
+		fail("Too many headers", STATUS_HEADERS_TOO_LARGE);
+		return false;
+	}
+
+	size_t valueStart = colon + 1;
+	while (valueStart < end && isWhitespace(m_pBuffer[valueStart])) valueStart++;
+	size_t valueEnd = end;
+	while (valueEnd > valueStart && isWhitespace(m_pBuffer[valueEnd - 1])) valueEnd--;
+
+	Header& header = m_headers[m_headerCount++];
+	header.name.offset  = start;
+	header.name.length  = colon - start;
+	header.value.offset = valueStart;
+	header.value.length = valueEnd - valueStart;
+	return true;
+} // parseHeaderLine
+
+
+/**
+ * @brief Parse the head of the request.
+ * The buffer must start at the first byte of the request and hold all the data received so far.  If the head
+ * is not yet complete, receive more data, append it to the buffer and call again with the larger length.
+ * @param [in] buffer The buffer holding the head.
+ * @param [in] length The number of bytes in the buffer.
+ * @return The length of the head if it is complete, 0 if more data is needed or -1 on an error.
+ */
+int HttpRequestParser::parseHead(const char* buffer, size_t length) {
+	m_pBuffer = buffer;
+	if (m_state == STATE_ERROR) return -1;
+	if (m_headLength > 0) return m_headLength;
+
+	while (m_state == STATE_REQUEST_LINE || m_state == STATE_HEADERS) {
+		const char* pEnd = (const char*) ::memchr(buffer + m_scanned, '\n', length - m_scanned);
+		if (pEnd == nullptr) {
+			m_scanned = length;
+			if (length > MAX_HEAD_LENGTH) {
+				fail("Request head too large", STATUS_HEADERS_TOO_LARGE);
+				return -1;
+			}
+			return 0;   // Need more data.
+		}
+		size_t lineEnd = pEnd - buffer;
+		if (lineEnd >= MAX_HEAD_LENGTH) {
+			fail("Request head too large", STATUS_HEADERS_TOO_LARGE);
+			return -1;
+		}
+		size_t nextLine = lineEnd + 1;
+		if (lineEnd > m_lineStart && buffer[lineEnd - 1] == '\r') lineEnd--;
+
+		if (m_state == STATE_REQUEST_LINE) {
+			// Ignore empty lines ahead of the request line (RFC7230 section 3.5).
+			if (lineEnd > m_lineStart) {
+				if (!parseRequestLine(m_lineStart, lineEnd)) return -1;
+				m_state = STATE_HEADERS;
+			}
+		} else if (lineEnd == m_lineStart) {
+			m_headLength = nextLine;  // The blank line that ends the head.
+			onHeadComplete();
+		} else if (!parseHeaderLine(m_lineStart, lineEnd)) {
+			return -1;
+		}
+		m_lineStart = nextLine;
+		m_scanned   = nextLine;
+	} // while
+
+	if (m_state == STATE_ERROR) return -1;
+	return m_headLength;
+} // parseHead
+
+
+/**
+ * @brief Parse the request line.
+ * @param [in] start The offset of the start of the line.
+ * @param [in] end The offset of the end of the line (excluding the line terminator).
+ * @return True if the line was parsed.
+ */
+bool HttpRequestParser::parseRequestLine(size_t start, size_t end) {
+	const char* pLine = m_pBuffer + start;
+	size_t      lineLength = end - start;
+	const char* pSpace1 = (const char*) ::memchr(pLine, ' ', lineLength);
+	if (pSpace1 == nullptr || pSpace1 == pLine) {
+		fail("Malformed request line", STATUS_BAD_REQUEST);
+		return false;
+	}
+	const char* pTarget = pSpace1 + 1;
+	const char* pSpace2 = (const char*) ::memchr(pTarget, ' ', (pLine + lineLength) - pTarget);
+	if (pSpace2 == nullptr || pSpace2 == pTarget || pSpace2 + 1 == pLine + lineLength) {
+		fail("Malformed request line", STATUS_BAD_REQUEST);
+		return false;
+	}
+	m_method.offset  = start;
+	m_method.length  = pSpace1 - pLine;
+	m_target.offset  = pTarget - m_pBuffer;
+	m_target.length  = pSpace2 - pTarget;
+	m_version.offset = (pSpace2 + 1) - m_pBuffer;
+	m_version.length = end - m_version.offset;
+	if (!getVersion().equals("HTTP/1.1") && !getVersion().equals("HTTP/1.0")) {
+		fail("Unsupported HTTP version", STATUS_VERSION_NOT_SUPPORTED);
+		return false;
+	}
+	return true;
+} // parseRequestLine
+
+
+/**
+ * @brief Reset the parser ready to parse a new request.
+ */
+void HttpRequestParser::reset() {
+	m_state         = STATE_REQUEST_LINE;
+	m_pBuffer       = "";
+	m_error         = nullptr;
+	m_errorStatus   = 0;
+	m_lineStart     = 0;
+	m_scanned       = 0;
+	m_headLength    = 0;
+	m_method.offset = m_method.length = 0;
+	m_target.offset = m_target.length = 0;
+	m_version.offset = m_version.length = 0;
+	m_headerCount   = 0;
+	m_contentLength = 0;
+	m_bodyRemaining = 0;
+	m_chunked       = false;
+} // reset
+
+
+/**
+ * @brief Set the buffer that holds the head.
+ * Use this when the head has been moved or copied since it was parsed.  The views returned by the parser
+ * will then refer to the new buffer.
+ * @param [in] buffer The buffer holding the head.
+ */
+void HttpRequestParser::setBuffer(const char* buffer) {
+	m_pBuffer = buffer;
+} // setBuffer
+
+
+HttpStringView HttpRequestParser::toView(const Span& span) const {
+	return HttpStringView(m_pBuffer + span.offset, span.length);
+} // toView
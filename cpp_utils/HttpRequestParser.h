@@ -0,0 +1,118 @@
+/*
+ * HttpRequestParser.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_HTTPREQUESTPARSER_H_
+#define COMPONENTS_CPP_UTILS_HTTPREQUESTPARSER_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/**
+ * @brief A non-owning reference to a run of characters.
+ *
+ * The data is not copied and is only valid as long as the buffer it refers to is valid and unchanged.
+ */
+class HttpStringView {
+public:
+	HttpStringView();
+	HttpStringView(const char* data, size_t length);
+
+	const char* data() const;
+	bool        empty() const;
+	bool        equals(const char* str) const;
+	bool        equalsIgnoreCase(const char* str) const;
+	size_t      length() const;
+	std::string toString() const;
+
+private:
+	const char* m_data;
+	size_t      m_length;
+
+}; // HttpStringView
+
+
+/**
+ * @brief Resumable parser for an HTTP/1.1 request.
+ *
+ * The parser does not own or copy any data.  The request head (the request line and the headers) is parsed
+ * from a caller-provided buffer and the method, target, version and headers are made available as views into
+ * that buffer.  The parser remembers how far it has scanned so the caller can append more data to the buffer
+ * and call parseHead() again without the earlier lines being scanned a second time.  Positions are recorded
+ * as offsets from the start of the buffer so the caller is free to move the head (for example when compacting
+ * a receive buffer) as long as it then calls setBuffer().
+ *
+ * Once the head is complete, the body is decoded with parseBody() which hands back body data as spans of the
+ * input.  Both Content-Length and chunked transfer encoding are handled and no state beyond a few counters is
+ * kept, so memory use does not depend on the size of the body.
+ *
+ * @code{.cpp}
+ * HttpRequestParser parser;
+ * int rc = parser.parseHead(buffer, length);   // 0 => need more data, -1 => error, otherwise head length.
+ * HttpStringView host = parser.getHeader("Host");
+ * @endcode
+ */
+class HttpRequestParser {
+public:
+	static const size_t MAX_HEADERS = 32;     // Maximum number of headers we will record.
+
+	HttpRequestParser();
+
+	HttpStringView getHeader(const char* name) const;   // Get the value of a header (case insensitive name).
+	HttpStringView getHeaderName(size_t index) const;   // Get the name of the header at index.
+	size_t         getHeaderCount() const;              // Get the number of headers.
+	HttpStringView getHeaderValue(size_t index) const;  // Get the value of the header at index.
+	uint32_t       getContentLength() const;            // Get the Content-Length of the body (0 if none).
+	const char*    getError() const;                    // Get a description of the parse error.
+	int            getErrorStatus() const;              // Get the HTTP status to answer a request that failed to parse.
+	size_t         getHeadLength() const;               // Get the length of the head including the blank line.
+	HttpStringView getMethod() const;
+	HttpStringView getTarget() const;
+	HttpStringView getVersion() const;
+	bool           hasBody() const;                     // Does the request carry a body?
+	bool           isChunked() const;                   // Is the body sent with chunked transfer encoding?
+	bool           isComplete() const;                  // Have we parsed the whole request including the body?
+	bool           isError() const;                     // Has the parse failed?
+	bool           isHeadComplete() const;              // Have we parsed the whole head?
+	size_t         parseBody(const uint8_t* data, size_t length, size_t maxBody, const uint8_t** ppBody, size_t* pBodyLength);
+	int            parseHead(const char* buffer, size_t length);
+	void           reset();                             // Prepare to parse a new request.
+	void           setBuffer(const char* buffer);       // Set the buffer holding the head.
+
+private:
+	struct Span {
+		uint16_t offset;
+		uint16_t length;
+	};
+	struct Header {
+		Span name;
+		Span value;
+	};
+
+	uint8_t     m_state;
+	const char* m_pBuffer;        // The buffer holding the head.
+	const char* m_error;          // Description of the error if the parse failed.
+	int         m_errorStatus;    // HTTP status to answer the request with if the parse failed.
+	size_t      m_lineStart;      // Offset of the start of the line being parsed.
+	size_t      m_scanned;        // Offset up to which we have searched for the end of the current line.
+	size_t      m_headLength;     // Length of the head once complete.
+	Span        m_method;
+	Span        m_target;
+	Span        m_version;
+	Header      m_headers[MAX_HEADERS];
+	size_t      m_headerCount;
+	uint32_t    m_contentLength;  // Declared Content-Length.
+	uint32_t    m_bodyRemaining;  // Bytes of body (or of the current chunk) still to be delivered.
+	bool        m_chunked;
+
+	void           fail(const char* error, int status);
+	void           onHeadComplete();
+	bool           parseHeaderLine(size_t start, size_t end);
+	bool           parseRequestLine(size_t start, size_t end);
+	HttpStringView toView(const Span& span) const;
+
+}; // HttpRequestParser
+
+#endif /* COMPONENTS_CPP_UTILS_HTTPREQUESTPARSER_H_ */
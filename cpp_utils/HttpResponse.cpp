@@ -5,35 +5,244 @@
  *      Author: kolban
  */
 #include <sstream>
-#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "HttpRequest.h"
 #include "HttpResponse.h"
+#include "GeneralUtils.h"
 #include <esp_log.h>
 
 static const char* LOG_TAG = "HttpResponse";
 
+#undef close
+
 const int HttpResponse::HTTP_STATUS_CONTINUE              = 100;
 const int HttpResponse::HTTP_STATUS_SWITCHING_PROTOCOL    = 101;
 const int HttpResponse::HTTP_STATUS_OK                    = 200;
+const int HttpResponse::HTTP_STATUS_NO_CONTENT            = 204;
+const int HttpResponse::HTTP_STATUS_PARTIAL_CONTENT       = 206;
 const int HttpResponse::HTTP_STATUS_MOVED_PERMANENTLY     = 301;
+const int HttpResponse::HTTP_STATUS_NOT_MODIFIED          = 304;
 const int HttpResponse::HTTP_STATUS_BAD_REQUEST           = 400;
 const int HttpResponse::HTTP_STATUS_UNAUTHORIZED          = 401;
 const int HttpResponse::HTTP_STATUS_FORBIDDEN             = 403;
 const int HttpResponse::HTTP_STATUS_NOT_FOUND             = 404;
 const int HttpResponse::HTTP_STATUS_METHOD_NOT_ALLOWED    = 405;
+const int HttpResponse::HTTP_STATUS_RANGE_NOT_SATISFIABLE = 416;
 const int HttpResponse::HTTP_STATUS_INTERNAL_SERVER_ERROR = 500;
 const int HttpResponse::HTTP_STATUS_NOT_IMPLEMENTED       = 501;
 const int HttpResponse::HTTP_STATUS_SERVICE_UNAVAILABLE   = 503;
 
 static std::string lineTerminator = "\r\n";
+
+
+/**
+ * @brief The part of a file still to be read by sendFile.
+ */
+struct FileSource {
+	int    fd;
+	size_t remaining;
+};
+
+
+/**
+ * @brief Does an Accept-Encoding header allow gzip?
+ */
+static bool acceptsGzip(std::string acceptEncoding) {
+	GeneralUtils::toLower(acceptEncoding);
+	std::vector<std::string> codings = GeneralUtils::split(acceptEncoding, ',');
+	for (auto it = codings.begin(); it != codings.end(); ++it) {
+		std::vector<std::string> parts = GeneralUtils::split(*it, ';');
+		if (parts.empty()) continue;
+		std::string coding = GeneralUtils::trim(parts[0]);
+		if (coding != "gzip" && coding != "*") continue;
+		if (parts.size() > 1 && GeneralUtils::trim(parts[1]).find_first_not_of("q=0.") == std::string::npos) continue;   // q=0 refuses it.
+		return true;
+	}
+	return false;
+} // acceptsGzip
+
+
+/**
+ * @brief Does an If-None-Match header name the entity tag?
+ * Comparison is weak, as required for If-None-Match, so a W/ prefix is ignored.
+ */
+static bool etagMatches(const std::string& ifNoneMatch, const std::string& etag) {
+	std::vector<std::string> tags = GeneralUtils::split(ifNoneMatch, ',');
+	for (auto it = tags.begin(); it != tags.end(); ++it) {
+		std::string tag = GeneralUtils::trim(*it);
+		if (tag.compare(0, 2, "W/") == 0) tag = tag.substr(2);
+		if (tag == "*" || tag == etag) return true;
+	}
+	return false;
+} // etagMatches
+
+
+/**
+ * @brief Format a time as an HTTP date such as "Sun, 06 Nov 1994 08:49:37 GMT".
+ */
+static std::string httpDate(time_t time) {
+	struct tm tm;
+	char buf[32];
+	::gmtime_r(&time, &tm);
+	::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+	return buf;
+} // httpDate
+
+
+/**
+ * @brief Parse an HTTP date in any of the three forms a client may send:
+ * "Sun, 06 Nov 1994 08:49:37 GMT", "Sunday, 06-Nov-94 08:49:37 GMT" or "Sun Nov  6 08:49:37 1994".
+ * @param [in] date The date.
+ * @param [out] pTime The time it represents.
+ * @return False if the date is not in one of these forms.
+ */
+static bool parseHttpDate(const std::string& date, time_t* pTime) {
+	static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+	char month[4];
+	int day, year, hour, minute, second;
+	if (::sscanf(date.c_str(), "%*[A-Za-z], %d %3s %d %d:%d:%d GMT", &day, month, &year, &hour, &minute, &second) != 6 &&
+			::sscanf(date.c_str(), "%*[A-Za-z], %d-%3s-%d %d:%d:%d GMT", &day, month, &year, &hour, &minute, &second) != 6 &&
+			::sscanf(date.c_str(), "%*[A-Za-z] %3s %d %d:%d:%d %d", month, &day, &hour, &minute, &second, &year) != 6) {
+		return false;
+	}
+	const char* pMonth = ::strstr(months, month);
+	if (::strlen(month) != 3 || pMonth == nullptr || (pMonth - months) % 3 != 0) return false;
+	int mon = (pMonth - months) / 3 + 1;
+	if (year < 100) year += year < 70 ? 2000 : 1900;   // The two digit years of the RFC 850 form.
+	if (day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
+
+	// Days since 1970-01-01 of the civil date, without relying on timegm() which not every C library has.
+	int y = mon <= 2 ? year - 1 : year;
+	int era = (y >= 0 ? y : y - 399) / 400;
+	int yearOfEra = y - era * 400;
+	int dayOfYear = (153 * (mon > 2 ? mon - 3 : mon + 9) + 2) / 5 + day - 1;
+	int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	int64_t days = (int64_t) era * 146097 + dayOfEra - 719468;
+	*pTime = (time_t) (days * 86400 + hour * 3600 + minute * 60 + second);
+	return true;
+} // parseHttpDate
+
+
+/**
+ * @brief Get the content type of a file from its extension.
+ * @return The content type or nullptr if we don't recognize the extension.
+ */
+static const char* mimeType(const std::string& fileName) {
+	static const char* types[][2] = {
+		{ ".html", "text/html" },
+		{ ".htm",  "text/html" },
+		{ ".css",  "text/css" },
+		{ ".js",   "application/javascript" },
+		{ ".json", "application/json" },
+		{ ".txt",  "text/plain" },
+		{ ".xml",  "text/xml" },
+		{ ".svg",  "image/svg+xml" },
+		{ ".png",  "image/png" },
+		{ ".jpg",  "image/jpeg" },
+		{ ".jpeg", "image/jpeg" },
+		{ ".gif",  "image/gif" },
+		{ ".ico",  "image/x-icon" },
+		{ ".wasm", "application/wasm" }
+	};
+	size_t dot = fileName.rfind('.');
+	if (dot == std::string::npos) return nullptr;
+	std::string extension = fileName.substr(dot);
+	GeneralUtils::toLower(extension);
+	for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+		if (extension == types[i][0]) return types[i][1];
+	}
+	return nullptr;
+} // mimeType
+
+
+/**
+ * @brief Parse an unsigned decimal number that must consist of nothing but digits.
+ */
+static bool parseDecimal(const std::string& text, size_t& value) {
+	if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) return false;
+	value = ::strtoul(text.c_str(), nullptr, 10);
+	return true;
+} // parseDecimal
+
+
+/**
+ * @brief Parse a Range header.
+ * Only a single range of bytes is supported.  Anything else is ignored and the whole file is sent.
+ * @param [in] rangeHeader The value of the Range header.
+ * @param [in] size The size of the file.
+ * @param [out] first The offset of the first byte of the range.
+ * @param [out] last The offset of the last byte of the range.
+ * @return 1 for a range to send, 0 if there is no range we can use or -1 if the range lies beyond the file.
+ */
+static int parseRange(const std::string& rangeHeader, size_t size, size_t& first, size_t& last) {
+	if (rangeHeader.compare(0, 6, "bytes=") != 0) return 0;
+	std::string spec = rangeHeader.substr(6);
+	size_t dash = spec.find('-');
+	if (dash == std::string::npos || spec.find(',') != std::string::npos) return 0;
+	std::string firstText = GeneralUtils::trim(spec.substr(0, dash));
+	std::string lastText  = GeneralUtils::trim(spec.substr(dash + 1));
+
+	if (firstText.empty()) {   // bytes=-n is the last n bytes.
+		size_t suffix;
+		if (!parseDecimal(lastText, suffix)) return 0;
+		if (suffix == 0 || size == 0) return -1;
+		first = suffix < size ? size - suffix : 0;
+		last  = size - 1;
+		return 1;
+	}
+	if (!parseDecimal(firstText, first)) return 0;
+	if (first >= size) return -1;
+	last = size - 1;
+	if (!lastText.empty()) {
+		size_t requested;
+		if (!parseDecimal(lastText, requested) || requested < first) return 0;
+		if (requested < last) last = requested;
+	}
+	return 1;
+} // parseRange
+
+
+/**
+ * @brief Fill a buffer from a file for sendFile.  Called on the reading thread of the DoubleBuffer.
+ */
+static int readFile(uint8_t* pBuffer, size_t length, void* pContext) {
+	FileSource* pSource = (FileSource*) pContext;
+	if (pSource->remaining == 0) return 0;
+	if (length > pSource->remaining) length = pSource->remaining;
+	int rc = ::read(pSource->fd, pBuffer, length);
+	if (rc <= 0) return -1;   // The file is shorter than it was when we sent the Content-Length.
+	pSource->remaining -= rc;
+	return rc;
+} // readFile
+
+
+/**
+ * @brief Send a buffer of a file to the client for sendFile.
+ */
+static bool sendSocket(const uint8_t* pData, size_t length, void* pContext) {
+	return ((Socket*) pContext)->send(pData, length) >= 0;
+} // sendSocket
+
 HttpResponse::HttpResponse(HttpRequest* request) {
 	m_request = request;
 	m_status  = 200;
 	m_headerCommitted = false; // We have not yet sent a header.
+	m_isClosed        = false; // We have not yet completed the response.
+	m_isChunked       = false; // The body is not chunked unless beginChunked() is called.
+	m_pStreamBuf      = nullptr;
+	m_pStream         = nullptr;
 }
 
 
 HttpResponse::~HttpResponse() {
+	delete m_pStream;
+	delete m_pStreamBuf;
 }
 
 
@@ -49,17 +258,62 @@ void HttpResponse::addHeader(const std::string name, const std::string value) {
 } // addHeader
 
 
+/**
+ * @brief Start a body whose length isn't known in advance.
+ * The header is sent with Transfer-Encoding: chunked and the body is then sent a piece at a time with
+ * writeChunk() or through getStream() until end() is called.  The client can tell where the body ends
+ * so the connection can still be kept open.  An HTTP/1.0 client doesn't understand chunks so it is sent
+ * the plain data and the end of the body is marked by closing the connection.
+ *
+ * @code{.cpp}
+ * pResponse->beginChunked();
+ * for (auto it = entries.begin(); it != entries.end(); ++it) {
+ *   if (!pResponse->writeChunk(it->data(), it->size())) break;   // The client has gone.
+ * }
+ * pResponse->end();
+ * @endcode
+ */
+void HttpResponse::beginChunked() {
+	if (m_headerCommitted) {
+		ESP_LOGE(LOG_TAG, "beginChunked: The header has already been sent");
+		return;
+	}
+	if (m_request->getVersion() != "HTTP/1.0") {
+		m_responseHeaders.erase(HttpRequest::HTTP_HEADER_CONTENT_LENGTH);
+		addHeader(HttpRequest::HTTP_HEADER_TRANSFER_ENCODING, "chunked");
+		m_isChunked = true;
+	}
+	sendHeader();
+} // beginChunked
+
+
 /**
  * @brief Close the response.
- * We close the response.  If we haven't yet sent the header, we send that now and then close
- * the socket.
+ * We close the response.  If we haven't yet sent the header, we send that now (with an empty body).  If the
+ * body is chunked, the last (empty) chunk is sent to mark its end.  If the connection is persistent it is left
+ * open for the next request, otherwise the socket is closed.
  */
 void HttpResponse::close() {
+	if (m_isClosed) return;
+	if (m_pStream != nullptr) {
+		m_pStream->flush();
+	}
+	if (m_isChunked && !m_request->isClosed()) {
+		if (m_request->getSocket().send("0\r\n\r\n") < 0) {
+			m_request->setKeepAlive(false);
+		}
+	}
 	// If we haven't yet sent the header of the data, send that now.
 	if (!m_headerCommitted) {
+		if (getHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH).empty() && m_status != HTTP_STATUS_NO_CONTENT && m_status != HTTP_STATUS_NOT_MODIFIED) {
+			addHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH, "0");
+		}
 		sendHeader();
 	}
-	m_request->close();
+	m_isClosed = true;
+	if (!m_request->isKeepAlive()) {
+		m_request->close();
+	}
 } // close
 
 
@@ -74,11 +328,46 @@ std::string HttpResponse::getHeader(std::string name) {
 } // getHeader
 
 
+/**
+ * @brief Finish a streamed response.
+ * Anything still buffered in the stream is sent followed by the last chunk.
+ */
+void HttpResponse::end() {
+	close();
+} // end
+
+
 std::map<std::string, std::string> HttpResponse::getHeaders() {
 	return m_responseHeaders;
 } // getHeaders
 
 
+/**
+ * @brief Get a stream that writes the body of the response.
+ * The first use begins a chunked body (see beginChunked()).  What is written is collected in a small
+ * fixed buffer and sent as a chunk each time the buffer fills or the stream is flushed, so a body of any
+ * size can be generated with formatted output without holding it in memory.
+ *
+ * @code{.cpp}
+ * std::ostream& out = pResponse->getStream();
+ * out << "[";
+ * for (size_t i = 0; i < count; i++) out << (i ? "," : "") << readings[i];
+ * out << "]";
+ * pResponse->end();
+ * @endcode
+ *
+ * @return The stream.
+ */
+std::ostream& HttpResponse::getStream() {
+	if (m_pStream == nullptr) {
+		if (!m_headerCommitted) beginChunked();
+		m_pStreamBuf = new HttpResponseStreamBuf(this);
+		m_pStream    = new std::ostream(m_pStreamBuf);
+	}
+	return *m_pStream;
+} // getStream
+
+
 /**
  * @brief Send data to the partner.
  * Send some data to the partner.  If we haven't yet sent the HTTP header then send that now.  We can call this function
@@ -88,7 +377,7 @@ std::map<std::string, std::string> HttpResponse::getHeaders() {
 void HttpResponse::sendData(std::string data) {
 	ESP_LOGD(LOG_TAG, ">> sendData");
 	// If the request is already closed, nothing further to do.
-	if (m_request->isClosed()) {
+	if (m_request->isClosed() || m_isClosed) {
 		ESP_LOGE(LOG_TAG, "<< sendData: Request to send more data but the request/response is already closed");
 		return;
 	}
@@ -99,14 +388,18 @@ void HttpResponse::sendData(std::string data) {
 	}
 
 	// Send the payload data.
-	m_request->getSocket().send(data);
+	if (m_isChunked) {
+		writeChunk((const uint8_t*) data.data(), data.length());
+	} else {
+		m_request->getSocket().send(data);
+	}
 	ESP_LOGD(LOG_TAG, "<< sendData");
 } // sendData
 
 void HttpResponse::sendData(uint8_t* pData, size_t size) {
 	ESP_LOGD(LOG_TAG, ">> sendData: 0x%x, size: %d", (uint32_t) pData, size);
 	// If the request is already closed, nothing further to do.
-	if (m_request->isClosed()) {
+	if (m_request->isClosed() || m_isClosed) {
 		ESP_LOGE(LOG_TAG, "<< sendData: Request to send more data but the request/response is already closed");
 		return;
 	}
@@ -117,37 +410,163 @@ void HttpResponse::sendData(uint8_t* pData, size_t size) {
 	}
 
 	// Send the payload data.
-	m_request->getSocket().send(pData, size);
+	if (m_isChunked) {
+		writeChunk(pData, size);
+	} else {
+		m_request->getSocket().send(pData, size);
+	}
 	ESP_LOGD(LOG_TAG, "<< sendData");
 } // sendData
 
+/**
+ * @brief Send the content of a file as the response.
+ * @param [in] fileName The name of the file to send.
+ * @param [in] bufSize The size of each of the buffers used to move the file to the client.
+ */
 void HttpResponse::sendFile(std::string fileName, size_t bufSize) {
+	DoubleBuffer buffer(bufSize);
+	sendFile(fileName, buffer);
+} // sendFile
+
+
+/**
+ * @brief Send the content of a file as the response.
+ *
+ * The response carries an ETag and Last-Modified built from the size and modification time of the file
+ * so that a client revalidating its cached copy with If-None-Match or If-Modified-Since is answered with
+ * a 304 and no body.  If the client accepts gzip and a precompressed fileName.gz exists, that is sent
+ * instead with a Content-Encoding of gzip.  A single byte range (Range: bytes=first-last) is answered
+ * with a 206 and only those bytes.
+ *
+ * The file is read into one half of the buffer while the other half is being sent so that the flash
+ * and the network are kept busy at the same time.
+ *
+ * @param [in] fileName The name of the file to send.
+ * @param [in] buffer The buffers used to move the file to the client.  These can be reused for many files.
+ */
+void HttpResponse::sendFile(std::string fileName, DoubleBuffer& buffer) {
 	ESP_LOGI(LOG_TAG, "Opening file: %s", fileName.c_str());
-	std::ifstream ifStream;
-	ifStream.open(fileName, std::ifstream::in | std::ifstream::binary);      // Attempt to open the file for reading.
+	std::string sendName = fileName;
+	bool gzipped = false;
+	struct stat fileStat;
+	if (acceptsGzip(m_request->getHeader(HttpRequest::HTTP_HEADER_ACCEPT_ENCODING)) &&
+			::stat((fileName + ".gz").c_str(), &fileStat) == 0 && S_ISREG(fileStat.st_mode)) {
+		sendName = fileName + ".gz";
+		gzipped  = true;
+	} else if (::stat(fileName.c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+		fileStat.st_size = -1;
+	}
+	int fd = fileStat.st_size < 0 ? -1 : ::open(sendName.c_str(), O_RDONLY);
 
 	// If we failed to open the requested file, then it probably didn't exist so return a not found.
-	if (!ifStream.is_open()) {
+	if (fd < 0) {
 		ESP_LOGE(LOG_TAG, "Unable to open file %s for reading", fileName.c_str());
 		setStatus(HttpResponse::HTTP_STATUS_NOT_FOUND, "Not Found");
 		addHeader(HttpRequest::HTTP_HEADER_CONTENT_TYPE, "text/plain");
+		addHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH, "9");
 		sendData("Not Found");
 		close();
 		return; // Since we failed to open the file, no further work to be done.
 	}
 
-	// We now have an open file and want to push the content of that file through to the browser.
-	// because of defect #252 we have to do some pretty important re-work here.  Specifically, we can't host the whole file in
-	// RAM at one time.  Instead what we have to do is ensure that we only have enough data in RAM to be sent.
+	size_t fileSize = fileStat.st_size;
+	std::string method = m_request->getMethod();
+	bool isHead = method == HttpRequest::HTTP_METHOD_HEAD;
+
+	// Validators.  A file system that doesn't record modification times (st_mtime of 0) would leave us with
+	// only the size, which doesn't change when the content does, so we offer no validators at all.
+	std::string etag;
+	std::string lastModified;
+	if (fileStat.st_mtime != 0) {
+		std::ostringstream oss;
+		oss << '"' << std::hex << (uint32_t) fileStat.st_mtime << '-' << fileSize << (gzipped ? "-gz" : "") << '"';
+		etag         = oss.str();
+		lastModified = httpDate(fileStat.st_mtime);
+		addHeader(HttpRequest::HTTP_HEADER_ETAG, etag);
+		addHeader(HttpRequest::HTTP_HEADER_LAST_MODIFIED, lastModified);
+	}
+	if (gzipped) {
+		addHeader(HttpRequest::HTTP_HEADER_CONTENT_ENCODING, "gzip");
+		addHeader(HttpRequest::HTTP_HEADER_VARY, HttpRequest::HTTP_HEADER_ACCEPT_ENCODING);
+	}
+	if (getHeader(HttpRequest::HTTP_HEADER_CONTENT_TYPE).empty()) {
+		const char* contentType = mimeType(fileName);   // The type of the original, not of the .gz.
+		if (contentType != nullptr) addHeader(HttpRequest::HTTP_HEADER_CONTENT_TYPE, contentType);
+	}
 
-	setStatus(HttpResponse::HTTP_STATUS_OK, "OK");
-	uint8_t *pData = new uint8_t[bufSize];
-	while (!ifStream.eof()) {
-		ifStream.read((char*) pData, bufSize);
-		sendData(pData, ifStream.gcount());
+	// Does the client already have this version?  If-None-Match takes precedence over If-Modified-Since.
+	if (!etag.empty() && (isHead || method == HttpRequest::HTTP_METHOD_GET)) {
+		std::string ifNoneMatch = m_request->getHeader(HttpRequest::HTTP_HEADER_IF_NONE_MATCH);
+		bool notModified;
+		if (ifNoneMatch.empty()) {        // Not modified if the file is no newer than the date the client has.
+			time_t since;
+			notModified = parseHttpDate(m_request->getHeader(HttpRequest::HTTP_HEADER_IF_MODIFIED_SINCE), &since) &&
+				fileStat.st_mtime <= since;
+		} else {
+			notModified = etagMatches(ifNoneMatch, etag);
+		}
+		if (notModified) {
+			::close(fd);
+			setStatus(HttpResponse::HTTP_STATUS_NOT_MODIFIED, "Not Modified");
+			close();
+			return;
+		}
+	}
+
+	// Is a part of the file wanted?  A range is ignored if If-Range names a different version of the file.
+	size_t first = 0;
+	size_t last  = fileSize - 1;
+	int range = 0;
+	if (method == HttpRequest::HTTP_METHOD_GET) {
+		std::string ifRange = m_request->getHeader(HttpRequest::HTTP_HEADER_IF_RANGE);
+		if (ifRange.empty() || (!etag.empty() && (ifRange == etag || ifRange == lastModified))) {
+			range = parseRange(m_request->getHeader(HttpRequest::HTTP_HEADER_RANGE), fileSize, first, last);
+		}
+	}
+	addHeader(HttpRequest::HTTP_HEADER_ACCEPT_RANGES, "bytes");
+	std::ostringstream contentRange;
+	if (range < 0) {
+		::close(fd);
+		contentRange << "bytes */" << fileSize;
+		setStatus(HttpResponse::HTTP_STATUS_RANGE_NOT_SATISFIABLE, "Range Not Satisfiable");
+		addHeader(HttpRequest::HTTP_HEADER_CONTENT_RANGE, contentRange.str());
+		close();
+		return;
 	}
-	delete[] pData;
-	ifStream.close();
+	if (range > 0) {
+		contentRange << "bytes " << first << '-' << last << '/' << fileSize;
+		setStatus(HttpResponse::HTTP_STATUS_PARTIAL_CONTENT, "Partial Content");
+		addHeader(HttpRequest::HTTP_HEADER_CONTENT_RANGE, contentRange.str());
+	} else {
+		setStatus(HttpResponse::HTTP_STATUS_OK, "OK");
+	}
+	size_t length = fileSize == 0 ? 0 : last - first + 1;
+	std::ostringstream contentLength;   // Tell the client how much is coming so the connection can be kept open.
+	contentLength << length;
+	addHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH, contentLength.str());
+
+	if (m_request->isClosed() || m_isClosed) {
+		ESP_LOGE(LOG_TAG, "sendFile: Request to send a file but the request/response is already closed");
+		::close(fd);
+		return;
+	}
+	sendHeader();
+
+	// We can't hold the whole file in RAM (defect #252) so we move it through the buffers a piece at a time.
+	if (!isHead && length > 0) {
+		FileSource source;
+		source.fd        = fd;
+		source.remaining = length;
+		Socket socket = m_request->getSocket();
+		if ((first > 0 && ::lseek(fd, first, SEEK_SET) < 0) ||
+				buffer.transfer(readFile, &source, sendSocket, &socket, length) != (int64_t) length) {
+			// We have promised a length that we can no longer deliver.  Closing the connection is the only
+			// way left to tell the client that the body is incomplete.
+			ESP_LOGE(LOG_TAG, "sendFile: Failed sending %s", sendName.c_str());
+			m_request->setKeepAlive(false);
+		}
+	}
+	::close(fd);
 	close();
 } // sendFile
 
@@ -157,6 +576,21 @@ void HttpResponse::sendFile(std::string fileName, size_t bufSize) {
 void HttpResponse::sendHeader() {
 	// If we haven't yet sent the header of the data, send that now.
 	if (!m_headerCommitted) {
+		// The connection can only be kept open if the client can tell where the body ends.  If it can't, the end
+		// of the body is marked by closing the connection.
+		std::string connection = getHeader(HttpRequest::HTTP_HEADER_CONNECTION);
+		bool delimited = m_status == HTTP_STATUS_SWITCHING_PROTOCOL || m_status == HTTP_STATUS_NO_CONTENT || m_status == HTTP_STATUS_NOT_MODIFIED ||
+			!getHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH).empty() || m_isChunked;
+		if (!delimited || connection == "close") {
+			m_request->setKeepAlive(false);
+		}
+		if (connection.empty()) {
+			if (!m_request->isKeepAlive()) {
+				addHeader(HttpRequest::HTTP_HEADER_CONNECTION, "close");
+			} else if (m_request->getVersion() == "HTTP/1.0") {
+				addHeader(HttpRequest::HTTP_HEADER_CONNECTION, "keep-alive");
+			}
+		}
 		std::ostringstream oss;
 		oss << m_request->getVersion() << " " << m_status << " " << m_statusMessage << lineTerminator;
 		for (auto it = m_responseHeaders.begin(); it != m_responseHeaders.end(); ++it) {
@@ -169,6 +603,52 @@ void HttpResponse::sendHeader() {
 } // sendHeader
 
 
+/**
+ * @brief Send a chunk of a streamed body.
+ * If the body hasn't been started it is started as a chunked body.  An empty chunk is ignored since it
+ * would mark the end of the body; use end() for that.
+ * @param [in] pData The data to send.
+ * @param [in] length The length of the data.
+ * @return False if the response is closed or the client can no longer be written to.
+ */
+bool HttpResponse::writeChunk(const uint8_t* pData, size_t length) {
+	if (m_request->isClosed() || m_isClosed) {
+		ESP_LOGE(LOG_TAG, "writeChunk: Request to send more data but the request/response is already closed");
+		return false;
+	}
+	if (!m_headerCommitted) {
+		beginChunked();
+	}
+	if (length == 0) return true;
+
+	Socket socket = m_request->getSocket();
+	int rc;
+	if (!m_isChunked) {   // HTTP/1.0 client; send the data as it is.
+		rc = socket.send(pData, length);
+	} else {
+		// The chunk is framed as <length in hex>\r\n<data>\r\n.  Small chunks are framed in one buffer so they
+		// leave in a single send.
+		char frame[HttpResponseStreamBuf::BUFFER_SIZE + 16];
+		int prefix = ::sprintf(frame, "%x\r\n", (unsigned int) length);
+		if (prefix + length + 2 <= sizeof(frame)) {
+			::memcpy(frame + prefix, pData, length);
+			::memcpy(frame + prefix + length, "\r\n", 2);
+			rc = socket.send((const uint8_t*) frame, prefix + length + 2);
+		} else {
+			rc = socket.send((const uint8_t*) frame, prefix);
+			if (rc >= 0) rc = socket.send(pData, length);
+			if (rc >= 0) rc = socket.send((const uint8_t*) "\r\n", 2);
+		}
+	}
+	if (rc < 0) {
+		ESP_LOGE(LOG_TAG, "writeChunk: Failed sending to the client");
+		m_request->setKeepAlive(false);   // The body is incomplete so the connection can't be reused.
+		return false;
+	}
+	return true;
+} // writeChunk
+
+
 /**
  * @brief Set the status code that is to be sent back to the client.
  * When a client makes a request, the response contains a status.  This call sets the status that
@@ -184,3 +664,39 @@ void HttpResponse::setStatus(const int status, const std::string message) {
 	m_status        = status;
 	m_statusMessage = message;
 } // setStatus
+
+
+HttpResponseStreamBuf::HttpResponseStreamBuf(HttpResponse* pResponse) {
+	m_pResponse = pResponse;
+	setp(m_buffer, m_buffer + BUFFER_SIZE);
+} // HttpResponseStreamBuf
+
+
+/**
+ * @brief Send what has been buffered as a chunk.
+ * @return False if the chunk couldn't be sent.
+ */
+bool HttpResponseStreamBuf::flushBuffer() {
+	size_t length = pptr() - pbase();
+	setp(m_buffer, m_buffer + BUFFER_SIZE);
+	if (length == 0) return true;
+	return m_pResponse->writeChunk((const uint8_t*) m_buffer, length);
+} // flushBuffer
+
+
+/**
+ * @brief The buffer is full; send it and make room for the character.
+ */
+HttpResponseStreamBuf::int_type HttpResponseStreamBuf::overflow(int_type c) {
+	if (!flushBuffer()) return traits_type::eof();
+	if (!traits_type::eq_int_type(c, traits_type::eof())) {
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+	}
+	return traits_type::not_eof(c);
+} // overflow
+
+
+int HttpResponseStreamBuf::sync() {
+	return flushBuffer() ? 0 : -1;
+} // sync
@@ -11,19 +11,51 @@
 #define COMPONENTS_CPP_UTILS_HTTPRESPONSE_H_
 #include <string>
 #include <map>
+#include <ostream>
+#include <streambuf>
 #include "HttpRequest.h"
+#include "DoubleBuffer.h"
+
+class HttpResponse;
+
+/**
+ * @brief A stream buffer that writes what is streamed to it as chunks of a response.
+ * Data is collected in a small fixed buffer and written as a chunk each time the buffer fills or the
+ * stream is flushed.
+ */
+class HttpResponseStreamBuf: public std::streambuf {
+public:
+	static const size_t BUFFER_SIZE = 512;
+
+	HttpResponseStreamBuf(HttpResponse* pResponse);
+
+protected:
+	int_type overflow(int_type c) override;
+	int      sync() override;
+
+private:
+	HttpResponse* m_pResponse;
+	char          m_buffer[BUFFER_SIZE];
+	bool          flushBuffer();
+
+}; // HttpResponseStreamBuf
+
 
 class HttpResponse {
 public:
 	static const int HTTP_STATUS_CONTINUE;
 	static const int HTTP_STATUS_SWITCHING_PROTOCOL;
 	static const int HTTP_STATUS_OK;
+	static const int HTTP_STATUS_NO_CONTENT;
+	static const int HTTP_STATUS_PARTIAL_CONTENT;
 	static const int HTTP_STATUS_MOVED_PERMANENTLY;
+	static const int HTTP_STATUS_NOT_MODIFIED;
 	static const int HTTP_STATUS_BAD_REQUEST;
 	static const int HTTP_STATUS_UNAUTHORIZED;
 	static const int HTTP_STATUS_FORBIDDEN;
 	static const int HTTP_STATUS_NOT_FOUND;
 	static const int HTTP_STATUS_METHOD_NOT_ALLOWED;
+	static const int HTTP_STATUS_RANGE_NOT_SATISFIABLE;
 	static const int HTTP_STATUS_INTERNAL_SERVER_ERROR;
 	static const int HTTP_STATUS_NOT_IMPLEMENTED;
 	static const int HTTP_STATUS_SERVICE_UNAVAILABLE;
@@ -32,16 +64,25 @@ public:
 	virtual ~HttpResponse();
 
 	void                               addHeader(std::string name, std::string value);  // Add a header to be sent to the client.
+	void                               beginChunked();                                  // Start a body of unknown length.
 	void                               close();                                         // Close the request/response.
+	void                               end();                                           // Finish a streamed response.
 	std::string                        getHeader(std::string name);                     // Get a named header.
 	std::map<std::string, std::string> getHeaders();                                    // Get all headers.
+	std::ostream&                      getStream();                                     // Get a stream that writes chunks of the body.
 	void                               sendData(std::string data);                      // Send data to the client.
 	void                               sendData(uint8_t* pData, size_t size);           // Send data to the client.
 	void                               setStatus(int status, std::string message);      // Set the response status.
 	void 							   sendFile(std::string fileName, size_t bufSize = 4 * 1024);	// Send file contents if exists.
+	void                               sendFile(std::string fileName, DoubleBuffer& buffer);      // Send file contents through reusable buffers.
+	bool                               writeChunk(const uint8_t* pData, size_t length); // Send a chunk of a streamed body.
 
 private:
 	bool							   m_headerCommitted;  // Has the header been sent?
+	bool							   m_isClosed;         // Has the response been completed?
+	bool                               m_isChunked;        // Is the body being sent with chunked transfer encoding?
+	HttpResponseStreamBuf*             m_pStreamBuf;       // Buffer behind the stream returned by getStream().
+	std::ostream*                      m_pStream;          // Stream returned by getStream().
 	HttpRequest*					   m_request;		  // The request associated with this response.
 	std::map<std::string, std::string> m_responseHeaders;  // The headers to be sent with the response.
 	int								m_status;		   // The status to be sent with the response.
@@ -0,0 +1,224 @@
+/*
+ * HttpRouter.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include <cstring>
+#include "HttpRouter.h"
+
+#include <esp_log.h>
+
+static const char* LOG_TAG = "HttpRouter";
+
+
+HttpRouteParams::HttpRouteParams() {
+	m_count = 0;
+} // HttpRouteParams
+
+
+/**
+ * @brief Add a parameter.
+ * @param [in] name The name of the parameter.  This must remain valid while the parameters are in use.
+ * @param [in] value The value of the parameter.
+ * @return False if the table of parameters is full.
+ */
+bool HttpRouteParams::add(const char* name, HttpStringView value) {
+	if (m_count == MAX_PARAMS) return false;
+	m_names[m_count]  = name;
+	m_values[m_count] = value;
+	m_count++;
+	return true;
+} // add
+
+
+void HttpRouteParams::clear() {
+	m_count = 0;
+} // clear
+
+
+/**
+ * @brief Get the value of the named parameter.
+ * @param [in] name The name of the parameter as written in the route between the braces.
+ * @return The value of the parameter or an empty view if there is no such parameter.
+ */
+HttpStringView HttpRouteParams::get(const char* name) const {
+	for (size_t i = 0; i < m_count; i++) {
+		if (::strcmp(m_names[i], name) == 0) return m_values[i];
+	}
+	return HttpStringView();
+} // get
+
+
+size_t HttpRouteParams::getCount() const {
+	return m_count;
+} // getCount
+
+
+const char* HttpRouteParams::getName(size_t index) const {
+	if (index >= m_count) return "";
+	return m_names[index];
+} // getName
+
+
+HttpStringView HttpRouteParams::getValue(size_t index) const {
+	if (index >= m_count) return HttpStringView();
+	return m_values[index];
+} // getValue
+
+
+void HttpRouteParams::truncate(size_t count) {
+	if (count < m_count) m_count = count;
+} // truncate
+
+
+HttpRouter::Node::Node() {
+	pParam = nullptr;
+} // Node
+
+
+HttpRouter::Node::~Node() {
+	for (auto it = children.begin(); it != children.end(); ++it) {
+		delete *it;
+	}
+	delete pParam;
+} // ~Node
+
+
+HttpRouter::HttpRouter() {
+} // HttpRouter
+
+
+HttpRouter::~HttpRouter() {
+} // ~HttpRouter
+
+
+/**
+ * @brief Add a route to the table.
+ * The pattern is a path starting with '/' in which any segment may be a parameter written as {name}.
+ * Registering the same method and pattern again replaces the handler.
+ *
+ * @code{.cpp}
+ * router.addRoute("GET", "/api/sensor/{id}", handleSensor);
+ * @endcode
+ *
+ * @param [in] method The method being used for access ("GET", "POST" etc).
+ * @param [in] pattern The path pattern to be matched.
+ * @param [in] handler The callback function to be invoked when a request matches.
+ */
+void HttpRouter::addRoute(const std::string& method, const std::string& pattern, Handler handler) {
+	ESP_LOGD(LOG_TAG, ">> addRoute: %s %s", method.c_str(), pattern.c_str());
+	if (pattern.empty() || pattern[0] != '/') {
+		ESP_LOGE(LOG_TAG, "<< addRoute: Pattern must start with '/': %s", pattern.c_str());
+		return;
+	}
+
+	Node* pNode = &m_root;
+	size_t pos = 0;
+	while (pos < pattern.length()) {    // pos is at a '/'
+		size_t segEnd = pattern.find('/', pos + 1);
+		if (segEnd == std::string::npos) segEnd = pattern.length();
+		std::string segment = pattern.substr(pos + 1, segEnd - pos - 1);
+
+		if (segment.length() > 2 && segment.front() == '{' && segment.back() == '}') {
+			std::string name = segment.substr(1, segment.length() - 2);
+			if (pNode->pParam == nullptr) {
+				pNode->pParam = new Node();
+				pNode->pParam->segment = name;
+			} else if (pNode->pParam->segment != name) {
+				ESP_LOGW(LOG_TAG, "addRoute: Parameter {%s} in %s is already named {%s} by another route",
+					name.c_str(), pattern.c_str(), pNode->pParam->segment.c_str());
+			}
+			pNode = pNode->pParam;
+		} else {
+			Node* pChild = nullptr;
+			for (auto it = pNode->children.begin(); it != pNode->children.end(); ++it) {
+				if ((*it)->segment == segment) {
+					pChild = *it;
+					break;
+				}
+			}
+			if (pChild == nullptr) {
+				pChild = new Node();
+				pChild->segment = segment;
+				pNode->children.push_back(pChild);
+			}
+			pNode = pChild;
+		}
+		pos = segEnd;
+	} // while
+
+	for (auto it = pNode->routes.begin(); it != pNode->routes.end(); ++it) {
+		if (it->method == method) {
+			it->handler = handler;
+			return;
+		}
+	}
+	Route route;
+	route.method  = method;
+	route.handler = handler;
+	pNode->routes.push_back(route);
+	ESP_LOGD(LOG_TAG, "<< addRoute");
+} // addRoute
+
+
+/**
+ * @brief Find the handler for a request.
+ * Any query string in the path is ignored.  The values of parameters in the matching route are recorded
+ * in params as views of the path, so the path must remain valid while they are in use.
+ * @param [in] method The method of the request.
+ * @param [in] path The path of the request.
+ * @param [out] params The parameters extracted from the path.
+ * @return The handler or nullptr if no route matches.
+ */
+HttpRouter::Handler HttpRouter::find(const std::string& method, HttpStringView path, HttpRouteParams& params) {
+	params.clear();
+	const char* pEnd = (const char*) ::memchr(path.data(), '?', path.length());
+	if (pEnd == nullptr) pEnd = path.data() + path.length();
+	if (path.empty() || path.data()[0] != '/') return nullptr;
+	return match(&m_root, method, path.data(), pEnd, params);
+} // find
+
+
+/**
+ * @brief Match the remainder of a path against a node of the tree.
+ * Literal children are tried before the parameter child.  If a branch fails further down we back up
+ * and try the next possibility.
+ * @param [in] pNode The node matched so far.
+ * @param [in] method The method of the request.
+ * @param [in] pPath The remainder of the path; either at a '/' or at the end.
+ * @param [in] pEnd The end of the path.
+ * @param [out] params The parameters extracted from the path.
+ * @return The handler or nullptr if no route matches.
+ */
+HttpRouter::Handler HttpRouter::match(Node* pNode, const std::string& method, const char* pPath, const char* pEnd, HttpRouteParams& params) {
+	if (pPath == pEnd) {
+		for (auto it = pNode->routes.begin(); it != pNode->routes.end(); ++it) {
+			if (it->method == method) return it->handler;
+		}
+		return nullptr;
+	}
+
+	const char* pSegment = pPath + 1;   // Skip the '/'
+	const char* pSegEnd  = (const char*) ::memchr(pSegment, '/', pEnd - pSegment);
+	if (pSegEnd == nullptr) pSegEnd = pEnd;
+	size_t length = pSegEnd - pSegment;
+
+	for (auto it = pNode->children.begin(); it != pNode->children.end(); ++it) {
+		Node* pChild = *it;
+		if (pChild->segment.length() == length && ::memcmp(pChild->segment.data(), pSegment, length) == 0) {
+			Handler handler = match(pChild, method, pSegEnd, pEnd, params);
+			if (handler != nullptr) return handler;
+		}
+	}
+
+	if (pNode->pParam != nullptr && length > 0) {
+		size_t count = params.getCount();
+		if (params.add(pNode->pParam->segment.c_str(), HttpStringView(pSegment, length))) {
+			Handler handler = match(pNode->pParam, method, pSegEnd, pEnd, params);
+			if (handler != nullptr) return handler;
+			params.truncate(count);
+		}
+	}
+	return nullptr;
+} // match
@@ -0,0 +1,89 @@
+/*
+ * HttpRouter.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_HTTPROUTER_H_
+#define COMPONENTS_CPP_UTILS_HTTPROUTER_H_
+#include <string>
+#include <vector>
+#include "HttpRequestParser.h"
+
+class HttpRequest;
+class HttpResponse;
+
+/**
+ * @brief The parameters extracted from a request path by a route such as /api/sensor/{id}.
+ *
+ * The parameters are held in a fixed table.  Names refer to the route table and values refer to the
+ * request path so nothing is allocated when a request is dispatched.
+ */
+class HttpRouteParams {
+public:
+	static const size_t MAX_PARAMS = 8;
+
+	HttpRouteParams();
+	bool           add(const char* name, HttpStringView value);
+	void           clear();
+	HttpStringView get(const char* name) const;    // Get the value of the named parameter.
+	size_t         getCount() const;
+	const char*    getName(size_t index) const;
+	HttpStringView getValue(size_t index) const;
+	void           truncate(size_t count);          // Discard parameters beyond the first count.
+
+private:
+	const char*    m_names[MAX_PARAMS];
+	HttpStringView m_values[MAX_PARAMS];
+	size_t         m_count;
+
+}; // HttpRouteParams
+
+
+/**
+ * @brief A table of routes compiled into a tree of path segments.
+ *
+ * A route is a method and a path pattern.  The pattern is split on '/' into segments, each of which is
+ * either literal text or a parameter written as {name}.  The segments are compiled into a tree so that a
+ * request is dispatched by walking the tree once for the segments of its path rather than trying each
+ * registered pattern in turn.  Literal segments are preferred over parameters when both could match.
+ *
+ * @code{.cpp}
+ * router.addRoute("GET", "/api/sensor/{id}", handleSensor);
+ * HttpRouteParams params;
+ * HttpRouter::Handler handler = router.find("GET", HttpStringView(path.data(), path.length()), params);
+ * @endcode
+ */
+class HttpRouter {
+public:
+	typedef void (*Handler)(HttpRequest* pHttpRequest, HttpResponse* pHttpResponse);
+
+	HttpRouter();
+	virtual ~HttpRouter();
+
+	void    addRoute(const std::string& method, const std::string& pattern, Handler handler);
+	Handler find(const std::string& method, HttpStringView path, HttpRouteParams& params);
+
+private:
+	struct Route {
+		std::string method;
+		Handler     handler;
+	};
+	struct Node {
+		std::string        segment;     // The literal text of the segment or the name of a parameter.
+		std::vector<Node*> children;    // Literal children.
+		Node*              pParam;      // Parameter child.
+		std::vector<Route> routes;      // Handlers for paths that end at this node.
+		Node();
+		~Node();
+	};
+
+	Node m_root;
+
+	HttpRouter(const HttpRouter&);              // Not copyable, we own the tree.
+	HttpRouter& operator=(const HttpRouter&);
+	Handler match(Node* pNode, const std::string& method, const char* pPath, const char* pEnd, HttpRouteParams& params);
+
+}; // HttpRouter
+
+#endif /* COMPONENTS_CPP_UTILS_HTTPROUTER_H_ */
@@ -11,6 +11,7 @@
  */
 
 #include <fstream>
+#include <sstream>
 #include "HttpServer.h"
 #include "SockServ.h"
 #include "Task.h"
@@ -21,43 +22,78 @@
 #include "WebSocket.h"
 #include "GeneralUtils.h"
 #include "Memory.h"
+#include "BufferedSocketReader.h"
+#include "WorkQueue.h"
+#include "DoubleBuffer.h"
 static const char* LOG_TAG = "HttpServer";
 
 #undef close
 
 
+/**
+ * @brief Get the reason phrase of a status with which a malformed request is answered.
+ */
+static const char* getErrorReason(int status) {
+	switch (status) {
+		case 413: return "Payload Too Large";
+		case 431: return "Request Header Fields Too Large";
+		case 501: return "Not Implemented";
+		case 505: return "HTTP Version Not Supported";
+		default:  return "Bad Request";
+	}
+} // getErrorReason
+
+
 /**
  * Constructor for HTTP Server
  */
 HttpServer::HttpServer() {
 	m_portNumber = 80;            // The default port number.
 	m_clientTimeout = 5;            // The default timeout 5 seconds.
+	m_keepAliveTimeout = 1000;      // Default idle time of a persistent connection is 1 second.
 	m_rootPath   = "";            // The default path.
 	m_useSSL     = false;         // Default SSL is no.
 	setDirectoryListing(false);   // Default directory listing is disabled.
 	m_fileBufferSize = 4 * 1024;	// Default size of the file buffer.
+	m_maxRequestsPerConnection = 100; // Default number of requests over a persistent connection.
+	m_maxHeadSize     = HttpParser::DEFAULT_MAX_HEAD_SIZE; // Default size of the largest request head.
+	m_workerCount     = 2;          // Default number of worker tasks.
+	m_acceptQueueSize = 8;          // Default number of accepted connections waiting for a worker.
+	m_rejectWhenBusy  = false;      // Default is to wait for a worker rather than reject.
+	m_pAcceptQueue    = nullptr;
+	m_runningWorkers  = 0;
+	::pthread_mutex_init(&m_workerLock, nullptr);
+	::pthread_cond_init(&m_workerStopped, nullptr);
+	setWebSocketCompression(false); // Default is not to compress web socket messages.
 } // HttpServer
 
 
 HttpServer::~HttpServer() {
 	ESP_LOGD(LOG_TAG, "~HttpServer");
+	if (m_pAcceptQueue != nullptr) {   // Still running (or stopped without the workers being joined).
+		stop();
+	}
+	::pthread_cond_destroy(&m_workerStopped);
+	::pthread_mutex_destroy(&m_workerLock);
 }
 
 
 /**
- * @brief Be an HTTP server task.
- * Here we define a Task that will be run when the HTTP server starts.  It is this task
- * that executes the majority of the passive work of the server.  It listens for incoming
- * connections and processes them when they arrive.
+ * @brief Be an HTTP server worker task.
+ * The server runs a fixed pool of these tasks.  Each one takes accepted client connections from the
+ * accept queue of the server and processes the requests that arrive over them.  While one worker is busy
+ * with a slow client or a long running handler, the other workers continue to serve other clients.
  */
-class HttpServerTask: public Task {
+class HttpServerWorker: public Task {
 public:
-	HttpServerTask(std::string name): Task(name, 16 * 1024) {
+	HttpServerWorker(std::string name): Task(name, 16 * 1024) {
 		m_pHttpServer = nullptr;
+		m_pFileBuffer = nullptr;
 	};
 
 private:
-	HttpServer* m_pHttpServer; // Reference to the HTTP Server
+	HttpServer*   m_pHttpServer; // Reference to the HTTP Server
+	DoubleBuffer* m_pFileBuffer; // Buffers for serving files, allocated on first use and reused for every file.
 
 	/**
 	 * @brief Process an incoming HTTP Request
@@ -74,23 +110,51 @@ private:
 		ESP_LOGD("HttpServerTask", ">> processRequest: Method: %s, Path: %s",
 			request.getMethod().c_str(), request.getPath().c_str());
 
-		// Loop over all the path handlers we have looking for the first one that matches.  Note that none of them
-		// need to match.  If we find one that does, then invoke the handler and that is the end of processing.
-		for (auto pathHandlerIterartor = m_pHttpServer->m_pathHandlers.begin();
-				pathHandlerIterartor != m_pHttpServer->m_pathHandlers.end();
-				++pathHandlerIterartor) {
-			if (pathHandlerIterartor->match(request.getMethod(), request.getPath())) { // Did we match the handler?
-				ESP_LOGD("HttpServerTask", "Found a path handler match!!");
-				if (request.isWebsocket()) {                                     // Is this handler to be invoked for a web socket?
-					pathHandlerIterartor->invokePathHandler(&request, nullptr);    // Invoke the handler.
-					request.getWebSocket()->startReader();
+		// Look for a handler in the compiled route table first.  This also extracts any parameters in the path.
+		std::string method = request.getMethod();
+		HttpRouter::Handler handler = m_pHttpServer->m_router.find(method, request.m_parser.getURLView(), request.m_routeParams);
+
+		// If there was no route, loop over all the regex path handlers we have looking for the first one that matches.
+		// Note that none of them need to match.
+		PathHandler* pPathHandler = nullptr;
+		if (handler == nullptr) {
+			for (auto pathHandlerIterartor = m_pHttpServer->m_pathHandlers.begin();
+					pathHandlerIterartor != m_pHttpServer->m_pathHandlers.end();
+					++pathHandlerIterartor) {
+				if (pathHandlerIterartor->match(method, request.getPath())) { // Did we match the handler?
+					pPathHandler = &(*pathHandlerIterartor);
+					break;
+				}
+			} // For each path handler
+		}
+
+		// If we found a handler, then invoke it and that is the end of processing.
+		if (handler != nullptr || pPathHandler != nullptr) {
+			ESP_LOGD("HttpServerTask", "Found a path handler match!!");
+			if (request.isWebsocket()) {                                     // Is this handler to be invoked for a web socket?
+				if (handler != nullptr) {
+					handler(&request, nullptr);                                  // Invoke the handler.
+				} else {
+					pPathHandler->invokePathHandler(&request, nullptr);
+				}
+				m_pHttpServer->m_webSocketHub.add(request.getWebSocket());   // Before the reader can see it close.
+				request.getWebSocket()->startReader();
+			} else {
+				HttpResponse response(&request);
+				if (handler != nullptr) {
+					handler(&request, &response);                                // Invoke the handler.
 				} else {
-					HttpResponse response(&request);
-					pathHandlerIterartor->invokePathHandler(&request, &response); // Invoke the handler.
+					pPathHandler->invokePathHandler(&request, &response);
 				}
-				return;                                                         // End of processing the request
-			} // Path handler match
-		} // For each path handler
+				int errorStatus = request.m_parser.getErrorStatus();
+				if (errorStatus != 0) {                                         // The handler came across a malformed body.
+					request.setKeepAlive(false);
+					response.setStatus(errorStatus, getErrorReason(errorStatus)); // Unless the handler has already responded.
+				}
+				response.close();                                              // Complete the response if the handler didn't.
+			}
+			return;                                                          // End of processing the request
+		} // Handler match
 
 		ESP_LOGD("HttpServerTask", "No Path handler found");
 		// If we reach here, then we did not find a handler for the request.
@@ -118,14 +182,159 @@ private:
 			return;
 		} // Path was a directory.
 
-		response.sendFile(fileName, m_pHttpServer->getFileBufferSize());
+		if (m_pFileBuffer == nullptr) {
+			m_pFileBuffer = new DoubleBuffer(m_pHttpServer->getFileBufferSize());
+		}
+		response.sendFile(fileName, *m_pFileBuffer);
 	} // processRequest
 
 
+	/**
+	 * @brief Answer a request that could not be parsed.
+	 * The caller closes the connection, through the request that owns it.
+	 * @param [in] clientSocket The socket connected to the client.
+	 * @param [in] status The status of the response, such as 400 or 431.
+	 */
+	void rejectRequest(Socket clientSocket, int status) {
+		ESP_LOGW("HttpServerWorker", "Rejecting malformed request with %d; sockFd=%d", status, clientSocket.getFD());
+		std::ostringstream oss;
+		oss << "HTTP/1.1 " << status << " " << getErrorReason(status) << "\r\n"
+			"Content-Length: 0\r\n"
+			"Connection: close\r\n\r\n";
+		clientSocket.send(oss.str());
+	} // rejectRequest
+
+
+	/**
+	 * @brief Wait for the next request over a persistent connection.
+	 * An idle connection holds this worker, so we only wait for the short keep-alive timeout rather than the
+	 * client timeout, and not at all when other clients are waiting for a worker.
+	 * @param [in] clientSocket The socket connected to the client.
+	 * @param [in] reader The read-ahead buffer of the connection.
+	 * @return True if the next request has started to arrive, false if the connection should be closed.
+	 */
+	bool waitForNextRequest(Socket clientSocket, BufferedSocketReader& reader) {
+		if (reader.available() > 0) return true;                  // A pipelined request is already buffered.
+		if (m_pHttpServer->m_pAcceptQueue->getDepth() > 0) return false;
+		uint32_t timeoutMs = m_pHttpServer->getKeepAliveTimeout();
+		struct timeval tv;
+		tv.tv_sec  = timeoutMs / 1000;
+		tv.tv_usec = (timeoutMs % 1000) * 1000;
+		clientSocket.setSocketOption(SO_RCVTIMEO, &tv, sizeof(tv));
+		bool received = reader.fill();
+		clientSocket.setTimeout(m_pHttpServer->getClientTimeout()); // The rest of the request gets the client timeout.
+		return received;
+	} // waitForNextRequest
+
+
+	/**
+	 * @brief Process the requests arriving over a client connection.
+	 *
+	 * A persistent (keep-alive) connection is used for request after request until the client or the response
+	 * asks for it to be closed, the connection has been idle for longer than the keep-alive timeout or we have
+	 * served the maximum number of requests for a connection.  Requests that a client pipelines are already
+	 * held in the read-ahead buffer and are processed in the order they arrived.
+	 * @param [in] clientSocket The socket connected to the client.
+	 */
+	void processConnection(Socket clientSocket) {
+		BufferedSocketReader reader(clientSocket, m_pHttpServer->getMaxHeadSize()); // Read-ahead buffer for this connection.
+		uint16_t requestCount = 0;
+		while (true) {
+			HttpRequest request(reader, &m_pHttpServer->m_webSocketDeflate); // Build the HTTP Request from the socket.
+			if (!request.isValid()) {            // If we couldn't parse a request (or the client has gone or is idle)
+				int errorStatus = request.m_parser.getErrorStatus();
+				if (errorStatus != 0) {
+					rejectRequest(clientSocket, errorStatus);   // Tell the client what was wrong with it.
+				}
+				request.close();                   //   there is nothing more we can do but drop the connection.
+				return;
+			}
+			requestCount++;
+			if (requestCount >= m_pHttpServer->getMaxRequestsPerConnection()) {
+				request.setKeepAlive(false);       // This is the last request we will serve on this connection.
+			}
+			if (request.isWebsocket()) {        // If this is a WebSocket
+				clientSocket.setTimeout(0);     //   Clear the timeout.
+			}
+			request.dump();                      // debug.
+			processRequest(request);             // Process the request.
+			if (request.isWebsocket()) {         // The connection now belongs to the WebSocket.
+				return;
+			}
+			if (!request.isKeepAlive()) {        // If the connection is not persistent, then close it as the request
+				request.close();                   //   has been completed.
+				return;
+			}
+			request.discardBody();               // Skip any body the handler didn't read to reach the next request.
+			if (request.m_parser.getErrorStatus() != 0 ||  // We can't tell where the next request starts or
+				!waitForNextRequest(clientSocket, reader)) {  //   the client has nothing more for us.
+				request.close();
+				return;
+			}
+		} // while
+	} // processConnection
+
+
+	/**
+	 * @brief Perform the task handling for a worker.
+	 * We loop taking client connections from the accept queue and processing them until the queue is
+	 * closed when the server stops.
+	 * @param [in] data A reference to the HttpServer.
+	 */
+	void run(void* data) {
+		m_pHttpServer = (HttpServer*) data;       // The passed in data is an instance of an HttpServer.
+		WorkQueue* pAcceptQueue = m_pHttpServer->m_pAcceptQueue;
+		while (true) {
+			Socket* pClientSocket = (Socket*) pAcceptQueue->pop();   // Block waiting for a connection to process.
+			if (pClientSocket == nullptr) break;                     // The server has stopped.
+			Socket clientSocket = *pClientSocket;
+			delete pClientSocket;
+			ESP_LOGD("HttpServerWorker", "Processing client connection; sockFd=%d", clientSocket.getFD());
+			processConnection(clientSocket);
+		} // while
+		delete m_pFileBuffer;
+		m_pFileBuffer = nullptr;
+		m_pHttpServer->workerStopped();   // From here the server may delete this worker, so we must not touch it
+		FreeRTOS::deleteTask();           //   again and end the task ourselves rather than return to Task::runTask.
+	} // run
+}; // HttpServerWorker
+
+
+/**
+ * @brief Be an HTTP server task.
+ * Here we define a Task that will be run when the HTTP server starts.  It listens for incoming
+ * connections and places them on the accept queue of the server to be processed by the worker tasks.
+ * If the queue is full we either wait for a worker to become free (leaving further clients waiting in
+ * the listen backlog) or, if the server is set to reject when busy, answer with a 503 and close.
+ */
+class HttpServerTask: public Task {
+public:
+	HttpServerTask(std::string name): Task(name, 16 * 1024) {
+		m_pHttpServer = nullptr;
+	};
+
+private:
+	HttpServer* m_pHttpServer; // Reference to the HTTP Server
+
+	/**
+	 * @brief Tell a client that we are too busy to serve it and close the connection.
+	 * @param [in] clientSocket The socket connected to the client.
+	 */
+	void rejectClient(Socket clientSocket) {
+		ESP_LOGW("HttpServerTask", "Accept queue full, rejecting client; sockFd=%d", clientSocket.getFD());
+		clientSocket.send(
+			"HTTP/1.1 503 Service Unavailable\r\n"
+			"Retry-After: 1\r\n"
+			"Content-Length: 0\r\n"
+			"Connection: close\r\n\r\n");
+		clientSocket.close();
+	} // rejectClient
+
+
 	/**
 	 * @brief Perform the task handling for server.
-	 * We loop forever waiting for new client connections to arrive.  When they do, we parse the
-	 * content and look for a handler for that content.
+	 * We loop forever waiting for new client connections to arrive.  When they do, we queue them for
+	 * the workers.
 	 * @param [in] data A reference to the HttpServer.
 	 */
 	void run(void* data) {
@@ -142,20 +351,16 @@ private:
 				clientSocket.setTimeout(m_pHttpServer->getClientTimeout());
 			} catch (std::exception& e) {
 				ESP_LOGE("HttpServerTask", "Caught an exception waiting for new client!");
+				m_pHttpServer->m_pAcceptQueue->close();          // Tell the workers to finish.
 				m_pHttpServer->m_semaphoreServerStarted.give();  // Release the semaphore .. we are now no longer running.
 				return;
 			}
 
 			ESP_LOGD("HttpServerTask", "HttpServer that was listening on port %d has received a new client connection; sockFd=%d", m_pHttpServer->getPort(), clientSocket.getFD());
-
-			HttpRequest request(clientSocket);   // Build the HTTP Request from the socket.
-			if (request.isWebsocket()) {        // If this is a WebSocket
-				clientSocket.setTimeout(0);     //   Clear the timeout.
-			}
-			request.dump();                      // debug.
-			processRequest(request);             // Process the request.
-			if (!request.isWebsocket()) {        // If this is NOT a WebSocket, then close it as the request
-				request.close();                   //   has been completed.
+			Socket* pClientSocket = new Socket(clientSocket);
+			if (!m_pHttpServer->m_pAcceptQueue->push(pClientSocket, !m_pHttpServer->m_rejectWhenBusy)) {
+				delete pClientSocket;
+				rejectClient(clientSocket);
 			}
 		} // while
 	} // run
@@ -196,8 +401,9 @@ void HttpServer::addPathHandler(
  * @brief Register a handler for a path.
  *
  * When a browser request arrives, the request will contain a method (GET, POST, etc) and a path
- * to be accessed.  Using this method we can register a regular expression and, if the incoming method
- * and path match the expression, the corresponding handler will be called.
+ * to be accessed.  Using this method we can register a plain path and, if the incoming method
+ * and path match exactly, the corresponding handler will be called.  The path is added to the compiled
+ * route table (see addRoute()).
  *
  * Example:
  * @code{.cpp}
@@ -216,17 +422,45 @@ void HttpServer::addPathHandler(
 		std::string method,
 		std::string path,
 		void (*handler)(HttpRequest* pHttpRequest, HttpResponse* pHttpResponse)) {
-
-	// We are maintaining a C++ vector of PathHandler objects.  We add a new entry into that vector.
-	m_pathHandlers.push_back(PathHandler(method, path, handler));
+	m_router.addRoute(method, path, handler);
 } // addPathHandler
 
 
+/**
+ * @brief Register a handler for a route.
+ *
+ * A route is a path in which any segment may be a parameter written as {name}.  Routes are compiled into a
+ * tree of path segments so a request is dispatched in a single walk over its path, no matter how many routes
+ * are registered.  Routes are looked up before any regular expression path handlers.  The values of the
+ * parameters are available to the handler through HttpRequest::getPathParam() without any allocation.
+ *
+ * Example:
+ * @code{.cpp}
+ * static void handleSensor(HttpRequest* pRequest, HttpResponse* pResponse) {
+ *	HttpStringView id = pRequest->getPathParam("id");
+ *	...
+ * }
+ *
+ * webServer.addRoute("GET", "/api/sensor/{id}", handleSensor);
+ * @endcode
+ *
+ * @param [in] method The method being used for access ("GET", "POST" etc).
+ * @param [in] pattern The path pattern to be matched.
+ * @param [in] handler The callback function to be invoked when a request arrives.
+ */
+void HttpServer::addRoute(
+		std::string method,
+		std::string pattern,
+		void (*handler)(HttpRequest* pHttpRequest, HttpResponse* pHttpResponse)) {
+	m_router.addRoute(method, pattern, handler);
+} // addRoute
+
+
 /**
  * @brief Get the size of the file buffer.
  * When serving up a file from the file system, we can't afford to read the whole file into RAM before
- * sending it.  As such, we must read the file in chunks.  The buffer size is the size of a chunk to be
- * transmitted before the next chunk is read.
+ * sending it.  As such, we must read the file in chunks.  The buffer size is the size of a chunk.  Each
+ * worker holds two buffers of this size so that the next chunk is read while the previous one is sent.
  * @return The file buffer size.
  */
 size_t HttpServer::getFileBufferSize() {
@@ -234,6 +468,17 @@ size_t HttpServer::getFileBufferSize() {
 } // getFileBufferSize
 
 
+/**
+ * @brief Get the queue of accepted connections waiting for a worker.
+ * The queue keeps counters of its depth, of how long connections waited for a worker and of how many
+ * connections were rejected because it was full.
+ * @return The accept queue or nullptr if the server has not been started.
+ */
+WorkQueue* HttpServer::getAcceptQueue() {
+	return m_pAcceptQueue;
+} // getAcceptQueue
+
+
 /**
  * @brief Get the port number on which the HTTP Server is listening.
  * @return The port number on which the HTTP server is listening.
@@ -252,6 +497,17 @@ std::string HttpServer::getRootPath() {
 } // getRootPath
 
 
+/**
+ * @brief Get the hub of the web sockets connected to the server.
+ * Every web socket accepted by the server is added to the hub and leaves it when it is closed, so a
+ * message broadcast through the hub reaches every connected client.
+ * @return The hub.
+ */
+WebSocketHub* HttpServer::getWebSocketHub() {
+	return &m_webSocketHub;
+} // getWebSocketHub
+
+
 /**
  * @brief Return whether or not we are using SSL.
  * @return True if we are using SSL.
@@ -330,6 +586,120 @@ uint32_t HttpServer::getClientTimeout() {
 }
 
 
+/**
+ * @brief Set the size of the queue of accepted connections waiting for a worker.
+ * Takes effect the next time the server is started.
+ * @param [in] size The maximum number of connections that can wait for a worker.
+ */
+void HttpServer::setAcceptQueueSize(size_t size) {
+	m_acceptQueueSize = size;
+} // setAcceptQueueSize
+
+
+/**
+ * @brief Set what happens to a new client when all the workers are busy and the accept queue is full.
+ * @param [in] reject If true the client is sent a 503 (Service Unavailable) response and the connection is
+ * closed.  If false we stop accepting until there is room in the queue so that new clients wait in the
+ * listen backlog.
+ */
+void HttpServer::setRejectWhenBusy(bool reject) {
+	m_rejectWhenBusy = reject;
+} // setRejectWhenBusy
+
+
+/**
+ * @brief Set whether web socket messages may be compressed with permessage-deflate (RFC 7692).
+ * When enabled, a client that offers the extension has its messages compressed in both directions.  Each
+ * web socket that uses it holds four times the window size, plus 2K, for compression and up to the window
+ * size of history for decompression, so a small window suits a device short of RAM.  Clients that can't be asked
+ * to limit their own window to the same size are served without compression.  Takes effect for web sockets
+ * opened afterwards.
+ * @param [in] enabled Offer the extension.
+ * @param [in] windowBits Base 2 logarithm of the window, from 9 (512 bytes) to 15 (32K).
+ * @param [in] contextTakeover Keep the window from one message to the next, which compresses similar
+ * messages far better at the cost of holding the memory for the life of the web socket.
+ */
+void HttpServer::setWebSocketCompression(bool enabled, uint8_t windowBits, bool contextTakeover) {
+	m_webSocketDeflate.enabled         = enabled;
+	m_webSocketDeflate.windowBits      = windowBits;
+	m_webSocketDeflate.contextTakeover = contextTakeover;
+} // setWebSocketCompression
+
+
+/**
+ * @brief Set the number of worker tasks that process client connections.
+ * Each worker serves one connection at a time (including any persistent connection it is holding open) so
+ * this is the number of clients that can be served concurrently.  Each worker has its own 16K stack.
+ * Takes effect the next time the server is started.
+ * @param [in] count The number of worker tasks.
+ */
+void HttpServer::setWorkerCount(uint8_t count) {
+	m_workerCount = count > 0 ? count : 1;
+} // setWorkerCount
+
+
+/**
+ * @brief Set how long an idle persistent connection is held open waiting for the next request.
+ * A worker is tied up for as long as it waits, so this is kept much shorter than the client timeout, which
+ * applies once a request has started to arrive.  A connection is not held at all while other clients are
+ * waiting for a worker.
+ * @param [in] timeoutMs The time in milliseconds.  The default is 1000.
+ */
+void HttpServer::setKeepAliveTimeout(uint32_t timeoutMs) {
+	m_keepAliveTimeout = timeoutMs;
+} // setKeepAliveTimeout
+
+
+/**
+ * @brief Get how long an idle persistent connection is held open waiting for the next request.
+ * @return The time in milliseconds.
+ */
+uint32_t HttpServer::getKeepAliveTimeout() {
+	return m_keepAliveTimeout;
+} // getKeepAliveTimeout
+
+
+/**
+ * @brief Set the maximum number of requests served over one persistent connection.
+ * Once a connection has carried this many requests it is closed after the last response.  A value of 1
+ * disables keep-alive.  How long an idle persistent connection is held open is set by setKeepAliveTimeout().
+ * @param [in] maxRequests The maximum number of requests per connection.
+ */
+void HttpServer::setMaxRequestsPerConnection(uint16_t maxRequests) {
+	m_maxRequestsPerConnection = maxRequests;
+} // setMaxRequestsPerConnection
+
+
+/**
+ * @brief Set the size of the largest request head (the request line and headers) that is accepted.
+ * Each connection has a read-ahead buffer of this size in which the head is parsed.  A client that sends a
+ * larger head, typically because of many or large cookies, is answered with 431 (Request Header Fields
+ * Too Large).  The size is kept between 512 bytes and 64K.
+ * @param [in] size The size in bytes.  The default is 8K.
+ */
+void HttpServer::setMaxHeadSize(size_t size) {
+	m_maxHeadSize = size < 512 ? 512 : (size > 0xffff ? 0xffff : size);
+} // setMaxHeadSize
+
+
+/**
+ * @brief Get the size of the largest request head that is accepted.
+ * @return The size in bytes.
+ */
+size_t HttpServer::getMaxHeadSize() {
+	return m_maxHeadSize;
+} // getMaxHeadSize
+
+
+/**
+ * @brief Get the maximum number of requests served over one persistent connection.
+ * @return The maximum number of requests per connection.
+ */
+uint16_t HttpServer::getMaxRequestsPerConnection() {
+	return m_maxRequestsPerConnection;
+} // getMaxRequestsPerConnection
+
+
 /**
  * @brief Set whether or not we will list directories.
  * @param [in] use Set to true to enable directory listing.
@@ -342,8 +712,8 @@ void HttpServer::setDirectoryListing(bool use) {
 /**
  * @brief Set the size of the file buffer.
  * When serving up a file from the file system, we can't afford to read the whole file into RAM before
- * sending it.  As such, we must read the file in chunks.  The buffer size is the size of a chunk to be
- * transmitted before the next chunk is read.
+ * sending it.  As such, we must read the file in chunks.  The buffer size is the size of a chunk.  Each
+ * worker holds two buffers of this size so that the next chunk is read while the previous one is sent.
  * @param [in] fileBufferSize How large should the file buffer size be?
  */
 void HttpServer::setFileBufferSize(size_t fileBufferSize) {
@@ -400,6 +770,17 @@ void HttpServer::start(uint16_t portNumber, bool useSSL) {
 	m_useSSL     = useSSL;
 	m_portNumber = portNumber;
 
+	// Create the queue of accepted connections and the pool of workers that serve them.  The workers of a
+	// previous run that ended without stop() (the listening socket failed) are joined first.
+	joinWorkers();
+	m_pAcceptQueue   = new WorkQueue(m_acceptQueueSize);
+	m_runningWorkers = m_workerCount;
+	for (uint8_t i = 0; i < m_workerCount; i++) {
+		HttpServerWorker* pHttpServerWorker = new HttpServerWorker("HttpServerWorker");
+		m_workers.push_back(pHttpServerWorker);
+		pHttpServerWorker->start(this);
+	}
+
 	HttpServerTask* pHttpServerTask = new HttpServerTask("HttpServerTask");
 	pHttpServerTask->start(this);
 	ESP_LOGD(LOG_TAG, "<< start");
@@ -416,10 +797,45 @@ void HttpServer::stop() {
 	ESP_LOGD(LOG_TAG, ">> stop");
 	m_socket.close();                      // Close the socket that is being used to watch for incoming requests.
 	m_semaphoreServerStarted.wait("stop"); // Wait for the server to stop.
+	joinWorkers();                         // Wait for the workers to finish the connections they are serving.
 	ESP_LOGD(LOG_TAG, "<< stop");
 } // stop
 
 
+/**
+ * @brief Wait for the workers to finish and free them and the accept queue.
+ * The queue is closed so that the workers, once done with their current connections, drain the
+ * connections still queued and end.  Only then can the queue they block on be freed.
+ */
+void HttpServer::joinWorkers() {
+	if (m_pAcceptQueue == nullptr) return;
+	m_pAcceptQueue->close();
+	::pthread_mutex_lock(&m_workerLock);
+	while (m_runningWorkers > 0) {
+		::pthread_cond_wait(&m_workerStopped, &m_workerLock);
+	}
+	::pthread_mutex_unlock(&m_workerLock);
+	for (auto it = m_workers.begin(); it != m_workers.end(); ++it) {
+		delete *it;
+	}
+	m_workers.clear();
+	delete m_pAcceptQueue;
+	m_pAcceptQueue = nullptr;
+} // joinWorkers
+
+
+/**
+ * @brief Note that a worker has finished with the accept queue.
+ * Called by each worker as the last thing it does with the server.
+ */
+void HttpServer::workerStopped() {
+	::pthread_mutex_lock(&m_workerLock);
+	m_runningWorkers--;
+	::pthread_cond_signal(&m_workerStopped);
+	::pthread_mutex_unlock(&m_workerLock);
+} // workerStopped
+
+
 /**
  * @brief Construct an instance of a PathHandler.
  *
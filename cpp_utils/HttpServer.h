@@ -11,15 +11,20 @@
 #ifndef COMPONENTS_CPP_UTILS_HTTPSERVER_H_
 #define COMPONENTS_CPP_UTILS_HTTPSERVER_H_
 #include <stdint.h>
+#include <pthread.h>
 
 #include <vector>
 #include "SockServ.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
 #include "FreeRTOS.h"
+#include "HttpRouter.h"
+#include "WebSocketHub.h"
 #include <regex>
 
 class HttpServerTask;
+class HttpServerWorker;
+class WorkQueue;
 
 /**
  * @brief Handle path matching for an incoming HTTP request.
@@ -74,30 +79,67 @@ public:
 			HttpRequest*  pHttpRequest,
 			HttpResponse* pHttpResponse)
 		);
+	WorkQueue*  getAcceptQueue();     // Get the queue of connections waiting for a worker.
+	void        addRoute(
+		std::string method,
+		std::string pattern,
+		void (*webServerRequestHandler)
+		(
+			HttpRequest*  pHttpRequest,
+			HttpResponse* pHttpResponse)
+		);
 	uint32_t    getClientTimeout();							// Get client's socket timeout
+	uint32_t    getKeepAliveTimeout();                     // Get how long an idle persistent connection is held.
+	size_t      getMaxHeadSize();                          // Get the size of the largest request head accepted.
+	uint16_t    getMaxRequestsPerConnection();             // Get the limit on requests over one connection.
 	size_t      getFileBufferSize();  // Get the current size of the file buffer.
 	uint16_t    getPort();            // Get the port on which the Http server is listening.
 	std::string getRootPath();        // Get the root of the file system path.
+	WebSocketHub* getWebSocketHub();  // Get the hub of the connected web sockets.
 	bool        getSSL();             // Are we using SSL?
+	void        setAcceptQueueSize(size_t size);           // Set the number of connections that can wait for a worker.
 	void        setClientTimeout(uint32_t timeout);			   // Set client's socket timeout
 	void        setDirectoryListing(bool use);             // Should we list the content of directories?
 	void        setFileBufferSize(size_t fileBufferSize);  // Set the size of the file buffer
+	void        setKeepAliveTimeout(uint32_t timeoutMs);   // Set how long an idle persistent connection is held.
+	void        setMaxHeadSize(size_t size);               // Set the size of the largest request head accepted.
+	void        setMaxRequestsPerConnection(uint16_t maxRequests); // Set the limit on requests over one connection.
+	void        setRejectWhenBusy(bool reject);            // Reject clients with a 503 when the accept queue is full?
 	void        setRootPath(std::string path);             // Set the root of the file system path.
+	void        setWebSocketCompression(bool enabled, uint8_t windowBits = 10, bool contextTakeover = true); // Offer permessage-deflate to web sockets?
+	void        setWorkerCount(uint8_t count);             // Set the number of worker tasks.
 	void        start(uint16_t portNumber, bool useSSL = false);
 	void        stop();          // Stop a previously started server.
 
 private:
 	friend class HttpServerTask;
+	friend class HttpServerWorker;
 	friend class WebSocket;
+	void                     joinWorkers();
 	void                     listDirectory(std::string path, HttpResponse& response);
+	void                     workerStopped();
 	size_t                   m_fileBufferSize;     // Size of the file buffer.
 	bool                     m_directoryListing;   // Should we list directory content?
-	std::vector<PathHandler> m_pathHandlers;       // Vector of path handlers.
+	std::vector<PathHandler> m_pathHandlers;       // Vector of regex path handlers.
+	HttpRouter               m_router;             // Compiled table of plain and parameterized routes.
 	uint16_t                 m_portNumber;         // Port number on which server is listening.
 	std::string              m_rootPath;           // Root path into the file system.
 	Socket                   m_socket;
 	bool                     m_useSSL;             // Is this server listening on an HTTPS port?
 	uint32_t                 m_clientTimeout;      // Default Timeout
+	uint32_t                 m_keepAliveTimeout;   // Milliseconds an idle persistent connection is held for the next request.
+	uint16_t                 m_maxRequestsPerConnection; // Requests served over a persistent connection before it is closed.
+	size_t                   m_maxHeadSize;        // Largest request head accepted; also the read-ahead buffer of a connection.
+	uint8_t                  m_workerCount;        // Number of worker tasks processing connections.
+	size_t                   m_acceptQueueSize;    // Number of accepted connections that can wait for a worker.
+	bool                     m_rejectWhenBusy;     // Reject new clients when the accept queue is full?
+	WorkQueue*               m_pAcceptQueue;       // Accepted connections waiting for a worker.
+	std::vector<HttpServerWorker*> m_workers;      // The worker tasks serving the accept queue.
+	uint8_t                  m_runningWorkers;     // Number of workers that have not yet finished.
+	pthread_mutex_t          m_workerLock;         // Guards m_runningWorkers.
+	pthread_cond_t           m_workerStopped;      // Signalled when a worker finishes.
+	WebSocketHub             m_webSocketHub;       // The connected web sockets.
+	WebSocketDeflateConfig   m_webSocketDeflate;   // How permessage-deflate is offered to web sockets.
 	FreeRTOS::Semaphore      m_semaphoreServerStarted = FreeRTOS::Semaphore("ServerStarted");
 }; // HttpServer
 
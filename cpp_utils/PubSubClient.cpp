@@ -21,8 +21,8 @@ static const char* TAG = "PubSubClient";
 /**
  * @brief A task that will handle the PubSubClient.
  *
- * This Task is started, when we have a valid connection.
- * If the connection breaks, we stop this Task.
+ * This Task is started when we first have a valid connection and lasts as long as the client.  While
+ * the connection is down it waits for the next one.
  */
 class PubSubClientTask: public Task {
 public:
@@ -43,58 +43,9 @@ private:
 
 		while (true) {
 			if (pPubSubClient->connected()) {
-				uint16_t len = pPubSubClient->readPacket();
-
-				if (len > 0) { // if there was data
-
-					pPubSubClient->keepAliveTimer->reset(0); //lastInActivity = t;
-
-					mqtt_message* msg = new mqtt_message;
-					pPubSubClient->parseData(msg, len);
-
-					//pPubSubClient->dumpData(msg);
-					ESP_LOGD(TAG, "Message type (%s)!", pPubSubClient->messageType_toString(msg->type).c_str());
-
-					if (msg->type == PUBLISH) {
-						if (pPubSubClient->callback) {
-							if (msg->qos == QOS0) {
-								pPubSubClient->callback(msg->topic, msg->payload);
-							} else if (msg->qos == QOS1) {
-								pPubSubClient->callback(msg->topic, msg->payload);
-
-								pPubSubClient->buffer[0] = PUBACK;
-								pPubSubClient->buffer[1] = 2;
-								pPubSubClient->buffer[2] = (msg->msgId >> 8);
-								pPubSubClient->buffer[3] = (msg->msgId & 0xFF);
-
-								int rc = pPubSubClient->_client->send(pPubSubClient->buffer, 4);
-								if (rc < 0) pPubSubClient->_state = CONNECTION_LOST;
-
-								pPubSubClient->keepAliveTimer->reset(0); //lastOutActivity = t;
-							} else if(msg->qos == QOS2) {
-								ESP_LOGD(TAG, "QOS2 is not supported!");
-							} else {
-								ESP_LOGD(TAG, "QOS-Level unkonwon yet!");
-							}
-						}
-					} else if (msg->type == PINGREQ) {
-						pPubSubClient->buffer[0] = PINGRESP;
-						pPubSubClient->buffer[1] = 0;
-						int rc = pPubSubClient->_client->send(pPubSubClient->buffer, 2);
-						if (rc < 0) pPubSubClient->_state = CONNECTION_LOST;
-
-					} else if (msg->type == PINGRESP) {
-						pPubSubClient->PING_outstanding = false;
-					} else if (msg->type == SUBACK) {
-						pPubSubClient->SUBACK_outstanding = false;
-						pPubSubClient->timeoutTimer->stop(0);
-					} else if (msg->type == UNSUBACK) {
-						pPubSubClient->UNSUBACK_Outstanding = false;
-						pPubSubClient->timeoutTimer->stop(0);
-					}
-
-					delete(msg);
-				}
+				pPubSubClient->receivePackets(); // The packets received are handled as they are decoded.
+			} else {
+				FreeRTOS::sleep(100);
 			}
 		} // while (true)
 	} // run
@@ -150,6 +101,7 @@ PubSubClient::~PubSubClient() {
 	delete (keepAliveTimer);
 	delete (timeoutTimer);
 	delete (m_task);
+	::pthread_mutex_destroy(&_lock);
 }
 
 
@@ -186,6 +138,14 @@ void PubSubClient::setup() {
 	PING_outstanding = false;
 	SUBACK_outstanding = false;
 	UNSUBACK_Outstanding = false;
+	nextMsgId = 1;
+	_inflightWindow = MQTT_MAX_INFLIGHT;
+	_queue = nullptr;
+	::pthread_mutex_init(&_lock, nullptr);
+	_sending = false;
+	streamCallback = nullptr;
+	_connackReceived = false;
+	_connackCode = 0;
 
 	keepAliveTimer = new FreeRTOSTimer((char*) "keepAliveTimer",
 			(MQTT_KEEPALIVE * 1000) / portTICK_PERIOD_MS, pdTRUE, this,
@@ -194,6 +154,7 @@ void PubSubClient::setup() {
 				(MQTT_KEEPALIVE * 1000) / portTICK_PERIOD_MS, pdTRUE, this,
 				timeoutTimerMapper);
 	m_task = new PubSubClientTask("PubSubClientTask");
+	m_taskStarted = false;
 } // setup
 
 /**
@@ -213,10 +174,7 @@ void PubSubClient::keepAliveChecker() {
 		//_client->close();
 		ESP_LOGD(TAG, "KeepAlive TIMEOUT!");
 	} else {
-		buffer[0] = PINGREQ;
-		buffer[1] = 0;
-		int rc = _client->send(buffer, 2);
-		if (rc < 0) _state = CONNECTION_LOST;
+		sendPacket(encodePacket(PINGREQ, ""));
 		ESP_LOGD(TAG, "send KeepAlive REQUEST!");
 		PING_outstanding = true;
 	}
@@ -315,7 +273,6 @@ bool PubSubClient::connect() {
 		int result = _client->connect((char *)_config.ip.c_str(), _config.port);
 
 		if (result == 0) {
-			nextMsgId = 1;
 			// Leave room in the buffer for header and variable length field
 			uint16_t length = 5;
 
@@ -367,20 +324,32 @@ bool PubSubClient::connect() {
 			// start keepAliveTimer in 1ms...
 			keepAliveTimer->start(0); //lastInActivity = lastOutActivity = millis();
 
-			readPacket();
-			uint8_t type = buffer[0] & 0xF0;
+			// Packets the server sends straight after the CONNACK are handled as they are decoded.
+			_decoder.reset();
+			_connackReceived = false;
+			while (!_connackReceived && receivePackets()) {}
 
-			if (type == CONNACK) {
+			if (_connackReceived && _connackCode == 0) {
 				ESP_LOGD(TAG, "Connected to mqtt server!");
 
 				keepAliveTimer->reset(0); //lastInActivity = millis();
 				PING_outstanding = false;
 				_state = CONNECTED;
 
-				m_task->start(this);
+				// Messages left in flight by the last connection go first, then those queued meanwhile.
+				::pthread_mutex_lock(&_lock);
+				retransmit();
+				drainQueue();
+				::pthread_mutex_unlock(&_lock);
+				flush();
+
+				if (!m_taskStarted) {   // The task of an earlier connection is still there, waiting for this one.
+					m_taskStarted = true;
+					m_task->start(this);
+				}
 				return true;
 			} else {
-				_state = (mqtt_state) buffer[3];
+				_state = _connackReceived ? (mqtt_state) _connackCode : CONNECT_FAILED;
 				ESP_LOGD(TAG, "Error: %d", _state);
 			}
 
@@ -395,18 +364,112 @@ bool PubSubClient::connect() {
 
 
 /**
- * @brief 	Receiving a MQTT packet and store it in the buffer to parse it.
+ * @brief 	Receive what the server has sent and decode it. Each packet completed is handled as it is
+ * 			decoded; a packet may be split over several calls and one call may complete several.
  * @param 	N/A.
- * @return 	Number of received bytes.
+ * @return 	data received (true), or the connection closed, failed or broke the protocol (false).
+ */
+bool PubSubClient::receivePackets() {
+	size_t res = _client->receive(_readBuffer, MQTT_READ_BUFFER_SIZE);
+	if (res == 0 || res == (size_t) -1) {
+		ESP_LOGD(TAG, "Connection closed by the server");
+		_state = CONNECTION_LOST;
+		_client->close();
+		return false;
+	}
+
+	keepAliveTimer->reset(0); //lastInActivity = t;
+	if (!_decoder.feed(_readBuffer, res)) {
+		ESP_LOGE(TAG, "Malformed packet received, closing the connection");
+		_state = CONNECTION_LOST;
+		_client->close();
+		return false;
+	}
+	return true;
+}
+
+
+/**
+ * @brief 	Handle a whole packet received from the server.
+ * @param 	[in] MQTT header.
+ * 			[in] the packet after its fixed header.
+ * 			[in] the length of the packet after its fixed header.
+ * @return 	N/A.
+ */
+void PubSubClient::onPacket(uint8_t header, const uint8_t* data, size_t length) {
+	mqtt_message msg;
+	if (!parseData(&msg, header, data, length)) {
+		ESP_LOGD(TAG, "Packet of type %s is too short", messageType_toString(header & 0xF0).c_str());
+		return;
+	}
+	//dumpData(&msg);
+	ESP_LOGD(TAG, "Message type (%s)!", messageType_toString(msg.type).c_str());
+
+	if (msg.type == PUBLISH) {
+		if (msg.qos == QOS2) {
+			ESP_LOGD(TAG, "QOS2 is not supported!");
+			return;
+		}
+		if (callback) {
+			callback(msg.topic, msg.payload);
+		}
+		if (msg.qos == QOS1) {
+			sendAck(PUBACK, msg.msgId);
+		}
+	} else if (msg.type == CONNACK) {
+		_connackCode = length >= 2 ? data[1] : CONNECT_UNAVAILABLE;
+		_connackReceived = true;
+	} else if (msg.type == PINGREQ) {
+		sendPacket(encodePacket(PINGRESP, ""));
+	} else if (msg.type == PINGRESP) {
+		PING_outstanding = false;
+	} else if (msg.type == PUBACK || msg.type == PUBREC || msg.type == PUBCOMP) {
+		acknowledge(msg.type, msg.msgId);
+	} else if (msg.type == SUBACK) {
+		SUBACK_outstanding = false;
+		timeoutTimer->stop(0);
+	} else if (msg.type == UNSUBACK) {
+		UNSUBACK_Outstanding = false;
+		timeoutTimer->stop(0);
+	}
+}
+
+
+/**
+ * @brief 	Start receiving a message whose payload is too long to be held; the payload is passed to
+ * 			the stream callback in pieces as it arrives.
+ * @param 	[in] MQTT header.
+ * 			[in] the topic.
+ * 			[in] the message id (QoS 1 and QoS 2).
+ * 			[in] the length of the payload.
+ * @return 	N/A.
  */
-size_t PubSubClient::readPacket() {
-	size_t res = _client->receive(buffer, MQTT_MAX_PACKET_SIZE);
+void PubSubClient::onPublishStart(uint8_t header, const std::string& topic, uint16_t msgId, size_t payloadLength) {
+	_streamTopic  = topic;
+	_streamQos    = header & 0x06;
+	_streamMsgId  = msgId;
+	_streamOffset = 0;
+	_streamLength = payloadLength;
+	if (streamCallback == nullptr) {
+		ESP_LOGD(TAG, "No stream callback, discarding %d bytes published to %s", payloadLength, topic.c_str());
+	}
+}
+
 
-	if (res > MQTT_MAX_PACKET_SIZE) {
-		res = 0; // This will cause the packet to be ignored.
+void PubSubClient::onPublishData(const uint8_t* data, size_t length) {
+	if (streamCallback != nullptr && _streamQos != QOS2) {
+		streamCallback(_streamTopic, data, length, _streamOffset, _streamLength);
 	}
+	_streamOffset += length;
+}
+
 
-	return (uint16_t) res;
+void PubSubClient::onPublishEnd() {
+	if (_streamQos == QOS1) {
+		sendAck(PUBACK, _streamMsgId);
+	} else if (_streamQos == QOS2) {
+		ESP_LOGD(TAG, "QOS2 is not supported!");
+	}
 }
 
 
@@ -454,25 +517,59 @@ bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned i
  * @return 	success (true), or no success (false).
  */
 bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength, bool retained) {
-	if (connected()) {
-		if (MQTT_MAX_PACKET_SIZE < 5 + 2 + strlen(topic) + plength) {
-			// Too long
-			return false;
-		}
-		// Leave room in the buffer for header and variable length field
-		uint16_t length = 5;
-		length = writeString(topic, buffer, length);
-		uint16_t i;
-		for (i = 0; i < plength; i++) {
-			buffer[length++] = payload[i];
-		}
-		uint8_t header = PUBLISH;
-		if (retained) {
-			header |= 1;
-		}
-		return write(header, buffer, length - 5);
+	return publish(topic, payload, plength, retained, QOS0);
+}
+
+
+/**
+ * @brief 	Publish a MQTT message with the given QoS.
+ * 			A QoS 1 or QoS 2 message is sent at once if fewer than the in-flight window of messages are
+ * 			waiting to be acknowledged, and is sent again after a reconnect until it is. Otherwise, or if
+ * 			we are not connected, the message goes to the store-and-forward queue if there is one, to be
+ * 			sent when there is room. Without a queue such a message is refused and the caller may try
+ * 			again later; this never waits for the network.
+ * @param 	[in] my topic.
+ * 			[in] my payload.
+ * 			[in] length of the message
+ * 			[in] is this a retained message (true/false)
+ * 			[in] QOS0, QOS1 or QOS2
+ * @return 	sent or queued (true), or refused (false).
+ */
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength, bool retained, mqtt_qos qos) {
+	size_t topicLength = strlen(topic);
+	if (MQTT_MAX_PACKET_SIZE < 5 + 2 + topicLength + plength + (qos == QOS0 ? 0 : 2)) {
+		// Too long
+		return false;
 	}
-	return false;
+	// A message is kept as its fixed header, topic and payload until it is given a message id and sent.
+	std::string record;
+	record.reserve(3 + topicLength + plength);
+	record.push_back((char) (PUBLISH | qos | (retained ? 1 : 0)));
+	record.push_back((char) (topicLength >> 8));
+	record.push_back((char) (topicLength & 0xFF));
+	record.append(topic, topicLength);
+	record.append((const char*) payload, plength);
+
+	// The packet is built under the lock, which keeps the message ids and the order of the packets, and sent
+	// once it has been released so that a slow network doesn't hold up the receiving task.
+	bool rc;
+	bool send = false;
+	::pthread_mutex_lock(&_lock);
+	bool queueEmpty = (_queue == nullptr || _queue->size() == 0);
+	if (connected() && queueEmpty && (qos == QOS0 || _inflight.size() < _inflightWindow)) {
+		queuePacket(preparePublish(record));
+		send = true;
+		rc = true;
+	} else if (_queue != nullptr) {
+		rc = _queue->push(record);
+	} else {
+		rc = false;
+	}
+	::pthread_mutex_unlock(&_lock);
+	if (send) {
+		rc = flush() || qos != QOS0;
+	}
+	return rc;
 }
 
 
@@ -536,7 +633,6 @@ bool PubSubClient::write(uint8_t header, uint8_t* buf, uint16_t length) {
 	uint8_t llen = 0;
 	uint8_t digit;
 	uint8_t pos = 0;
-	int rc;
 	uint16_t len = length;
 	do {
 		digit = len % 128;
@@ -567,14 +663,209 @@ bool PubSubClient::write(uint8_t header, uint8_t* buf, uint16_t length) {
 //	}
 //	return result;
 //#else
-	rc = _client->send(buf + (4 - llen), length + 1 + llen);
-	if(rc < 0) _state = CONNECTION_LOST;
-	keepAliveTimer->reset(0); //lastOutActivity = millis();
-	return (rc == 1 + llen + length);
+	return sendPacket(std::string((const char*) buf + (4 - llen), length + 1 + llen));
 //#endif
 }
 
 
+/**
+ * @brief 	Handle the acknowledgment of a QoS 1 or QoS 2 message we published.
+ * 			PUBACK and PUBCOMP complete the message and free its place in the window for a queued
+ * 			one. PUBREC is answered with PUBREL.
+ * @param 	[in] PUBACK, PUBREC or PUBCOMP.
+ * 			[in] the message id acknowledged.
+ * @return 	N/A.
+ */
+void PubSubClient::acknowledge(uint8_t type, uint16_t msgId) {
+	::pthread_mutex_lock(&_lock);
+	for (auto it = _inflight.begin(); it != _inflight.end(); ++it) {
+		if (it->msgId != msgId) continue;
+		if (type == PUBREC) {
+			it->released = true;
+			std::string().swap(it->packet);    // It won't be sent again.
+			std::string body;
+			body.push_back((char) (msgId >> 8));
+			body.push_back((char) (msgId & 0xFF));
+			queuePacket(encodePacket(PUBREL | QOS1, body));
+		} else {
+			_inflight.erase(it);
+		}
+		break;
+	}
+	drainQueue();
+	::pthread_mutex_unlock(&_lock);
+	flush();
+} // acknowledge
+
+
+/**
+ * @brief 	Get the next message id, skipping those still in flight. The lock must be held.
+ * @return 	The message id.
+ */
+uint16_t PubSubClient::allocateMsgId() {
+	while (true) {
+		nextMsgId++;
+		if (nextMsgId == 0) {
+			nextMsgId = 1;
+		}
+		bool inUse = false;
+		for (auto& message : _inflight) {
+			if (message.msgId == nextMsgId) {
+				inUse = true;
+				break;
+			}
+		}
+		if (!inUse) return nextMsgId;
+	}
+} // allocateMsgId
+
+
+/**
+ * @brief 	Move queued messages to the outgoing packets while there is room in the in-flight window.
+ * 			The lock must be held; the caller sends them with flush() once it has released it. If the
+ * 			send fails the QoS 1 and QoS 2 messages stay in flight to be sent again on reconnect; the
+ * 			QoS 0 ones are lost.
+ * @return 	N/A.
+ */
+void PubSubClient::drainQueue() {
+	if (_queue == nullptr) return;
+	std::string record;
+	while (connected() && _inflight.size() < _inflightWindow && _queue->front(&record)) {
+		queuePacket(preparePublish(record));
+		_queue->pop();
+	}
+} // drainQueue
+
+
+/**
+ * @brief 	Send the outgoing packets. The lock must not be held.
+ * 			The lock is only taken to pick the packets up, never while the socket is written. If another
+ * 			task is already sending, it sends these too, in order, and this returns at once.
+ * @return 	sent or being sent by another task (true), or the send failed (false).
+ */
+bool PubSubClient::flush() {
+	bool rc = true;
+	::pthread_mutex_lock(&_lock);
+	if (_sending) {
+		::pthread_mutex_unlock(&_lock);
+		return true;
+	}
+	_sending = true;
+	while (!_outgoing.empty()) {
+		std::string packets;
+		packets.swap(_outgoing);
+		::pthread_mutex_unlock(&_lock);
+		rc = writePackets(packets) && rc;
+		::pthread_mutex_lock(&_lock);
+	}
+	_sending = false;
+	::pthread_mutex_unlock(&_lock);
+	return rc;
+} // flush
+
+
+/**
+ * @brief 	Encode a MQTT packet from its fixed header byte and the rest of the packet.
+ * @param 	[in] MQTT header.
+ * 			[in] variable header and payload.
+ * @return 	The packet.
+ */
+std::string PubSubClient::encodePacket(uint8_t header, const std::string& body) {
+	std::string packet;
+	packet.reserve(5 + body.length());
+	packet.push_back((char) header);
+	size_t len = body.length();
+	do {
+		uint8_t digit = len % 128;
+		len = len / 128;
+		if (len > 0) {
+			digit |= 0x80;
+		}
+		packet.push_back((char) digit);
+	} while (len > 0);
+	packet += body;
+	return packet;
+} // encodePacket
+
+
+/**
+ * @brief 	Turn a message published or queued into a PUBLISH packet. The lock must be held.
+ * 			A QoS 1 or QoS 2 message gets its message id and is added to the in-flight messages.
+ * @param 	[in] fixed header, topic and payload of the message.
+ * @return 	The packet, or nothing if the record is corrupt.
+ */
+std::string PubSubClient::preparePublish(const std::string& record) {
+	if (record.length() < 3) return "";
+	uint8_t header = record[0];
+	size_t topicEnd = 3 + ((uint8_t) record[1] << 8 | (uint8_t) record[2]);
+	if (topicEnd > record.length()) return "";
+
+	std::string body = record.substr(1, topicEnd - 1);
+	if ((header & 0x06) == QOS0) {
+		body.append(record, topicEnd, std::string::npos);
+		return encodePacket(header, body);
+	}
+	mqtt_inflight message;
+	message.msgId = allocateMsgId();
+	message.released = false;
+	body.push_back((char) (message.msgId >> 8));
+	body.push_back((char) (message.msgId & 0xFF));
+	body.append(record, topicEnd, std::string::npos);
+	message.packet = encodePacket(header, body);
+	_inflight.push_back(message);
+	return message.packet;
+} // preparePublish
+
+
+/**
+ * @brief 	Add packets to the outgoing packets. The lock must be held; flush() sends them.
+ * @param 	[in] the packets.
+ * @return 	N/A.
+ */
+void PubSubClient::queuePacket(const std::string& packet) {
+	_outgoing += packet;
+} // queuePacket
+
+
+/**
+ * @brief 	Send again the messages left in flight by the last connection. The lock must be held.
+ * 			A PUBLISH goes with the DUP flag; a message whose PUBREC we had goes as PUBREL. The caller
+ * 			sends them with flush() once it has released the lock.
+ * @return 	N/A.
+ */
+void PubSubClient::retransmit() {
+	std::string batch;
+	for (auto& message : _inflight) {
+		if (message.released) {
+			std::string body;
+			body.push_back((char) (message.msgId >> 8));
+			body.push_back((char) (message.msgId & 0xFF));
+			batch += encodePacket(PUBREL | QOS1, body);
+		} else {
+			message.packet[0] |= 0x08;
+			batch += message.packet;
+		}
+	}
+	if (!batch.empty()) {
+		ESP_LOGD(TAG, "Sending %d messages again", _inflight.size());
+		queuePacket(batch);
+	}
+} // retransmit
+
+
+/**
+ * @brief 	Send encoded MQTT packets after any already waiting to go. The lock must not be held.
+ * @param 	[in] the packets.
+ * @return 	success (true), or no success (false).
+ */
+bool PubSubClient::sendPacket(const std::string& packet) {
+	::pthread_mutex_lock(&_lock);
+	queuePacket(packet);
+	::pthread_mutex_unlock(&_lock);
+	return flush();
+} // sendPacket
+
+
 /**
  * @brief 	Subscribe a MQTT topic.
  * @param 	[in] my topic
@@ -587,12 +878,11 @@ bool PubSubClient::subscribe(const char* topic, bool ack) {
 	if (connected()) {
 		// Leave room in the buffer for header and variable length field
 		uint16_t length = 5;
-		nextMsgId++;
-		if (nextMsgId == 0) {
-			nextMsgId = 1;
-		}
-		buffer[length++] = (nextMsgId >> 8);
-		buffer[length++] = (nextMsgId & 0xFF);
+		::pthread_mutex_lock(&_lock);
+		uint16_t msgId = allocateMsgId();
+		::pthread_mutex_unlock(&_lock);
+		buffer[length++] = (msgId >> 8);
+		buffer[length++] = (msgId & 0xFF);
 		length = writeString(topic, buffer, length);
 		buffer[length++] = QOS1;
 
@@ -627,12 +917,11 @@ bool PubSubClient::unsubscribe(const char* topic, bool ack) {
 
 	if (connected()) {
 		uint16_t length = 5;
-		nextMsgId++;
-		if (nextMsgId == 0) {
-			nextMsgId = 1;
-		}
-		buffer[length++] = (nextMsgId >> 8);
-		buffer[length++] = (nextMsgId & 0xFF);
+		::pthread_mutex_lock(&_lock);
+		uint16_t msgId = allocateMsgId();
+		::pthread_mutex_unlock(&_lock);
+		buffer[length++] = (msgId >> 8);
+		buffer[length++] = (msgId & 0xFF);
 		length = writeString(topic, buffer, length);
 
 		if (write(UNSUBSCRIBE | QOS1, buffer, length - 5)) {
@@ -660,9 +949,7 @@ bool PubSubClient::isUnsubscribeDone() {
  * @return 	N/A.
  */
 void PubSubClient::disconnect() {
-	buffer[0] = DISCONNECT;
-	buffer[1] = 0;
-	_client->send(buffer, 2);
+	sendPacket(encodePacket(DISCONNECT, ""));
 	_state = DISCONNECTED;
 	_client->close();
 	keepAliveTimer->stop(0); //lastInActivity = lastOutActivity = millis();
@@ -687,6 +974,30 @@ uint16_t PubSubClient::writeString(const char* string, uint8_t* buf, uint16_t po
 }
 
 
+/**
+ * @brief 	Get the number of QoS 1 and QoS 2 messages published but not yet acknowledged.
+ * @return 	number of messages.
+ */
+size_t PubSubClient::getInflightCount() {
+	::pthread_mutex_lock(&_lock);
+	size_t count = _inflight.size();
+	::pthread_mutex_unlock(&_lock);
+	return count;
+}
+
+
+/**
+ * @brief 	Get the number of messages waiting in the store-and-forward queue.
+ * @return 	number of messages.
+ */
+size_t PubSubClient::getQueuedCount() {
+	::pthread_mutex_lock(&_lock);
+	size_t count = _queue == nullptr ? 0 : _queue->size();
+	::pthread_mutex_unlock(&_lock);
+	return count;
+}
+
+
 /**
  * @brief 	Check the connection to the MQTT server.
  * @return 	connected (true/false)
@@ -745,6 +1056,45 @@ PubSubClient& PubSubClient::setClient(Socket& client) {
 }
 
 
+/**
+ * @brief 	Set the most QoS 1 and QoS 2 messages that may wait for acknowledgment at once.
+ * @param   [in] the window, at least 1.
+ * @return 	My instance.
+ */
+PubSubClient& PubSubClient::setInflightWindow(uint8_t window) {
+	this->_inflightWindow = window == 0 ? 1 : window;
+	return *this;
+}
+
+
+/**
+ * @brief 	Set the store-and-forward queue for messages published while they can't be sent, such as
+ * 			during a WiFi drop. They are sent in order once the connection is back. The queue
+ * 			remains the caller's.
+ * @param   [in] the queue, or nullptr to refuse such messages.
+ * @return 	My instance.
+ */
+PubSubClient& PubSubClient::setQueue(PubSubClientQueue* queue) {
+	::pthread_mutex_lock(&_lock);
+	this->_queue = queue;
+	::pthread_mutex_unlock(&_lock);
+	return *this;
+}
+
+
+/**
+ * @brief 	Set the callback function for messages too long to be held in MQTT_MAX_PACKET_SIZE. Their
+ * 			payload is passed to it in pieces as it arrives, along with its offset and total length.
+ * 			Without it such messages are discarded.
+ * @param   [in] callback function
+ * @return 	My instance.
+ */
+PubSubClient& PubSubClient::setStreamCallback(MQTT_STREAM_CALLBACK_SIGNATURE) {
+	this->streamCallback = streamCallback;
+	return *this;
+}
+
+
 /**
  * @brief 	Get the current MYTT state form the instance.
  * @param   N/A.
@@ -756,56 +1106,79 @@ int PubSubClient::state() {
 
 
 /**
- * @brief 	Parsing the received data in to the internal message struct.
+ * @brief 	Parsing a received packet in to the internal message struct.
+ * @param 	[out] the message.
+ * 			[in] MQTT header.
+ * 			[in] the packet after its fixed header.
+ * 			[in] the length of the packet after its fixed header.
+ * @return 	parsed (true), or the packet is too short (false).
  */
-void PubSubClient::parseData(mqtt_message* msg, uint16_t len) {
+bool PubSubClient::parseData(mqtt_message* msg, uint8_t header, const uint8_t* data, size_t length) {
 	/********* Parse Fixed header *********/
-	msg->type = buffer[0] & 0xF0;
+	msg->type     = header & 0xF0;
+	msg->dup      = false;
+	msg->qos      = QOS0;
+	msg->retained = false;
+	msg->msgId    = 0;
 
-	/* read DUP-Flag */
 	if (msg->type == PUBLISH) {
-		msg->dup = (bool) (buffer[0] & 0x18) >> 3;
-	}
-
-	/* read QoS-Level */
-	if(msg->type == PUBLISH) {
-		msg->qos = (buffer[0] & 0x06);
-	}
-
-	/* read RETAIN-Frag */
-	if(msg->type == PUBLISH) {
-		msg->retained = (bool) (buffer[0] & 0x01);
+		msg->dup      = (header & 0x08) != 0;   /* read DUP-Flag */
+		msg->qos      = (header & 0x06);        /* read QoS-Level */
+		msg->retained = (header & 0x01) != 0;   /* read RETAIN-Flag */
 	}
 
-	uint8_t remainingLength = buffer[1];
-
 	/********* Parse Variable header *********/
-	int pos = 2;
+	size_t pos = 0;
 
 	/* read topic name */
 	if (msg->type == PUBLISH) {
-		uint16_t topicLen = (buffer[2] << 8) + buffer[3];
-
-		msg->topic = "";
-		for (int i = 4; i < (topicLen + 4); i++) {
-			msg->topic += (char) buffer[i];
-			pos++;
-		}
+		if (length < 2) return false;
+		size_t topicLen = (data[0] << 8) + data[1];
+		if (length < 2 + topicLen) return false;
+		msg->topic.assign((const char*) data + 2, topicLen);
+		pos = 2 + topicLen;
 	}
 
 	/* read Message ID */
-	if (msg->type == PUBLISH || msg->type == PUBACK || msg->type == PUBREC || msg->type == PUBCOMP || msg->type ==  SUBACK || msg->type ==  UNSUBACK) {
-		msg->msgId = (buffer[pos] << 8) + (buffer[pos + 1]);
+	if ((msg->type == PUBLISH && msg->qos != QOS0) || msg->type == PUBACK || msg->type == PUBREC || msg->type == PUBCOMP || msg->type ==  SUBACK || msg->type ==  UNSUBACK) {
+		if (length < pos + 2) return false;
+		msg->msgId = (data[pos] << 8) + (data[pos + 1]);
 		pos += 2;
 	}
 
 	/********* read Payload *********/
 	if (msg->type == PUBLISH) {
-		msg->payload = "";
-		for (int i = pos; i < remainingLength + 2; i++) {
-			msg->payload += (char) buffer[i];
-		}
+		msg->payload.assign((const char*) data + pos, length - pos);
 	}
+	return true;
+}
+
+
+/**
+ * @brief 	Write encoded MQTT packets to the socket. Only flush() calls this, so packets go out whole and
+ * 			in order.
+ * @param 	[in] the packets.
+ * @return 	success (true), or no success (false).
+ */
+bool PubSubClient::writePackets(const std::string& packets) {
+	int rc = _client->send((const uint8_t*) packets.data(), packets.length());
+	if (rc < 0) _state = CONNECTION_LOST;
+	keepAliveTimer->reset(0); //lastOutActivity = millis();
+	return rc == (int) packets.length();
+} // writePackets
+
+
+/**
+ * @brief 	Send a PUBACK for a message received.
+ * @param 	[in] PUBACK.
+ * 			[in] the message id.
+ * @return 	N/A.
+ */
+void PubSubClient::sendAck(uint8_t type, uint16_t msgId) {
+	std::string body;
+	body.push_back((char) (msgId >> 8));
+	body.push_back((char) (msgId & 0xFF));
+	sendPacket(encodePacket(type, body));
 }
 
 
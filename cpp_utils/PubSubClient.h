@@ -9,9 +9,13 @@
 #ifndef PubSubClient_h
 #define PubSubClient_h
 
+#include <pthread.h>
+#include <deque>
 #include <string>
 #include "Socket.h"
 #include "FreeRTOSTimer.h"
+#include "PubSubClientDecoder.h"
+#include "PubSubClientQueue.h"
 
 #define MQTT_VERSION_3_1      3
 #define MQTT_VERSION_3_1_1    4
@@ -27,6 +31,12 @@
 #define MQTT_MAX_PACKET_SIZE 128
 #endif
 
+// MQTT_READ_BUFFER_SIZE : Size of the buffer the socket is read into. Packets may be split over reads and a
+//  read may hold several packets.
+#ifndef MQTT_READ_BUFFER_SIZE
+#define MQTT_READ_BUFFER_SIZE 512
+#endif
+
 // MQTT_KEEPALIVE : keepAlive interval in Seconds
 #ifndef MQTT_KEEPALIVE
 #define MQTT_KEEPALIVE 15
@@ -37,6 +47,11 @@
 #define MQTT_SOCKET_TIMEOUT 15
 #endif
 
+// MQTT_MAX_INFLIGHT : Maximum number of QoS 1 and QoS 2 messages published but not yet acknowledged
+#ifndef MQTT_MAX_INFLIGHT
+#define MQTT_MAX_INFLIGHT 8
+#endif
+
 // MQTT_MAX_TRANSFER_SIZE : limit how much data is passed to the network client
 //  in each write call. Needed for the Arduino Wifi Shield. Leave undefined to
 //  pass the entire MQTT packet in each write call.
@@ -105,11 +120,22 @@ struct mqtt_message {
 	uint16_t msgId;
 };
 
+// A QoS 1 or QoS 2 message published and not yet acknowledged.
+struct mqtt_inflight {
+	uint16_t msgId;
+	bool released;          // PUBREC received and PUBREL sent, waiting for PUBCOMP (QoS 2).
+	std::string packet;     // The PUBLISH packet, sent again with DUP set after a reconnect.
+};
+
 #define MQTT_CALLBACK_SIGNATURE void (*callback) (std::string, std::string)
 
+// Receives the payload of a message longer than MQTT_MAX_PACKET_SIZE in pieces:
+// topic, data, length of the data, offset of the data in the payload, length of the payload.
+#define MQTT_STREAM_CALLBACK_SIGNATURE void (*streamCallback) (std::string, const uint8_t*, size_t, size_t, size_t)
+
 class PubSubClientTask;
 
-class PubSubClient {
+class PubSubClient: private PubSubClientDecoder::Handler {
 public:
    PubSubClient();
    PubSubClient(Socket& client);
@@ -121,6 +147,9 @@ public:
    PubSubClient& setServer(std::string ip, uint16_t port);
    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE);
    PubSubClient& setClient(Socket& client);
+   PubSubClient& setInflightWindow(uint8_t window);
+   PubSubClient& setQueue(PubSubClientQueue* queue);
+   PubSubClient& setStreamCallback(MQTT_STREAM_CALLBACK_SIGNATURE);
 
    bool connect(const char* id);
    bool connect(const char* id, const char* user, const char* pass);
@@ -132,6 +161,7 @@ public:
    bool publish(const char* topic, const char* payload, bool retained);
    bool publish(const char* topic, const uint8_t* payload, unsigned int plength);
    bool publish(const char* topic, const uint8_t* payload, unsigned int plength, bool retained);
+   bool publish(const char* topic, const uint8_t* payload, unsigned int plength, bool retained, mqtt_qos qos);
    //bool publish_P(const char* topic, const uint8_t * payload, unsigned int plength, bool retained);
 
    bool subscribe(const char* topic, bool ack = false);
@@ -140,6 +170,8 @@ public:
    bool isUnsubscribeDone();
 
    bool connected();
+   size_t getInflightCount();
+   size_t getQueuedCount();
    int state();
    void keepAliveChecker();
    void timeoutChecker();
@@ -147,23 +179,55 @@ public:
 private:
    friend class 	PubSubClientTask;
    PubSubClientTask* m_task;
+   bool 			m_taskStarted;  // The task outlives connections, waiting while disconnected.
    Socket* 			_client;
    mqtt_InitTypeDef _config;
    mqtt_state 		_state;
    uint8_t 			buffer[MQTT_MAX_PACKET_SIZE];
+   uint8_t 			_readBuffer[MQTT_READ_BUFFER_SIZE];
+   PubSubClientDecoder _decoder = PubSubClientDecoder(this, MQTT_MAX_PACKET_SIZE);
+   bool 			_connackReceived;
+   uint8_t 			_connackCode;
+   std::string 		_streamTopic;   // The long message being received.
+   uint8_t 			_streamQos;
+   uint16_t 		_streamMsgId;
+   size_t 			_streamOffset;
+   size_t 			_streamLength;
    uint16_t 		nextMsgId;
    bool 			PING_outstanding;
    bool 			SUBACK_outstanding;
    bool 			UNSUBACK_Outstanding;
    FreeRTOSTimer* 	keepAliveTimer;
    FreeRTOSTimer* 	timeoutTimer;
+   std::deque<mqtt_inflight> _inflight;
+   uint8_t 			_inflightWindow;
+   PubSubClientQueue* _queue;
+   pthread_mutex_t 	_lock;          // Guards the in-flight messages, the queue and the outgoing packets.
+   std::string 		_outgoing;      // Packets built but not yet sent, in the order they were built.
+   bool 			_sending;       // A task is sending the outgoing packets.
 
    MQTT_CALLBACK_SIGNATURE;
+   MQTT_STREAM_CALLBACK_SIGNATURE;
    void setup();
-   size_t readPacket();
+   void acknowledge(uint8_t type, uint16_t msgId);
+   uint16_t allocateMsgId();
+   void drainQueue();
+   std::string preparePublish(const std::string& record);
+   void retransmit();
+   bool flush();
+   void queuePacket(const std::string& packet);
+   bool sendPacket(const std::string& packet);
+   bool writePackets(const std::string& packets);
+   static std::string encodePacket(uint8_t header, const std::string& body);
+   bool receivePackets();
+   void onPacket(uint8_t header, const uint8_t* data, size_t length);
+   void onPublishStart(uint8_t header, const std::string& topic, uint16_t msgId, size_t payloadLength);
+   void onPublishData(const uint8_t* data, size_t length);
+   void onPublishEnd();
+   void sendAck(uint8_t type, uint16_t msgId);
    bool write(uint8_t header, uint8_t* buf, uint16_t length);
    uint16_t writeString(const char* string, uint8_t* buf, uint16_t pos);
-   void parseData(mqtt_message* msg, uint16_t len);
+   bool parseData(mqtt_message* msg, uint8_t header, const uint8_t* data, size_t length);
    void dumpData(mqtt_message* msg);
    std::string messageType_toString(uint8_t type);
 
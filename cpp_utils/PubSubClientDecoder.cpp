@@ -0,0 +1,176 @@
+/*
+ * PubSubClientDecoder.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <esp_log.h>
+#include "PubSubClientDecoder.h"
+
+static const char* LOG_TAG = "PubSubClientDecoder";
+
+static const uint8_t PUBLISH_TYPE = 3 << 4;
+
+
+PubSubClientDecoder::Handler::~Handler() {
+} // ~Handler
+
+
+/**
+ * @brief Create a decoder.
+ * @param [in] pHandler Receives the packets decoded.
+ * @param [in] maxPacketSize The longest packet, after its fixed header, that is handed over whole.
+ */
+PubSubClientDecoder::PubSubClientDecoder(Handler* pHandler, size_t maxPacketSize) {
+	m_pHandler      = pHandler;
+	m_maxPacketSize = maxPacketSize;
+	reset();
+} // PubSubClientDecoder
+
+
+/**
+ * @brief The remaining length of a packet has been read; decide how the rest of it is to be handled.
+ */
+void PubSubClientDecoder::endLength() {
+	if (m_remaining == 0) {
+		m_pHandler->onPacket(m_header, nullptr, 0);
+		m_state = STATE_HEADER;
+	} else if (m_remaining <= m_maxPacketSize) {
+		m_state = STATE_BODY;
+	} else if ((m_header & 0xF0) == PUBLISH_TYPE) {
+		m_state = STATE_PUBLISH_HEADER;
+	} else {
+		ESP_LOGD(LOG_TAG, "Skipping packet of type %d and length %d", m_header >> 4, m_remaining);
+		m_state = STATE_SKIP;
+	}
+} // endLength
+
+
+/**
+ * @brief Decode the data received.
+ * @param [in] data The data.
+ * @param [in] length The length of the data.
+ * @return False if the data is not a valid stream of MQTT packets.  The decoder must then be reset.
+ */
+bool PubSubClientDecoder::feed(const uint8_t* data, size_t length) {
+	const uint8_t* end = data + length;
+	while (data < end) {
+		size_t available = end - data;
+		switch (m_state) {
+			case STATE_HEADER: {
+				m_header     = *data++;
+				m_remaining  = 0;
+				m_multiplier = 1;
+				m_state      = STATE_LENGTH;
+				break;
+			}
+
+			case STATE_LENGTH: {
+				uint8_t digit = *data++;
+				m_remaining += (digit & 0x7F) * m_multiplier;
+				if ((digit & 0x80) == 0) {
+					endLength();
+				} else if (m_multiplier == 128 * 128 * 128) {
+					ESP_LOGE(LOG_TAG, "Remaining length is longer than four bytes");
+					return false;
+				} else {
+					m_multiplier *= 128;
+				}
+				break;
+			}
+
+			case STATE_BODY: {
+				if (m_packet.empty() && available >= m_remaining) {
+					// The whole packet is here; hand it over without copying it.
+					m_pHandler->onPacket(m_header, data, m_remaining);
+					data   += m_remaining;
+					m_state = STATE_HEADER;
+					break;
+				}
+				size_t count = available < m_remaining - m_packet.length() ? available : m_remaining - m_packet.length();
+				m_packet.append((const char*) data, count);
+				data += count;
+				if (m_packet.length() == m_remaining) {
+					m_pHandler->onPacket(m_header, (const uint8_t*) m_packet.data(), m_packet.length());
+					m_packet.clear();
+					m_state = STATE_HEADER;
+				}
+				break;
+			}
+
+			case STATE_PUBLISH_HEADER: {
+				m_packet.push_back((char) *data++);
+				if (!publishHeader()) return false;
+				break;
+			}
+
+			case STATE_PUBLISH_DATA: {
+				size_t count = available < m_remaining ? available : m_remaining;
+				if (count > 0) {
+					m_pHandler->onPublishData(data, count);
+					data        += count;
+					m_remaining -= count;
+				}
+				if (m_remaining == 0) {
+					m_pHandler->onPublishEnd();
+					m_state = STATE_HEADER;
+				}
+				break;
+			}
+
+			case STATE_SKIP: {
+				size_t count = available < m_remaining ? available : m_remaining;
+				data        += count;
+				m_remaining -= count;
+				if (m_remaining == 0) {
+					m_state = STATE_HEADER;
+				}
+				break;
+			}
+		}
+	}
+	return true;
+} // feed
+
+
+/**
+ * @brief Check whether the topic and message id of a long PUBLISH have been gathered and if so start
+ * passing on its payload.
+ * @return False if the packet is malformed.
+ */
+bool PubSubClientDecoder::publishHeader() {
+	size_t gathered = m_packet.length();
+	if (gathered < 2) return true;
+	size_t topicLength  = (uint8_t) m_packet[0] << 8 | (uint8_t) m_packet[1];
+	size_t headerLength = 2 + topicLength + ((m_header & 0x06) != 0 ? 2 : 0);
+	if (headerLength > m_remaining || headerLength > m_maxPacketSize) {
+		ESP_LOGE(LOG_TAG, "PUBLISH topic of %d bytes is too long", topicLength);
+		return false;
+	}
+	if (gathered < headerLength) return true;
+
+	uint16_t msgId = 0;
+	if ((m_header & 0x06) != 0) {
+		msgId = (uint8_t) m_packet[2 + topicLength] << 8 | (uint8_t) m_packet[3 + topicLength];
+	}
+	m_remaining -= headerLength;
+	m_pHandler->onPublishStart(m_header, m_packet.substr(2, topicLength), msgId, m_remaining);
+	m_packet.clear();
+	m_state = STATE_PUBLISH_DATA;
+	if (m_remaining == 0) {
+		m_pHandler->onPublishEnd();
+		m_state = STATE_HEADER;
+	}
+	return true;
+} // publishHeader
+
+
+/**
+ * @brief Forget any packet partly decoded, such as when a new connection is made.
+ */
+void PubSubClientDecoder::reset() {
+	m_state      = STATE_HEADER;
+	m_header     = 0;
+	m_remaining  = 0;
+	m_multiplier = 1;
+	m_packet.clear();
+} // reset
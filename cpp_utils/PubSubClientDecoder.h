@@ -0,0 +1,65 @@
+/*
+ * PubSubClientDecoder.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_PUBSUBCLIENTDECODER_H_
+#define COMPONENTS_CPP_UTILS_PUBSUBCLIENTDECODER_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/**
+ * @brief An incremental decoder of the MQTT packets received from a server.
+ *
+ * The bytes received are fed in as they arrive, in pieces of any size: a packet may be split over several
+ * reads and one read may hold several packets.  Each packet no longer than the maximum packet size is
+ * handed over whole, straight from the data fed in when it is all there and otherwise from a copy
+ * gathered over several reads.  A longer PUBLISH is handed over as its topic followed by its payload in
+ * pieces as they arrive, so a payload of any size passes through without being held in memory.  Other
+ * packets that are too long are skipped.
+ */
+class PubSubClientDecoder {
+public:
+	/**
+	 * @brief Receives the packets decoded.
+	 */
+	class Handler {
+	public:
+		virtual ~Handler();
+		virtual void onPacket(uint8_t header, const uint8_t* data, size_t length) = 0;  // A whole packet after its fixed header.
+		virtual void onPublishStart(uint8_t header, const std::string& topic, uint16_t msgId, size_t payloadLength) = 0;
+		virtual void onPublishData(const uint8_t* data, size_t length) = 0;
+		virtual void onPublishEnd() = 0;
+	};
+
+	PubSubClientDecoder(Handler* pHandler, size_t maxPacketSize);
+
+	bool feed(const uint8_t* data, size_t length);
+	void reset();
+
+private:
+	enum State {
+		STATE_HEADER,           // Waiting for the first byte of the fixed header.
+		STATE_LENGTH,           // Reading the remaining length.
+		STATE_BODY,             // Gathering a packet to be handed over whole.
+		STATE_PUBLISH_HEADER,   // Gathering the topic and message id of a long PUBLISH.
+		STATE_PUBLISH_DATA,     // Passing on the payload of a long PUBLISH.
+		STATE_SKIP              // Discarding a long packet.
+	};
+
+	Handler*    m_pHandler;
+	size_t      m_maxPacketSize;
+	State       m_state;
+	uint8_t     m_header;
+	uint32_t    m_remaining;     // Bytes of the packet after the fixed header not yet consumed.
+	uint32_t    m_multiplier;    // Of the next byte of the remaining length.
+	std::string m_packet;        // The part of the packet gathered so far.
+
+	void endLength();
+	bool publishHeader();
+
+}; // PubSubClientDecoder
+
+#endif /* COMPONENTS_CPP_UTILS_PUBSUBCLIENTDECODER_H_ */
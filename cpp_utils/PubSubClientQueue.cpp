@@ -0,0 +1,222 @@
+/*
+ * PubSubClientQueue.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <string.h>
+#include <esp_log.h>
+#include "PubSubClientQueue.h"
+
+static const char* LOG_TAG = "PubSubClientQueue";
+
+static const char* KEY_HEAD  = "head";
+static const char* KEY_COUNT = "count";
+
+
+PubSubClientQueue::PubSubClientQueue() {
+	m_dropCount = 0;
+} // PubSubClientQueue
+
+
+PubSubClientQueue::~PubSubClientQueue() {
+} // ~PubSubClientQueue
+
+
+uint32_t PubSubClientQueue::getDropCount() {
+	return m_dropCount;
+} // getDropCount
+
+
+/**
+ * @brief Create a queue in RAM.
+ * @param [in] capacity The size of the ring buffer in bytes.
+ */
+PubSubClientRAMQueue::PubSubClientRAMQueue(size_t capacity) {
+	m_buffer   = new uint8_t[capacity];
+	m_capacity = capacity;
+	m_head     = 0;
+	m_used     = 0;
+	m_count    = 0;
+} // PubSubClientRAMQueue
+
+
+PubSubClientRAMQueue::~PubSubClientRAMQueue() {
+	delete[] m_buffer;
+} // ~PubSubClientRAMQueue
+
+
+/**
+ * @brief Get the oldest record.
+ * @param [out] pRecord The record.
+ * @return False if the queue is empty.
+ */
+bool PubSubClientRAMQueue::front(std::string* pRecord) {
+	if (m_count == 0) return false;
+	uint8_t length[2];
+	read(m_head, length, sizeof(length));
+	pRecord->resize(length[0] << 8 | length[1]);
+	read(m_head + sizeof(length), (uint8_t*) &(*pRecord)[0], pRecord->length());
+	return true;
+} // front
+
+
+/**
+ * @brief Remove the oldest record.
+ */
+void PubSubClientRAMQueue::pop() {
+	if (m_count == 0) return;
+	uint8_t length[2];
+	read(m_head, length, sizeof(length));
+	size_t size = sizeof(length) + (length[0] << 8 | length[1]);
+	m_head  = (m_head + size) % m_capacity;
+	m_used -= size;
+	m_count--;
+} // pop
+
+
+/**
+ * @brief Add a record, dropping the oldest ones if there is no room for it.
+ * @param [in] record The record.
+ * @return False if the record is larger than the whole buffer.
+ */
+bool PubSubClientRAMQueue::push(const std::string& record) {
+	size_t size = 2 + record.length();
+	if (record.length() > 0xffff || size > m_capacity) {
+		ESP_LOGE(LOG_TAG, "Record of %d bytes is too large for the queue", record.length());
+		return false;
+	}
+	while (m_capacity - m_used < size) {
+		pop();
+		m_dropCount++;
+	}
+	size_t tail = (m_head + m_used) % m_capacity;
+	uint8_t length[2] = { (uint8_t) (record.length() >> 8), (uint8_t) (record.length() & 0xff) };
+	write(tail, length, sizeof(length));
+	write(tail + sizeof(length), (const uint8_t*) record.data(), record.length());
+	m_used += size;
+	m_count++;
+	return true;
+} // push
+
+
+/**
+ * @brief Copy data out of the ring buffer, wrapping at its end.
+ */
+void PubSubClientRAMQueue::read(size_t offset, uint8_t* pData, size_t length) {
+	offset %= m_capacity;
+	size_t first = m_capacity - offset;
+	if (first > length) first = length;
+	::memcpy(pData, m_buffer + offset, first);
+	::memcpy(pData + first, m_buffer, length - first);
+} // read
+
+
+size_t PubSubClientRAMQueue::size() {
+	return m_count;
+} // size
+
+
+/**
+ * @brief Copy data into the ring buffer, wrapping at its end.
+ */
+void PubSubClientRAMQueue::write(size_t offset, const uint8_t* pData, size_t length) {
+	offset %= m_capacity;
+	size_t first = m_capacity - offset;
+	if (first > length) first = length;
+	::memcpy(m_buffer + offset, pData, first);
+	::memcpy(m_buffer, pData + first, length - first);
+} // write
+
+
+/**
+ * @brief Open a queue in flash.
+ * Records queued before a restart are still there.
+ * @param [in] name The %NVS namespace of the queue, no longer than 15 characters.
+ * @param [in] capacity The most records held.
+ */
+PubSubClientNVSQueue::PubSubClientNVSQueue(std::string name, uint32_t capacity) : m_nvs(name) {
+	m_capacity = capacity;
+	m_head     = 0;
+	m_count    = 0;
+	uint32_t head;
+	uint32_t count;
+	if (m_nvs.get(KEY_HEAD, head) == ESP_OK && m_nvs.get(KEY_COUNT, count) == ESP_OK && head < capacity && count <= capacity) {
+		m_head  = head;
+		m_count = count;
+		ESP_LOGD(LOG_TAG, "%d records queued in %s", m_count, name.c_str());
+	}
+} // PubSubClientNVSQueue
+
+
+/**
+ * @brief Get the oldest record.
+ * A record that can't be read is skipped.
+ * @param [out] pRecord The record.
+ * @return False if the queue is empty.
+ */
+bool PubSubClientNVSQueue::front(std::string* pRecord) {
+	while (m_count > 0) {
+		if (m_nvs.get(getKey(m_head), pRecord, true) == ESP_OK) return true;
+		ESP_LOGE(LOG_TAG, "Queued record %d is missing", m_head);
+		removeFront();
+		saveState();
+	}
+	return false;
+} // front
+
+
+std::string PubSubClientNVSQueue::getKey(uint32_t slot) {
+	return "m" + std::to_string(slot);
+} // getKey
+
+
+/**
+ * @brief Remove the oldest record.
+ */
+void PubSubClientNVSQueue::pop() {
+	if (m_count == 0) return;
+	removeFront();
+	saveState();
+} // pop
+
+
+/**
+ * @brief Add a record, dropping the oldest one if the queue is full.
+ * @param [in] record The record.
+ * @return True, the record is queued.
+ */
+bool PubSubClientNVSQueue::push(const std::string& record) {
+	if (m_count == m_capacity) {
+		removeFront();
+		m_dropCount++;
+	}
+	m_nvs.set(getKey((m_head + m_count) % m_capacity), record, true);
+	m_count++;
+	saveState();
+	return true;
+} // push
+
+
+/**
+ * @brief Forget the oldest record, without saving the state of the ring.
+ */
+void PubSubClientNVSQueue::removeFront() {
+	m_nvs.erase(getKey(m_head));
+	m_head = (m_head + 1) % m_capacity;
+	m_count--;
+} // removeFront
+
+
+/**
+ * @brief Save the head and count of the ring and commit everything written.
+ */
+void PubSubClientNVSQueue::saveState() {
+	m_nvs.set(KEY_HEAD, m_head);
+	m_nvs.set(KEY_COUNT, m_count);
+	m_nvs.commit();
+} // saveState
+
+
+size_t PubSubClientNVSQueue::size() {
+	return m_count;
+} // size
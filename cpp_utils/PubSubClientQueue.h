@@ -0,0 +1,96 @@
+/*
+ * PubSubClientQueue.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_PUBSUBCLIENTQUEUE_H_
+#define COMPONENTS_CPP_UTILS_PUBSUBCLIENTQUEUE_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include "CPPNVS.h"
+
+/**
+ * @brief A store-and-forward queue of messages published while a PubSubClient can't send them.
+ *
+ * Messages are queued as opaque records in the order they were published and sent, oldest first, once the
+ * client can send them again.  When the queue is full the oldest record is dropped to make room, so a long
+ * outage keeps the most recent messages.  The client serializes its use of the queue.
+ */
+class PubSubClientQueue {
+public:
+	virtual ~PubSubClientQueue();
+
+	virtual bool   front(std::string* pRecord) = 0;   // Get the oldest record, if there is one.
+	virtual void   pop() = 0;                         // Remove the oldest record.
+	virtual bool   push(const std::string& record) = 0;
+	virtual size_t size() = 0;                        // Number of records queued.
+
+	uint32_t getDropCount();    // Number of records dropped because the queue was full.
+
+protected:
+	PubSubClientQueue();
+	uint32_t m_dropCount;
+
+}; // PubSubClientQueue
+
+
+/**
+ * @brief A queue held in a ring buffer in RAM.
+ * Each record takes its length plus two bytes of the buffer.
+ */
+class PubSubClientRAMQueue: public PubSubClientQueue {
+public:
+	PubSubClientRAMQueue(size_t capacity);
+	virtual ~PubSubClientRAMQueue();
+
+	bool   front(std::string* pRecord);
+	void   pop();
+	bool   push(const std::string& record);
+	size_t size();
+
+private:
+	uint8_t* m_buffer;
+	size_t   m_capacity;
+	size_t   m_head;       // Offset of the oldest record.
+	size_t   m_used;       // Bytes of the buffer in use.
+	size_t   m_count;      // Number of records.
+
+	void read(size_t offset, uint8_t* pData, size_t length);
+	void write(size_t offset, const uint8_t* pData, size_t length);
+
+	PubSubClientRAMQueue(const PubSubClientRAMQueue&);             // Not copyable, we own the buffer.
+	PubSubClientRAMQueue& operator=(const PubSubClientRAMQueue&);
+
+}; // PubSubClientRAMQueue
+
+
+/**
+ * @brief A queue held in flash, in an %NVS namespace of its own, which survives a restart.
+ * Each record is a blob in a ring of slots; the ring's head and count are kept with them.  %NVS spreads
+ * the writes over its pages, but every record queued and sent still costs a few flash writes, so this
+ * suits messages that are published occasionally rather than streams of them.
+ */
+class PubSubClientNVSQueue: public PubSubClientQueue {
+public:
+	PubSubClientNVSQueue(std::string name, uint32_t capacity);
+
+	bool   front(std::string* pRecord);
+	void   pop();
+	bool   push(const std::string& record);
+	size_t size();
+
+private:
+	NVS      m_nvs;
+	uint32_t m_capacity;   // Number of slots.
+	uint32_t m_head;       // Slot of the oldest record.
+	uint32_t m_count;      // Number of records.
+
+	static std::string getKey(uint32_t slot);
+	void removeFront();
+	void saveState();
+
+}; // PubSubClientNVSQueue
+
+#endif /* COMPONENTS_CPP_UTILS_PUBSUBCLIENTQUEUE_H_ */
@@ -3,6 +3,10 @@
  *
  * See also:
  * * https://tools.ietf.org/html/rfc1350
+ * * https://tools.ietf.org/html/rfc2347 - Option extension
+ * * https://tools.ietf.org/html/rfc2348 - Blocksize option
+ * * https://tools.ietf.org/html/rfc2349 - Timeout option
+ * * https://tools.ietf.org/html/rfc7440 - Windowsize option
  *  Created on: May 21, 2017
  *      Author: kolban
  */
@@ -15,6 +19,8 @@
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
+#include <stdlib.h>
+#include <algorithm>
 #include "Socket.h"
 
 #include "sdkconfig.h"
@@ -33,7 +39,8 @@ enum opcode {
 	TFTP_OPCODE_WRQ   = 2, // Write request
 	TFTP_OPCODE_DATA  = 3, // Data
 	TFTP_OPCODE_ACK   = 4, // Acknowledgement
-	TFTP_OPCODE_ERROR = 5  // Error
+	TFTP_OPCODE_ERROR = 5, // Error
+	TFTP_OPCODE_OACK  = 6  // Option acknowledgement
 };
 
 enum ERRORCODE {
@@ -44,14 +51,60 @@ enum ERRORCODE {
 	ERROR_CODE_ILLEGAL_OPERATION = 4,
 	ERROR_CODE_UNKNOWN_ID        = 5,
 	ERROR_CODE_FILE_EXISTS       = 6,
-	ERROR_CODE_UNKNOWN_USER      = 7
+	ERROR_CODE_UNKNOWN_USER      = 7,
+	ERROR_CODE_OPTION            = 8
 };
 
 /**
- * Size of the TFTP data payload.
+ * Size of the TFTP data payload, unless a client negotiates another.
  */
 const int TFTP_DATA_SIZE = 512;
 
+/**
+ * Largest block size allowed by default: the largest that fits an Ethernet frame without fragmenting.
+ */
+const uint16_t TFTP_MAX_BLOCK_SIZE = 1468;
+
+/**
+ * Largest window allowed by default.  Blocks in flight are re-read from the file when they must be sent
+ * again, so a window costs no memory; this bounds the burst of datagrams handed to the network stack.
+ */
+const uint16_t TFTP_MAX_WINDOW_SIZE = 16;
+
+/**
+ * Milliseconds to wait for the partner before retransmitting, unless a client negotiates another.
+ */
+const uint32_t TFTP_TIMEOUT = 1000;
+
+/**
+ * Number of retransmissions without progress before a transfer is abandoned.
+ */
+const int TFTP_MAX_RETRIES = 5;
+
+/**
+ * Results of waitForAck and receivePacket other than a block number or a length.
+ */
+const int TFTP_TIMEOUT_EXPIRED = -1; // Nothing was received before the timeout.
+const int TFTP_FAILED          = -2; // The partner sent an error or something unexpected.
+
+/**
+ * Number of transfers that may run at once unless set otherwise.
+ */
+const size_t TFTP_MAX_TRANSACTIONS = 4;
+
+/**
+ * Stack size of the task that runs a transfer.
+ */
+const uint32_t TFTP_TASK_STACK_SIZE = 8 * 1024;
+
+/**
+ * What a transfer's task is started with.
+ */
+struct TransactionTaskParam {
+	TFTP*                   pTFTP;
+	TFTP::TFTP_Transaction* pTransaction;
+};
+
 struct data_packet {
 	uint16_t blockNumber;
 	std::string data;
@@ -60,12 +113,27 @@ struct data_packet {
 
 
 TFTP::TFTP() {
-	m_baseDir = "";
+	m_baseDir         = "";
+	m_maxBlockSize    = TFTP_MAX_BLOCK_SIZE;
+	m_maxWindowSize   = TFTP_MAX_WINDOW_SIZE;
+	m_maxTransactions = TFTP_MAX_TRANSACTIONS;
+	m_activeCount     = 0;
+	::pthread_mutex_init(&m_lock, nullptr);
 }
 
 TFTP::~TFTP() {
+	::pthread_mutex_destroy(&m_lock);
 }
 
+
+/**
+ * @brief Get the throughput of a transfer.
+ * @return The bytes transferred per second.
+ */
+uint32_t TFTP::TransferStats::getThroughput() const {
+	return (uint64_t) bytes * 1000 / (duration == 0 ? 1 : duration);
+} // getThroughput
+
 /**
  * @brief Start a TFTP transaction.
  * @return N/A.
@@ -75,9 +143,95 @@ TFTP::TFTP_Transaction::TFTP_Transaction() {
 	m_filename = "";
 	m_mode     = "";
 	m_opCode   = -1;
+	m_maxBlockSize  = TFTP_MAX_BLOCK_SIZE;
+	m_maxWindowSize = TFTP_MAX_WINDOW_SIZE;
+	m_blockSize     = TFTP_DATA_SIZE;
+	m_windowSize    = 1;
+	m_timeout       = TFTP_TIMEOUT;
+	m_startTime     = 0;
+	m_stats.write           = false;
+	m_stats.success         = false;
+	m_stats.bytes           = 0;
+	m_stats.duration        = 0;
+	m_stats.retransmissions = 0;
+	m_stats.blockSize       = TFTP_DATA_SIZE;
+	m_stats.windowSize      = 1;
 } // TFTP_Transaction
 
 
+TFTP::TFTP_Transaction::~TFTP_Transaction() {
+	m_partnerSocket.close();
+} // ~TFTP_Transaction
+
+
+/**
+ * @brief Acknowledge the blocks received up to and including the given one.
+ * Before any data has arrived, the acknowledgment of a request with options is the option acknowledgment.
+ * Once the block number has rolled over block 0 is a data block like any other and gets a plain acknowledgment.
+ * @param [in] blockNumber The last block received.
+ * @param [in] dataReceived Whether any data block has been received.
+ * @return N/A.
+ */
+void TFTP::TFTP_Transaction::acknowledge(uint16_t blockNumber, bool dataReceived) {
+	if (!dataReceived && !m_options.empty()) {
+		sendOptionAck();
+	} else {
+		sendAck(blockNumber);
+	}
+} // acknowledge
+
+
+/**
+ * @brief Complete the statistics of the transfer and log them.
+ * @param [in] success True if the whole file was transferred.
+ * @return N/A.
+ */
+void TFTP::TFTP_Transaction::endStats(bool success) {
+	m_stats.success    = success;
+	m_stats.duration   = FreeRTOS::getTimeSinceStart() - m_startTime;
+	m_stats.blockSize  = m_blockSize;
+	m_stats.windowSize = m_windowSize;
+	ESP_LOGI(LOG_TAG, "%s %s %s: %d bytes in %d ms (%d bytes/s), %d retransmissions",
+		success ? "Completed" : "Failed", m_stats.write ? "write of" : "read of", m_stats.filename.c_str(),
+		m_stats.bytes, m_stats.duration, m_stats.getThroughput(), m_stats.retransmissions);
+} // endStats
+
+
+/**
+ * @brief Get the statistics of the transfer.
+ * They are complete once processRRQ() or processWRQ() has returned.
+ */
+const TFTP::TransferStats& TFTP::TFTP_Transaction::getStats() {
+	return m_stats;
+} // getStats
+
+
+/**
+ * @brief Accept or decline an option of a request.
+ * Options that are accepted are kept for the option acknowledgment; others are ignored, which declines them.
+ * @param [in] name The name of the option, in lower case.
+ * @param [in] value The value requested.
+ * @return N/A.
+ */
+void TFTP::TFTP_Transaction::parseOption(std::string name, std::string value) {
+	long requested = ::strtol(value.c_str(), nullptr, 10);
+	if (name == "blksize" && requested >= 8 && requested <= 65464) {
+		// We may answer with a smaller block size than the one asked for.
+		m_blockSize = std::min((long) m_maxBlockSize, requested);
+		m_options.push_back(std::make_pair(name, std::to_string(m_blockSize)));
+	} else if (name == "windowsize" && requested >= 1 && requested <= 65535) {
+		m_windowSize = std::min((long) m_maxWindowSize, requested);
+		m_options.push_back(std::make_pair(name, std::to_string(m_windowSize)));
+	} else if (name == "timeout" && requested >= 1 && requested <= 255) {
+		// The timeout must be accepted as it is or not at all.
+		m_timeout = requested * 1000;
+		m_options.push_back(std::make_pair(name, value));
+	} else {
+		ESP_LOGD(LOG_TAG, "Declining option %s=%s", name.c_str(), value.c_str());
+	}
+} // parseOption
+
+
 /**
  * @brief Process a client read request.
  * @return N/A.
@@ -105,41 +259,118 @@ void TFTP::TFTP_Transaction::processRRQ() {
 	int length = buf.st_size;
 	*/
 
-	int blockNumber = 1;
-
 	file = fopen(tmpName.c_str(), "r");
 	if (file == nullptr) {
 		ESP_LOGE(LOG_TAG, "Failed to open file for reading: %s: %s", tmpName.c_str(), strerror(errno));
 		sendError(ERROR_CODE_FILE_NOT_FOUND, tmpName);
+		m_partnerSocket.close();
+		endStats(false);
 		return;
 	}
+	setReceiveTimeout();
+
+	// With options, the client acknowledges our option acknowledgment as block 0 before data is sent.
+	int retries = 0;
+	while (!m_options.empty()) {
+		sendOptionAck();
+		int ack = waitForAck();
+		if (ack == 0) break;
+		if (ack == TFTP_FAILED || ++retries > TFTP_MAX_RETRIES) {
+			ESP_LOGE(LOG_TAG, "Option acknowledgment not acknowledged");
+			fclose(file);
+			m_partnerSocket.close();
+			endStats(false);
+			return;
+		}
+	}
 
-	struct {
-		uint16_t opCode;
-		uint16_t blockNumber;
-		uint8_t buf[TFTP_DATA_SIZE];
-	} record;
-
-	record.opCode = htons(TFTP_OPCODE_DATA); // Set the op code to be DATA.
+	std::vector<uint8_t> record(4 + m_blockSize);
+	*(uint16_t*) &record[0] = htons(TFTP_OPCODE_DATA); // Set the op code to be DATA.
 
+	/*
+	 * Blocks are counted from 1 in 32 bits; on the wire the block number is the low 16 bits, so it rolls over
+	 * to 0 on long transfers.  Up to a window of blocks is sent ahead of the last one acknowledged.  When the
+	 * client acknowledges a block before the last one sent it has lost the next one, and when nothing new is
+	 * acknowledged within the timeout either a block or the acknowledgment was lost; both times we go back and
+	 * send again from the first block not acknowledged, re-reading it from the file.  The client also tells us
+	 * it lost the first block of the window by acknowledging the block before it again, so with a window a
+	 * duplicate acknowledgment has us go back, but only once until there is progress: going back on every
+	 * duplicate would have every later block sent twice (the Sorcerer's Apprentice problem).
+	 */
+	uint32_t windowStart = 1; // The first block not acknowledged.
+	uint32_t nextBlock   = 1; // The next block to send.
+	uint32_t fileBlock   = 1; // The block the file is positioned at.
+	uint32_t lastBlock   = 0; // The final block, once it has been read.
+	uint32_t sentTime    = FreeRTOS::getTimeSinceStart(); // When we last made progress or went back.
+	bool     wentBack    = false; // Whether we went back on a duplicate acknowledgment since the last progress.
+	uint32_t highestSent = 0; // The last block sent, not counting those sent again.
+	retries = 0;
 	while (!finished) {
-		record.blockNumber = htons(blockNumber);
-
-		int sizeRead = fread(record.buf, 1, TFTP_DATA_SIZE, file);
+		while (nextBlock < windowStart + m_windowSize && (lastBlock == 0 || nextBlock <= lastBlock)) {
+			if (fileBlock != nextBlock) {
+				fseek(file, (long) (nextBlock - 1) * m_blockSize, SEEK_SET);
+				fileBlock = nextBlock;
+			}
+			int sizeRead = fread(&record[4], 1, m_blockSize, file);
+			fileBlock++;
+			if (sizeRead < m_blockSize) {
+				lastBlock = nextBlock;
+			}
+			*(uint16_t*) &record[2] = htons((uint16_t) nextBlock);
 
-		ESP_LOGD(LOG_TAG, "Sending data to %s, blockNumber=%d, size=%d",
-				Socket::addressToString(&m_partnerAddress).c_str(), blockNumber, sizeRead);
+			ESP_LOGD(LOG_TAG, "Sending data to %s, blockNumber=%d, size=%d",
+					Socket::addressToString(&m_partnerAddress).c_str(), nextBlock, sizeRead);
 
-		m_partnerSocket.sendTo((uint8_t*) &record, sizeRead + 4, &m_partnerAddress);
+			m_partnerSocket.sendTo(record.data(), sizeRead + 4, &m_partnerAddress);
+			if (nextBlock > highestSent) {
+				highestSent = nextBlock;
+				m_stats.bytes += sizeRead;
+			} else {
+				m_stats.retransmissions++;
+			}
+			nextBlock++;
+		}
 
+		int ack = waitForAck();
+		if (ack == TFTP_FAILED) break;
+		if (ack != TFTP_TIMEOUT_EXPIRED) {
+			// Map the 16 bit block number onto the blocks sent; an older acknowledgment maps past them.
+			uint32_t acked = windowStart - 1 + (uint16_t) (ack - (windowStart - 1));
+			if (acked >= windowStart && acked < nextBlock) {
+				windowStart = acked + 1;
+				sentTime    = FreeRTOS::getTimeSinceStart();
+				retries     = 0;
+				wentBack    = false;
+				if (acked == lastBlock) {
+					finished = true;
+				} else if (acked < nextBlock - 1) {
+					ESP_LOGD(LOG_TAG, "Block %d was lost, resending from it", acked + 1);
+					nextBlock = acked + 1;
+				}
+				continue;
+			}
+			if (acked == windowStart - 1 && m_windowSize > 1 && !wentBack) {
+				ESP_LOGD(LOG_TAG, "Block %d was lost, resending from it", windowStart);
+				nextBlock = windowStart;
+				wentBack  = true;
+				continue;
+			}
+			ESP_LOGD(LOG_TAG, "Ignoring duplicate acknowledgment of block %d", ack);
+			if (FreeRTOS::getTimeSinceStart() - sentTime < m_timeout) continue;
+		}
 
-		if (sizeRead < TFTP_DATA_SIZE) {
-			finished = true;
-		} else {
-			waitForAck(blockNumber);
+		if (++retries > TFTP_MAX_RETRIES) {
+			ESP_LOGE(LOG_TAG, "Timed out waiting for block %d to be acknowledged", windowStart);
+			sendError(ERROR_CODE_NOTDEFINED, "Timed out");
+			break;
 		}
-		blockNumber++; // Increment the block number.
+		ESP_LOGD(LOG_TAG, "Timeout, resending from block %d", windowStart);
+		nextBlock = windowStart;
+		sentTime  = FreeRTOS::getTimeSinceStart();
 	}
+	fclose(file);
+	m_partnerSocket.close();
+	endStats(finished);
 	ESP_LOGD(LOG_TAG, "File sent");
 } // processRRQ
 
@@ -156,14 +387,6 @@ void TFTP::TFTP_Transaction::processWRQ() {
  *        ---------------------------------
  * The opcode for data is 0x03 - TFTP_OPCODE_DATA
  */
-	struct recv_data {
-		uint16_t opCode;
-		uint16_t blockNumber;
-		uint8_t  data;
-	} *pRecv_data;
-
-	struct sockaddr recvAddr;
-	uint8_t dataBuffer[TFTP_DATA_SIZE + 2 + 2];
 	bool finished = false;
 
 	FILE* file;
@@ -173,29 +396,134 @@ void TFTP::TFTP_Transaction::processWRQ() {
 	file = fopen(tmpName.c_str(), "w");
 	if (file == nullptr) {
 		ESP_LOGE(LOG_TAG, "Failed to open file for writing: %s: %s", tmpName.c_str(), strerror(errno));
+		sendError(ERROR_CODE_ACCESS_VIOLATION, tmpName);
+		m_partnerSocket.close();
+		endStats(false);
 		return;
 	}
-	while(!finished) {
-		pRecv_data = (struct recv_data*) dataBuffer;
-		int receivedSize = m_partnerSocket.receiveFrom(dataBuffer, sizeof(dataBuffer), &recvAddr);
-		if (receivedSize == -1) {
-			ESP_LOGE(LOG_TAG, "rc == -1 from receive_from");
+	setReceiveTimeout();
+	acknowledge(0, false);
+
+	/*
+	 * The client sends a window of blocks and then waits for our acknowledgment of the last of them.  When a
+	 * block arrives out of order one was lost, so we acknowledge the last block received in order for the
+	 * client to send again from the next; when no block arrives in order within the timeout we repeat our last
+	 * acknowledgment.
+	 */
+	std::vector<uint8_t> dataBuffer(4 + m_blockSize);
+	uint16_t expected     = 1;     // The next block wanted.
+	uint16_t windowCount  = 0;     // Blocks received since the last acknowledgment.
+	bool     gapReported  = false; // Whether an out of order block has been acknowledged since the last in order one.
+	bool     dataReceived = false; // Whether any block has been received, after which block 0 is data rather than the options.
+	uint32_t ackTime      = FreeRTOS::getTimeSinceStart(); // When we last acknowledged.
+	int      retries      = 0;
+	while (!finished) {
+		int receivedSize = receivePacket(dataBuffer.data(), dataBuffer.size());
+		if (receivedSize == TFTP_FAILED) break;
+		uint16_t blockNumber = 0;
+		if (receivedSize != TFTP_TIMEOUT_EXPIRED) {
+			if (ntohs(*(uint16_t*) &dataBuffer[0]) != TFTP_OPCODE_DATA) {
+				sendError(ERROR_CODE_ILLEGAL_OPERATION, "Expected DATA");
+				break;
+			}
+			blockNumber = ntohs(*(uint16_t*) &dataBuffer[2]);
+			if (blockNumber != expected) {
+				ESP_LOGD(LOG_TAG, "Received block %d but expected %d", blockNumber, expected);
+				if (!gapReported) {
+					acknowledge(expected - 1, dataReceived);
+					gapReported = true;
+					windowCount = 0;
+					ackTime     = FreeRTOS::getTimeSinceStart();
+					continue;
+				}
+				if (FreeRTOS::getTimeSinceStart() - ackTime < m_timeout) continue;
+			}
+		}
+		if (receivedSize == TFTP_TIMEOUT_EXPIRED || blockNumber != expected) {
+			if (++retries > TFTP_MAX_RETRIES) {
+				ESP_LOGE(LOG_TAG, "Timed out waiting for block %d", expected);
+				sendError(ERROR_CODE_NOTDEFINED, "Timed out");
+				break;
+			}
+			acknowledge(expected - 1, dataReceived);
+			windowCount = 0;
+			ackTime     = FreeRTOS::getTimeSinceStart();
+			m_stats.retransmissions++;
+			continue;
+		}
+
+		size_t dataLength = receivedSize - 4;
+		if (fwrite(&dataBuffer[4], 1, dataLength, file) != dataLength) {
+			ESP_LOGE(LOG_TAG, "Failed to write file: %s: %s", tmpName.c_str(), strerror(errno));
+			sendError(ERROR_CODE_NO_SPACE, "Write failed");
+			break;
 		}
-		struct data_packet dp;
-		dp.blockNumber = ntohs(pRecv_data->blockNumber);
-		dp.data = std::string((char*) &pRecv_data->data, receivedSize - 4);
-		fwrite(dp.data.data(), dp.data.length(), 1, file);
-		sendAck(dp.blockNumber);
-		ESP_LOGD(LOG_TAG, "Block size: %d", dp.data.length());
-		if (dp.data.length() < TFTP_DATA_SIZE) {
+		ESP_LOGD(LOG_TAG, "Block: %d, size: %d", blockNumber, dataLength);
+		m_stats.bytes += dataLength;
+		expected++;
+		windowCount++;
+		retries      = 0;
+		gapReported  = false;
+		dataReceived = true;
+		if (dataLength < m_blockSize) {
 			finished = true;
+			sendAck(blockNumber);
+		} else if (windowCount == m_windowSize) {
+			sendAck(blockNumber);
+			windowCount = 0;
+			ackTime     = FreeRTOS::getTimeSinceStart();
 		}
 	} // Finished
 	fclose(file);
+	endStats(finished);
+	if (finished) {
+		// Linger for a timeout so a final block sent again, because our acknowledgment was lost, is acknowledged again.
+		uint16_t lastBlock = expected - 1;
+		while (receivePacket(dataBuffer.data(), dataBuffer.size()) >= 4 && ntohs(*(uint16_t*) &dataBuffer[2]) == lastBlock) {
+			sendAck(lastBlock);
+		}
+	}
 	m_partnerSocket.close();
 } // process
 
 
+/**
+ * @brief Receive a packet from the partner, waiting no longer than the timeout.
+ * A packet from anyone else is answered with an error, as it belongs to no transfer of ours.  An error from
+ * the partner ends the transfer.
+ * @param [in] data The buffer to receive into.
+ * @param [in] length The size of the buffer.
+ * @return The length of the packet, TFTP_TIMEOUT_EXPIRED or TFTP_FAILED.
+ */
+int TFTP::TFTP_Transaction::receivePacket(uint8_t* data, size_t length) {
+	while (true) {
+		struct sockaddr recvAddr;
+		int receivedSize = m_partnerSocket.receiveFrom(data, length, &recvAddr);
+		if (receivedSize < 0) {
+			return TFTP_TIMEOUT_EXPIRED;
+		}
+		struct sockaddr_in* pFrom    = (struct sockaddr_in*) &recvAddr;
+		struct sockaddr_in* pPartner = (struct sockaddr_in*) &m_partnerAddress;
+		if (pFrom->sin_port != pPartner->sin_port || pFrom->sin_addr.s_addr != pPartner->sin_addr.s_addr) {
+			ESP_LOGD(LOG_TAG, "Packet from unknown partner %s", Socket::addressToString(&recvAddr).c_str());
+			uint8_t error[] = { 0, TFTP_OPCODE_ERROR, 0, ERROR_CODE_UNKNOWN_ID, 0 };
+			m_partnerSocket.sendTo(error, sizeof(error), &recvAddr);
+			continue;
+		}
+		if (receivedSize < 4) {
+			ESP_LOGE(LOG_TAG, "Received a packet of only %d bytes", receivedSize);
+			sendError(ERROR_CODE_ILLEGAL_OPERATION, "Packet too short");
+			return TFTP_FAILED;
+		}
+		if (ntohs(*(uint16_t*) data) == TFTP_OPCODE_ERROR) {
+			ESP_LOGE(LOG_TAG, "Partner sent error %d: %.*s", ntohs(*(uint16_t*) (data + 2)), receivedSize - 4, (char*) (data + 4));
+			return TFTP_FAILED;
+		}
+		return receivedSize;
+	}
+} // receivePacket
+
+
 /**
  * @brief Send an acknowledgment back to the partner.
  * A TFTP acknowledgment packet contains an opcode (4) and a block number.
@@ -217,6 +545,31 @@ void TFTP::TFTP_Transaction::sendAck(uint16_t blockNumber) {
 } // sendAck
 
 
+/**
+ * @brief Send the option acknowledgment, listing the options accepted and their values.
+ * @return N/A.
+ */
+void TFTP::TFTP_Transaction::sendOptionAck() {
+/*
+ *  2 bytes   string   1 byte  string   1 byte
+ *  ---------------------------------------------
+ * | Opcode |  opt1  |   0  |  value1 |   0  | ...
+ *  ---------------------------------------------
+ */
+	std::string oack;
+	oack += (char) 0;
+	oack += (char) TFTP_OPCODE_OACK;
+	for (auto it = m_options.begin(); it != m_options.end(); ++it) {
+		oack += it->first;
+		oack += (char) 0;
+		oack += it->second;
+		oack += (char) 0;
+	}
+	ESP_LOGD(LOG_TAG, "Sending option ack to %s", Socket::addressToString(&m_partnerAddress).c_str());
+	m_partnerSocket.sendTo((uint8_t*) oack.data(), oack.length(), &m_partnerAddress);
+} // sendOptionAck
+
+
 /**
  * @brief Start being a TFTP server.
  *
@@ -229,34 +582,60 @@ void TFTP::start(uint16_t port) {
 /*
  * Loop forever.  At the start of the loop we block waiting for an incoming client request.
  * The requests that we are expecting are either a request to read a file from the server
- * or write a file to the server.  Once we have received a request we then call the appropriate
- * handler to handle that type of request.  When the request has been completed, we start again.
+ * or write a file to the server.  Once we have received a request we start a task that calls the
+ * appropriate handler for that type of request, and go back to waiting for the next request.
  */
 	ESP_LOGD(LOG_TAG, "Starting TFTP::start() on port %d", port);
 	Socket serverSocket;
 	serverSocket.listen(port, true); // Create a listening socket that is a datagram.
 	while (true) {
-		// This would be a good place to start a transaction in the background.
 		TFTP_Transaction* pTFTPTransaction = new TFTP_Transaction();
 		pTFTPTransaction->setBaseDir(m_baseDir);
+		pTFTPTransaction->setMaxBlockSize(m_maxBlockSize);
+		pTFTPTransaction->setMaxWindowSize(m_maxWindowSize);
 		uint16_t receivedOpCode = pTFTPTransaction->waitForRequest(&serverSocket);
-		switch (receivedOpCode) {
-			// Handle the write request (client file upload)
-			case opcode::TFTP_OPCODE_WRQ: {
-				pTFTPTransaction->processWRQ();
-				break;
-			}
+		if (receivedOpCode != opcode::TFTP_OPCODE_WRQ && receivedOpCode != opcode::TFTP_OPCODE_RRQ) {
+			ESP_LOGE(LOG_TAG, "Unknown opcode: %d", receivedOpCode);
+			delete pTFTPTransaction;
+			continue;
+		}
 
-			// Handle the read request (server file download)
-			case opcode::TFTP_OPCODE_RRQ: {
-				pTFTPTransaction->processRRQ();
-				break;
-			}
-			default:
-				ESP_LOGE(LOG_TAG, "Unknown opcode: %d", receivedOpCode);
-				break;
+		// A client that heard nothing back yet sends its request again.  The transfer it asked for is already
+		// running and answers it, so a second one from the same address and port is dropped.
+		uint64_t partnerKey = pTFTPTransaction->getPartnerKey();
+		::pthread_mutex_lock(&m_lock);
+		bool duplicate = m_partners.count(partnerKey) > 0;
+		bool busy      = !duplicate && m_activeCount >= m_maxTransactions;
+		if (!duplicate && !busy) {
+			m_activeCount++;
+			m_partners.insert(partnerKey);
+		}
+		::pthread_mutex_unlock(&m_lock);
+		if (duplicate) {
+			ESP_LOGD(LOG_TAG, "Dropping repeated request for %s", pTFTPTransaction->getStats().filename.c_str());
+			delete pTFTPTransaction;
+			continue;
+		}
+		// Run the transfer in the background, on the transaction's own socket, unless too many are running.
+		if (busy) {
+			ESP_LOGW(LOG_TAG, "Refusing request, %d transfers are running", m_maxTransactions);
+			pTFTPTransaction->sendError(ERROR_CODE_NOTDEFINED, "Server busy, try again later");
+			delete pTFTPTransaction;
+			continue;
+		}
+		TransactionTaskParam* pParam = new TransactionTaskParam();
+		pParam->pTFTP        = this;
+		pParam->pTransaction = pTFTPTransaction;
+		if (!FreeRTOS::startTask(transactionTask, "TFTP_Transaction", pParam, TFTP_TASK_STACK_SIZE)) {
+			ESP_LOGE(LOG_TAG, "Unable to start a task for the transfer");
+			::pthread_mutex_lock(&m_lock);
+			m_activeCount--;
+			m_partners.erase(partnerKey);
+			::pthread_mutex_unlock(&m_lock);
+			pTFTPTransaction->sendError(ERROR_CODE_NOTDEFINED, "Server out of memory, try again later");
+			delete pParam;
+			delete pTFTPTransaction;
 		}
-		delete pTFTPTransaction;
 	} // End while loop
 } // run
 
@@ -272,6 +651,92 @@ void TFTP::TFTP_Transaction::setBaseDir(std::string baseDir) {
 } // setBaseDir
 
 
+/**
+ * @brief Set the largest block size the client may negotiate.
+ * @param [in] maxBlockSize The largest block size.
+ * @return N/A.
+ */
+void TFTP::TFTP_Transaction::setMaxBlockSize(uint16_t maxBlockSize) {
+	m_maxBlockSize = maxBlockSize;
+} // setMaxBlockSize
+
+
+/**
+ * @brief Set the largest window the client may negotiate.
+ * @param [in] maxWindowSize The largest window, in blocks.
+ * @return N/A.
+ */
+void TFTP::TFTP_Transaction::setMaxWindowSize(uint16_t maxWindowSize) {
+	m_maxWindowSize = maxWindowSize;
+} // setMaxWindowSize
+
+
+/**
+ * @brief Get the address and port of the partner as one number, to tell its transfer from the others.
+ * @return The address in the upper bits and the port in the lower 16.
+ */
+uint64_t TFTP::TFTP_Transaction::getPartnerKey() {
+	struct sockaddr_in* pPartner = (struct sockaddr_in*) &m_partnerAddress;
+	return ((uint64_t) pPartner->sin_addr.s_addr << 16) | pPartner->sin_port;
+} // getPartnerKey
+
+
+/**
+ * @brief Have receives from the partner give up after the retransmission timeout.
+ * @return N/A.
+ */
+void TFTP::TFTP_Transaction::setReceiveTimeout() {
+	struct timeval tv;
+	tv.tv_sec  = m_timeout / 1000;
+	tv.tv_usec = (m_timeout % 1000) * 1000;
+	m_partnerSocket.setSocketOption(SO_RCVTIMEO, &tv, sizeof(tv));
+} // setReceiveTimeout
+
+
+/**
+ * @brief Run a transfer and count it as ended when it has.
+ * @param [in] pParam The TransactionTaskParam of the transfer.
+ * @return N/A.
+ */
+void TFTP::transactionTask(void* pParam) {
+	TransactionTaskParam* pTaskParam = (TransactionTaskParam*) pParam;
+	TFTP* pTFTP = pTaskParam->pTFTP;
+	TFTP_Transaction* pTFTPTransaction = pTaskParam->pTransaction;
+	delete pTaskParam;
+
+	if (pTFTPTransaction->getStats().write) {
+		// Handle the write request (client file upload)
+		pTFTPTransaction->processWRQ();
+	} else {
+		// Handle the read request (server file download)
+		pTFTPTransaction->processRRQ();
+	}
+	if (pTFTP->m_statsHandler) {
+		pTFTP->m_statsHandler(pTFTPTransaction->getStats());
+	}
+	uint64_t partnerKey = pTFTPTransaction->getPartnerKey();
+	delete pTFTPTransaction;
+
+	::pthread_mutex_lock(&pTFTP->m_lock);
+	pTFTP->m_activeCount--;
+	pTFTP->m_partners.erase(partnerKey);
+	::pthread_mutex_unlock(&pTFTP->m_lock);
+	FreeRTOS::deleteTask();
+} // transactionTask
+
+
+/**
+ * @brief Get the number of transfers running.
+ * @return The number of transfers running.
+ */
+size_t TFTP::getActiveCount() {
+	::pthread_mutex_lock(&m_lock);
+	size_t count = m_activeCount;
+	::pthread_mutex_unlock(&m_lock);
+	return count;
+} // getActiveCount
+
+
 /**
  * @brief Set the base dir for file access.
  * If we are asked to put a file to the file system, this is the base relative directory.
@@ -284,38 +749,73 @@ void TFTP::setBaseDir(std::string baseDir) {
 
 
 /**
- * @brief Wait for an acknowledgment from the client.
- * After having sent data to the client, we expect an acknowledment back from the client.
- * This function causes us to wait for an incoming acknowledgment.
+ * @brief Set the largest block size a client may negotiate.
+ * Larger blocks mean fewer packets and acknowledgments but may be fragmented by the network.  The default
+ * is 1468 bytes, the largest that fits an Ethernet frame.
+ * @param [in] maxBlockSize The largest block size, at least 512.
+ * @return N/A.
  */
-void TFTP::TFTP_Transaction::waitForAck(uint16_t blockNumber) {
-	struct {
-		uint16_t opCode;
-		uint16_t blockNumber;
-	} ackData;
+void TFTP::setMaxBlockSize(uint16_t maxBlockSize) {
+	m_maxBlockSize = std::max(maxBlockSize, (uint16_t) TFTP_DATA_SIZE);
+} // setMaxBlockSize
 
-	ESP_LOGD(LOG_TAG, "TFTP: Waiting for an acknowledgment request");
-	int sizeRead = m_partnerSocket.receiveFrom((uint8_t*) &ackData, sizeof(ackData), &m_partnerAddress);
-	ESP_LOGD(LOG_TAG, "TFTP: Received some data.");
 
-	if (sizeRead != sizeof(ackData)) {
-		ESP_LOGE(LOG_TAG, "waitForAck: Received %d but expected %d", sizeRead, sizeof(ackData));
-		sendError(ERROR_CODE_NOTDEFINED, "Ack not correct size");
-		return;
-	}
+/**
+ * @brief Set the largest window a client may negotiate.
+ * The window is the number of blocks sent before waiting for an acknowledgment.  The default is 16.
+ * @param [in] maxWindowSize The largest window, in blocks.  1 is the one block at a time of plain %TFTP.
+ * @return N/A.
+ */
+void TFTP::setMaxWindowSize(uint16_t maxWindowSize) {
+	m_maxWindowSize = std::max(maxWindowSize, (uint16_t) 1);
+} // setMaxWindowSize
 
-	ackData.opCode      = ntohs(ackData.opCode);
-	ackData.blockNumber = ntohs(ackData.blockNumber);
 
-	if (ackData.opCode != opcode::TFTP_OPCODE_ACK) {
-		ESP_LOGE(LOG_TAG, "waitForAck: Received opcode %d but expected %d", ackData.opCode, opcode::TFTP_OPCODE_ACK);
-		return;
+/**
+ * @brief Set the number of transfers that may run at once.
+ * Each runs in a task of its own.  A request beyond the limit is refused with an error.  The default is 4.
+ * @param [in] maxTransactions The number of transfers.
+ * @return N/A.
+ */
+void TFTP::setMaxTransactions(size_t maxTransactions) {
+	m_maxTransactions = std::max(maxTransactions, (size_t) 1);
+} // setMaxTransactions
+
+
+/**
+ * @brief Set a function to be given the statistics of each transfer when it ends.
+ * It is called in the task of the transfer, so may be called by several tasks at once.
+ * @param [in] handler The function.
+ * @return N/A.
+ */
+void TFTP::setStatsHandler(std::function<void(const TransferStats&)> handler) {
+	m_statsHandler = handler;
+} // setStatsHandler
+
+
+/**
+ * @brief Wait for an acknowledgment from the client.
+ * After having sent data to the client, we expect an acknowledment back from the client.
+ * This function causes us to wait for an incoming acknowledgment, no longer than the timeout.
+ * @return The block number acknowledged, TFTP_TIMEOUT_EXPIRED or TFTP_FAILED.
+ */
+int TFTP::TFTP_Transaction::waitForAck() {
+	uint8_t buf[TFTP_DATA_SIZE + 4]; // Room for an error message.
+
+	ESP_LOGD(LOG_TAG, "TFTP: Waiting for an acknowledgment request");
+	int sizeRead = receivePacket(buf, sizeof(buf));
+	if (sizeRead < 0) {
+		return sizeRead;
 	}
+	ESP_LOGD(LOG_TAG, "TFTP: Received some data.");
 
-	if (ackData.blockNumber != blockNumber) {
-		ESP_LOGE(LOG_TAG, "waitForAck: Blocknumber received %d but expected %d", ackData.blockNumber, blockNumber);
-		return;
+	uint16_t opCode = ntohs(*(uint16_t*) &buf[0]);
+	if (opCode != opcode::TFTP_OPCODE_ACK) {
+		ESP_LOGE(LOG_TAG, "waitForAck: Received opcode %d but expected %d", opCode, opcode::TFTP_OPCODE_ACK);
+		sendError(ERROR_CODE_ILLEGAL_OPERATION, "Expected ACK");
+		return TFTP_FAILED;
 	}
+	return ntohs(*(uint16_t*) &buf[2]);
 } // waitForAck
 
 
@@ -336,28 +836,38 @@ void TFTP::TFTP_Transaction::waitForAck(uint16_t blockNumber) {
  */
 uint16_t TFTP::TFTP_Transaction::waitForRequest(Socket* pServerSocket) {
 	union {
-		uint8_t buf[TFTP_DATA_SIZE];
+		uint8_t buf[TFTP_DATA_SIZE + 1];
 		uint16_t opCode;
 	} record;
-	size_t length = 100;
 
 	ESP_LOGD(LOG_TAG, "TFTP: Waiting for a request");
-	pServerSocket->receiveFrom(record.buf, length, &m_partnerAddress);
-
-	// Save the filename, mode and op code.
+	int length = pServerSocket->receiveFrom(record.buf, TFTP_DATA_SIZE, &m_partnerAddress);
+	if (length < 4) {
+		ESP_LOGE(LOG_TAG, "Request of %d bytes is too short", length);
+		return 0;
+	}
+	record.buf[length] = 0; // Terminate the last string, should the client not have.
 
-	m_filename = std::string((char*) (record.buf + 2));
-	m_mode	 = std::string((char*) (record.buf + 3 + m_filename.length()));
+	// Save the filename, mode and op code.  Any further strings are pairs of option name and value.
+	std::vector<std::string> fields;
+	for (char* p = (char*) record.buf + 2; p < (char*) record.buf + length; p += strlen(p) + 1) {
+		fields.push_back(std::string(p));
+	}
+	m_filename = fields.size() > 0 ? fields[0] : "";
+	m_mode     = fields.size() > 1 ? fields[1] : "";
 	m_opCode   = ntohs(record.opCode);
+	m_startTime      = FreeRTOS::getTimeSinceStart();
+	m_stats.filename = m_filename;
+	m_stats.write    = m_opCode == TFTP_OPCODE_WRQ;
+	for (size_t i = 2; i + 1 < fields.size(); i += 2) {
+		std::string name = fields[i];
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		parseOption(name, fields[i + 1]);
+	}
+
 	switch (m_opCode) {
 		// Handle the Write Request command.
-		case TFTP_OPCODE_WRQ: {
-			m_partnerSocket.createSocket(true);
-			m_partnerSocket.bind(0, INADDR_ANY);
-			sendAck(0);
-			break;
-		}
-
+		case TFTP_OPCODE_WRQ:
 		// Handle the Read request command.
 		case TFTP_OPCODE_RRQ: {
 			m_partnerSocket.createSocket(true);
@@ -9,6 +9,11 @@
 #define COMPONENTS_CPP_UTILS_TFTP_H_
 #define TFTP_DEFAULT_PORT (69)
 #include <string>
+#include <set>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <pthread.h>
 #include <Socket.h>
 /**
  * @brief A %TFTP server.
@@ -31,25 +36,72 @@
  * @endcode
  *
  * On Linux, I recommend the <a href="https://linux.die.net/man/1/atftp">atftp</a> client.
+ *
+ * Clients may negotiate a larger block size (<a href="https://tools.ietf.org/html/rfc2348">RFC 2348</a>),
+ * a window of several blocks sent before an acknowledgment is awaited
+ * (<a href="https://tools.ietf.org/html/rfc7440">RFC 7440</a>) and the retransmission timeout
+ * (<a href="https://tools.ietf.org/html/rfc2349">RFC 2349</a>).  Lost blocks and acknowledgments are
+ * retransmitted after the timeout.  For example, with atftp:
+ *
+ * @code
+ * atftp --option "blksize 1428" --option "windowsize 8" --get -r firmware.bin 192.168.1.99
+ * @endcode
+ *
+ * Each transfer runs in a task of its own on its own UDP port, so a slow client doesn't hold up the others.
+ * Requests beyond the limit set with setMaxTransactions() are refused with an error, which clients report
+ * and may retry later.  The statistics of each transfer are logged when it ends and can be passed to a
+ * handler:
+ *
+ * @code{.cpp}
+ * tftp.setMaxTransactions(8);
+ * tftp.setStatsHandler([](const TFTP::TransferStats& stats) {
+ *    printf("%s: %d bytes/s\n", stats.filename.c_str(), stats.getThroughput());
+ * });
+ * @endcode
  */
 class TFTP {
 public:
+	/**
+	 * @brief Statistics of a transfer, given to the stats handler when it ends.
+	 */
+	struct TransferStats {
+		std::string filename;
+		bool        write;           // True for a file written by the client, false for one it read.
+		bool        success;         // True if the whole file was transferred.
+		uint32_t    bytes;           // Bytes of the file transferred.
+		uint32_t    duration;        // Milliseconds from the request to the end of the transfer.
+		uint32_t    retransmissions; // Blocks sent again, or acknowledgments repeated when writing.
+		uint16_t    blockSize;
+		uint16_t    windowSize;
+		uint32_t    getThroughput() const;
+	};
+
 	TFTP();
 	virtual ~TFTP();
+	size_t getActiveCount();
 	void start(uint16_t port = TFTP_DEFAULT_PORT);
 	void setBaseDir(std::string baseDir);
+	void setMaxBlockSize(uint16_t maxBlockSize);
+	void setMaxTransactions(size_t maxTransactions);
+	void setMaxWindowSize(uint16_t maxWindowSize);
+	void setStatsHandler(std::function<void(const TransferStats&)> handler);
 	/**
 	 * @brief Internal class for %TFTP processing.
 	 */
 	class TFTP_Transaction {
 	public:
 		TFTP_Transaction();
+		~TFTP_Transaction();
+		uint64_t getPartnerKey();
+		const TransferStats& getStats();
 		void processWRQ();
 		void processRRQ();
 		void sendAck(uint16_t blockNumber);
 		void sendError(uint16_t code, std::string message);
 		void setBaseDir(std::string baseDir);
-		void waitForAck(uint16_t blockNumber);
+		void setMaxBlockSize(uint16_t maxBlockSize);
+		void setMaxWindowSize(uint16_t maxWindowSize);
+		int waitForAck();
 		uint16_t waitForRequest(Socket* pServerSocket);
 
 	private:
@@ -62,11 +114,34 @@ public:
 		std::string m_filename; // The name of the file.
 		std::string m_mode;
 		std::string m_baseDir; // The base directory.
+		uint16_t    m_maxBlockSize;  // The largest block size a client may ask for.
+		uint16_t    m_maxWindowSize; // The largest window size a client may ask for.
+		uint16_t    m_blockSize;     // The block size of this transfer.
+		uint16_t    m_windowSize;    // Blocks sent before waiting for an acknowledgment.
+		uint32_t    m_timeout;       // Milliseconds to wait before retransmitting.
+		std::vector<std::pair<std::string, std::string>> m_options; // The options accepted, for the OACK.
+		TransferStats m_stats;
+		uint32_t    m_startTime;     // When the request arrived.
 
+		void acknowledge(uint16_t blockNumber, bool dataReceived);
+		void endStats(bool success);
+		void parseOption(std::string name, std::string value);
+		int  receivePacket(uint8_t* data, size_t length);
+		void sendOptionAck();
+		void setReceiveTimeout();
 	};
 
 private:
-	std::string m_baseDir;
+	std::string     m_baseDir;
+	uint16_t        m_maxBlockSize;
+	uint16_t        m_maxWindowSize;
+	size_t          m_maxTransactions;
+	size_t          m_activeCount;     // Transactions running.
+	std::set<uint64_t> m_partners;     // The address and port of the client of each transaction running.
+	pthread_mutex_t m_lock;            // Guards m_activeCount and m_partners.
+	std::function<void(const TransferStats&)> m_statsHandler;
+
+	static void transactionTask(void* pParam);
 
 };
 
@@ -5,10 +5,13 @@
  *      Author: kolban
  */
 
+#include <string.h>
 #include <sstream>
 #include "WebSocket.h"
 #include "Task.h"
 #include "GeneralUtils.h"
+#include "WebSocketDeflate.h"
+#include "WebSocketHub.h"
 #include <esp_log.h>
 
 extern "C" {
@@ -28,6 +31,9 @@ static const uint8_t OPCODE_CLOSE    = 0x08;
 static const uint8_t OPCODE_PING     = 0x09;
 static const uint8_t OPCODE_PONG     = 0x0a;
 
+// The longest compressed message, or message decompressed, that we accept.
+static const size_t MAX_INFLATED_LENGTH = 65536;
+
 
 // Structure definition for the WebSocket frame.
 struct Frame {
@@ -86,111 +92,404 @@ static void dumpFrame(Frame frame) {
 } // dumpFrame
 
 
+/**
+ * @brief Unmask WebSocket payload data in place.
+ *
+ * The bytes up to the first word boundary are unmasked one at a time.  The rest are unmasked a word at a
+ * time, two words per step, with the mask rotated to line up with the position of the first whole word in
+ * the payload.
+ *
+ * @param [in] pData The data to unmask.
+ * @param [in] length The length of the data.
+ * @param [in] mask The mask of the frame.
+ * @param [in] offset The position of the data in the payload of the frame.
+ */
+static void unmask(uint8_t* pData, size_t length, const uint8_t* mask, size_t offset) {
+	typedef uint32_t __attribute__((__may_alias__)) word_t;
+
+	while (length > 0 && ((uintptr_t) pData & 3) != 0) {
+		*pData++ ^= mask[offset++ & 3];
+		length--;
+	}
+
+	uint8_t rotated[4];
+	for (int i = 0; i < 4; i++) {
+		rotated[i] = mask[(offset + i) & 3];
+	}
+	uint32_t maskWord;
+	memcpy(&maskWord, rotated, sizeof(maskWord));
+
+	word_t* pWord = (word_t*) pData;
+	while (length >= 8) {
+		pWord[0] ^= maskWord;
+		pWord[1] ^= maskWord;
+		pWord  += 2;
+		length -= 8;
+	}
+	if (length >= 4) {
+		*pWord++ ^= maskWord;
+		length   -= 4;
+	}
+	pData = (uint8_t*) pWord;
+	for (size_t i = 0; i < length; i++) {
+		pData[i] ^= rotated[i];
+	}
+} // unmask
+
+
 /**
  * @brief A task that will watch web socket inputs.
  *
  * When a WebSocket is created it is created by the client requesting an HTTP protocol changed to WebSockets.
  * After the original Socket has been flagged as being a WebSocket, we must now start watching that socket for
  * incoming asynchronous events.  We spawn a task to do this.  This is the implementation of that task.
+ *
+ * The reader receives into a buffer of its own as much as the socket has available, so a frame header and
+ * the payload following it usually arrive in a single receive.  Payload is unmasked in place and handed to
+ * the message's WebSocketInputStreambuf without being copied.  A message fragmented over several frames
+ * is delivered as one stream; control frames arriving between its fragments are handled as they come.
+ *
+ * A compressed message can only be decompressed whole, so it is collected and decompressed first and the
+ * message is then read from the decompressed copy.
  */
 class WebSocketReader: public Task {
 public:
 	WebSocketReader() {
-		m_end = false;
+		m_end              = false;
+		m_failed           = false;
+		m_buffer           = new uint8_t[BUFFER_SIZE];
+		m_head             = 0;
+		m_tail             = 0;
+		m_payloadRemaining = 0;
+		m_masked           = false;
+		m_maskOffset       = 0;
+		m_fin              = true;
+		m_inflating        = false;
+		m_inflatedPos      = 0;
+		m_pWebSocket       = nullptr;
+	}
+	~WebSocketReader() {
+		delete[] m_buffer;
 	}
 	void end() {
 		m_end = true;
 	}
 
 private:
-	bool m_end;
+	friend class WebSocketInputStreambuf;
+
+	static const size_t BUFFER_SIZE = 4096;
+
+	bool        m_end;
+	bool        m_failed;           // The socket failed or the peer broke the protocol.
+	uint8_t*    m_buffer;           // Data received from the socket.
+	size_t      m_head;             // The start of the data in the buffer not yet consumed.
+	size_t      m_tail;             // The end of the data in the buffer.
+	uint64_t    m_payloadRemaining; // The payload of the current frame not yet consumed.
+	uint8_t     m_mask[4];
+	bool        m_masked;
+	size_t      m_maskOffset;       // The position in the payload of the current frame, modulo 4.
+	bool        m_fin;              // The current data frame is the last of its message.
+	bool        m_inflating;        // The current message is read from m_inflated.
+	std::string m_inflated;         // The current message, decompressed.
+	size_t      m_inflatedPos;      // The start of m_inflated not yet read.
+	Socket      m_socket;
+	WebSocket*  m_pWebSocket;
+
+
+	/**
+	 * @brief Make sure that the buffer holds at least length bytes not yet consumed.
+	 * @param [in] length The number of bytes needed; no more than the size of the buffer.
+	 * @return False if the socket was closed or failed first.
+	 */
+	bool fill(size_t length) {
+		if (m_tail - m_head >= length) return true;
+		if (m_head + length > BUFFER_SIZE) {   // Not enough room after the data; move it to the start.
+			memmove(m_buffer, m_buffer + m_head, m_tail - m_head);
+			m_tail -= m_head;
+			m_head  = 0;
+		}
+		while (m_tail - m_head < length) {
+			size_t rc = m_socket.receive(m_buffer + m_tail, BUFFER_SIZE - m_tail);
+			if (rc == 0 || rc == (size_t) -1) return false;
+			m_tail += rc;
+		}
+		return true;
+	} // fill
+
+
+	/**
+	 * @brief Handle a control frame, which may arrive between the fragments of a message.
+	 * @param [in] frame The frame whose header has just been read.
+	 * @return False if the frame broke the protocol or could not be read.
+	 */
+	bool handleControl(Frame& frame) {
+		if (!frame.fin || m_payloadRemaining > 125) {
+			ESP_LOGD("WebSocketReader", "Control frame fragmented or too long");
+			m_pWebSocket->close(WebSocket::CLOSE_PROTOCOL_ERROR);
+			return false;
+		}
+		if (!fill(m_payloadRemaining)) return false;
+		uint8_t* pData;
+		readPayload(&pData);     // The whole payload is in the buffer and is unmasked in one piece.
+
+		switch (frame.opCode) {
+			// If the WebSocket operation code is close then we are closing the connection.
+			case OPCODE_CLOSE: {
+				m_pWebSocket->m_receivedClose = true;
+				WebSocketHandler* pWebSocketHandler = m_pWebSocket->getHandler();
+				if (pWebSocketHandler != nullptr) { // If we have a handler, invoke the onClose method upon it.
+					pWebSocketHandler->onClose();
+				}
+				m_pWebSocket->close();              // Close the websocket.
+				break;
+			}
+
+			case OPCODE_PING: {
+				break;
+			}
+
+			case OPCODE_PONG: {
+				break;
+			}
+
+			default: {
+				ESP_LOGD("WebSocketReader", "Unknown opcode: %d", frame.opCode);
+				break;
+			}
+		} // Switch opCode
+		return true;
+	} // handleControl
+
+
+	/**
+	 * @brief Read the header of the next frame.
+	 * @param [out] pFrame The first two bytes of the header.  The payload length and mask are kept by the reader.
+	 * @return False if the socket was closed or failed first.
+	 */
+	bool readHeader(Frame* pFrame) {
+		if (!fill(sizeof(Frame))) return false;
+		memcpy(pFrame, m_buffer + m_head, sizeof(Frame));
+		dumpFrame(*pFrame);
+
+		size_t headerLength = sizeof(Frame);
+		if (pFrame->len == 126) {
+			headerLength += 2;
+		} else if (pFrame->len == 127) {
+			headerLength += 8;
+		}
+		if (pFrame->mask == 1) {
+			headerLength += sizeof(m_mask);
+		}
+		if (!fill(headerLength)) return false;
+
+		// The extended payload length is in network byte order.
+		uint8_t* p = m_buffer + m_head + sizeof(Frame);
+		if (pFrame->len < 126) {
+			m_payloadRemaining = pFrame->len;
+		} else {
+			int count = (pFrame->len == 126) ? 2 : 8;
+			m_payloadRemaining = 0;
+			for (int i = 0; i < count; i++) {
+				m_payloadRemaining = (m_payloadRemaining << 8) | *p++;
+			}
+		}
+		m_masked     = (pFrame->mask == 1);
+		m_maskOffset = 0;
+		if (m_masked) {
+			memcpy(m_mask, p, sizeof(m_mask));
+		}
+		m_head += headerLength;
+
+		// RSV1 marks a compressed message, so it is only allowed on the first frame of a data message and only
+		// if permessage-deflate was negotiated.  No extension defines RSV2 or RSV3.
+		bool dataStart = pFrame->opCode == OPCODE_TEXT || pFrame->opCode == OPCODE_BINARY;
+		if (pFrame->rsv2 || pFrame->rsv3 || (pFrame->rsv1 && (!dataStart || m_pWebSocket->m_pDeflate == nullptr))) {
+			ESP_LOGD("WebSocketReader", "Reserved bits set in frame header");
+			m_pWebSocket->close(WebSocket::CLOSE_PROTOCOL_ERROR);
+			return false;
+		}
+		return true;
+	} // readHeader
+
+
+	/**
+	 * @brief Collect the rest of a compressed message and decompress it.
+	 * The message is then read from the decompressed copy.
+	 * @return False if the message broke the protocol, was too long or could not be read.
+	 */
+	bool inflateMessage() {
+		std::string compressed;
+		uint8_t* pData;
+		size_t length;
+		while ((length = readFragments(&pData)) > 0) {
+			if (compressed.length() + length > MAX_INFLATED_LENGTH) {
+				ESP_LOGD("WebSocketReader", "Compressed message too long");
+				m_pWebSocket->close(WebSocket::CLOSE_TOO_BIG);
+				return false;
+			}
+			compressed.append((const char*) pData, length);
+		}
+		if (m_failed) return false;
+
+		if (!m_pWebSocket->m_pDeflate->inflate((const uint8_t*) compressed.data(), compressed.length(), &m_inflated, MAX_INFLATED_LENGTH)) {
+			m_pWebSocket->close(m_inflated.length() > MAX_INFLATED_LENGTH ? WebSocket::CLOSE_TOO_BIG : WebSocket::CLOSE_PROTOCOL_ERROR);
+			return false;
+		}
+		m_inflating   = true;
+		m_inflatedPos = 0;
+		return true;
+	} // inflateMessage
+
+
+	/**
+	 * @brief Get the next piece of the payload of the current message, reading further frames as needed.
+	 * @param [out] ppData Set to the unmasked data, which is valid until the next read.
+	 * @return The length of the data, or 0 at the end of the message.
+	 */
+	size_t readFragments(uint8_t** ppData) {
+		while (true) {
+			size_t length = readPayload(ppData);
+			if (length > 0) return length;
+			if (m_failed || m_end || m_fin) return 0;
+
+			Frame frame;
+			if (!readHeader(&frame)) {
+				m_failed = true;
+				return 0;
+			}
+			if (frame.opCode & 0x08) {
+				if (!handleControl(frame)) {
+					m_failed = true;
+					return 0;
+				}
+			} else if (frame.opCode == OPCODE_CONTINUE) {
+				m_fin = frame.fin;
+			} else {
+				ESP_LOGD("WebSocketReader", "New message started before the last was finished");
+				m_pWebSocket->close(WebSocket::CLOSE_PROTOCOL_ERROR);
+				m_failed = true;
+				return 0;
+			}
+		}
+	} // readFragments
+
+
+	/**
+	 * @brief Get the next piece of the current message, decompressed if it was compressed.
+	 * @param [out] ppData Set to the data, which is valid until the next read.
+	 * @return The length of the data, or 0 at the end of the message.
+	 */
+	size_t readMessage(uint8_t** ppData) {
+		if (!m_inflating) return readFragments(ppData);
+		size_t length = m_inflated.length() - m_inflatedPos;
+		if (length == 0) return 0;
+		*ppData = (uint8_t*) &m_inflated[m_inflatedPos];
+		m_inflatedPos += length;
+		return length;
+	} // readMessage
+
+
+	/**
+	 * @brief Get the next piece of the payload of the current frame.
+	 * If nothing is buffered, the buffer is refilled with as much as the socket has available.
+	 * @param [out] ppData Set to the unmasked data, which is valid until the next read.
+	 * @return The length of the data, or 0 at the end of the frame.
+	 */
+	size_t readPayload(uint8_t** ppData) {
+		if (m_payloadRemaining == 0) return 0;
+		if (m_head == m_tail) {
+			m_head = 0;
+			m_tail = 0;
+			if (!fill(1)) {
+				m_failed = true;
+				return 0;
+			}
+		}
+		size_t length = m_tail - m_head;
+		if (length > m_payloadRemaining) {
+			length = m_payloadRemaining;
+		}
+		*ppData = m_buffer + m_head;
+		if (m_masked) {
+			unmask(*ppData, length, m_mask, m_maskOffset);
+			m_maskOffset = (m_maskOffset + length) & 3;
+		}
+		m_head             += length;
+		m_payloadRemaining -= length;
+		return length;
+	} // readPayload
+
+
 	/**
 	 * @brief Loop over the web socket waiting for new input.
 	 * @param [in] data A pointer to an instance of the WebSocket.
 	 */
 	void run(void* data) {
-		WebSocket* pWebSocket = (WebSocket*) data;
-		ESP_LOGD("WebSocketReader", "WebSocketReader Task started, socket: %s", pWebSocket->getSocket().toString().c_str());
-
-		Socket peerSocket = pWebSocket->getSocket();
+		m_pWebSocket = (WebSocket*) data;
+		m_socket     = m_pWebSocket->getSocket();
+		ESP_LOGD("WebSocketReader", "WebSocketReader Task started, socket: %s", m_socket.toString().c_str());
 
 		Frame frame;
+		uint8_t* pData;
 		while (true) {
 			if (m_end) break;
-			ESP_LOGD("WebSocketReader", "Waiting on socket data for socket %s", peerSocket.toString().c_str());
-			int length = peerSocket.receive((uint8_t*) &frame, sizeof(frame), true); // Read exact
-			if (length != sizeof(frame)) {
+			ESP_LOGD("WebSocketReader", "Waiting on socket data for socket %s", m_socket.toString().c_str());
+			if (!readHeader(&frame)) {
 				ESP_LOGD("WebSocketReader", "Socket read error");
-				pWebSocket->close();
+				m_pWebSocket->close();
 				return;
 			}
-			ESP_LOGD("WebSocketReader", "Received data from web socket.  Length: %d", length);
-			dumpFrame(frame);
-
-			// The following section parses the WebSocket frame.
-			uint32_t payloadLen = 0;
-			uint8_t  mask[4];
-			if (frame.len < 126) {
-				payloadLen = frame.len;
-			} else if (frame.len == 126) {
-				uint16_t tempLen;
-				peerSocket.receive((uint8_t*) &tempLen, sizeof(tempLen), true);
-				payloadLen = ntohs(tempLen);
-			} else if (frame.len == 127) {
-				uint64_t tempLen;
-				peerSocket.receive((uint8_t*) &tempLen, sizeof(tempLen), true);
-				payloadLen = ntohl((uint32_t) tempLen);
-			}
-			if (frame.mask == 1) {
-				peerSocket.receive(mask, sizeof(mask), true);
-			}
-
-			if (payloadLen == 0) {
-				ESP_LOGD("WebSocketReader", "Web socket payload is not present");
-			} else {
-				ESP_LOGD("WebSocketReader", "Web socket payload, length=%d:", payloadLen);
-			}
+			ESP_LOGD("WebSocketReader", "Web socket payload, length=%d", (uint32_t) m_payloadRemaining);
 
-			WebSocketHandler* pWebSocketHandler = pWebSocket->getHandler();
 			switch (frame.opCode) {
 				case OPCODE_TEXT:
 				case OPCODE_BINARY: {
+					m_fin = frame.fin;
+					if (frame.rsv1 && !inflateMessage()) {
+						m_failed = true;
+						break;
+					}
+					WebSocketHandler* pWebSocketHandler = m_pWebSocket->getHandler();
 					if (pWebSocketHandler != nullptr) {
-						WebSocketInputStreambuf streambuf(pWebSocket->getSocket(), payloadLen, (frame.mask == 1) ? mask : nullptr);
-						pWebSocketHandler->onMessage(&streambuf, pWebSocket);
-						//streambuf.discard();
+						WebSocketInputStreambuf streambuf(this, m_inflating ? m_inflated.length() : m_payloadRemaining);
+						pWebSocketHandler->onMessage(&streambuf, m_pWebSocket);
+					} // The streambuf discards whatever the handler didn't read.
+					while (readMessage(&pData) > 0) {}
+					if (m_inflating) {
+						m_inflating = false;
+						if (m_inflated.capacity() > BUFFER_SIZE) {
+							std::string().swap(m_inflated);   // Don't hold on to the memory of a long message.
+						}
 					}
 					break;
 				}
 
-				// If the WebSocket operation code is close then we are closing the connection.
-				case OPCODE_CLOSE: {
-					pWebSocket->m_receivedClose = true;
-					if (pWebSocketHandler != nullptr) { // If we have a handler, invoke the onClose method upon it.
-						pWebSocketHandler->onClose();
-					}
-					pWebSocket->close();                // Close the websocket.
+				case OPCODE_CLOSE:
+				case OPCODE_PING:
+				case OPCODE_PONG: {
+					if (!handleControl(frame)) m_failed = true;
 					break;
 				}
 
 				case OPCODE_CONTINUE: {
-					break;
-				}
-
-				case OPCODE_PING: {
-					break;
-				}
-
-				case OPCODE_PONG: {
+					ESP_LOGD("WebSocketReader", "Continuation frame without a message");
+					m_pWebSocket->close(WebSocket::CLOSE_PROTOCOL_ERROR);
+					m_failed = true;
 					break;
 				}
 
 				default: {
 					ESP_LOGD("WebSocketReader", "Unknown opcode: %d", frame.opCode);
+					while (readPayload(&pData) > 0) {}
 					break;
 				}
 			} // Switch opCode
 
+			if (m_failed) {
+				if (!m_end) m_pWebSocket->close();
+				return;
+			}
 		} // while (true)
 		ESP_LOGD("WebSocketReader", "<< run");
 	} // run
@@ -242,6 +541,9 @@ WebSocket::WebSocket(Socket socket) {
 	m_socket            = socket;
 	m_pWebSockerReader  = new WebSocketReader();
 	m_pWebSocketHandler = nullptr;
+	m_pHub              = nullptr;
+	m_pDeflate          = nullptr;
+	::pthread_mutex_init(&m_sendLock, nullptr);
 } // WebSocket
 
 
@@ -251,6 +553,8 @@ WebSocket::WebSocket(Socket socket) {
 WebSocket::~WebSocket() {
 	m_pWebSockerReader->stop();
 	delete m_pWebSockerReader;
+	delete m_pDeflate;
+	::pthread_mutex_destroy(&m_sendLock);
 } // ~WebSocket
 
 
@@ -264,8 +568,7 @@ void WebSocket::close(uint16_t status, std::string message) {
 
 	if (m_sentClose) {             // If we have previously sent a close request then we can close the underlying socket.
 		ESP_LOGD(LOG_TAG, "Closing the underlying socket");
-		m_socket.close();            // Close the underlying socket.
-		m_pWebSockerReader->end();   // Stop the web socket reader.
+		closeSocket();
 		return;
 	}
 	m_sentClose = true;              // Flag that we have sent a close request.
@@ -278,6 +581,7 @@ void WebSocket::close(uint16_t status, std::string message) {
 	frame.opCode = OPCODE_CLOSE;
 	frame.mask   = 0;
 	frame.len    = message.length() + 2;
+	::pthread_mutex_lock(&m_sendLock);
 	int rc = m_socket.send((uint8_t*) &frame, sizeof(frame));
 
 	if (rc > 0) {
@@ -287,14 +591,63 @@ void WebSocket::close(uint16_t status, std::string message) {
 	if (rc > 0) {
 		m_socket.send(message);
 	}
+	::pthread_mutex_unlock(&m_sendLock);
 
 	if (m_receivedClose || rc == 0 || rc == -1) {
-		m_socket.close();            // Close the underlying socket.
-		m_pWebSockerReader->end();   // Stop the web socket reader.
+		closeSocket();
 	}
 } // close
 
 
+/**
+ * @brief Close the underlying socket, stop the reader and leave the hub.
+ */
+void WebSocket::closeSocket() {
+	if (m_pHub != nullptr) {
+		m_pHub->remove(this);        // Stop broadcasting to the socket.
+	}
+	m_socket.close();                // Close the underlying socket.
+	m_pWebSockerReader->end();       // Stop the web socket reader.
+} // closeSocket
+
+
+/**
+ * @brief Encode the header of an unmasked, unfragmented frame as sent by a server.
+ * See the WebSocket spec (RFC6455) section "5.2 Base Framing Protocol".
+ * @param [out] pHeader The header, at least MAX_HEADER_LENGTH bytes.
+ * @param [in] length The length of the payload.
+ * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
+ * @param [in] compressed The payload was compressed with permessage-deflate.
+ * @return The length of the header.
+ */
+size_t WebSocket::encodeHeader(uint8_t* pHeader, uint64_t length, uint8_t sendType, bool compressed) {
+	Frame frame;
+	frame.fin    = 1;
+	frame.rsv1   = compressed ? 1 : 0;
+	frame.rsv2   = 0;
+	frame.rsv3   = 0;
+	frame.opCode = (sendType == SEND_TYPE_TEXT) ? OPCODE_TEXT : OPCODE_BINARY;
+	frame.mask   = 0;
+
+	int lengthBytes;    // The extended payload length is in network byte order.
+	if (length < 126) {
+		frame.len   = length;
+		lengthBytes = 0;
+	} else if (length <= 0xffff) {
+		frame.len   = 126;
+		lengthBytes = 2;
+	} else {
+		frame.len   = 127;
+		lengthBytes = 8;
+	}
+	memcpy(pHeader, &frame, sizeof(frame));
+	for (int i = 0; i < lengthBytes; i++) {
+		pHeader[sizeof(frame) + i] = (length >> (8 * (lengthBytes - 1 - i))) & 0xff;
+	}
+	return sizeof(frame) + lengthBytes;
+} // encodeHeader
+
+
 /**
  * @brief Get the current WebSocketHandler
  * A web socket handler is a user registered class instance that is called when an incoming
@@ -322,56 +675,55 @@ Socket WebSocket::getSocket() {
  * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
  */
 void WebSocket::send(std::string data, uint8_t sendType) {
-	ESP_LOGD(LOG_TAG, ">> send: Length: %d", data.length());
-	Frame frame;
-	frame.fin    = 1;
-	frame.rsv1   = 0;
-	frame.rsv2   = 0;
-	frame.rsv3   = 0;
-	frame.opCode = (sendType == SEND_TYPE_TEXT) ? OPCODE_TEXT : OPCODE_BINARY;
-	frame.mask   = 0;
-	if (data.length() < 126) {
-		frame.len = data.length();
-		m_socket.send((uint8_t*) &frame, sizeof(frame));
-	} else {
-		frame.len = 126;
-		m_socket.send((uint8_t*) &frame, sizeof(frame));
-		m_socket.send(htons((uint16_t) data.length()));  // Convert to network byte order from host byte order
-	}
-	m_socket.send((uint8_t*)data.data(), data.length());
-	ESP_LOGD(LOG_TAG, "<< send");
+	send((uint8_t*) data.data(), data.length(), sendType);
 } // send_cpp
 
 
 /**
  * @brief Send data down the web socket
  * See the WebSocket spec (RFC6455) section "6.1 Sending Data".
- * We build a WebSocket frame, send the frame followed by the data.
+ * We build a WebSocket frame, send the frame followed by the data.  If permessage-deflate was negotiated
+ * the data is compressed first.
  * @param [in] data The data to send down the WebSocket.
  * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
  */
-void WebSocket::send(uint8_t* data, uint16_t length, uint8_t sendType) {
+void WebSocket::send(uint8_t* data, size_t length, uint8_t sendType) {
 	ESP_LOGD(LOG_TAG, ">> send: Length: %d", length);
-	Frame frame;
-	frame.fin    = 1;
-	frame.rsv1   = 0;
-	frame.rsv2   = 0;
-	frame.rsv3   = 0;
-	frame.opCode = (sendType==SEND_TYPE_TEXT) ? OPCODE_TEXT : OPCODE_BINARY;
-	frame.mask   = 0;
-	if (length < 126) {
-		frame.len = length;
-		m_socket.send((uint8_t*) &frame, sizeof(frame));
-	} else {
-		frame.len = 126;
-		m_socket.send((uint8_t*) &frame, sizeof(frame));
-		m_socket.send(htons(length));  // Convert to network byte order from host byte order
+	uint8_t header[MAX_HEADER_LENGTH];
+	if (m_pDeflate != nullptr) {
+		// The compressor keeps its window between messages, so messages must be compressed in the order they
+		// are sent and by one task at a time: hold the lock across both.
+		std::string compressed;
+		::pthread_mutex_lock(&m_sendLock);
+		m_pDeflate->deflate(data, length, &compressed);
+		m_socket.send(header, encodeHeader(header, compressed.length(), sendType, true));
+		m_socket.send((uint8_t*) compressed.data(), compressed.length());
+		::pthread_mutex_unlock(&m_sendLock);
+		ESP_LOGD(LOG_TAG, "<< send: Compressed to %d", compressed.length());
+		return;
 	}
+	::pthread_mutex_lock(&m_sendLock);   // The header and the payload must go out together.
+	m_socket.send(header, encodeHeader(header, length, sendType));
 	m_socket.send(data, length);
+	::pthread_mutex_unlock(&m_sendLock);
 	ESP_LOGD(LOG_TAG, "<< send");
 }
 
 
+/**
+ * @brief Send a frame that has already been encoded, header and all.
+ * @param [in] pFrame The frame.
+ * @param [in] length The length of the frame.
+ * @return The result of the send on the socket.
+ */
+int WebSocket::sendFrame(const uint8_t* pFrame, size_t length) {
+	::pthread_mutex_lock(&m_sendLock);
+	int rc = m_socket.send(pFrame, length);
+	::pthread_mutex_unlock(&m_sendLock);
+	return rc;
+} // sendFrame
+
+
 /**
  * @brief Set the Web socket handler associated with this Websocket.
  *
@@ -397,23 +749,18 @@ void WebSocket::startReader() {
 
 /**
  * @brief Create a Web Socket input record streambuf
- * @param [in] socket The socket we will be reading from.
- * @param [in] dataLength The size of a record.
- * @param [in] bufferSize The size of the buffer we wish to allocate to hold data.
+ * The data of the message is read through the web socket reader, directly from its buffer.
+ * @param [in] pReader The reader of the web socket.
+ * @param [in] dataLength The payload length of the first frame of the message.
  */
 WebSocketInputStreambuf::WebSocketInputStreambuf(
-	Socket   socket,
-	size_t   dataLength,
-	uint8_t* pMask,
-	size_t   bufferSize) {
-	m_socket     = socket;    // The socket we will be reading from
+	WebSocketReader* pReader,
+	size_t           dataLength) {
+	m_pReader    = pReader;    // The reader we will be getting data from.
 	m_dataLength = dataLength; // The size of the record we wish to read.
-	m_pMask      = pMask;
-	m_bufferSize = bufferSize; // The size of the buffer used to hold data
 	m_sizeRead   = 0;          // The size of data read from the socket
-	m_buffer = new char[bufferSize]; // Create the buffer used to hold the data read from the socket.
 
-	setg(m_buffer, m_buffer, m_buffer); // Set the initial get buffer pointers to no data.
+	setg(nullptr, nullptr, nullptr); // Set the initial get buffer pointers to no data.
 } // WebSocketInputStreambuf
 
 
@@ -421,7 +768,6 @@ WebSocketInputStreambuf::WebSocketInputStreambuf(
  * @brief Destructor
  */
 WebSocketInputStreambuf::~WebSocketInputStreambuf() {
-	delete[] m_buffer;
 	discard();
 } // ~WebSocketInputRecordStreambuf
 
@@ -429,77 +775,59 @@ WebSocketInputStreambuf::~WebSocketInputStreambuf() {
 /**
  * @brief Discard data for the record that has not yet been read.
  *
- * We are working on a logical fixed length record in a socket stream.  This means that we know in advance
- * how big the record should be.  If we have read some data from the stream and no longer wish to consume
- * any further, we have to discard the remaining bytes in the stream before we can get to process the
- * next record.  This function discards the remainder of the data.
- *
- * For example, if our record size is 1000 bytes and we have read 700 bytes and determine that we no
- * longer need to continue, we can't just stop.  There are still 300 bytes in the socket stream that
- * need to be consumed/discarded before we can move on to the next record.
+ * We are working on a logical record in a socket stream.  If we have read some data from the stream and no
+ * longer wish to consume any further, we have to discard the remaining bytes of the message (including
+ * any further fragments of it) before we can get to process the next record.  This function discards the
+ * remainder of the data.
  */
 void WebSocketInputStreambuf::discard() {
-	uint8_t byte;
-	ESP_LOGD("WebSocketInputStreambuf", ">> discard: Discarding %d bytes", m_dataLength - m_sizeRead);
-	while(m_sizeRead < m_dataLength) {
-		m_socket.receive(&byte, 1);
-		m_sizeRead++;
+	ESP_LOGD("WebSocketInputStreambuf", ">> discard");
+	uint8_t* pData;
+	size_t length;
+	while ((length = m_pReader->readMessage(&pData)) > 0) {
+		m_sizeRead += length;
 	}
+	setg(nullptr, nullptr, nullptr);
 	ESP_LOGD("WebSocketInputStreambuf", "<< discard");
 } // discard
 
 
 /**
  * @brief Get the size of the expected record.
- * @return The size of the expected record.
+ * A message fragmented over several frames may be longer than this.
+ * @return The payload length of the first frame of the message.
  */
 size_t WebSocketInputStreambuf::getRecordSize() {
 	return m_dataLength;
 } // getRecordSize
 
 
+/**
+ * @brief Get the number of bytes of the message read so far.
+ * @return The number of bytes read.
+ */
+size_t WebSocketInputStreambuf::getSizeRead() {
+	return m_sizeRead;
+} // getSizeRead
+
+
 /**
  * @brief Handle the request to read data from the stream but we need more data from the source.
- *
+ * The get area is pointed at the next piece of the message in the reader's buffer.
  */
 WebSocketInputStreambuf::int_type WebSocketInputStreambuf::underflow() {
 	ESP_LOGD("WebSocketInputStreambuf", ">> underflow");
 
-	// If we have already read as many bytes as our record definition says we should read
-	// then don't attempt to ready any further.
-	if (m_sizeRead >= getRecordSize()) {
-		ESP_LOGD("WebSocketInputStreambuf", "<< underflow: Already read maximum");
-		return EOF;
-	}
-
-	// We wish to refill the buffer.  We want to read data from the socket.  We want to read either
-	// the size of the buffer to fill it or the maximum number of bytes remaining to be read.
-	// We will choose which ever is smaller as the number of bytes to read into the buffer.
-	size_t remainingBytes = getRecordSize() - m_sizeRead;
-	size_t sizeToRead;
-	if (remainingBytes < m_bufferSize) {
-		sizeToRead = remainingBytes;
-	} else {
-		sizeToRead = m_bufferSize;
-	}
-
-	ESP_LOGD("WebSocketInputRecordStreambuf", "- getting next buffer of data; size request: %d", sizeToRead);
-	size_t bytesRead = m_socket.receive((uint8_t*) m_buffer, sizeToRead, true);
+	uint8_t* pData;
+	size_t bytesRead = m_pReader->readMessage(&pData);
 	if (bytesRead == 0) {
-		ESP_LOGD("WebSocketInputRecordStreambuf", "<< underflow: Read 0 bytes");
+		ESP_LOGD("WebSocketInputRecordStreambuf", "<< underflow: End of message");
 		return EOF;
 	}
 
-	// If the WebSocket frame shows that we have a mask bit set then we have to unmask the data.
-	if (m_pMask != nullptr) {
-		for (int i = 0; i < bytesRead; i++) {
-			m_buffer[i] = m_buffer[i] ^ m_pMask[(m_sizeRead + i) % 4];
-		}
-	}
-
 	m_sizeRead += bytesRead;  // Increase the count of number of bytes actually read from the source.
 
-	setg(m_buffer, m_buffer, m_buffer + bytesRead); // Changethe buffer pointers to reflect the new data read.
+	setg((char*) pData, (char*) pData, (char*) pData + bytesRead); // Change the buffer pointers to reflect the new data read.
 	ESP_LOGD("WebSocketInputRecordStreambuf", "<< underflow - got %d more bytes", bytesRead);
 	return traits_type::to_int_type(*gptr());
 } // underflow
@@ -7,6 +7,7 @@
 
 #ifndef COMPONENTS_WEBSOCKET_H_
 #define COMPONENTS_WEBSOCKET_H_
+#include <pthread.h>
 #include <string>
 #include "Socket.h"
 
@@ -14,6 +15,8 @@
 #undef send
 class WebSocketReader;
 class WebSocket;
+class WebSocketHub;
+class WebSocketDeflate;
 
 // +-------------------------------+
 // | WebSocketInputStreambuf |
@@ -21,22 +24,18 @@ class WebSocket;
 class WebSocketInputStreambuf : public std::streambuf {
 public:
 	WebSocketInputStreambuf(
-		Socket   socket,
-		size_t   dataLength,
-		uint8_t* pMask = nullptr,
-		size_t   bufferSize = 2048);
+		WebSocketReader* pReader,
+		size_t           dataLength);
 	~WebSocketInputStreambuf();
 	int_type underflow();
 	void discard();
 	size_t getRecordSize();
+	size_t getSizeRead();
 
 private:
-	char*    m_buffer;
-	Socket   m_socket;
-	size_t   m_dataLength;
-	size_t   m_bufferSize;
-	size_t   m_sizeRead;
-	uint8_t* m_pMask;
+	WebSocketReader* m_pReader;
+	size_t           m_dataLength;
+	size_t           m_sizeRead;
 
 };
 
@@ -84,18 +83,30 @@ public:
 	WebSocketHandler* getHandler();
 	Socket            getSocket();
 	void              send(std::string data, uint8_t sendType = SEND_TYPE_BINARY);
-	void              send(uint8_t* data, uint16_t length, uint8_t sendType = SEND_TYPE_BINARY);
+	void              send(uint8_t* data, size_t length, uint8_t sendType = SEND_TYPE_BINARY);
 	void              setHandler(WebSocketHandler *handler);
 
+	static const size_t MAX_HEADER_LENGTH = 10;
+
+	static size_t     encodeHeader(uint8_t* pHeader, uint64_t length, uint8_t sendType, bool compressed = false);
+
 private:
 	friend class WebSocketReader;
+	friend class WebSocketHub;
 	friend class HttpServerTask;
+	friend class HttpServerWorker;
+	friend class HttpRequest;
+	void              closeSocket();
+	int               sendFrame(const uint8_t* pFrame, size_t length);
 	void              startReader();
 	bool              m_receivedClose; // True when we have received a close request.
 	bool              m_sentClose;	 // True when we have sent a close request.
 	Socket            m_socket;		// Partner socket.
 	WebSocketHandler* m_pWebSocketHandler;
 	WebSocketReader*  m_pWebSockerReader;
+	WebSocketHub*     m_pHub;          // The hub this web socket belongs to, if any.
+	WebSocketDeflate* m_pDeflate;      // The permessage-deflate extension, if negotiated.
+	pthread_mutex_t   m_sendLock;      // Held while a frame is compressed and sent so that frames from the hub and the application don't interleave.
 
 }; // WebSocket
 
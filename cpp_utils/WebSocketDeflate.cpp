@@ -0,0 +1,599 @@
+/*
+ * WebSocketDeflate.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sstream>
+#include <vector>
+#include <esp_log.h>
+#include "GeneralUtils.h"
+#include "WebSocketDeflate.h"
+
+static const char* LOG_TAG = "WebSocketDeflate";
+
+static const int    HASH_BITS = 10;
+static const size_t HASH_SIZE = 1 << HASH_BITS;
+static const int    MAX_CHAIN = 16;      // The most earlier positions examined when looking for a match.
+static const size_t MIN_MATCH = 3;
+static const size_t MAX_MATCH = 258;
+
+// Lengths 3 to 258 are coded by symbols 257 to 285 and distances by codes 0 to 29 (RFC 1951 3.2.5).
+static const uint16_t LENGTH_BASE[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LENGTH_EXTRA[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t DISTANCE_BASE[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+	4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t DISTANCE_EXTRA[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// The end of a sync flush, removed by the sender of every compressed message (RFC 7692 7.2.1).
+static const uint8_t FLUSH_TAIL[4] = { 0x00, 0x00, 0xff, 0xff };
+
+
+/**
+ * @brief Writes a deflate bit stream, least significant bit first.
+ */
+class BitWriter {
+public:
+	BitWriter(std::string* pOut) {
+		m_pOut  = pOut;
+		m_bits  = 0;
+		m_count = 0;
+	}
+
+	void flush() {
+		if (m_count > 0) {
+			m_pOut->push_back((char) (m_bits & 0xff));
+		}
+		m_bits  = 0;
+		m_count = 0;
+	}
+
+	void put(uint32_t value, int count) {
+		m_bits  |= value << m_count;
+		m_count += count;
+		while (m_count >= 8) {
+			m_pOut->push_back((char) (m_bits & 0xff));
+			m_bits  >>= 8;
+			m_count -= 8;
+		}
+	}
+
+	// Huffman codes are sent most significant bit first.
+	void putCode(uint32_t code, int length) {
+		uint32_t reversed = 0;
+		for (int i = 0; i < length; i++) {
+			reversed = (reversed << 1) | ((code >> i) & 1);
+		}
+		put(reversed, length);
+	}
+
+	void putLiteral(uint8_t value) {
+		if (value < 144) {
+			putCode(0x30 + value, 8);
+		} else {
+			putCode(0x190 + value - 144, 9);
+		}
+	}
+
+	void putMatch(size_t length, size_t distance) {
+		int i = 28;
+		while (LENGTH_BASE[i] > length) i--;
+		putSymbol(257 + i);
+		put(length - LENGTH_BASE[i], LENGTH_EXTRA[i]);
+		int d = 29;
+		while (DISTANCE_BASE[d] > distance) d--;
+		putCode(d, 5);
+		put(distance - DISTANCE_BASE[d], DISTANCE_EXTRA[d]);
+	}
+
+	void putSymbol(int symbol) {
+		if (symbol < 280) {
+			putCode(symbol - 256, 7);
+		} else {
+			putCode(0xc0 + symbol - 280, 8);
+		}
+	}
+
+private:
+	std::string* m_pOut;
+	uint32_t     m_bits;
+	int          m_count;
+}; // BitWriter
+
+
+/**
+ * @brief Decodes one deflate stream (RFC 1951) after the manner of zlib's puff.
+ * The input is followed by the four bytes of the sync flush that the sender removed.  Back references may
+ * reach into the history of the previous messages.
+ */
+class Inflater {
+public:
+	Inflater(const uint8_t* data, size_t length, std::string* pOut, const std::string& history, size_t maxLength)
+		: m_history(history) {
+		m_data      = data;
+		m_length    = length + sizeof(FLUSH_TAIL);
+		m_pos       = 0;
+		m_bits      = 0;
+		m_bitCount  = 0;
+		m_pOut      = pOut;
+		m_maxLength = maxLength;
+		m_error     = false;
+	}
+
+	bool run() {
+		int last;
+		do {
+			last = bits(1);
+			int type = bits(2);
+			if (m_error) return false;
+			bool ok;
+			switch (type) {
+				case 0:
+					ok = stored();
+					break;
+				case 1:
+					ok = fixed();
+					break;
+				case 2:
+					ok = dynamic();
+					break;
+				default:
+					ok = false;
+					break;
+			}
+			if (!ok || m_error) return false;
+		} while (!last && m_pos < m_length);
+		return true;
+	}
+
+private:
+	struct Huffman {
+		uint16_t count[16];     // Number of codes of each length.
+		uint16_t symbol[288];   // Symbols ordered by code.
+	};
+
+	struct FixedTables {
+		Huffman lengthCode;
+		Huffman distanceCode;
+	};
+
+	const uint8_t*     m_data;
+	size_t             m_length;
+	size_t             m_pos;
+	uint32_t           m_bits;
+	int                m_bitCount;
+	std::string*       m_pOut;
+	const std::string& m_history;
+	size_t             m_maxLength;
+	bool               m_error;
+
+	int bits(int count) {
+		uint32_t value = m_bits;
+		while (m_bitCount < count) {
+			if (m_pos >= m_length) {
+				m_error = true;
+				return 0;
+			}
+			value |= (uint32_t) nextByte() << m_bitCount;
+			m_bitCount += 8;
+		}
+		m_bits      = value >> count;
+		m_bitCount -= count;
+		return value & ((1UL << count) - 1);
+	}
+
+	uint8_t nextByte() {
+		size_t pos = m_pos++;
+		return pos < m_length - sizeof(FLUSH_TAIL) ? m_data[pos] : FLUSH_TAIL[pos - (m_length - sizeof(FLUSH_TAIL))];
+	}
+
+	bool codes(const Huffman& lengthCode, const Huffman& distanceCode) {
+		while (true) {
+			int symbol = decode(lengthCode);
+			if (symbol < 0) return false;
+			if (symbol == 256) return true;
+			if (symbol < 256) {
+				m_pOut->push_back((char) symbol);
+			} else {
+				symbol -= 257;
+				if (symbol >= 29) return false;
+				size_t length = LENGTH_BASE[symbol] + bits(LENGTH_EXTRA[symbol]);
+				int d = decode(distanceCode);
+				if (d < 0 || d >= 30) return false;
+				size_t distance = DISTANCE_BASE[d] + bits(DISTANCE_EXTRA[d]);
+				if (m_error || distance > m_pOut->size() + m_history.size()) return false;
+				while (length-- > 0) {
+					size_t size = m_pOut->size();
+					char c = distance <= size ? (*m_pOut)[size - distance] : m_history[m_history.size() - (distance - size)];
+					m_pOut->push_back(c);
+				}
+			}
+			if (m_pOut->size() > m_maxLength) return false;
+		}
+	}
+
+	static int construct(Huffman* pHuffman, const uint8_t* lengths, int n) {
+		for (int length = 0; length < 16; length++) {
+			pHuffman->count[length] = 0;
+		}
+		for (int symbol = 0; symbol < n; symbol++) {
+			pHuffman->count[lengths[symbol]]++;
+		}
+		if (pHuffman->count[0] == n) return 0;   // No codes; complete, but decoding will fail.
+
+		int left = 1;                            // Codes of the current length left unused; negative if over-subscribed.
+		for (int length = 1; length < 16; length++) {
+			left <<= 1;
+			left -= pHuffman->count[length];
+			if (left < 0) return left;
+		}
+
+		uint16_t offsets[16];
+		offsets[1] = 0;
+		for (int length = 1; length < 15; length++) {
+			offsets[length + 1] = offsets[length] + pHuffman->count[length];
+		}
+		for (int symbol = 0; symbol < n; symbol++) {
+			if (lengths[symbol] != 0) {
+				pHuffman->symbol[offsets[lengths[symbol]]++] = symbol;
+			}
+		}
+		return left;                             // Positive if the code is incomplete.
+	}
+
+	int decode(const Huffman& huffman) {
+		int code  = 0;   // The bits decoded so far.
+		int first = 0;   // The first code of the current length.
+		int index = 0;   // The index of the first code of the current length in the symbol table.
+		for (int length = 1; length < 16; length++) {
+			code |= bits(1);
+			if (m_error) return -1;
+			int count = huffman.count[length];
+			if (code - count < first) {
+				return huffman.symbol[index + (code - first)];
+			}
+			index += count;
+			first += count;
+			first <<= 1;
+			code  <<= 1;
+		}
+		return -1;
+	}
+
+	bool dynamic() {
+		static const uint8_t ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		uint8_t lengths[286 + 30];
+		Huffman lengthCode;
+		Huffman distanceCode;
+
+		int lengthCount   = bits(5) + 257;
+		int distanceCount = bits(5) + 1;
+		int codeCount     = bits(4) + 4;
+		if (m_error || lengthCount > 286 || distanceCount > 30) return false;
+
+		int index;
+		for (index = 0; index < codeCount; index++) {
+			lengths[ORDER[index]] = bits(3);
+		}
+		for (; index < 19; index++) {
+			lengths[ORDER[index]] = 0;
+		}
+		if (m_error || construct(&lengthCode, lengths, 19) != 0) return false;
+
+		index = 0;
+		while (index < lengthCount + distanceCount) {
+			int symbol = decode(lengthCode);
+			if (symbol < 0) return false;
+			if (symbol < 16) {
+				lengths[index++] = symbol;
+				continue;
+			}
+			uint8_t length = 0;
+			if (symbol == 16) {
+				if (index == 0) return false;
+				length = lengths[index - 1];
+				symbol = 3 + bits(2);
+			} else if (symbol == 17) {
+				symbol = 3 + bits(3);
+			} else {
+				symbol = 11 + bits(7);
+			}
+			if (m_error || index + symbol > lengthCount + distanceCount) return false;
+			while (symbol-- > 0) {
+				lengths[index++] = length;
+			}
+		}
+		if (lengths[256] == 0) return false;     // There must be an end of block code.
+
+		int rc = construct(&lengthCode, lengths, lengthCount);
+		if (rc < 0 || (rc > 0 && lengthCount - lengthCode.count[0] != 1)) return false;
+		rc = construct(&distanceCode, lengths + lengthCount, distanceCount);
+		if (rc < 0 || (rc > 0 && distanceCount - distanceCode.count[0] != 1)) return false;
+		return codes(lengthCode, distanceCode);
+	}
+
+	bool fixed() {
+		static const FixedTables tables = buildFixedTables();
+		return codes(tables.lengthCode, tables.distanceCode);
+	}
+
+	static FixedTables buildFixedTables() {
+		FixedTables tables;
+		uint8_t lengths[288];
+		int symbol;
+		for (symbol = 0; symbol < 144; symbol++) lengths[symbol] = 8;
+		for (; symbol < 256; symbol++) lengths[symbol] = 9;
+		for (; symbol < 280; symbol++) lengths[symbol] = 7;
+		for (; symbol < 288; symbol++) lengths[symbol] = 8;
+		construct(&tables.lengthCode, lengths, 288);
+		for (symbol = 0; symbol < 30; symbol++) lengths[symbol] = 5;
+		construct(&tables.distanceCode, lengths, 30);
+		return tables;
+	}
+
+	bool stored() {
+		m_bits     = 0;     // A stored block starts on a byte boundary.
+		m_bitCount = 0;
+		if (m_pos + 4 > m_length) return false;
+		size_t length = nextByte();
+		length |= nextByte() << 8;
+		size_t check = nextByte();
+		check |= nextByte() << 8;
+		if (length != (~check & 0xffff) || m_pos + length > m_length) return false;
+		while (length-- > 0) {
+			m_pOut->push_back((char) nextByte());
+		}
+		return m_pOut->size() <= m_maxLength;
+	}
+}; // Inflater
+
+
+/**
+ * @brief Set up the extension as negotiated.
+ * @param [in] deflateWindowBits The window for the messages we send.
+ * @param [in] deflateTakeover Keep the window for messages we send from one message to the next.
+ * @param [in] inflateWindowBits The window for the messages we receive.
+ * @param [in] inflateTakeover Keep the window for messages we receive from one message to the next.
+ */
+WebSocketDeflate::WebSocketDeflate(uint8_t deflateWindowBits, bool deflateTakeover, uint8_t inflateWindowBits, bool inflateTakeover) {
+	m_deflateWindowSize = 1 << deflateWindowBits;
+	m_deflateTakeover   = deflateTakeover;
+	m_window            = new uint8_t[2 * m_deflateWindowSize];
+	m_head              = new uint16_t[HASH_SIZE];
+	m_prev              = new uint16_t[m_deflateWindowSize];
+	m_inflateWindowSize = 1 << inflateWindowBits;
+	m_inflateTakeover   = inflateTakeover;
+	resetDeflate();
+} // WebSocketDeflate
+
+
+WebSocketDeflate::~WebSocketDeflate() {
+	delete[] m_window;
+	delete[] m_head;
+	delete[] m_prev;
+} // ~WebSocketDeflate
+
+
+/**
+ * @brief Compress a message.
+ * The message is coded as one block with the fixed Huffman codes and ends with a sync flush, less its last
+ * four bytes, as RFC 7692 requires.
+ * @param [in] data The message.
+ * @param [in] length The length of the message.
+ * @param [out] pOut The compressed message is appended.
+ * @return True if the message was compressed.
+ */
+bool WebSocketDeflate::deflate(const uint8_t* data, size_t length, std::string* pOut) {
+	if (!m_deflateTakeover) {
+		resetDeflate();
+	}
+	BitWriter writer(pOut);
+	writer.put(0, 1);   // BFINAL; later messages continue the stream.
+	writer.put(1, 2);   // BTYPE; fixed Huffman codes.
+
+	size_t windowSize = m_deflateWindowSize;
+	while (length > 0) {
+		if (m_windowLength == 2 * windowSize) {
+			slideWindow();
+		}
+		size_t count = 2 * windowSize - m_windowLength;
+		if (count > length) {
+			count = length;
+		}
+		memcpy(m_window + m_windowLength, data, count);
+		size_t pos = m_windowLength;
+		m_windowLength += count;
+		data           += count;
+		length         -= count;
+
+		while (pos < m_windowLength) {
+			size_t available = m_windowLength - pos;
+			if (available > MAX_MATCH) {
+				available = MAX_MATCH;
+			}
+			size_t bestLength   = 0;
+			size_t bestDistance = 0;
+			if (available >= MIN_MATCH) {
+				// Position 0 marks an empty chain, so it is never matched.
+				uint8_t* p = m_window + pos;
+				uint32_t hash = ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761U) >> (32 - HASH_BITS);
+				size_t candidate = m_head[hash];
+				m_prev[pos & (windowSize - 1)] = candidate;
+				m_head[hash] = pos;
+				for (int chain = 0; chain < MAX_CHAIN && candidate > 0 && pos - candidate < windowSize; chain++) {
+					uint8_t* q = m_window + candidate;
+					if (q[bestLength] == p[bestLength]) {
+						size_t matched = 0;
+						while (matched < available && q[matched] == p[matched]) matched++;
+						if (matched > bestLength) {
+							bestLength   = matched;
+							bestDistance = pos - candidate;
+							if (matched == available) break;
+						}
+					}
+					size_t next = m_prev[candidate & (windowSize - 1)];
+					if (next >= candidate) break;
+					candidate = next;
+				}
+			}
+
+			if (bestLength >= MIN_MATCH) {
+				writer.putMatch(bestLength, bestDistance);
+				for (size_t i = 1; i < bestLength && pos + i + MIN_MATCH <= m_windowLength; i++) {
+					uint8_t* p = m_window + pos + i;
+					uint32_t hash = ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761U) >> (32 - HASH_BITS);
+					m_prev[(pos + i) & (windowSize - 1)] = m_head[hash];
+					m_head[hash] = pos + i;
+				}
+				pos += bestLength;
+			} else {
+				writer.putLiteral(m_window[pos]);
+				pos++;
+			}
+		}
+	}
+
+	writer.putSymbol(256);   // End of block.
+	writer.put(0, 1);        // The empty stored block of the sync flush, up to the byte boundary.
+	writer.put(0, 2);
+	writer.flush();
+	return true;
+} // deflate
+
+
+/**
+ * @brief Decompress a message.
+ * @param [in] data The compressed message as received.
+ * @param [in] length The length of the compressed message.
+ * @param [out] pOut The message.
+ * @param [in] maxLength The largest message accepted.
+ * @return False if the message was corrupt or too long.
+ */
+bool WebSocketDeflate::inflate(const uint8_t* data, size_t length, std::string* pOut, size_t maxLength) {
+	if (!m_inflateTakeover) {
+		m_history.clear();
+	}
+	pOut->clear();
+	Inflater inflater(data, length, pOut, m_history, maxLength);
+	if (!inflater.run()) {
+		ESP_LOGD(LOG_TAG, "Compressed message is corrupt or longer than %d bytes", maxLength);
+		return false;
+	}
+	if (m_inflateTakeover) {
+		m_history.append(*pOut);
+		if (m_history.length() > m_inflateWindowSize) {
+			m_history.erase(0, m_history.length() - m_inflateWindowSize);
+		}
+	}
+	return true;
+} // inflate
+
+
+/**
+ * @brief Accept the first permessage-deflate offer that can be met.
+ *
+ * The window in each direction is no larger than the configured one.  The client can only be asked to limit
+ * its window if it offered client_max_window_bits; if it didn't, the offer is declined unless the configured
+ * window is the full 32 KB.  Without context takeover both sides are asked not to keep their windows between
+ * messages.
+ *
+ * @param [in] offers The value of the Sec-WebSocket-Extensions header of the upgrade request.
+ * @param [in] config How the server offers the extension.
+ * @param [out] pResponse The value of the Sec-WebSocket-Extensions header of the response.
+ * @return The extension, or nullptr if no offer was accepted and messages are not to be compressed.
+ */
+WebSocketDeflate* WebSocketDeflate::negotiate(const std::string& offers, const WebSocketDeflateConfig& config, std::string* pResponse) {
+	if (!config.enabled) return nullptr;
+	int windowBits = config.windowBits < 9 ? 9 : (config.windowBits > 15 ? 15 : config.windowBits);
+
+	std::vector<std::string> offerList = GeneralUtils::split(offers, ',');
+	for (auto& offer : offerList) {
+		std::vector<std::string> params = GeneralUtils::split(offer, ';');
+		if (params.empty() || GeneralUtils::trim(params[0]) != "permessage-deflate") continue;   // An empty offer, as in "a,,b".
+
+		bool ok                 = true;
+		bool serverNoTakeover   = !config.contextTakeover;
+		bool clientNoTakeover   = !config.contextTakeover;
+		int  serverBits         = windowBits;
+		bool clientBitsOffered  = false;
+		int  clientBits         = 15;
+		for (size_t i = 1; i < params.size(); i++) {
+			std::string param = GeneralUtils::trim(params[i]);
+			if (param.find_first_not_of(' ') == std::string::npos) continue;   // Nothing between two ';'; trim() leaves spaces alone.
+			std::string name  = param;
+			std::string value;
+			size_t equals = param.find('=');
+			if (equals != std::string::npos) {
+				name  = GeneralUtils::trim(param.substr(0, equals));
+				value = GeneralUtils::trim(param.substr(equals + 1));
+				if (value.length() >= 2 && value[0] == '"' && value[value.length() - 1] == '"') {
+					value = value.substr(1, value.length() - 2);
+				}
+			}
+			int bits = atoi(value.c_str());
+			if (name == "server_no_context_takeover") {
+				serverNoTakeover = true;
+			} else if (name == "client_no_context_takeover") {
+				clientNoTakeover = true;
+			} else if (name == "server_max_window_bits") {
+				if (bits < 8 || bits > 15) ok = false;
+				if (bits < serverBits) serverBits = bits;
+			} else if (name == "client_max_window_bits") {
+				clientBitsOffered = true;
+				if (!value.empty()) {
+					if (bits < 8 || bits > 15) ok = false;
+					clientBits = bits;
+				}
+			} else {
+				ok = false;    // A parameter we don't know makes the offer unacceptable.
+			}
+		}
+		if (!ok) continue;
+		if (!clientBitsOffered && windowBits < 15) continue;   // We can't limit the client's window.
+
+		int inflateBits = clientBits < windowBits ? clientBits : windowBits;
+		std::ostringstream response;
+		response << "permessage-deflate";
+		if (serverNoTakeover) response << "; server_no_context_takeover";
+		if (clientNoTakeover) response << "; client_no_context_takeover";
+		if (serverBits < 15) response << "; server_max_window_bits=" << serverBits;
+		if (clientBitsOffered) response << "; client_max_window_bits=" << inflateBits;
+		*pResponse = response.str();
+		ESP_LOGD(LOG_TAG, "Accepted: %s", pResponse->c_str());
+
+		// zlib can't compress with a window of 8 bits and quietly uses 9, so allow for that.
+		return new WebSocketDeflate(serverBits, !serverNoTakeover, inflateBits < 9 ? 9 : inflateBits, !clientNoTakeover);
+	}
+	return nullptr;
+} // negotiate
+
+
+/**
+ * @brief Forget the messages compressed so far.
+ */
+void WebSocketDeflate::resetDeflate() {
+	m_windowLength = 0;
+	memset(m_head, 0, HASH_SIZE * sizeof(uint16_t));
+	memset(m_prev, 0, m_deflateWindowSize * sizeof(uint16_t));
+} // resetDeflate
+
+
+/**
+ * @brief Move the second half of the window to the first, making room for more data.
+ */
+void WebSocketDeflate::slideWindow() {
+	size_t windowSize = m_deflateWindowSize;
+	memcpy(m_window, m_window + windowSize, windowSize);
+	m_windowLength = windowSize;
+	for (size_t i = 0; i < HASH_SIZE; i++) {
+		m_head[i] = m_head[i] >= windowSize ? m_head[i] - windowSize : 0;
+	}
+	for (size_t i = 0; i < windowSize; i++) {
+		m_prev[i] = m_prev[i] >= windowSize ? m_prev[i] - windowSize : 0;
+	}
+} // slideWindow
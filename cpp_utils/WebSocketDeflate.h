@@ -0,0 +1,65 @@
+/*
+ * WebSocketDeflate.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_WEBSOCKETDEFLATE_H_
+#define COMPONENTS_CPP_UTILS_WEBSOCKETDEFLATE_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/**
+ * @brief How a server offers the permessage-deflate extension to its web socket clients.
+ */
+struct WebSocketDeflateConfig {
+	bool    enabled;          // Accept the extension when a client offers it.
+	uint8_t windowBits;       // Base 2 logarithm of the largest window used in either direction, 9 to 15.
+	bool    contextTakeover;  // Keep the window from one message to the next.
+};
+
+
+/**
+ * @brief The permessage-deflate extension (RFC 7692) of one web socket.
+ *
+ * Messages sent are compressed with LZ77 over a window of our choosing and coded with the fixed Huffman
+ * codes, which keeps the compressor small.  Messages received are decompressed by a complete inflater.
+ * The memory needed in each direction is set by the window size; the client is asked to limit its window
+ * in the same way, and the extension is declined if it can't be asked.  With context takeover the window is
+ * kept between messages, which is where repetitive messages such as telemetry gain the most.
+ */
+class WebSocketDeflate {
+public:
+	virtual ~WebSocketDeflate();
+
+	bool deflate(const uint8_t* data, size_t length, std::string* pOut);
+	bool inflate(const uint8_t* data, size_t length, std::string* pOut, size_t maxLength);
+
+	static WebSocketDeflate* negotiate(const std::string& offers, const WebSocketDeflateConfig& config, std::string* pResponse);
+
+private:
+	WebSocketDeflate(uint8_t deflateWindowBits, bool deflateTakeover, uint8_t inflateWindowBits, bool inflateTakeover);
+
+	// Compression.
+	size_t    m_deflateWindowSize;
+	bool      m_deflateTakeover;
+	uint8_t*  m_window;           // Data compressed, twice the window size so that it slides half at a time.
+	size_t    m_windowLength;
+	uint16_t* m_head;             // Most recent position of each hash of three bytes.
+	uint16_t* m_prev;             // Previous position with the same hash as each position in the window.
+
+	// Decompression.
+	size_t      m_inflateWindowSize;
+	bool        m_inflateTakeover;
+	std::string m_history;        // The end of the previous messages, for back references into them.
+
+	void resetDeflate();
+	void slideWindow();
+
+	WebSocketDeflate(const WebSocketDeflate&);             // Not copyable, we own the window.
+	WebSocketDeflate& operator=(const WebSocketDeflate&);
+
+}; // WebSocketDeflate
+
+#endif /* COMPONENTS_CPP_UTILS_WEBSOCKETDEFLATE_H_ */
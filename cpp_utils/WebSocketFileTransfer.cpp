@@ -54,7 +54,7 @@ public:
 	/**
 	 * @brief Handler for the message received over the web socket.
 	 */
-	virtual void onMessage(WebSocketInputStreambuf* pWebSocketInputStreambuf) {
+	virtual void onMessage(WebSocketInputStreambuf* pWebSocketInputStreambuf, WebSocket* pWebSocket) {
 		ESP_LOGD("FileTransferWebSocketHandler", ">> onMessage");
 		// Test to see if we are currently active.  If not, this is the start of a transfer.
 		if (!m_active) {
@@ -109,6 +109,7 @@ public:
 		else {
 			// We are about to receive a chunk of file
 			m_ofStream << pWebSocketInputStreambuf;
+			m_sizeReceived += pWebSocketInputStreambuf->getSizeRead();
 			/*
 			std::stringstream bufferStream;
 			bufferStream << pWebSocketInputRecordStreambuf;
@@ -0,0 +1,250 @@
+/*
+ * WebSocketHub.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "WebSocketHub.h"
+#include "FreeRTOS.h"
+#include <esp_log.h>
+
+static const char* LOG_TAG = "WebSocketHub";
+
+static const uint32_t SEND_TASK_STACK_SIZE = 4096;
+
+
+/**
+ * @brief Create a hub.
+ * @param [in] queueLength The maximum number of frames waiting to be sent to each client.
+ * @param [in] policy What to do when a client's queue is full.
+ */
+WebSocketHub::WebSocketHub(size_t queueLength, SlowConsumerPolicy policy) {
+	m_queueLength     = queueLength;
+	m_policy          = policy;
+	m_disconnectCount = 0;
+	m_dropCount       = 0;
+	::pthread_mutex_init(&m_lock, nullptr);
+} // WebSocketHub
+
+
+WebSocketHub::~WebSocketHub() {
+	::pthread_mutex_lock(&m_lock);
+	while (!m_clients.empty()) {
+		removeClient(m_clients.begin());
+	}
+	::pthread_mutex_unlock(&m_lock);
+	::pthread_mutex_destroy(&m_lock);
+} // ~WebSocketHub
+
+
+/**
+ * @brief Add a web socket to the hub.
+ * @param [in] pWebSocket The web socket.
+ */
+void WebSocketHub::add(WebSocket* pWebSocket) {
+	Client* pClient     = new Client();
+	pClient->pWebSocket = pWebSocket;
+	pClient->started    = false;
+	pClient->closing    = false;
+	::pthread_mutex_init(&pClient->lock, nullptr);
+	::pthread_cond_init(&pClient->ready, nullptr);
+
+	::pthread_mutex_lock(&m_lock);
+	if (m_clients.find(pWebSocket) != m_clients.end()) {
+		::pthread_mutex_unlock(&m_lock);
+		deleteClient(pClient);
+		return;
+	}
+	m_clients.insert(std::pair<WebSocket*, Client*>(pWebSocket, pClient));
+	pWebSocket->m_pHub = this;
+	::pthread_mutex_unlock(&m_lock);
+	ESP_LOGD(LOG_TAG, "Added web socket %s", pWebSocket->getSocket().toString().c_str());
+} // add
+
+
+/**
+ * @brief Send a message to every web socket in the hub.
+ * The frame is encoded once and queued for each client; this doesn't wait for any of them to send it.
+ * @param [in] data The message.
+ * @param [in] length The length of the message.
+ * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
+ * @return The number of clients the message was queued for.
+ */
+size_t WebSocketHub::broadcast(const uint8_t* data, size_t length, uint8_t sendType) {
+	uint8_t header[WebSocket::MAX_HEADER_LENGTH];
+	size_t headerLength = WebSocket::encodeHeader(header, length, sendType);
+	Frame* pFrame = new Frame();
+	pFrame->data.reserve(headerLength + length);
+	pFrame->data.append((const char*) header, headerLength);
+	pFrame->data.append((const char*) data, length);
+	pFrame->headerLength = headerLength;
+	pFrame->sendType     = sendType;
+	FramePtr frame(pFrame);
+
+	size_t queued = 0;
+	::pthread_mutex_lock(&m_lock);
+	auto it = m_clients.begin();
+	while (it != m_clients.end()) {
+		Client* pClient = it->second;
+		::pthread_mutex_lock(&pClient->lock);
+		if (pClient->frames.size() >= m_queueLength) {
+			if (m_policy == DISCONNECT) {
+				::pthread_mutex_unlock(&pClient->lock);
+				ESP_LOGD(LOG_TAG, "Disconnecting slow web socket %s", pClient->pWebSocket->getSocket().toString().c_str());
+				// Shutting the socket down fails a send that is blocked and has the reader close the web socket.
+				::shutdown(pClient->pWebSocket->m_socket.getFD(), SHUT_RDWR);
+				m_disconnectCount++;
+				removeClient(it++);
+				continue;
+			}
+			pClient->frames.pop_front();
+			m_dropCount++;
+		}
+		pClient->frames.push_back(frame);
+		bool start = !pClient->started;
+		pClient->started = true;
+		::pthread_cond_signal(&pClient->ready);
+		::pthread_mutex_unlock(&pClient->lock);
+
+		if (start) {
+			FreeRTOS::startTask(sendTask, "WebSocketHub", pClient, SEND_TASK_STACK_SIZE);
+		}
+		queued++;
+		++it;
+	}
+	::pthread_mutex_unlock(&m_lock);
+	return queued;
+} // broadcast
+
+
+/**
+ * @brief Send a message to every web socket in the hub.
+ * @param [in] data The message.
+ * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
+ * @return The number of clients the message was queued for.
+ */
+size_t WebSocketHub::broadcast(const std::string& data, uint8_t sendType) {
+	return broadcast((const uint8_t*) data.data(), data.length(), sendType);
+} // broadcast
+
+
+/**
+ * @brief Release a client once nothing refers to it any more.
+ */
+void WebSocketHub::deleteClient(Client* pClient) {
+	::pthread_cond_destroy(&pClient->ready);
+	::pthread_mutex_destroy(&pClient->lock);
+	delete pClient;
+} // deleteClient
+
+
+/**
+ * @brief Get the number of web sockets in the hub.
+ */
+size_t WebSocketHub::getClientCount() {
+	::pthread_mutex_lock(&m_lock);
+	size_t count = m_clients.size();
+	::pthread_mutex_unlock(&m_lock);
+	return count;
+} // getClientCount
+
+
+uint32_t WebSocketHub::getDisconnectCount() {
+	return m_disconnectCount;
+} // getDisconnectCount
+
+
+uint32_t WebSocketHub::getDropCount() {
+	return m_dropCount;
+} // getDropCount
+
+
+/**
+ * @brief Remove a web socket from the hub.
+ * Frames still waiting for it are discarded.  This is called when the web socket is closed.
+ * @param [in] pWebSocket The web socket.
+ */
+void WebSocketHub::remove(WebSocket* pWebSocket) {
+	::pthread_mutex_lock(&m_lock);
+	auto it = m_clients.find(pWebSocket);
+	if (it != m_clients.end()) {
+		removeClient(it);
+	}
+	::pthread_mutex_unlock(&m_lock);
+} // remove
+
+
+/**
+ * @brief Remove a client from the hub and have its sending task end.
+ * The hub lock must be held.  Once removed the client belongs to its sending task, which frees it.
+ * @param [in] it The client.
+ */
+void WebSocketHub::removeClient(std::map<WebSocket*, Client*>::iterator it) {
+	Client* pClient = it->second;
+	pClient->pWebSocket->m_pHub = nullptr;
+	m_clients.erase(it);
+
+	::pthread_mutex_lock(&pClient->lock);
+	pClient->closing = true;
+	bool started = pClient->started;
+	::pthread_cond_signal(&pClient->ready);
+	::pthread_mutex_unlock(&pClient->lock);
+	if (!started) {
+		deleteClient(pClient);    // There is no sending task to do it.
+	}
+} // removeClient
+
+
+/**
+ * @brief Set the maximum number of frames waiting to be sent to each client.
+ * @param [in] queueLength The maximum number of frames.
+ */
+void WebSocketHub::setQueueLength(size_t queueLength) {
+	m_queueLength = queueLength;
+} // setQueueLength
+
+
+/**
+ * @brief Set what happens when a client's queue is full.
+ * @param [in] policy Drop the oldest frame waiting, or disconnect the client.
+ */
+void WebSocketHub::setSlowConsumerPolicy(SlowConsumerPolicy policy) {
+	m_policy = policy;
+} // setSlowConsumerPolicy
+
+
+/**
+ * @brief Send the frames queued for a client until it leaves the hub.
+ * After a failed send the rest are discarded; the reader of the web socket will see the failure too and
+ * close it.
+ * @param [in] pParam The client.
+ */
+void WebSocketHub::sendTask(void* pParam) {
+	Client* pClient = (Client*) pParam;
+	bool failed = false;
+	while (true) {
+		::pthread_mutex_lock(&pClient->lock);
+		while (pClient->frames.empty() && !pClient->closing) {
+			::pthread_cond_wait(&pClient->ready, &pClient->lock);
+		}
+		if (pClient->closing) {
+			::pthread_mutex_unlock(&pClient->lock);
+			break;
+		}
+		FramePtr frame = pClient->frames.front();
+		pClient->frames.pop_front();
+		::pthread_mutex_unlock(&pClient->lock);
+
+		if (!failed && pClient->pWebSocket->m_pDeflate != nullptr) {
+			pClient->pWebSocket->send((uint8_t*) frame->data.data() + frame->headerLength,
+				frame->data.length() - frame->headerLength, frame->sendType);
+		} else if (!failed) {
+			int rc = pClient->pWebSocket->sendFrame((const uint8_t*) frame->data.data(), frame->data.length());
+			if (rc < 0) {
+				ESP_LOGD(LOG_TAG, "Send failed, discarding further frames for the web socket");
+				failed = true;
+			}
+		}
+	}
+	deleteClient(pClient);
+	FreeRTOS::deleteTask();
+} // sendTask
@@ -0,0 +1,91 @@
+/*
+ * WebSocketHub.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_WEBSOCKETHUB_H_
+#define COMPONENTS_CPP_UTILS_WEBSOCKETHUB_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include "WebSocket.h"
+
+/**
+ * @brief A set of web sockets to which the same message can be broadcast.
+ *
+ * A broadcast frame is encoded once into a reference counted buffer which is shared by the send queues of
+ * all the clients.  Each client has its own bounded queue and its own sending task, started when the first
+ * frame is queued for it, so the caller never waits on the network and one stalled client doesn't delay the
+ * others.  When a client's queue is full the hub either drops the oldest frame still waiting for it or
+ * disconnects it, depending on its slow consumer policy.
+ *
+ * A client that negotiated permessage-deflate has its own compression context, so its sending task compresses
+ * the payload of the shared frame for it alone.
+ *
+ * A web socket leaves the hub by itself when it is closed.  Once a web socket has been added, data sent to it
+ * by other means may be interleaved with the frames sent by the hub.
+ *
+ * @code{.cpp}
+ * WebSocketHub* pHub = httpServer.getWebSocketHub();
+ * pHub->broadcast(json, WebSocket::SEND_TYPE_TEXT);
+ * @endcode
+ */
+class WebSocketHub {
+public:
+	enum SlowConsumerPolicy {
+		DROP_OLDEST,    // Drop the oldest frame waiting for the client.
+		DISCONNECT      // Disconnect the client.
+	};
+
+	WebSocketHub(size_t queueLength = 8, SlowConsumerPolicy policy = DROP_OLDEST);
+	virtual ~WebSocketHub();
+
+	void     add(WebSocket* pWebSocket);
+	size_t   broadcast(const uint8_t* data, size_t length, uint8_t sendType = WebSocket::SEND_TYPE_BINARY);
+	size_t   broadcast(const std::string& data, uint8_t sendType = WebSocket::SEND_TYPE_BINARY);
+	size_t   getClientCount();
+	uint32_t getDisconnectCount();   // Number of clients disconnected for being too slow.
+	uint32_t getDropCount();         // Number of frames dropped for clients that were too slow.
+	void     remove(WebSocket* pWebSocket);
+	void     setQueueLength(size_t queueLength);
+	void     setSlowConsumerPolicy(SlowConsumerPolicy policy);
+
+private:
+	struct Frame {
+		std::string data;           // The encoded frame, header and payload.
+		size_t      headerLength;
+		uint8_t     sendType;
+	};
+	typedef std::shared_ptr<const Frame> FramePtr;
+
+	struct Client {
+		WebSocket*           pWebSocket;
+		std::deque<FramePtr> frames;      // Encoded frames waiting to be sent.
+		bool                 started;     // The sending task has been started.
+		bool                 closing;     // The client has left the hub; the sending task is to end.
+		pthread_mutex_t      lock;
+		pthread_cond_t       ready;
+	};
+
+	std::map<WebSocket*, Client*> m_clients;
+	pthread_mutex_t               m_lock;
+	size_t                        m_queueLength;
+	SlowConsumerPolicy            m_policy;
+	uint32_t                      m_disconnectCount;
+	uint32_t                      m_dropCount;
+
+	static void deleteClient(Client* pClient);
+	void        removeClient(std::map<WebSocket*, Client*>::iterator it);
+	static void sendTask(void* pParam);
+
+	WebSocketHub(const WebSocketHub&);             // Not copyable, we own the clients.
+	WebSocketHub& operator=(const WebSocketHub&);
+
+}; // WebSocketHub
+
+#endif /* COMPONENTS_CPP_UTILS_WEBSOCKETHUB_H_ */
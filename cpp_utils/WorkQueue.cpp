@@ -0,0 +1,184 @@
+/*
+ * WorkQueue.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include <sys/time.h>
+#include "WorkQueue.h"
+
+
+/**
+ * @brief Get the current time in microseconds.
+ */
+static uint64_t nowUs() {
+	struct timeval tv;
+	::gettimeofday(&tv, nullptr);
+	return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+} // nowUs
+
+
+/**
+ * @brief Create a queue.
+ * @param [in] capacity The maximum number of items the queue can hold.
+ */
+WorkQueue::WorkQueue(size_t capacity) {
+	m_capacity    = capacity > 0 ? capacity : 1;
+	m_entries     = new Entry[m_capacity];
+	m_head        = 0;
+	m_depth       = 0;
+	m_maxDepth    = 0;
+	m_closed      = false;
+	m_popCount    = 0;
+	m_rejectCount = 0;
+	m_totalWaitUs = 0;
+	m_maxWaitUs   = 0;
+	::pthread_mutex_init(&m_mutex, nullptr);
+	::pthread_cond_init(&m_notEmpty, nullptr);
+	::pthread_cond_init(&m_notFull, nullptr);
+} // WorkQueue
+
+
+WorkQueue::~WorkQueue() {
+	::pthread_cond_destroy(&m_notFull);
+	::pthread_cond_destroy(&m_notEmpty);
+	::pthread_mutex_destroy(&m_mutex);
+	delete[] m_entries;
+} // ~WorkQueue
+
+
+/**
+ * @brief Close the queue.
+ * Further pushes are refused.  Consumers continue to receive the items already queued and then
+ * receive nullptr.
+ */
+void WorkQueue::close() {
+	::pthread_mutex_lock(&m_mutex);
+	m_closed = true;
+	::pthread_cond_broadcast(&m_notEmpty);
+	::pthread_cond_broadcast(&m_notFull);
+	::pthread_mutex_unlock(&m_mutex);
+} // close
+
+
+/**
+ * @brief Get the average time that items spent in the queue before being taken.
+ * @return The average wait in milliseconds.
+ */
+uint32_t WorkQueue::getAverageWaitMs() {
+	::pthread_mutex_lock(&m_mutex);
+	uint32_t ret = m_popCount == 0 ? 0 : (uint32_t) (m_totalWaitUs / m_popCount / 1000);
+	::pthread_mutex_unlock(&m_mutex);
+	return ret;
+} // getAverageWaitMs
+
+
+size_t WorkQueue::getCapacity() {
+	return m_capacity;
+} // getCapacity
+
+
+size_t WorkQueue::getDepth() {
+	::pthread_mutex_lock(&m_mutex);
+	size_t ret = m_depth;
+	::pthread_mutex_unlock(&m_mutex);
+	return ret;
+} // getDepth
+
+
+size_t WorkQueue::getMaxDepth() {
+	::pthread_mutex_lock(&m_mutex);
+	size_t ret = m_maxDepth;
+	::pthread_mutex_unlock(&m_mutex);
+	return ret;
+} // getMaxDepth
+
+
+uint32_t WorkQueue::getMaxWaitMs() {
+	::pthread_mutex_lock(&m_mutex);
+	uint32_t ret = (uint32_t) (m_maxWaitUs / 1000);
+	::pthread_mutex_unlock(&m_mutex);
+	return ret;
+} // getMaxWaitMs
+
+
+uint32_t WorkQueue::getPopCount() {
+	::pthread_mutex_lock(&m_mutex);
+	uint32_t ret = m_popCount;
+	::pthread_mutex_unlock(&m_mutex);
+	return ret;
+} // getPopCount
+
+
+uint32_t WorkQueue::getRejectCount() {
+	::pthread_mutex_lock(&m_mutex);
+	uint32_t ret = m_rejectCount;
+	::pthread_mutex_unlock(&m_mutex);
+	return ret;
+} // getRejectCount
+
+
+bool WorkQueue::isClosed() {
+	::pthread_mutex_lock(&m_mutex);
+	bool ret = m_closed;
+	::pthread_mutex_unlock(&m_mutex);
+	return ret;
+} // isClosed
+
+
+/**
+ * @brief Take the oldest item from the queue.
+ * Block until an item is available.
+ * @return The item or nullptr if the queue has been closed and is empty.
+ */
+void* WorkQueue::pop() {
+	::pthread_mutex_lock(&m_mutex);
+	while (m_depth == 0 && !m_closed) {
+		::pthread_cond_wait(&m_notEmpty, &m_mutex);
+	}
+	if (m_depth == 0) {   // Closed and drained.
+		::pthread_mutex_unlock(&m_mutex);
+		return nullptr;
+	}
+	Entry& entry = m_entries[m_head];
+	m_head = (m_head + 1) % m_capacity;
+	m_depth--;
+
+	uint64_t waitUs = nowUs() - entry.queuedUs;
+	m_totalWaitUs += waitUs;
+	if (waitUs > m_maxWaitUs) m_maxWaitUs = waitUs;
+	m_popCount++;
+	void* pItem = entry.pItem;
+
+	::pthread_cond_signal(&m_notFull);
+	::pthread_mutex_unlock(&m_mutex);
+	return pItem;
+} // pop
+
+
+/**
+ * @brief Add an item to the queue.
+ * @param [in] pItem The item to add.
+ * @param [in] wait If the queue is full, wait for space when true or refuse the item when false.
+ * @return True if the item was queued.  False if it was refused, in which case the caller still owns it.
+ */
+bool WorkQueue::push(void* pItem, bool wait) {
+	::pthread_mutex_lock(&m_mutex);
+	while (m_depth == m_capacity && wait && !m_closed) {
+		::pthread_cond_wait(&m_notFull, &m_mutex);
+	}
+	if (m_closed || m_depth == m_capacity) {
+		m_rejectCount++;
+		::pthread_mutex_unlock(&m_mutex);
+		return false;
+	}
+	Entry& entry = m_entries[(m_head + m_depth) % m_capacity];
+	entry.pItem    = pItem;
+	entry.queuedUs = nowUs();
+	m_depth++;
+	if (m_depth > m_maxDepth) m_maxDepth = m_depth;
+
+	::pthread_cond_signal(&m_notEmpty);
+	::pthread_mutex_unlock(&m_mutex);
+	return true;
+} // push
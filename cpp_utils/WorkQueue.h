@@ -0,0 +1,72 @@
+/*
+ * WorkQueue.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_WORKQUEUE_H_
+#define COMPONENTS_CPP_UTILS_WORKQUEUE_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/**
+ * @brief A bounded first-in first-out queue of work items shared between tasks.
+ *
+ * Producers push items and consumers block in pop() until an item arrives.  When the queue is full a
+ * producer can either wait for space or be told that the item was rejected so that it can apply its own
+ * back pressure policy.  The queue keeps counters of its depth and of how long items waited before being
+ * taken.
+ *
+ * The queue is built only on pthreads (which ESP-IDF provides on top of FreeRTOS) so the same code runs
+ * on a Linux host.  Items are opaque pointers; ownership passes from the producer to the consumer.
+ *
+ * @code{.cpp}
+ * WorkQueue queue(8);
+ * queue.push(pItem, true);    // Producer.
+ * void* pItem = queue.pop();  // Consumer, nullptr once the queue has been closed.
+ * @endcode
+ */
+class WorkQueue {
+public:
+	WorkQueue(size_t capacity);
+	virtual ~WorkQueue();
+
+	void     close();                          // Reject further items and wake all waiting tasks.
+	uint32_t getAverageWaitMs();               // Average time an item spent queued.
+	size_t   getCapacity();                    // Maximum number of items held.
+	size_t   getDepth();                       // Number of items currently held.
+	size_t   getMaxDepth();                    // Largest number of items that have been held at once.
+	uint32_t getMaxWaitMs();                   // Longest time an item spent queued.
+	uint32_t getPopCount();                    // Number of items taken from the queue.
+	uint32_t getRejectCount();                 // Number of items refused because the queue was full.
+	bool     isClosed();
+	void*    pop();                            // Take the oldest item, blocking until one is available.
+	bool     push(void* pItem, bool wait);     // Add an item to the queue.
+
+private:
+	struct Entry {
+		void*    pItem;
+		uint64_t queuedUs;   // When the item was queued.
+	};
+
+	Entry*          m_entries;      // Ring of entries.
+	size_t          m_capacity;
+	size_t          m_head;         // Index of the oldest entry.
+	size_t          m_depth;
+	size_t          m_maxDepth;
+	bool            m_closed;
+	uint32_t        m_popCount;
+	uint32_t        m_rejectCount;
+	uint64_t        m_totalWaitUs;
+	uint64_t        m_maxWaitUs;
+	pthread_mutex_t m_mutex;
+	pthread_cond_t  m_notEmpty;
+	pthread_cond_t  m_notFull;
+
+	WorkQueue(const WorkQueue&);             // Not copyable, we own the mutex and the ring.
+	WorkQueue& operator=(const WorkQueue&);
+
+}; // WorkQueue
+
+#endif /* COMPONENTS_CPP_UTILS_WORKQUEUE_H_ */
@@ -0,0 +1,50 @@
+/*
+ * HostTest.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_HOSTTEST_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_HOSTTEST_H_
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief Minimal checks and timing for the host tests.
+ *
+ * Each test is a plain program: CHECK() reports a failed condition and counts it, and the program
+ * returns the number of failures from main() through testResult().
+ */
+static int testFailures = 0;
+
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+		testFailures++; \
+	} \
+} while (0)
+
+
+/**
+ * @brief Get a monotonic time in nanoseconds for timing a benchmark.
+ */
+static inline uint64_t testNowNs() {
+	struct timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+} // testNowNs
+
+
+/**
+ * @brief Report the outcome of a test program.
+ * @param [in] name The name of the test.
+ * @return The exit status for main().
+ */
+static inline int testResult(const char* name) {
+	printf("%s: %s (%d failures)\n", name, testFailures == 0 ? "PASS" : "FAIL", testFailures);
+	return testFailures == 0 ? 0 : 1;
+} // testResult
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_HOSTTEST_H_ */
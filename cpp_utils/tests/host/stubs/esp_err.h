@@ -0,0 +1,19 @@
+/*
+ * esp_err.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the ESP-IDF error codes in the host tests.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_ESP_ERR_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_ESP_ERR_H_
+#include <stdint.h>
+
+typedef int32_t esp_err_t;
+
+#define ESP_OK                0
+#define ESP_FAIL              -1
+#define ESP_ERR_INVALID_STATE 0x103
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_ESP_ERR_H_ */
@@ -0,0 +1,32 @@
+/*
+ * esp_gatt_defs.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the ESP-IDF GATT UUID types used by BLEUUID in the host tests.  The layout matches
+ * ESP-IDF.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_ESP_GATT_DEFS_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_ESP_GATT_DEFS_H_
+#include <stdint.h>
+
+#define ESP_UUID_LEN_16  2
+#define ESP_UUID_LEN_32  4
+#define ESP_UUID_LEN_128 16
+
+typedef struct {
+	uint16_t len;
+	union {
+		uint16_t uuid16;
+		uint32_t uuid32;
+		uint8_t  uuid128[ESP_UUID_LEN_128];
+	} uuid;
+} __attribute__((packed)) esp_bt_uuid_t;
+
+typedef struct {
+	esp_bt_uuid_t uuid;
+	uint8_t       inst_id;
+} __attribute__((packed)) esp_gatt_id_t;
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_ESP_GATT_DEFS_H_ */
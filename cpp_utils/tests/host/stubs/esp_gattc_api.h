@@ -0,0 +1,82 @@
+/*
+ * esp_gattc_api.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the parts of the ESP-IDF GATT client API used by BLERemoteOperationQueue in the host
+ * tests.  The values match ESP-IDF; the request functions are defined by the test, which plays the peer.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_ESP_GATTC_API_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_ESP_GATTC_API_H_
+#include <stdint.h>
+#include "esp_err.h"
+
+#define ESP_GATT_IF_NONE                0xff
+#define ESP_GATT_MAX_READ_MULTI_HANDLES 10
+
+typedef uint8_t esp_gatt_if_t;
+
+typedef enum {
+	ESP_GATT_OK                = 0x0,
+	ESP_GATT_INVALID_HANDLE    = 0x01,
+	ESP_GATT_REQ_NOT_SUPPORTED = 0x06,
+	ESP_GATT_ERROR             = 0x85,
+} esp_gatt_status_t;
+
+typedef enum {
+	ESP_GATT_AUTH_REQ_NONE = 0,
+} esp_gatt_auth_req_t;
+
+typedef enum {
+	ESP_GATT_WRITE_TYPE_NO_RSP = 1,
+	ESP_GATT_WRITE_TYPE_RSP,
+} esp_gatt_write_type_t;
+
+typedef enum {
+	ESP_GATTC_REG_EVT           = 0,
+	ESP_GATTC_OPEN_EVT          = 2,
+	ESP_GATTC_READ_CHAR_EVT     = 3,
+	ESP_GATTC_WRITE_CHAR_EVT    = 4,
+	ESP_GATTC_NOTIFY_EVT        = 10,
+	ESP_GATTC_READ_MULTIPLE_EVT = 22,
+	ESP_GATTC_DISCONNECT_EVT    = 41,
+} esp_gattc_cb_event_t;
+
+typedef struct {
+	uint8_t  num_attr;
+	uint16_t handles[ESP_GATT_MAX_READ_MULTI_HANDLES];
+} esp_gattc_multi_t;
+
+typedef union {
+	struct {
+		esp_gatt_status_t status;
+		uint16_t          conn_id;
+		uint16_t          mtu;
+	} open;
+	struct {
+		esp_gatt_status_t status;
+		uint16_t          conn_id;
+		uint16_t          handle;
+		uint8_t*          value;
+		uint16_t          value_len;
+	} read;
+	struct {
+		esp_gatt_status_t status;
+		uint16_t          conn_id;
+		uint16_t          handle;
+		uint16_t          offset;
+	} write;
+	struct {
+		int               reason;
+		uint16_t          conn_id;
+	} disconnect;
+} esp_ble_gattc_cb_param_t;
+
+esp_err_t esp_ble_gattc_read_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle, esp_gatt_auth_req_t auth_req);
+esp_err_t esp_ble_gattc_read_multiple(esp_gatt_if_t gattc_if, uint16_t conn_id, esp_gattc_multi_t* read_multi,
+	esp_gatt_auth_req_t auth_req);
+esp_err_t esp_ble_gattc_write_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle, uint16_t value_len,
+	uint8_t* value, esp_gatt_write_type_t write_type, esp_gatt_auth_req_t auth_req);
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_ESP_GATTC_API_H_ */
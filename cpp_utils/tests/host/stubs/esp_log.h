@@ -0,0 +1,20 @@
+/*
+ * esp_log.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the ESP-IDF logging macros in the host tests.  Errors and warnings are printed so that a
+ * test shows why it failed; the chattier levels are dropped.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_ESP_LOG_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_ESP_LOG_H_
+#include <stdio.h>
+
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) do { (void) (tag); } while (0)
+#define ESP_LOGD(tag, format, ...) do { (void) (tag); } while (0)
+#define ESP_LOGV(tag, format, ...) do { (void) (tag); } while (0)
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_ESP_LOG_H_ */
@@ -0,0 +1,26 @@
+/*
+ * FreeRTOS.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the FreeRTOS definitions in the host tests.  Only the types and constants that FreeRTOS.h
+ * in cpp_utils declares with are given; a test that calls FreeRTOS:: functions defines them over pthreads.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_FREERTOS_FREERTOS_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_FREERTOS_FREERTOS_H_
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int32_t  BaseType_t;
+typedef void*    TaskHandle_t;
+typedef void*    SemaphoreHandle_t;
+typedef void*    RingbufHandle_t;
+
+#define pdFALSE            0
+#define pdTRUE             1
+#define pdPASS             pdTRUE
+#define portMAX_DELAY      ((TickType_t) 0xffffffff)
+#define portTICK_PERIOD_MS 1
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_FREERTOS_FREERTOS_H_ */
@@ -0,0 +1,19 @@
+/*
+ * ringbuf.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the ESP-IDF ring buffer definitions in the host tests; see FreeRTOS.h.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_FREERTOS_RINGBUF_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_FREERTOS_RINGBUF_H_
+#include "FreeRTOS.h"
+
+typedef enum {
+	RINGBUF_TYPE_NOSPLIT,
+	RINGBUF_TYPE_ALLOWSPLIT,
+	RINGBUF_TYPE_BYTEBUF
+} ringbuf_type_t;
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_FREERTOS_RINGBUF_H_ */
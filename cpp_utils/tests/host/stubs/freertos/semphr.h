@@ -0,0 +1,13 @@
+/*
+ * semphr.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the FreeRTOS semaphore definitions in the host tests; see FreeRTOS.h.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_FREERTOS_SEMPHR_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_FREERTOS_SEMPHR_H_
+#include "FreeRTOS.h"
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_FREERTOS_SEMPHR_H_ */
@@ -0,0 +1,13 @@
+/*
+ * task.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the FreeRTOS task definitions in the host tests; see FreeRTOS.h.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_FREERTOS_TASK_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_FREERTOS_TASK_H_
+#include "FreeRTOS.h"
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_FREERTOS_TASK_H_ */
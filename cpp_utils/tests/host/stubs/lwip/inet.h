@@ -0,0 +1,13 @@
+/*
+ * inet.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the lwip address conversions in the host tests.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_LWIP_INET_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_LWIP_INET_H_
+#include <arpa/inet.h>
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_LWIP_INET_H_ */
@@ -0,0 +1,32 @@
+/*
+ * sockets.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the lwip socket API in the host tests.  The re-entrant lwip calls that Socket makes are
+ * passed to the POSIX socket calls of the host.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_LWIP_SOCKETS_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_LWIP_SOCKETS_H_
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#define ERR_OK 0
+
+static inline int lwip_accept_r(int s, struct sockaddr* addr, socklen_t* addrlen) {
+	*addrlen = sizeof(struct sockaddr_in);
+	return ::accept(s, addr, addrlen);
+}
+static inline int lwip_bind_r(int s, const struct sockaddr* name, socklen_t namelen) { return ::bind(s, name, namelen); }
+static inline int lwip_close_r(int s) { return ::close(s); }
+static inline int lwip_connect_r(int s, const struct sockaddr* name, socklen_t namelen) { return ::connect(s, name, namelen); }
+static inline int lwip_listen_r(int s, int backlog) { return ::listen(s, backlog); }
+static inline int lwip_recv_r(int s, void* mem, size_t len, int flags) { return (int) ::recv(s, mem, len, flags); }
+static inline int lwip_send_r(int s, const void* data, size_t size, int flags) { return (int) ::send(s, data, size, flags | MSG_NOSIGNAL); }
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_LWIP_SOCKETS_H_ */
@@ -0,0 +1,13 @@
+/*
+ * debug.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the mbedtls header in the host tests; see platform.h.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_MBEDTLS_DEBUG_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_MBEDTLS_DEBUG_H_
+#include <mbedtls/platform.h>
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_MBEDTLS_DEBUG_H_ */
@@ -0,0 +1,65 @@
+/*
+ * platform.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the mbedtls headers that Socket.h includes, so that Socket builds in the host tests over
+ * plain POSIX sockets.  TLS is not available: every call fails or does nothing.  Most of them are macros
+ * that drop their arguments; those whose arguments would otherwise be unused are functions.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_MBEDTLS_PLATFORM_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_MBEDTLS_PLATFORM_H_
+#include <stddef.h>
+
+typedef struct { int fd; } mbedtls_net_context;
+typedef struct { int unused; } mbedtls_entropy_context;
+typedef struct { int unused; } mbedtls_ctr_drbg_context;
+typedef struct { int unused; } mbedtls_ssl_context;
+typedef struct { int unused; } mbedtls_ssl_config;
+typedef struct { int unused; } mbedtls_x509_crt;
+typedef struct { int unused; } mbedtls_pk_context;
+
+#define MBEDTLS_ERR_SSL_WANT_READ     -0x6900
+#define MBEDTLS_ERR_SSL_WANT_WRITE    -0x6880
+#define MBEDTLS_ERR_SSL_NOT_AVAILABLE -0x7080
+#define MBEDTLS_SSL_IS_SERVER         1
+#define MBEDTLS_SSL_TRANSPORT_STREAM  0
+#define MBEDTLS_SSL_PRESET_DEFAULT    0
+#define MBEDTLS_SSL_VERIFY_NONE       0
+
+#define mbedtls_ctr_drbg_init(...)       ((void) 0)
+#define mbedtls_debug_set_threshold(...) ((void) 0)
+#define mbedtls_entropy_init(...)        ((void) 0)
+#define mbedtls_net_init(...)            ((void) 0)
+#define mbedtls_pk_init(...)             ((void) 0)
+#define mbedtls_pk_parse_key(...)        MBEDTLS_ERR_SSL_NOT_AVAILABLE
+#define mbedtls_ssl_close_notify(...)    MBEDTLS_ERR_SSL_NOT_AVAILABLE
+#define mbedtls_ssl_conf_authmode(...)   ((void) 0)
+#define mbedtls_ssl_conf_ca_chain(...)   ((void) 0)
+#define mbedtls_ssl_conf_own_cert(...)   MBEDTLS_ERR_SSL_NOT_AVAILABLE
+#define mbedtls_ssl_conf_rng(...)        ((void) 0)
+#define mbedtls_ssl_config_defaults(...) MBEDTLS_ERR_SSL_NOT_AVAILABLE
+#define mbedtls_ssl_config_init(...)     ((void) 0)
+#define mbedtls_ssl_handshake(...)       MBEDTLS_ERR_SSL_NOT_AVAILABLE
+#define mbedtls_ssl_init(...)            ((void) 0)
+#define mbedtls_ssl_read(...)            MBEDTLS_ERR_SSL_NOT_AVAILABLE
+#define mbedtls_ssl_session_reset(...)   ((void) 0)
+#define mbedtls_ssl_set_bio(...)         ((void) 0)
+#define mbedtls_ssl_setup(...)           MBEDTLS_ERR_SSL_NOT_AVAILABLE
+#define mbedtls_ssl_write(...)           MBEDTLS_ERR_SSL_NOT_AVAILABLE
+#define mbedtls_x509_crt_init(...)       ((void) 0)
+#define mbedtls_x509_crt_parse(...)      MBEDTLS_ERR_SSL_NOT_AVAILABLE
+
+static inline int mbedtls_entropy_func(void* data, unsigned char* output, size_t len) {
+	return MBEDTLS_ERR_SSL_NOT_AVAILABLE;
+}
+static inline int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* ctx, int (*f_entropy)(void*, unsigned char*, size_t),
+	void* p_entropy, const unsigned char* custom, size_t len) {
+	return MBEDTLS_ERR_SSL_NOT_AVAILABLE;
+}
+static inline void mbedtls_ssl_conf_dbg(mbedtls_ssl_config* conf, void (*f_dbg)(void*, int, const char*, int, const char*),
+	void* p_dbg) {
+}
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_MBEDTLS_PLATFORM_H_ */
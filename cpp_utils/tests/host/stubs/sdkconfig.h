@@ -0,0 +1,16 @@
+/*
+ * sdkconfig.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the generated configuration in the host tests.  Only the options that select the code
+ * under test are set.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_SDKCONFIG_H_
+#define COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_SDKCONFIG_H_
+
+#define CONFIG_BT_ENABLED 1
+#define CONFIG_CXX_EXCEPTIONS 1
+
+#endif /* COMPONENTS_CPP_UTILS_TESTS_HOST_STUBS_SDKCONFIG_H_ */
@@ -0,0 +1,195 @@
+/*
+ * test_ble_advertisement_parser.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of BLEAdvertisementParser.  Advertisements come off the radio from anyone, so besides a
+ * well-formed payload the parser is given zero length structures, lengths running past the payload and
+ * truncated final structures, and every prefix of each.  Each payload is held in a buffer of exactly its
+ * size, so the sanitizer catches any read beyond it.
+ */
+#include <string.h>
+#include <vector>
+#include "BLEAdvertisementParser.h"
+#include "HostTest.h"
+
+static const uint8_t TYPE_FLAGS        = 0x01;
+static const uint8_t TYPE_UUID16       = 0x03;
+static const uint8_t TYPE_NAME         = 0x09;
+static const uint8_t TYPE_TX_POWER     = 0x0a;
+static const uint8_t TYPE_APPEARANCE   = 0x19;
+static const uint8_t TYPE_MANUFACTURER = 0xff;
+
+
+/**
+ * @brief Parse a payload held in a heap buffer of exactly its size.
+ * The fields refer to the buffer, which the caller deletes once done with them.
+ * @return The fields found, in order.
+ */
+static std::vector<BLEAdField> parse(const std::vector<uint8_t>& payload, std::vector<uint8_t>** ppCopy) {
+	*ppCopy = new std::vector<uint8_t>(payload);
+	BLEAdvertisementParser parser((*ppCopy)->empty() ? nullptr : (*ppCopy)->data(), (*ppCopy)->size());
+	std::vector<BLEAdField> fields;
+	for (const BLEAdField& field : parser) {
+		CHECK(field.data + field.length <= (*ppCopy)->data() + (*ppCopy)->size());
+		uint8_t sum = 0;
+		for (size_t i = 0; i < field.length; i++) sum += field.data[i];   // Touch every byte of the data.
+		(void) sum;
+		fields.push_back(field);
+	}
+	return fields;
+} // parse
+
+
+static bool wellFormed(const std::vector<uint8_t>& payload) {
+	std::vector<uint8_t> copy(payload);
+	return BLEAdvertisementParser(copy.empty() ? nullptr : copy.data(), copy.size()).isWellFormed();
+} // wellFormed
+
+
+/**
+ * @brief A typical advertisement: flags, name, 16 bit service UUIDs, TX power, appearance, manufacturer data.
+ */
+static std::vector<uint8_t> typicalPayload() {
+	const uint8_t payload[] = {
+		0x02, TYPE_FLAGS, 0x06,
+		0x06, TYPE_NAME, 'E', 'S', 'P', '3', '2',
+		0x05, TYPE_UUID16, 0x0d, 0x18, 0x0f, 0x18,
+		0x02, TYPE_TX_POWER, 0xf4,
+		0x03, TYPE_APPEARANCE, 0x41, 0x03,
+		0x07, TYPE_MANUFACTURER, 0xe5, 0x02, 0x78, 0x56, 0x34, 0x12
+	};
+	return std::vector<uint8_t>(payload, payload + sizeof(payload));
+} // typicalPayload
+
+
+static void testWellFormed() {
+	std::vector<uint8_t>* pCopy;
+	std::vector<BLEAdField> fields = parse(typicalPayload(), &pCopy);
+	CHECK(fields.size() == 6);
+	CHECK(fields[0].type == TYPE_FLAGS && fields[0].length == 1 && fields[0].data[0] == 0x06);
+	CHECK(fields[1].type == TYPE_NAME && fields[1].length == 5 && memcmp(fields[1].data, "ESP32", 5) == 0);
+	CHECK(fields[2].type == TYPE_UUID16 && fields[2].getUint16(0) == 0x180d && fields[2].getUint16(2) == 0x180f);
+	CHECK(fields[2].getUint16(3) == 0);   // Would run past the data.
+	CHECK(fields[3].type == TYPE_TX_POWER && (int8_t) fields[3].data[0] == -12);
+	CHECK(fields[4].type == TYPE_APPEARANCE && fields[4].getUint16() == 0x0341);
+	CHECK(fields[5].type == TYPE_MANUFACTURER && fields[5].getUint16() == 0x02e5 && fields[5].getUint32(2) == 0x12345678);
+	CHECK(fields[5].getUint32(3) == 0);
+	CHECK(wellFormed(typicalPayload()));
+
+	BLEAdvertisementParser parser(pCopy->data(), pCopy->size());
+	BLEAdField field;
+	CHECK(parser.find(TYPE_APPEARANCE, &field) && field.data == fields[4].data);
+	CHECK(!parser.find(0x16, &field));
+	delete pCopy;
+
+	std::vector<uint8_t> padded = typicalPayload();   // Zero padding to the full 31 bytes.
+	padded.resize(31, 0);
+	CHECK(parse(padded, &pCopy).size() == 6);
+	CHECK(wellFormed(padded));
+	delete pCopy;
+
+	std::vector<uint8_t> typeOnly = { 0x01, 0x20 };   // A structure with a type and no data.
+	fields = parse(typeOnly, &pCopy);
+	CHECK(fields.size() == 1 && fields[0].type == 0x20 && fields[0].length == 0);
+	CHECK(fields[0].getUint16() == 0);
+	CHECK(wellFormed(typeOnly));
+	delete pCopy;
+} // testWellFormed
+
+
+static void testZeroLength() {
+	std::vector<uint8_t>* pCopy;
+	std::vector<uint8_t> payload = { 0x02, TYPE_FLAGS, 0x06, 0x00, 0x03, TYPE_NAME, 'h', 'i' };
+	std::vector<BLEAdField> fields = parse(payload, &pCopy);
+	CHECK(fields.size() == 1 && fields[0].type == TYPE_FLAGS);   // The zero length ends the data.
+	delete pCopy;
+
+	std::vector<uint8_t> first = { 0x00, 0x02, TYPE_FLAGS, 0x06 };
+	CHECK(parse(first, &pCopy).empty());
+	delete pCopy;
+
+	CHECK(parse(std::vector<uint8_t>(), &pCopy).empty());
+	CHECK(wellFormed(std::vector<uint8_t>()));
+	delete pCopy;
+
+	BLEAdvertisementParser none(nullptr, 10);   // No payload at all.
+	CHECK(!(none.begin() != none.end()));
+} // testZeroLength
+
+
+static void testPastEnd() {
+	std::vector<uint8_t>* pCopy;
+	std::vector<uint8_t> payload = { 0x02, TYPE_FLAGS, 0x06, 0xff, TYPE_MANUFACTURER, 0x01, 0x02 };
+	std::vector<BLEAdField> fields = parse(payload, &pCopy);
+	CHECK(fields.size() == 1 && fields[0].type == TYPE_FLAGS);   // The second claims 254 bytes of data.
+	CHECK(!wellFormed(payload));
+	delete pCopy;
+
+	std::vector<uint8_t> oneOver = { 0x02, TYPE_FLAGS, 0x06, 0x04, TYPE_NAME, 'a', 'b' };
+	CHECK(parse(oneOver, &pCopy).size() == 1);
+	CHECK(!wellFormed(oneOver));
+	delete pCopy;
+} // testPastEnd
+
+
+/**
+ * @brief Every prefix of a payload, as a truncated advertisement, gives the complete structures before the cut.
+ */
+static void testTruncated() {
+	std::vector<uint8_t> full = typicalPayload();
+	std::vector<size_t> ends;   // Where each structure ends.
+	for (size_t pos = 0; pos < full.size(); pos += 1 + full[pos]) ends.push_back(pos + 1 + full[pos]);
+
+	for (size_t length = 0; length <= full.size(); length++) {
+		std::vector<uint8_t> prefix(full.begin(), full.begin() + length);
+		size_t complete = 0;
+		bool   boundary = length == 0;
+		for (size_t i = 0; i < ends.size(); i++) {
+			if (ends[i] <= length) complete++;
+			if (ends[i] == length) boundary = true;
+		}
+		std::vector<uint8_t>* pCopy;
+		CHECK(parse(prefix, &pCopy).size() == complete);
+		CHECK(wellFormed(prefix) == boundary);
+		delete pCopy;
+	}
+
+	std::vector<uint8_t> lengthOnly = { 0x02, TYPE_FLAGS, 0x06, 0x05 };   // The final structure is only its length.
+	std::vector<uint8_t>* pCopy;
+	CHECK(parse(lengthOnly, &pCopy).size() == 1);
+	CHECK(!wellFormed(lengthOnly));
+	delete pCopy;
+} // testTruncated
+
+
+/**
+ * @brief Random payloads are never read beyond their end.
+ */
+static void testRandom() {
+	uint32_t seed = 11;
+	for (int round = 0; round < 20000; round++) {
+		seed = seed * 1103515245 + 12345;
+		std::vector<uint8_t> payload((seed >> 16) % 32);
+		for (size_t i = 0; i < payload.size(); i++) {
+			seed = seed * 1103515245 + 12345;
+			payload[i] = (seed >> 16) % 4 == 0 ? (uint8_t) ((seed >> 8) % 8) : (uint8_t) (seed >> 24);
+		}
+		std::vector<uint8_t>* pCopy;
+		std::vector<BLEAdField> fields = parse(payload, &pCopy);
+		size_t used = 0;
+		for (size_t i = 0; i < fields.size(); i++) used += 2 + fields[i].length;
+		CHECK(used <= payload.size());
+		delete pCopy;
+	}
+} // testRandom
+
+
+int main() {
+	testWellFormed();
+	testZeroLength();
+	testPastEnd();
+	testTruncated();
+	testRandom();
+	return testResult("test_ble_advertisement_parser");
+} // main
@@ -0,0 +1,493 @@
+/*
+ * test_ble_remote_operation_queue.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of BLERemoteOperationQueue against a simulated GATT peer.  The test defines the ESP-IDF request
+ * functions, which record each request, and answers them by passing the queue the events the stack would.
+ * It checks that only one request is ever in flight, that responses go to the operation that asked for them
+ * even when several readers read the same handle, that Read Multiple falls back to reading one by one, that
+ * events for other interfaces, connections and handles are left alone and that a disconnect ends everything,
+ * even one arriving while a request is being handed to the stack.
+ */
+#include <pthread.h>
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+#include "BLERemoteOperationQueue.h"
+#include "GeneralUtils.h"
+#include "HostTest.h"
+
+static const esp_gatt_if_t GATTC_IF = 3;
+static const uint16_t      CONN_ID  = 7;
+
+/**
+ * @brief A request the queue handed to the stack.
+ */
+struct Request {
+	esp_gattc_cb_event_t  event;     // The event that answers it.
+	std::vector<uint16_t> handles;
+	std::string           data;
+};
+
+static pthread_mutex_t     peerLock    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t      peerRequest = PTHREAD_COND_INITIALIZER;
+static std::deque<Request> requests;
+static size_t              maxInFlight = 0;
+static bool                supportsReadMultiple = true;
+static bool                failRequests = false;
+static uint32_t            sequence    = 0;   // Changes the values of the peer with every read.
+static void              (*duringRequest)() = nullptr;   // Run inside the next request, as the BT task may.
+
+
+static esp_err_t record(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, uint16_t conn_id, const uint16_t* handles,
+		size_t count, const uint8_t* data, size_t length) {
+	CHECK(gattc_if == GATTC_IF && conn_id == CONN_ID);
+	bool fail = failRequests;
+	if (duringRequest != nullptr) {
+		void (*during)() = duringRequest;
+		duringRequest = nullptr;
+		during();
+	}
+	if (fail) return ESP_ERR_INVALID_STATE;
+	Request request;
+	request.event = event;
+	request.handles.assign(handles, handles + count);
+	request.data.assign((const char*) data, length);
+	pthread_mutex_lock(&peerLock);
+	requests.push_back(request);
+	if (requests.size() > maxInFlight) maxInFlight = requests.size();
+	pthread_cond_signal(&peerRequest);
+	pthread_mutex_unlock(&peerLock);
+	return ESP_OK;
+} // record
+
+
+esp_err_t esp_ble_gattc_read_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle, esp_gatt_auth_req_t auth_req) {
+	return record(ESP_GATTC_READ_CHAR_EVT, gattc_if, conn_id, &handle, 1, nullptr, 0);
+} // esp_ble_gattc_read_char
+
+
+esp_err_t esp_ble_gattc_read_multiple(esp_gatt_if_t gattc_if, uint16_t conn_id, esp_gattc_multi_t* read_multi,
+		esp_gatt_auth_req_t auth_req) {
+	return record(ESP_GATTC_READ_MULTIPLE_EVT, gattc_if, conn_id, read_multi->handles, read_multi->num_attr, nullptr, 0);
+} // esp_ble_gattc_read_multiple
+
+
+esp_err_t esp_ble_gattc_write_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle, uint16_t value_len,
+		uint8_t* value, esp_gatt_write_type_t write_type, esp_gatt_auth_req_t auth_req) {
+	return record(ESP_GATTC_WRITE_CHAR_EVT, gattc_if, conn_id, &handle, 1, value, value_len);
+} // esp_ble_gattc_write_char
+
+
+const char* GeneralUtils::errorToString(esp_err_t errCode) {
+	return "error";
+} // errorToString
+
+
+/**
+ * @brief The value the peer holds for a handle; it starts with the handle so a reader can tell whose it is.
+ */
+static std::string peerValue(uint16_t handle, uint32_t seq) {
+	char value[24];
+	snprintf(value, sizeof(value), "%04x:%u", handle, seq);
+	return value;
+} // peerValue
+
+
+/**
+ * @brief Answer the oldest request as the stack would.
+ * @return False if there was no request.
+ */
+static bool respond(BLERemoteOperationQueue* pQueue) {
+	pthread_mutex_lock(&peerLock);
+	if (requests.empty()) {
+		pthread_mutex_unlock(&peerLock);
+		return false;
+	}
+	Request request = requests.front();
+	requests.pop_front();
+	uint32_t seq = sequence++;
+	pthread_mutex_unlock(&peerLock);
+
+	esp_ble_gattc_cb_param_t param;
+	std::string value;
+	if (request.event == ESP_GATTC_WRITE_CHAR_EVT) {
+		param.write.status  = ESP_GATT_OK;
+		param.write.conn_id = CONN_ID;
+		param.write.handle  = request.handles[0];
+		param.write.offset  = 0;
+	} else {
+		param.read.status  = ESP_GATT_OK;
+		param.read.conn_id = CONN_ID;
+		param.read.handle  = request.handles[0];
+		if (request.event == ESP_GATTC_READ_MULTIPLE_EVT && !supportsReadMultiple) {
+			param.read.status = ESP_GATT_REQ_NOT_SUPPORTED;
+		} else {
+			for (auto handle : request.handles) value += peerValue(handle, seq);
+		}
+		param.read.value     = (uint8_t*) value.data();
+		param.read.value_len = value.length();
+	}
+	CHECK(pQueue->handleGATTClientEvent(request.event, GATTC_IF, &param));
+	return true;
+} // respond
+
+
+static void open(BLERemoteOperationQueue* pQueue) {
+	esp_ble_gattc_cb_param_t param;
+	param.open.status  = ESP_GATT_OK;
+	param.open.conn_id = CONN_ID;
+	param.open.mtu     = 23;
+	CHECK(!pQueue->handleGATTClientEvent(ESP_GATTC_OPEN_EVT, GATTC_IF, &param));
+} // open
+
+
+static void reset() {
+	requests.clear();
+	maxInFlight          = 0;
+	supportsReadMultiple = true;
+	failRequests         = false;
+	sequence             = 0;
+} // reset
+
+
+/**
+ * @brief What a callback was told.
+ */
+struct Result {
+	int               calls = 0;
+	esp_gatt_status_t status;
+	std::string       value;
+	std::vector<int>* pOrder = nullptr;   // Each callback appends its id.
+	int               id = 0;
+};
+
+static void onRead(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length, void* pArg) {
+	Result* pResult = (Result*) pArg;
+	pResult->calls++;
+	pResult->status = status;
+	pResult->value.assign((char*) pData, pData == nullptr ? 0 : length);
+	if (pResult->pOrder != nullptr) pResult->pOrder->push_back(pResult->id);
+} // onRead
+
+static void onReadMultiple(BLEClient* pClient, esp_gatt_status_t status, uint8_t* pData, size_t length, void* pArg) {
+	onRead(nullptr, status, pData, length, pArg);
+} // onReadMultiple
+
+static void onWrite(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, void* pArg) {
+	onRead(pCharacteristic, status, nullptr, 0, pArg);
+} // onWrite
+
+
+static void testOneInFlight() {
+	reset();
+	BLERemoteOperationQueue queue(nullptr);
+	queue.setGattcIf(GATTC_IF);
+	uint8_t data[2] = { 1, 2 };
+	CHECK(!queue.read(nullptr, 1, onRead, nullptr));   // Not connected yet.
+	open(&queue);
+
+	std::vector<int> order;
+	Result results[4];
+	for (int i = 0; i < 4; i++) {
+		results[i].pOrder = &order;
+		results[i].id     = i;
+	}
+	CHECK(queue.read(nullptr, 0x10, onRead, &results[0]));
+	CHECK(queue.write(nullptr, 0x11, data, sizeof(data), true, onWrite, &results[1]));
+	CHECK(queue.read(nullptr, 0x12, onRead, &results[2]));
+	CHECK(queue.write(nullptr, 0x13, data, sizeof(data), false, onWrite, &results[3]));
+	CHECK(requests.size() == 1 && queue.getPendingCount() == 4);
+	CHECK(requests[0].data.empty());
+
+	while (respond(&queue)) {}
+	CHECK(maxInFlight == 1 && queue.getPendingCount() == 0);
+	CHECK(order.size() == 4 && order[0] == 0 && order[1] == 1 && order[2] == 2 && order[3] == 3);
+	CHECK(results[0].calls == 1 && results[0].status == ESP_GATT_OK && results[0].value == peerValue(0x10, 0));
+	CHECK(results[1].calls == 1 && results[1].status == ESP_GATT_OK);
+	CHECK(results[2].value == peerValue(0x12, 2));
+} // testOneInFlight
+
+
+/**
+ * @brief Two readers of the same handle each get the response to their own read.
+ * A blocking and an asynchronous read of one handle once both took the first response.
+ */
+static void testSameHandle() {
+	reset();
+	BLERemoteOperationQueue queue(nullptr);
+	queue.setGattcIf(GATTC_IF);
+	open(&queue);
+
+	Result first, second;
+	CHECK(queue.read(nullptr, 0x20, onRead, &first));
+	CHECK(queue.read(nullptr, 0x20, onRead, &second));
+	CHECK(respond(&queue));
+	CHECK(first.calls == 1 && first.value == peerValue(0x20, 0) && second.calls == 0);
+	CHECK(respond(&queue));
+	CHECK(first.calls == 1 && second.calls == 1 && second.value == peerValue(0x20, 1));
+} // testSameHandle
+
+
+static void testForeignEvents() {
+	reset();
+	BLERemoteOperationQueue queue(nullptr);
+	queue.setGattcIf(GATTC_IF);
+	open(&queue);
+
+	Result result;
+	uint8_t value = 42;
+	CHECK(queue.read(nullptr, 0x30, onRead, &result));
+	esp_ble_gattc_cb_param_t param;
+	param.read.status    = ESP_GATT_OK;
+	param.read.conn_id   = CONN_ID;
+	param.read.handle    = 0x30;
+	param.read.value     = &value;
+	param.read.value_len = 1;
+	CHECK(!queue.handleGATTClientEvent(ESP_GATTC_READ_CHAR_EVT, GATTC_IF + 1, &param));   // Another client.
+	param.read.conn_id = CONN_ID + 1;
+	CHECK(!queue.handleGATTClientEvent(ESP_GATTC_READ_CHAR_EVT, GATTC_IF, &param));       // Another connection.
+	param.read.conn_id = CONN_ID;
+	param.read.handle  = 0x31;
+	CHECK(!queue.handleGATTClientEvent(ESP_GATTC_READ_CHAR_EVT, GATTC_IF, &param));       // Another handle.
+	param.write.status  = ESP_GATT_OK;
+	param.write.conn_id = CONN_ID;
+	param.write.handle  = 0x30;
+	CHECK(!queue.handleGATTClientEvent(ESP_GATTC_WRITE_CHAR_EVT, GATTC_IF, &param));      // Not a write.
+	CHECK(result.calls == 0 && queue.getPendingCount() == 1);
+
+	CHECK(respond(&queue));
+	CHECK(result.calls == 1 && result.value == peerValue(0x30, 0));
+	param.read.handle = 0x30;
+	CHECK(!queue.handleGATTClientEvent(ESP_GATTC_READ_CHAR_EVT, GATTC_IF, &param));       // Nothing in flight.
+} // testForeignEvents
+
+
+static void testReadMultipleFallback() {
+	reset();
+	BLERemoteOperationQueue queue(nullptr);
+	queue.setGattcIf(GATTC_IF);
+	open(&queue);
+
+	uint16_t handles[3] = { 0x40, 0x41, 0x42 };
+	Result result;
+	CHECK(!queue.readMultiple(handles, 1, onReadMultiple, &result));
+	CHECK(queue.readMultiple(handles, 3, onReadMultiple, &result));
+	CHECK(requests.size() == 1 && requests[0].event == ESP_GATTC_READ_MULTIPLE_EVT && requests[0].handles.size() == 3);
+	CHECK(respond(&queue));
+	CHECK(result.calls == 1 && result.value == peerValue(0x40, 0) + peerValue(0x41, 0) + peerValue(0x42, 0));
+
+	supportsReadMultiple = false;
+	result = Result();
+	CHECK(queue.readMultiple(handles, 3, onReadMultiple, &result));
+	CHECK(respond(&queue));                                    // Rejected.
+	CHECK(requests.size() == 1 && requests[0].event == ESP_GATTC_READ_CHAR_EVT && requests[0].handles[0] == 0x40);
+	while (respond(&queue)) {}
+	CHECK(maxInFlight == 1);
+	CHECK(result.calls == 1 && result.status == ESP_GATT_OK);
+	CHECK(result.value == peerValue(0x40, 2) + peerValue(0x41, 3) + peerValue(0x42, 4));
+
+	result = Result();                                         // Remembered for the connection.
+	CHECK(queue.readMultiple(handles, 2, onReadMultiple, &result));
+	CHECK(requests.size() == 1 && requests[0].event == ESP_GATTC_READ_CHAR_EVT);
+	while (respond(&queue)) {}
+	CHECK(result.value == peerValue(0x40, 5) + peerValue(0x41, 6));
+
+	open(&queue);                                              // A new peer may support it.
+	CHECK(queue.readMultiple(handles, 2, onReadMultiple, &result));
+	CHECK(requests.size() == 1 && requests[0].event == ESP_GATTC_READ_MULTIPLE_EVT);
+	while (respond(&queue)) {}
+} // testReadMultipleFallback
+
+
+static void disconnect(BLERemoteOperationQueue* pQueue) {
+	esp_ble_gattc_cb_param_t param;
+	param.disconnect.reason  = 0x13;
+	param.disconnect.conn_id = CONN_ID;
+	CHECK(!pQueue->handleGATTClientEvent(ESP_GATTC_DISCONNECT_EVT, GATTC_IF, &param));
+} // disconnect
+
+
+static void testDisconnectAndFailure() {
+	reset();
+	BLERemoteOperationQueue queue(nullptr);
+	queue.setGattcIf(GATTC_IF);
+	open(&queue);
+
+	Result results[3];
+	for (int i = 0; i < 3; i++) CHECK(queue.read(nullptr, 0x50 + i, onRead, &results[i]));
+	esp_ble_gattc_cb_param_t param;
+	param.disconnect.reason  = 0x13;
+	param.disconnect.conn_id = CONN_ID;
+	CHECK(!queue.handleGATTClientEvent(ESP_GATTC_DISCONNECT_EVT, GATTC_IF, &param));
+	for (int i = 0; i < 3; i++) CHECK(results[i].calls == 1 && results[i].status == ESP_GATT_ERROR);
+	CHECK(queue.getPendingCount() == 0);
+	CHECK(!queue.read(nullptr, 0x50, onRead, &results[0]));
+	CHECK(results[0].calls == 1);
+
+	requests.clear();                                          // The stack drops what was in flight.
+	open(&queue);
+	failRequests = true;                                       // The stack refuses; each fails in turn.
+	Result refused[2];
+	CHECK(queue.read(nullptr, 0x60, onRead, &refused[0]));
+	CHECK(queue.read(nullptr, 0x61, onRead, &refused[1]));
+	CHECK(refused[0].status == ESP_GATT_ERROR && refused[1].status == ESP_GATT_ERROR);
+	CHECK(queue.getPendingCount() == 0);
+} // testDisconnectAndFailure
+
+
+static BLERemoteOperationQueue* pRacingQueue;
+static Result                   racingResult;
+
+static void disconnectRacing() {
+	disconnect(pRacingQueue);
+} // disconnectRacing
+
+static void reconnectRacing() {
+	disconnect(pRacingQueue);
+	open(pRacingQueue);
+	failRequests = false;
+	CHECK(pRacingQueue->read(nullptr, 0x71, onRead, &racingResult));
+} // reconnectRacing
+
+
+/**
+ * @brief A disconnect that clears the queue while the stack is being handed an operation.
+ * The stack must be given a value that is still valid, and a request refused afterwards must not fail an
+ * operation queued since.
+ */
+static void testDisconnectDuringRequest() {
+	reset();
+	BLERemoteOperationQueue queue(nullptr);
+	pRacingQueue = &queue;
+	queue.setGattcIf(GATTC_IF);
+	open(&queue);
+
+	uint8_t data[64];
+	for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t) i;
+	Result written;
+	duringRequest = disconnectRacing;                          // The value is read after the queue is cleared.
+	CHECK(queue.write(nullptr, 0x70, data, sizeof(data), true, onWrite, &written));
+	CHECK(written.calls == 1 && written.status == ESP_GATT_ERROR);
+	CHECK(requests.size() == 1 && requests[0].data == std::string((const char*) data, sizeof(data)));
+	CHECK(queue.getPendingCount() == 0);
+
+	requests.clear();
+	open(&queue);
+	Result refused;
+	racingResult = Result();
+	duringRequest = reconnectRacing;                           // Cleared, reconnected and a new read issued...
+	failRequests  = true;                                      // ...before the first request is refused.
+	CHECK(queue.read(nullptr, 0x72, onRead, &refused));
+	CHECK(refused.calls == 1 && refused.status == ESP_GATT_ERROR);   // Once, by the disconnect.
+	CHECK(racingResult.calls == 0 && queue.getPendingCount() == 1);   // Still in flight.
+	CHECK(requests.size() == 1 && requests[0].handles[0] == 0x71);
+	CHECK(respond(&queue));
+	CHECK(racingResult.calls == 1 && racingResult.status == ESP_GATT_OK && racingResult.value == peerValue(0x71, 0));
+} // testDisconnectDuringRequest
+
+
+/**
+ * @brief Readers on several threads block on reads of shared handles while a peer thread answers.
+ * Each must get a value of the handle it read.
+ */
+struct Reader {
+	BLERemoteOperationQueue* pQueue;
+	int                      id;
+	std::atomic<int>         mismatches;
+};
+
+struct BlockingRead {
+	pthread_mutex_t lock;
+	pthread_cond_t  done;
+	bool            complete;
+	std::string     value;
+};
+
+static void onBlockingRead(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length, void* pArg) {
+	BlockingRead* pRead = (BlockingRead*) pArg;
+	pthread_mutex_lock(&pRead->lock);
+	pRead->value.assign((char*) pData, pData == nullptr ? 0 : length);
+	pRead->complete = true;
+	pthread_cond_signal(&pRead->done);
+	pthread_mutex_unlock(&pRead->lock);
+} // onBlockingRead
+
+static void* readerThread(void* pArg) {
+	Reader* pReader = (Reader*) pArg;
+	BlockingRead read;
+	pthread_mutex_init(&read.lock, nullptr);
+	pthread_cond_init(&read.done, nullptr);
+	for (int i = 0; i < 2000; i++) {
+		uint16_t handle = 0x70 + (i + pReader->id) % 3;
+		read.complete = false;
+		if (!pReader->pQueue->read(nullptr, handle, onBlockingRead, &read)) {
+			pReader->mismatches++;
+			continue;
+		}
+		pthread_mutex_lock(&read.lock);
+		while (!read.complete) pthread_cond_wait(&read.done, &read.lock);
+		pthread_mutex_unlock(&read.lock);
+		if (read.value.compare(0, 4, peerValue(handle, 0), 0, 4) != 0) pReader->mismatches++;
+	}
+	pthread_cond_destroy(&read.done);
+	pthread_mutex_destroy(&read.lock);
+	return nullptr;
+} // readerThread
+
+static std::atomic<bool> peerStop(false);
+
+static void* peerThread(void* pArg) {
+	BLERemoteOperationQueue* pQueue = (BLERemoteOperationQueue*) pArg;
+	while (true) {
+		pthread_mutex_lock(&peerLock);
+		while (requests.empty() && !peerStop) pthread_cond_wait(&peerRequest, &peerLock);
+		bool stop = requests.empty() && peerStop;
+		pthread_mutex_unlock(&peerLock);
+		if (stop) break;
+		respond(pQueue);
+	}
+	return nullptr;
+} // peerThread
+
+static void testConcurrentReaders() {
+	reset();
+	BLERemoteOperationQueue queue(nullptr);
+	queue.setGattcIf(GATTC_IF);
+	open(&queue);
+
+	pthread_t peer;
+	pthread_create(&peer, nullptr, peerThread, &queue);
+	Reader readers[4];
+	pthread_t threads[4];
+	for (int i = 0; i < 4; i++) {
+		readers[i].pQueue     = &queue;
+		readers[i].id         = i;
+		readers[i].mismatches = 0;
+		pthread_create(&threads[i], nullptr, readerThread, &readers[i]);
+	}
+	for (int i = 0; i < 4; i++) {
+		pthread_join(threads[i], nullptr);
+		CHECK(readers[i].mismatches == 0);
+	}
+	pthread_mutex_lock(&peerLock);
+	peerStop = true;
+	pthread_cond_signal(&peerRequest);
+	pthread_mutex_unlock(&peerLock);
+	pthread_join(peer, nullptr);
+	CHECK(maxInFlight == 1 && sequence == 8000);
+} // testConcurrentReaders
+
+
+int main() {
+	testOneInFlight();
+	testSameHandle();
+	testForeignEvents();
+	testReadMultipleFallback();
+	testDisconnectAndFailure();
+	testDisconnectDuringRequest();
+	testConcurrentReaders();
+	return testResult("test_ble_remote_operation_queue");
+} // main
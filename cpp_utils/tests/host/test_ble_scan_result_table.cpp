@@ -0,0 +1,157 @@
+/*
+ * test_ble_scan_result_table.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of BLEScanResultTable.  Random updates and erasures are checked against a std::map, an
+ * advertisement and its scan response must be kept together, and a reader copying results under the lock
+ * must never see a torn result while another thread updates the table.
+ */
+#include <string.h>
+#include <atomic>
+#include <map>
+#include <string>
+#include <pthread.h>
+#include "BLEScanResultTable.h"
+#include "HostTest.h"
+
+static void makeAddress(uint32_t n, uint8_t* address) {
+	address[0] = 0xa4;
+	address[1] = 0xc1;
+	address[2] = n >> 24;
+	address[3] = n >> 16;
+	address[4] = n >> 8;
+	address[5] = n;
+} // makeAddress
+
+
+static void testAgainstMap() {
+	BLEScanResultTable table(50);
+	std::map<uint32_t, int8_t> expected;
+	uint32_t seed = 1;
+	for (int i = 0; i < 100000; i++) {
+		seed = seed * 1103515245 + 12345;
+		uint32_t n = (seed >> 16) % 80;
+		uint8_t address[6];
+		makeAddress(n, address);
+		if ((seed >> 8) % 4 == 0) {
+			CHECK(table.erase(address) == (expected.erase(n) == 1));
+		} else {
+			int8_t rssi = -(int8_t) (seed % 100);
+			uint8_t adv[3] = { 2, 0x01, (uint8_t) n };
+			bool isNew;
+			BLEScanResult* pResult = table.update(address, 0, rssi, adv, sizeof(adv), 0, i, &isNew);
+			if (expected.count(n) == 0 && expected.size() == table.getCapacity()) {
+				CHECK(pResult == nullptr);
+				continue;
+			}
+			CHECK(pResult != nullptr && isNew == (expected.count(n) == 0));
+			expected[n] = rssi;
+		}
+		CHECK(table.getCount() == expected.size());
+	}
+	for (auto it = expected.begin(); it != expected.end(); ++it) {
+		uint8_t address[6];
+		makeAddress(it->first, address);
+		BLEScanResult* pResult = table.find(address);
+		CHECK(pResult != nullptr && pResult->rssi == it->second && pResult->payload[2] == (uint8_t) it->first);
+	}
+	CHECK(table.getDropCount() > 0);
+} // testAgainstMap
+
+
+static void testScanResponse() {
+	BLEScanResultTable table(4);
+	uint8_t address[6];
+	makeAddress(7, address);
+	uint8_t adv[] = { 2, 0x01, 0x06, 3, 0x03, 0x0f, 0x18 };
+	uint8_t rsp[] = { 5, 0x09, 'e', 's', 'p', '3' };
+
+	table.update(address, 0, -50, adv, sizeof(adv), 0, 1, nullptr);
+	BLEScanResult* pResult = table.update(address, 0, -51, rsp, 0, sizeof(rsp), 2, nullptr);
+	CHECK(pResult->advLength == sizeof(adv) && pResult->payloadLength == sizeof(adv) + sizeof(rsp));
+	CHECK(::memcmp(pResult->payload, adv, sizeof(adv)) == 0);
+	CHECK(::memcmp(pResult->payload + sizeof(adv), rsp, sizeof(rsp)) == 0);
+
+	uint8_t shorter[] = { 2, 0x01, 0x04 };   // A new advertisement keeps the scan response.
+	pResult = table.update(address, 0, -52, shorter, sizeof(shorter), 0, 3, nullptr);
+	CHECK(pResult->payloadLength == sizeof(shorter) + sizeof(rsp));
+	CHECK(::memcmp(pResult->payload, shorter, sizeof(shorter)) == 0);
+	CHECK(::memcmp(pResult->payload + sizeof(shorter), rsp, sizeof(rsp)) == 0);
+
+	uint8_t both[sizeof(adv) + sizeof(rsp)];   // Both in one event, as an ESP32 may report them.
+	::memcpy(both, adv, sizeof(adv));
+	::memcpy(both + sizeof(adv), rsp, sizeof(rsp));
+	makeAddress(8, address);
+	pResult = table.update(address, 0, -53, both, sizeof(adv), sizeof(rsp), 4, nullptr);
+	CHECK(pResult->payloadLength == sizeof(both) && ::memcmp(pResult->payload, both, sizeof(both)) == 0);
+
+	uint8_t large[40] = { 0 };   // Each part is limited to 31 bytes.
+	pResult = table.update(address, 0, -54, large, sizeof(large), 0, 5, nullptr);
+	CHECK(pResult->advLength == BLEScanResult::MAX_PART);
+	CHECK(pResult->payloadLength == BLEScanResult::MAX_PART + sizeof(rsp));
+} // testScanResponse
+
+
+static std::atomic<bool> writerDone(false);
+
+/**
+ * @brief Update and erase devices as fast as possible.  Each result's payload is filled with one byte
+ * value and its RSSI is derived from it, so a reader can tell a torn copy.
+ */
+static void* writer(void* pTable) {
+	BLEScanResultTable* pResultTable = (BLEScanResultTable*) pTable;
+	for (int i = 0; i < 200000; i++) {
+		uint8_t address[6];
+		makeAddress(i % 37, address);
+		uint8_t value = i;
+		uint8_t payload[BLEScanResult::MAX_PAYLOAD];
+		::memset(payload, value, sizeof(payload));
+		pResultTable->lock();
+		if (i % 11 == 0) {
+			pResultTable->erase(address);
+		} else {
+			pResultTable->update(address, 0, (int8_t) (value & 0x7f), payload, BLEScanResult::MAX_PART, BLEScanResult::MAX_PART, i, nullptr);
+		}
+		pResultTable->unlock();
+	}
+	writerDone = true;
+	return nullptr;
+} // writer
+
+
+static void testConcurrentReader() {
+	BLEScanResultTable table(32);
+	pthread_t thread;
+	::pthread_create(&thread, nullptr, writer, &table);
+	uint32_t copies = 0;
+	uint32_t torn   = 0;
+	while (!writerDone) {
+		table.lock();
+		size_t count = table.getCount();
+		BLEScanResult result;
+		bool found = false;
+		if (count > 0) {
+			result = *table.getResult(copies % count);
+			found = true;
+		}
+		table.unlock();
+		if (!found) continue;
+		copies++;
+		for (size_t i = 0; i < result.payloadLength; i++) {
+			if (result.payload[i] != result.payload[0]) torn++;
+		}
+		if (result.rssi != (int8_t) (result.payload[0] & 0x7f)) torn++;
+	}
+	::pthread_join(thread, nullptr);
+	CHECK(torn == 0);
+	CHECK(copies > 0);
+} // testConcurrentReader
+
+
+int main() {
+	testAgainstMap();
+	testScanResponse();
+	testConcurrentReader();
+	return testResult("test_ble_scan_result_table");
+} // main
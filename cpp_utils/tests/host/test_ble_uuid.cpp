@@ -0,0 +1,149 @@
+/*
+ * test_ble_uuid.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test and microbenchmark of BLEUUID as a map key.  A UUID must equal, hash and order the same in its
+ * short and 128 bit forms, and finding the attribute of a server by UUID in a map keyed on BLEUUID is timed
+ * against the scans it replaced: one calling equals() on every attribute and one comparing toString().
+ */
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "BLEUUID.h"
+#include "HostTest.h"
+
+/**
+ * @brief The 128 bit string form of a UUID in the Bluetooth Base UUID.
+ */
+static std::string baseString(uint32_t value) {
+	char uuid[40];
+	snprintf(uuid, sizeof(uuid), "%08x-0000-1000-8000-00805f9b34fb", value);
+	return uuid;
+} // baseString
+
+
+static void testForms() {
+	BLEUUID short16((uint16_t) 0x180d);
+	BLEUUID short32((uint32_t) 0x180d);
+	BLEUUID long128(baseString(0x180d));
+	BLEUUID parsed = BLEUUID::fromString("0x180D");
+	CHECK(short16 == short32 && short16 == long128 && long128 == short16 && parsed == long128);
+	CHECK(short16.hash() == long128.hash() && short32.hash() == long128.hash());
+	CHECK(!(short16 < long128) && !(long128 < short16));
+	CHECK(short16.to128().toString() == baseString(0x180d));
+
+	BLEUUID custom("4fafc201-1fb5-459e-8fcc-c5c9c331914b");
+	CHECK(custom != short16 && custom == BLEUUID(std::string("4fafc201-1fb5-459e-8fcc-c5c9c331914b")));
+	CHECK((custom < short16) != (short16 < custom));
+	CHECK(BLEUUID() != BLEUUID());   // An unset UUID equals nothing.
+} // testForms
+
+
+/**
+ * @brief Random UUIDs in every form must be ordered consistently with equality.
+ */
+static void testOrdering() {
+	std::vector<BLEUUID> uuids;
+	uint32_t seed = 7;
+	for (int i = 0; i < 300; i++) {
+		seed = seed * 1103515245 + 12345;
+		uint32_t value = (seed >> 8) % 40;   // Small so that forms of the same UUID collide.
+		switch (seed % 3) {
+			case 0:  uuids.push_back(BLEUUID((uint16_t) value)); break;
+			case 1:  uuids.push_back(BLEUUID((uint32_t) value)); break;
+			default: uuids.push_back(BLEUUID(baseString(value))); break;
+		}
+	}
+	uuids.push_back(BLEUUID("4fafc201-1fb5-459e-8fcc-c5c9c331914b"));
+	uuids.push_back(BLEUUID("beb5483e-36e1-4688-b7f5-ea07361b26a8"));
+	for (size_t i = 0; i < uuids.size(); i++) {
+		for (size_t j = 0; j < uuids.size(); j++) {
+			const BLEUUID& a = uuids[i];
+			const BLEUUID& b = uuids[j];
+			CHECK(!(a < b && b < a));
+			CHECK(a.equals(b) == (!(a < b) && !(b < a)));
+			CHECK(a.equals(b) == (a.toString() == b.toString()));
+			if (a == b) CHECK(a.hash() == b.hash());
+		}
+	}
+} // testOrdering
+
+
+/**
+ * @brief Find each attribute of a typical server by UUID, given in the other form to the one stored.
+ */
+static void benchmark() {
+	std::vector<BLEUUID> attributes;
+	std::vector<BLEUUID> queries;
+	for (uint32_t i = 0; i < 24; i++) {   // Standard services and characteristics held in 16 bits.
+		attributes.push_back(BLEUUID((uint16_t) (0x2a00 + i)));
+		queries.push_back(BLEUUID(baseString(0x2a00 + i)));
+	}
+	for (uint32_t i = 0; i < 8; i++) {    // Vendor characteristics.
+		char uuid[40];
+		snprintf(uuid, sizeof(uuid), "beb5483e-36e1-4688-b7f5-ea07361b%04x", i);
+		attributes.push_back(BLEUUID(uuid));
+		queries.push_back(BLEUUID(std::string(uuid)));
+	}
+	std::multimap<BLEUUID, int> map;
+	std::vector<std::string> strings;
+	for (size_t i = 0; i < attributes.size(); i++) {
+		map.insert(std::pair<BLEUUID, int>(attributes[i], i));
+		strings.push_back(attributes[i].toString());
+	}
+
+	const int rounds = 20000;
+	size_t found = 0;
+	uint64_t start = testNowNs();
+	for (int round = 0; round < rounds; round++) {
+		for (size_t i = 0; i < queries.size(); i++) {
+			auto it = map.lower_bound(queries[i]);
+			if (it != map.end() && it->first == queries[i] && it->second == (int) i) found++;
+		}
+	}
+	uint64_t mapNs = (testNowNs() - start) / (rounds * queries.size());
+	CHECK(found == rounds * queries.size());
+
+	found = 0;
+	start = testNowNs();
+	for (int round = 0; round < rounds; round++) {
+		for (size_t i = 0; i < queries.size(); i++) {
+			for (size_t j = 0; j < attributes.size(); j++) {
+				if (attributes[j].equals(queries[i])) {
+					if (j == i) found++;
+					break;
+				}
+			}
+		}
+	}
+	uint64_t scanNs = (testNowNs() - start) / (rounds * queries.size());
+	CHECK(found == rounds * queries.size());
+
+	found = 0;
+	start = testNowNs();
+	for (int round = 0; round < rounds / 20; round++) {
+		for (size_t i = 0; i < queries.size(); i++) {
+			std::string query = queries[i].toString();
+			for (size_t j = 0; j < attributes.size(); j++) {
+				if (attributes[j].toString() == query) {
+					if (j == i) found++;
+					break;
+				}
+			}
+		}
+	}
+	uint64_t stringNs = (testNowNs() - start) / (rounds / 20 * queries.size());
+	CHECK(found == rounds / 20 * queries.size());
+	printf("  %d attributes: map %llu ns, equals() scan %llu ns, toString() scan %llu ns per lookup\n",
+		(int) attributes.size(), (unsigned long long) mapNs, (unsigned long long) scanNs, (unsigned long long) stringNs);
+} // benchmark
+
+
+int main() {
+	testForms();
+	testOrdering();
+	benchmark();
+	return testResult("test_ble_uuid");
+} // main
@@ -0,0 +1,153 @@
+/*
+ * test_buffered_socket_reader.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of BufferedSocketReader over a loopback TCP connection.  Lines and delimiters split across
+ * fills, lines longer than the buffer, data following the headers and the partner closing in the middle
+ * of a line must all read back exactly what was sent, at every buffer size.
+ */
+#include <string.h>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include "BufferedSocketReader.h"
+#include "Socket.h"
+#include "HostTest.h"
+
+/**
+ * @brief A connected pair of sockets: what is sent on one is read from the other.
+ */
+struct Connection {
+	Socket listener;
+	Socket sender;
+	Socket receiver;
+
+	Connection() {
+		listener.listen(0);
+		struct sockaddr_in addr;
+		listener.getBind((struct sockaddr*) &addr);
+		struct in_addr loopback;
+		loopback.s_addr = htonl(INADDR_LOOPBACK);
+		sender.connect(loopback, ntohs(addr.sin_port));
+		receiver = listener.accept();
+	}
+
+	~Connection() {
+		receiver.close();
+		sender.close();
+		listener.close();
+	}
+
+	/**
+	 * @brief Send the data and then end the stream, as a partner closing the connection does.
+	 */
+	void sendAndClose(const std::string& data) {
+		sender.send(data);
+		::shutdown(sender.getFD(), SHUT_WR);
+	}
+};
+
+
+/**
+ * @brief Lines of every length around the buffer size, each one read back exactly whatever the size.
+ */
+static void testLines() {
+	std::vector<std::string> lines;
+	for (size_t length = 0; length < 40; length++) {
+		std::string line;
+		for (size_t i = 0; i < length; i++) line += (char) ('a' + (i + length) % 26);
+		lines.push_back(line);
+	}
+	std::string data;
+	for (size_t i = 0; i < lines.size(); i++) data += lines[i] + "\r\n";
+
+	for (size_t bufferSize = 2; bufferSize <= 20; bufferSize++) {
+		Connection connection;
+		connection.sendAndClose(data);
+		BufferedSocketReader reader(connection.receiver, bufferSize);
+		for (size_t i = 0; i < lines.size(); i++) {
+			CHECK(reader.readToDelim("\r\n") == lines[i]);
+		}
+		CHECK(reader.readToDelim("\r\n") == "");
+		CHECK(reader.available() == 0);
+	}
+} // testLines
+
+
+/**
+ * @brief A request head followed by its body, as an HTTP server reads one.
+ */
+static void testHeadAndBody() {
+	Connection connection;
+	std::string body(100, 'x');
+	for (size_t i = 0; i < body.length(); i++) body[i] = (char) ('0' + i % 10);
+	connection.sendAndClose("GET /a/rather/long/path/index.html HTTP/1.1\r\nHost: esp32\r\n\r\n" + body);
+
+	BufferedSocketReader reader(connection.receiver, 16);
+	CHECK(reader.readToDelim("\r\n") == "GET /a/rather/long/path/index.html HTTP/1.1");   // Longer than the buffer.
+	CHECK(reader.readToDelim("\r\n") == "Host: esp32");
+	CHECK(reader.readToDelim("\r\n") == "");
+
+	uint8_t data[100];
+	CHECK(reader.read(data, 10, true) == 10);   // Through the buffer.
+	CHECK(memcmp(data, body.data(), 10) == 0);
+	CHECK(reader.read(data, 90, true) == 90);   // What is left in the buffer, then straight into ours.
+	CHECK(memcmp(data, body.data() + 10, 90) == 0);
+	CHECK(reader.read(data, sizeof(data)) == 0);
+} // testHeadAndBody
+
+
+/**
+ * @brief A delimiter split over two fills is still found.
+ */
+static void testSplitDelimiter() {
+	Connection connection;
+	connection.sendAndClose("1234567\r\nabcdef--boundary--tail");
+	BufferedSocketReader reader(connection.receiver, 8);
+	CHECK(reader.readToDelim("\r\n") == "1234567");                // "\r" ends the first fill.
+	CHECK(reader.readToDelim("--boundary--") == "abcdef");         // A delimiter longer than the buffer.
+	CHECK(reader.readToDelim("\r\n") == "tail");
+} // testSplitDelimiter
+
+
+/**
+ * @brief The partner closing in the middle of a line gives what was read, then nothing.
+ */
+static void testEndInLine() {
+	Connection connection;
+	connection.sendAndClose("complete\r\na partial line that ends\r");
+	BufferedSocketReader reader(connection.receiver, 8);
+	CHECK(reader.readToDelim("\r\n") == "complete");
+	CHECK(reader.readToDelim("\r\n") == "a partial line that ends\r");
+	CHECK(reader.readToDelim("\r\n") == "");
+	uint8_t data[4];
+	CHECK(reader.read(data, sizeof(data), true) == 0);
+} // testEndInLine
+
+
+/**
+ * @brief peek(), consume() and fill() as a parser working on the buffer uses them.
+ */
+static void testPeek() {
+	Connection connection;
+	connection.sendAndClose("abcdefghij");
+	BufferedSocketReader reader(connection.receiver, 4);
+	std::string seen;
+	while (reader.fill() && reader.available() > 0) {
+		seen.append((const char*) reader.peek(), reader.available());
+		reader.consume(reader.available());
+	}
+	CHECK(seen == "abcdefghij");
+	CHECK(reader.getBufferSize() == 4);
+} // testPeek
+
+
+int main() {
+	testLines();
+	testHeadAndBody();
+	testSplitDelimiter();
+	testEndInLine();
+	testPeek();
+	return testResult("test_buffered_socket_reader");
+} // main
@@ -0,0 +1,117 @@
+/*
+ * test_double_buffer.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of DoubleBuffer.  Transfers of every size around the buffer size must deliver the data in
+ * order, failures on either side must end the transfer, one producer thread must serve every
+ * transfer of a DoubleBuffer, and that thread must have the stack it was given.
+ */
+#include <string.h>
+#include <string>
+#include <pthread.h>
+#include "DoubleBuffer.h"
+#include "HostTest.h"
+
+struct Source {
+	std::string data;
+	size_t      pos;
+	long        failAt;       // Fail when this many bytes have been produced, -1 never.
+	pthread_t   thread;       // The thread the producer last ran on.
+};
+
+struct Sink {
+	std::string data;
+	long        abortAt;      // Abandon the transfer once this many bytes have been consumed, -1 never.
+};
+
+
+static int produce(uint8_t* pBuffer, size_t length, void* pContext) {
+	Source* pSource = (Source*) pContext;
+	pSource->thread = ::pthread_self();
+	if (pSource->failAt >= 0 && pSource->pos >= (size_t) pSource->failAt) return -1;
+	size_t n = std::min(length, pSource->data.length() - pSource->pos);
+	::memcpy(pBuffer, pSource->data.data() + pSource->pos, n);
+	pSource->pos += n;
+	return (int) n;
+} // produce
+
+
+/**
+ * @brief A producer that needs a large stack, as one decoding or logging what it reads may.
+ */
+static int produceOnStack(uint8_t* pBuffer, size_t length, void* pContext) {
+	volatile uint8_t scratch[64 * 1024];
+	for (size_t i = 0; i < sizeof(scratch); i += 512) scratch[i] = (uint8_t) i;
+	return produce(pBuffer, length, pContext) + scratch[0];
+} // produceOnStack
+
+
+static bool consume(const uint8_t* pData, size_t length, void* pContext) {
+	Sink* pSink = (Sink*) pContext;
+	pSink->data.append((const char*) pData, length);
+	return pSink->abortAt < 0 || pSink->data.length() < (size_t) pSink->abortAt;
+} // consume
+
+
+static std::string pattern(size_t length) {
+	std::string data;
+	for (size_t i = 0; i < length; i++) data += (char) ('a' + i * 7 % 26);
+	return data;
+} // pattern
+
+
+int main() {
+	const size_t bufferSize = 64;
+	DoubleBuffer buffer(bufferSize);
+	pthread_t producerThread;
+	bool first = true;
+
+	for (size_t length = 0; length <= 4 * bufferSize + 1; length++) {
+		for (int hinted = 0; hinted < 2; hinted++) {
+			Source source = { pattern(length), 0, -1, pthread_t() };
+			Sink sink = { "", -1 };
+			int64_t total = buffer.transfer(produce, &source, consume, &sink, hinted ? length : 0);
+			CHECK(total == (int64_t) length);
+			CHECK(sink.data == source.data);
+			if (hinted && length > 0 && length <= bufferSize) {
+				CHECK(::pthread_equal(source.thread, ::pthread_self()));   // Small enough to run on the caller.
+			} else if (!hinted) {
+				if (first) producerThread = source.thread;
+				first = false;
+				CHECK(::pthread_equal(source.thread, producerThread));     // The same thread every time.
+				CHECK(!::pthread_equal(source.thread, ::pthread_self()));
+			}
+		}
+	}
+
+	Source failing = { pattern(1000), 0, 3 * (long) bufferSize, pthread_t() };
+	Sink sink = { "", -1 };
+	CHECK(buffer.transfer(produce, &failing, consume, &sink) == -1);
+	CHECK(sink.data == failing.data.substr(0, 3 * bufferSize));
+
+	Source source = { pattern(1000), 0, -1, pthread_t() };
+	Sink aborting = { "", 2 * (long) bufferSize };
+	CHECK(buffer.transfer(produce, &source, consume, &aborting) == -1);
+	CHECK(aborting.data == source.data.substr(0, 2 * bufferSize));
+
+	Source after = { pattern(500), 0, -1, pthread_t() };   // Still usable after the failures.
+	Sink afterSink = { "", -1 };
+	CHECK(buffer.transfer(produce, &after, consume, &afterSink) == 500);
+	CHECK(afterSink.data == after.data);
+	CHECK(::pthread_equal(after.thread, producerThread));
+
+	{
+		DoubleBuffer large(bufferSize, 512 * 1024);
+		Source deep = { pattern(1000), 0, -1, pthread_t() };
+		Sink deepSink = { "", -1 };
+		CHECK(large.transfer(produceOnStack, &deep, consume, &deepSink) == 1000);
+		CHECK(deepSink.data == deep.data);
+		CHECK(!::pthread_equal(deep.thread, ::pthread_self()));
+	}
+
+	{
+		DoubleBuffer unused(bufferSize);   // Deleting a DoubleBuffer that never started its thread.
+	}
+	return testResult("test_double_buffer");
+} // main
@@ -0,0 +1,172 @@
+/*
+ * test_ftp_callbacks.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of FTPBulkFileCallbacks.  Files stored in chunks of any size, multiples of the block size or
+ * not, must be written byte for byte and read back the same.  A failing write must fail the chunk it
+ * happens in, every chunk after it and the end of the store, without writing past the block it keeps.
+ */
+#include <string.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include "FTPServer.h"
+#include "HostTest.h"
+
+static std::string directory;
+
+
+// FTPServer.cpp needs the ESP-IDF; onDir() only needs the current directory.
+std::string FTPServer::getCurrentDirectory() {
+	return directory;
+} // FTPServer::getCurrentDirectory
+
+
+static std::string content(size_t length, uint32_t seed) {
+	std::string data(length, '\0');
+	for (size_t i = 0; i < length; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = (char) (seed >> 16);
+	}
+	return data;
+} // content
+
+
+static std::string readFile(const std::string& fileName) {
+	std::ifstream file(fileName, std::ios::binary);
+	std::stringstream ss;
+	ss << file.rdbuf();
+	return ss.str();
+} // readFile
+
+
+/**
+ * @brief Store data in chunks of one size, as the server hands them over.
+ * @return True if every chunk was accepted and the store ended without an exception.
+ */
+static bool store(FTPBulkFileCallbacks& callbacks, const std::string& fileName, const std::string& data, size_t chunkSize) {
+	callbacks.onStoreStart(fileName);
+	std::string chunk;
+	bool ok = true;
+	for (size_t pos = 0; pos < data.length(); pos += chunkSize) {
+		chunk = data.substr(pos, chunkSize);   // A buffer of its own, so that reading past it is caught.
+		ok = callbacks.onStoreData((uint8_t*) &chunk[0], chunk.length()) == chunk.length() && ok;
+	}
+	try {
+		callbacks.onStoreEnd();
+	} catch (FTPServer::FileException&) {
+		return false;
+	}
+	return ok;
+} // store
+
+
+static std::string retrieve(FTPBulkFileCallbacks& callbacks, const std::string& fileName, size_t chunkSize) {
+	callbacks.onRetrieveStart(fileName);
+	std::string data;
+	std::string chunk(chunkSize, '\0');
+	size_t length;
+	while ((length = callbacks.onRetrieveData((uint8_t*) &chunk[0], chunkSize)) > 0) {
+		CHECK(length <= chunkSize);
+		data.append(chunk, 0, length);
+	}
+	callbacks.onRetrieveEnd();
+	return data;
+} // retrieve
+
+
+/**
+ * @brief Every file length around the block size, stored and retrieved in chunks that are and aren't
+ * multiples of it.
+ */
+static void testRoundTrip() {
+	static const size_t blockSizes[] = { 64, 4096 };
+	static const size_t chunkSizes[] = { 1, 37, 64, 100, 1460, 4096, 5000 };
+	std::string fileName = directory + "/roundtrip";
+	for (size_t b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++) {
+		size_t blockSize = blockSizes[b];
+		FTPBulkFileCallbacks callbacks(blockSize);   // One for all the transfers, as the server keeps it.
+		size_t lengths[] = { 0, 1, blockSize - 1, blockSize, blockSize + 1, 3 * blockSize, 3 * blockSize + 17, 50000 };
+		for (size_t c = 0; c < sizeof(chunkSizes) / sizeof(chunkSizes[0]); c++) {
+			for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+				std::string data = content(lengths[l], (uint32_t) (b * 1000 + c * 100 + l));
+				CHECK(store(callbacks, fileName, data, chunkSizes[c]));
+				CHECK(readFile(fileName) == data);
+				CHECK(retrieve(callbacks, fileName, chunkSizes[c]) == data);
+			}
+		}
+	}
+	::unlink(fileName.c_str());
+} // testRoundTrip
+
+
+/**
+ * @brief Writes that fail, to /dev/full, while completing a block kept from the last chunk and while
+ * writing whole blocks straight from a chunk.
+ */
+static void testWriteFails() {
+	FTPBulkFileCallbacks callbacks(64);
+	std::string data = content(1000, 7);
+
+	// A kept block completed by a chunk bigger than a block: the rest of the chunk mustn't be kept.
+	callbacks.onStoreStart("/dev/full");
+	CHECK(callbacks.onStoreData((uint8_t*) &data[0], 10) == 10);
+	CHECK(callbacks.onStoreData((uint8_t*) &data[10], 300) == 0);
+	CHECK(callbacks.onStoreData((uint8_t*) &data[310], 5) == 0);   // Nothing more once a write has failed.
+	bool thrown = false;
+	try {
+		callbacks.onStoreEnd();
+	} catch (FTPServer::FileException&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+
+	// Whole blocks written straight from the chunk.
+	CHECK(!store(callbacks, "/dev/full", data, 200));
+
+	// Only a partial block, written at the end.
+	CHECK(!store(callbacks, "/dev/full", data.substr(0, 20), 20));
+
+	// A failure doesn't carry over to the next store.
+	std::string fileName = directory + "/afterfailure";
+	CHECK(store(callbacks, fileName, data, 100));
+	CHECK(readFile(fileName) == data);
+	::unlink(fileName.c_str());
+} // testWriteFails
+
+
+static void testOpenFails() {
+	FTPBulkFileCallbacks callbacks;
+	bool thrown = false;
+	try {
+		callbacks.onStoreStart(directory + "/no/such/directory");
+	} catch (FTPServer::FileException&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	thrown = false;
+	try {
+		callbacks.onRetrieveStart(directory + "/no-such-file");
+	} catch (FTPServer::FileException&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+} // testOpenFails
+
+
+int main() {
+	char dir[] = "/tmp/test_ftp_callbacksXXXXXX";
+	if (::mkdtemp(dir) == nullptr) {
+		perror("mkdtemp");
+		return 2;
+	}
+	directory = dir;
+	testRoundTrip();
+	testWriteFails();
+	testOpenFails();
+	::rmdir(dir);
+	return testResult("test_ftp_callbacks");
+} // main
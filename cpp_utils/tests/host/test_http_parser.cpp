@@ -0,0 +1,257 @@
+/*
+ * test_http_parser.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of HttpRequestParser.  Requests are parsed whole and fed a byte at a time or in random pieces,
+ * which must all give the same result; malformed framing must fail with the right status; mutated requests
+ * are fuzzed through the parser (run under the sanitizers); and a typical browser request is timed.
+ */
+#include <string.h>
+#include <string>
+#include <vector>
+#include "HttpRequestParser.h"
+#include "HostTest.h"
+
+struct ParseResult {
+	int         headStatus;   // > 0 head length, 0 incomplete, -1 error.
+	int         errorStatus;
+	std::string method;
+	std::string target;
+	std::string body;
+	bool        complete;
+};
+
+
+/**
+ * @brief Parse a request delivered in pieces, as a reader would receive it.
+ * @param [in] request The request.
+ * @param [in] pieces The length of each piece; the last one is repeated until the request is used up.
+ */
+static ParseResult parse(const std::string& request, const std::vector<size_t>& pieces) {
+	HttpRequestParser parser;
+	ParseResult result;
+	result.headStatus = 0;
+	result.complete   = false;
+	size_t received = 0;
+	size_t piece    = 0;
+	size_t bodyPos  = 0;
+	while (received < request.length()) {
+		size_t length = pieces[piece < pieces.size() ? piece : pieces.size() - 1];
+		piece++;
+		received = std::min(request.length(), received + length);
+		std::string buffer = request.substr(0, received);    // A fresh copy, so stale views would show.
+		if (!parser.isHeadComplete()) {
+			result.headStatus = parser.parseHead(buffer.data(), buffer.length());
+			if (result.headStatus < 0) break;
+			if (result.headStatus == 0) continue;
+			bodyPos = result.headStatus;
+			result.method = parser.getMethod().toString();
+			result.target = parser.getTarget().toString();
+		}
+		while (bodyPos < received && !parser.isComplete() && !parser.isError()) {
+			const uint8_t* pBody;
+			size_t bodyLength;
+			bodyPos += parser.parseBody((const uint8_t*) buffer.data() + bodyPos, received - bodyPos, 7, &pBody, &bodyLength);
+			result.body.append((const char*) pBody, bodyLength);
+		}
+	}
+	result.errorStatus = parser.getErrorStatus();
+	result.complete    = parser.isComplete();
+	return result;
+} // parse
+
+
+static ParseResult parseWhole(const std::string& request) {
+	return parse(request, std::vector<size_t>(1, request.length()));
+} // parseWhole
+
+
+static bool sameResult(const ParseResult& a, const ParseResult& b) {
+	return a.headStatus == b.headStatus && a.errorStatus == b.errorStatus && a.method == b.method &&
+		a.target == b.target && a.body == b.body && a.complete == b.complete;
+} // sameResult
+
+
+static void testStringView() {
+	HttpStringView view("chunkedXYZ", 7);
+	CHECK(view.equals("chunked"));
+	CHECK(!view.equals("chunke"));
+	CHECK(!view.equals("chunkedX"));
+	CHECK(!view.equals(""));
+	CHECK(HttpStringView("", 0).equals(""));
+	CHECK(!HttpStringView("ab", 2).equals("a"));
+	CHECK(view.equalsIgnoreCase("CHUNKED"));
+	CHECK(!view.equalsIgnoreCase("chunkedX"));
+} // testStringView
+
+
+static void testRequests() {
+	std::string get = "GET /index.html?a=1 HTTP/1.1\r\nHost: esp32\r\nAccept: */*\r\n\r\n";
+	ParseResult result = parseWhole(get);
+	CHECK(result.headStatus == (int) get.length());
+	CHECK(result.method == "GET" && result.target == "/index.html?a=1");
+	CHECK(result.complete && result.errorStatus == 0);
+
+	result = parseWhole("POST /p HTTP/1.1\r\nContent-Length: 11\r\n\r\nhello world");
+	CHECK(result.complete && result.body == "hello world");
+
+	std::string chunked = "POST /p HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+		"5\r\nhello\r\n6;ext=1\r\n world\r\n0\r\nTrailer: x\r\n\r\n";
+	result = parseWhole(chunked);
+	CHECK(result.complete && result.body == "hello world");
+
+	// Every way of splitting the request over reads gives the same result.
+	const std::string* requests[] = { &get, &chunked };
+	for (size_t r = 0; r < 2; r++) {
+		ParseResult whole = parseWhole(*requests[r]);
+		CHECK(sameResult(whole, parse(*requests[r], std::vector<size_t>(1, 1))));
+		for (size_t split = 1; split < requests[r]->length(); split++) {
+			std::vector<size_t> pieces;
+			pieces.push_back(split);
+			pieces.push_back(requests[r]->length());
+			CHECK(sameResult(whole, parse(*requests[r], pieces)));
+		}
+	}
+} // testRequests
+
+
+static void testTransferEncoding() {
+	const char* body = "\r\n\r\n3\r\nabc\r\n0\r\n\r\n";
+	struct {
+		const char* value;
+		int         status;
+	} cases[] = {
+		{ "chunked",           0 },
+		{ "Chunked",           0 },
+		{ " chunked ",         0 },
+		{ ", chunked,",        0 },      // Empty list elements are ignored.
+		{ "gzip, chunked",     501 },
+		{ "chunked, gzip",     501 },
+		{ "xchunked",          501 },
+		{ "notchunked",        501 },
+		{ "chunked, chunked",  400 },
+		{ ",",                 400 },
+	};
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		ParseResult result = parseWhole(std::string("POST / HTTP/1.1\r\nTransfer-Encoding: ") + cases[i].value + body);
+		CHECK(result.errorStatus == cases[i].status);
+		if (cases[i].status == 0) CHECK(result.complete && result.body == "abc");
+		if (result.errorStatus != cases[i].status) printf("  Transfer-Encoding: %s gave %d\n", cases[i].value, result.errorStatus);
+	}
+} // testTransferEncoding
+
+
+static void testChunkSize() {
+	std::string head = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+	struct {
+		const char* chunks;
+		int         status;
+	} cases[] = {
+		{ "3\r\nabc\r\n0\r\n\r\n",      0 },
+		{ "3 ;x\r\nabc\r\n0\r\n\r\n",   0 },      // Whitespace before an extension.
+		{ "\r\nabc\r\n",                400 },    // An empty size line must not read as the last chunk.
+		{ "3\r\nabc\r\n\r\n",           400 },
+		{ "xyz\r\nabc\r\n0\r\n\r\n",    400 },
+		{ "3z\r\nabc\r\n0\r\n\r\n",     400 },
+		{ ";ext\r\nabc\r\n0\r\n\r\n",   400 },
+		{ "3\r\nabcX\r\n0\r\n\r\n",     400 },
+		{ "fffffffff\r\n",              413 },
+	};
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		ParseResult result = parseWhole(head + cases[i].chunks);
+		CHECK(result.errorStatus == cases[i].status);
+		CHECK(result.complete == (cases[i].status == 0));
+	}
+} // testChunkSize
+
+
+static void testHeadErrors() {
+	CHECK(parseWhole("GET / HTTP/2.0\r\n\r\n").errorStatus == 505);
+	CHECK(parseWhole("GET /\r\n\r\n").errorStatus == 400);
+	CHECK(parseWhole("GET / HTTP/1.1\r\nBad Header\r\n\r\n").errorStatus == 400);
+	CHECK(parseWhole("GET / HTTP/1.1\r\nName : value\r\n\r\n").errorStatus == 400);
+	CHECK(parseWhole("POST / HTTP/1.1\r\nContent-Length: 12a\r\n\r\n").errorStatus == 400);
+	CHECK(parseWhole("POST / HTTP/1.1\r\nContent-Length: 99999999999\r\n\r\n").errorStatus == 413);
+	std::string many = "GET / HTTP/1.1\r\n";
+	for (size_t i = 0; i <= HttpRequestParser::MAX_HEADERS; i++) many += "X: y\r\n";
+	CHECK(parseWhole(many + "\r\n").errorStatus == 431);
+} // testHeadErrors
+
+
+/**
+ * @brief Feed mutated requests through the parser.  Whatever the outcome, splitting the input must not
+ * change it, and under the sanitizers nothing may be read outside the data.
+ */
+static void testFuzz() {
+	const char* seeds[] = {
+		"GET /a/b?c=d HTTP/1.1\r\nHost: h\r\nCookie: x=1; y=2\r\n\r\n",
+		"POST /form HTTP/1.0\r\nContent-Length: 5\r\nContent-Type: text/plain\r\n\r\nabcde",
+		"PUT /up HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n4;a=b\r\nwxyz\r\n10\r\n0123456789abcdef\r\n0\r\nT: v\r\n\r\n",
+	};
+	const char alphabet[] = "\r\n :;,0123456789abcdefABCDEFXchunked\t";
+	uint32_t seed = 12345;
+	uint32_t runs = 0;
+	for (int round = 0; round < 20000; round++) {
+		seed = seed * 1103515245 + 12345;
+		std::string request = seeds[(seed >> 16) % 3];
+		int mutations = 1 + (seed >> 8) % 4;
+		for (int m = 0; m < mutations; m++) {
+			seed = seed * 1103515245 + 12345;
+			size_t pos = (seed >> 12) % request.length();
+			char c = alphabet[(seed >> 4) % (sizeof(alphabet) - 1)];
+			switch ((seed >> 24) % 3) {
+				case 0: request[pos] = c; break;
+				case 1: request.insert(pos, 1, c); break;
+				default: request.erase(pos, 1); break;
+			}
+		}
+		ParseResult whole = parseWhole(request);
+		std::vector<size_t> pieces;
+		for (size_t i = 0; i < 8; i++) {
+			seed = seed * 1103515245 + 12345;
+			pieces.push_back(1 + (seed >> 16) % 9);
+		}
+		CHECK(sameResult(whole, parse(request, pieces)));
+		CHECK(whole.headStatus >= 0 || whole.errorStatus >= 400);
+		runs++;
+	}
+	printf("  fuzzed %u mutated requests\n", runs);
+} // testFuzz
+
+
+static void benchmark() {
+	std::string request =
+		"GET /api/sensor/17?format=json HTTP/1.1\r\n"
+		"Host: esp32.local\r\n"
+		"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/118.0 Safari/537.36\r\n"
+		"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+		"Accept-Encoding: gzip, deflate\r\n"
+		"Accept-Language: en-GB,en;q=0.9\r\n"
+		"Cookie: session=0123456789abcdef0123456789abcdef; theme=dark\r\n"
+		"Connection: keep-alive\r\n\r\n";
+	const int count = 200000;
+	HttpRequestParser parser;
+	size_t total = 0;
+	uint64_t start = testNowNs();
+	for (int i = 0; i < count; i++) {
+		parser.reset();
+		total += parser.parseHead(request.data(), request.length());
+		total += parser.getHeader("Connection").length();
+	}
+	uint64_t elapsed = testNowNs() - start;
+	CHECK(total == (size_t) count * (request.length() + 10));
+	printf("  parse %d byte head: %llu ns per request\n", (int) request.length(), (unsigned long long) (elapsed / count));
+} // benchmark
+
+
+int main() {
+	testStringView();
+	testRequests();
+	testTransferEncoding();
+	testChunkSize();
+	testHeadErrors();
+	testFuzz();
+	benchmark();
+	return testResult("test_http_parser");
+} // main
@@ -0,0 +1,151 @@
+/*
+ * test_http_router.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of HttpRouter.  A table of 60 routes, literal and parameterized, is dispatched through the
+ * router and checked, and the time to find a route is compared with trying each route as a regular
+ * expression in turn, which is how PathHandler dispatches.
+ */
+#include <string.h>
+#include <regex>
+#include <string>
+#include <vector>
+#include "HttpRouter.h"
+#include "HostTest.h"
+
+static int lastHandler = -1;
+
+/**
+ * @brief A distinct handler for each route, so that a lookup can be checked against the route it found.
+ */
+template<int N> static void handler(HttpRequest* pHttpRequest, HttpResponse* pHttpResponse) {
+	lastHandler = N;
+}
+
+template<int N> struct HandlerTable {
+	static void fill(HttpRouter::Handler* pHandlers) {
+		pHandlers[N - 1] = handler<N - 1>;
+		HandlerTable<N - 1>::fill(pHandlers);
+	}
+};
+
+template<> struct HandlerTable<0> {
+	static void fill(HttpRouter::Handler* pHandlers) {}
+};
+
+static const int ROUTE_COUNT = 60;
+
+struct RouteCase {
+	std::string method;
+	std::string pattern;   // As given to the router.
+	std::string regex;     // The same route as PathHandler would match it.
+	std::string path;      // A request path that matches only this route.
+};
+
+
+/**
+ * @brief Build a table of the routes of a typical device: a REST API over a few resources plus pages.
+ */
+static std::vector<RouteCase> buildRoutes() {
+	const char* resources[] = { "sensor", "relay", "led", "config", "user", "log", "file", "wifi", "ota", "time" };
+	std::vector<RouteCase> routes;
+	for (size_t i = 0; i < 10; i++) {
+		std::string r = resources[i];
+		RouteCase cases[] = {
+			{ "GET",    "/api/" + r,                        "^/api/" + r + "$",                       "/api/" + r },
+			{ "GET",    "/api/" + r + "/{id}",              "^/api/" + r + "/([^/]+)$",               "/api/" + r + "/17" },
+			{ "PUT",    "/api/" + r + "/{id}",              "^/api/" + r + "/([^/]+)$",               "/api/" + r + "/17" },
+			{ "GET",    "/api/" + r + "/{id}/history",      "^/api/" + r + "/([^/]+)/history$",       "/api/" + r + "/17/history" },
+			{ "DELETE", "/api/" + r + "/{id}/tag/{tag}",    "^/api/" + r + "/([^/]+)/tag/([^/]+)$",   "/api/" + r + "/17/tag/red" },
+			{ "GET",    "/ui/" + r + "/index.html",         "^/ui/" + r + "/index\\.html$",           "/ui/" + r + "/index.html" },
+		};
+		routes.insert(routes.end(), cases, cases + 6);
+	}
+	return routes;
+} // buildRoutes
+
+
+static void testRoutes(HttpRouter& router, const std::vector<RouteCase>& routes) {
+	HttpRouteParams params;
+	for (size_t i = 0; i < routes.size(); i++) {
+		lastHandler = -1;
+		HttpRouter::Handler pHandler = router.find(routes[i].method, HttpStringView(routes[i].path.data(), routes[i].path.length()), params);
+		CHECK(pHandler != nullptr);
+		if (pHandler == nullptr) continue;
+		pHandler(nullptr, nullptr);
+		CHECK(lastHandler == (int) i);
+	}
+
+	std::string path = "/api/sensor/42/tag/blue?verbose=1";
+	CHECK(router.find("DELETE", HttpStringView(path.data(), path.length()), params) != nullptr);
+	CHECK(params.getCount() == 2);
+	CHECK(params.get("id").equals("42"));
+	CHECK(params.get("tag").equals("blue"));
+
+	const char* misses[] = { "/api/sensor/17/unknown", "/api", "/api/pump", "/ui/led", "/api/led/1/tag", "" };
+	for (size_t i = 0; i < sizeof(misses) / sizeof(misses[0]); i++) {
+		CHECK(router.find("GET", HttpStringView(misses[i], ::strlen(misses[i])), params) == nullptr);
+	}
+	std::string led = "/api/led";
+	CHECK(router.find("POST", HttpStringView(led.data(), led.length()), params) == nullptr);
+} // testRoutes
+
+
+/**
+ * @brief Time finding each route through the router and by trying the regular expressions in turn.
+ */
+static void benchmark(HttpRouter& router, const std::vector<RouteCase>& routes) {
+	std::vector<std::regex> regexes;
+	for (size_t i = 0; i < routes.size(); i++) {
+		regexes.push_back(std::regex(routes[i].regex));
+	}
+	const int rounds = 200;
+	size_t lookups = 0;
+	size_t found   = 0;
+	HttpRouteParams params;
+
+	uint64_t start = testNowNs();
+	for (int round = 0; round < rounds * 10; round++) {
+		for (size_t i = 0; i < routes.size(); i++) {
+			if (router.find(routes[i].method, HttpStringView(routes[i].path.data(), routes[i].path.length()), params) != nullptr) found++;
+			lookups++;
+		}
+	}
+	uint64_t routerNs = (testNowNs() - start) / lookups;
+	CHECK(found == lookups);
+
+	found   = 0;
+	lookups = 0;
+	start = testNowNs();
+	for (int round = 0; round < rounds; round++) {
+		for (size_t i = 0; i < routes.size(); i++) {
+			for (size_t j = 0; j < routes.size(); j++) {
+				if (routes[j].method == routes[i].method && std::regex_search(routes[i].path, regexes[j])) {
+					found++;
+					break;
+				}
+			}
+			lookups++;
+		}
+	}
+	uint64_t regexNs = (testNowNs() - start) / lookups;
+	CHECK(found == lookups);
+	printf("  %d routes: router %llu ns per lookup, regex list %llu ns per lookup\n", (int) routes.size(),
+		(unsigned long long) routerNs, (unsigned long long) regexNs);
+} // benchmark
+
+
+int main() {
+	std::vector<RouteCase> routes = buildRoutes();
+	CHECK(routes.size() == ROUTE_COUNT);
+	HttpRouter::Handler handlers[ROUTE_COUNT];
+	HandlerTable<ROUTE_COUNT>::fill(handlers);
+	HttpRouter router;
+	for (size_t i = 0; i < routes.size(); i++) {
+		router.addRoute(routes[i].method, routes[i].pattern, handlers[i]);
+	}
+	testRoutes(router, routes);
+	benchmark(router, routes);
+	return testResult("test_http_router");
+} // main
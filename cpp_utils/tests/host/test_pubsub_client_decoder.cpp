@@ -0,0 +1,291 @@
+/*
+ * test_pubsub_client_decoder.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of PubSubClientDecoder.  A stream of MQTT packets must decode to the same packets however it
+ * is split into reads: byte by byte, at every split point, in random pieces and all coalesced into one.
+ * A PUBLISH longer than the maximum packet size must come through as its topic and payload in pieces, a
+ * long packet of another type must be skipped, and a remaining length of five bytes or a PUBLISH whose
+ * topic runs past the packet must be refused.  Each read is held in a buffer of exactly its size, so the
+ * sanitizer catches any read beyond it.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "PubSubClientDecoder.h"
+#include "HostTest.h"
+
+static const size_t MAX_PACKET_SIZE = 64;
+
+/**
+ * @brief Records what the decoder hands over as lines of text.
+ * The pieces of a long PUBLISH payload are joined so that the record doesn't depend on how the data was
+ * split; how many pieces there were is counted separately.
+ */
+class Recorder: public PubSubClientDecoder::Handler {
+public:
+	std::vector<std::string> events;
+	size_t                   dataCalls = 0;
+	bool                     inPublish = false;
+
+	void onPacket(uint8_t header, const uint8_t* data, size_t length) override {
+		CHECK(!inPublish);
+		events.push_back(describe('P', header) + std::string((const char*) data, length));
+	}
+
+	void onPublishStart(uint8_t header, const std::string& topic, uint16_t msgId, size_t payloadLength) override {
+		CHECK(!inPublish);
+		inPublish = true;
+		char text[32];
+		snprintf(text, sizeof(text), ":%u:%u:", msgId, (unsigned) payloadLength);
+		events.push_back(describe('S', header) + topic + text);
+	}
+
+	void onPublishData(const uint8_t* data, size_t length) override {
+		CHECK(inPublish && length > 0);
+		events.back().append((const char*) data, length);
+		dataCalls++;
+	}
+
+	void onPublishEnd() override {
+		CHECK(inPublish);
+		inPublish = false;
+		events.push_back("E");
+	}
+
+private:
+	static std::string describe(char kind, uint8_t header) {
+		char text[8];
+		snprintf(text, sizeof(text), "%c%02x:", kind, header);
+		return text;
+	}
+}; // Recorder
+
+
+/**
+ * @brief Encode a packet.
+ */
+static std::string packet(uint8_t header, const std::string& body) {
+	std::string result(1, (char) header);
+	size_t length = body.length();
+	do {
+		uint8_t digit = length % 128;
+		length /= 128;
+		result.push_back((char) (length > 0 ? digit | 0x80 : digit));
+	} while (length > 0);
+	return result + body;
+} // packet
+
+
+/**
+ * @brief Encode a PUBLISH, with a message id when the QoS is above 0.
+ */
+static std::string publish(uint8_t qos, const std::string& topic, uint16_t msgId, const std::string& payload) {
+	std::string body;
+	body.push_back((char) (topic.length() >> 8));
+	body.push_back((char) (topic.length() & 0xff));
+	body += topic;
+	if (qos > 0) {
+		body.push_back((char) (msgId >> 8));
+		body.push_back((char) (msgId & 0xff));
+	}
+	return packet(0x30 | qos << 1, body + payload);
+} // publish
+
+
+static std::string payload(size_t length, uint32_t seed) {
+	std::string result(length, 0);
+	for (size_t i = 0; i < length; i++) {
+		seed = seed * 1103515245 + 12345;
+		result[i] = (char) (seed >> 24);
+	}
+	return result;
+} // payload
+
+
+/**
+ * @brief Feed a stream to a new decoder in pieces of the given lengths, the last piece taking the rest.
+ * @return The record of what was decoded.
+ */
+static Recorder decode(const std::string& stream, const std::vector<size_t>& pieces, bool* pOk = nullptr) {
+	Recorder recorder;
+	PubSubClientDecoder decoder(&recorder, MAX_PACKET_SIZE);
+	size_t pos = 0;
+	bool ok = true;
+	for (size_t i = 0; ok && pos < stream.length(); i++) {
+		size_t length = i < pieces.size() ? pieces[i] : stream.length() - pos;
+		if (length > stream.length() - pos) length = stream.length() - pos;
+		std::vector<uint8_t> read(stream.begin() + pos, stream.begin() + pos + length);
+		ok = decoder.feed(read.empty() ? nullptr : read.data(), read.size());
+		pos += length;
+	}
+	if (pOk != nullptr) *pOk = ok;
+	return recorder;
+} // decode
+
+
+/**
+ * @brief A session's worth of packets: CONNACK, SUBACK, short and long PUBLISH of each QoS, PUBREL,
+ * PINGRESP and a long SUBACK to be skipped.
+ */
+static std::string session() {
+	std::string stream;
+	stream += packet(0x20, std::string("\x00\x00", 2));                   // CONNACK
+	stream += packet(0x90, std::string("\x00\x01\x01", 3));               // SUBACK
+	stream += publish(0, "a/b", 0, "hello");
+	stream += publish(1, "sensors/temperature", 0x1234, "21.5");
+	stream += packet(0xd0, "");                                           // PINGRESP
+	stream += publish(2, "long/qos2", 0xbeef, payload(1000, 1));          // Longer than the maximum packet.
+	stream += packet(0x62, std::string("\xbe\xef", 2));                   // PUBREL
+	stream += packet(0x90, payload(300, 2));                              // Too long and not a PUBLISH; skipped.
+	stream += publish(0, "t", 0, payload(MAX_PACKET_SIZE - 3, 3));        // Exactly the maximum.
+	stream += publish(0, "t", 0, payload(MAX_PACKET_SIZE - 2, 4));        // One byte over.
+	stream += publish(0, "empty", 0, "");
+	stream += packet(0xb0, std::string("\x00\x07", 2));                   // UNSUBACK
+	return stream;
+} // session
+
+
+static void testCoalesced() {
+	Recorder recorder = decode(session(), {});
+	std::vector<std::string>& events = recorder.events;
+	CHECK(events.size() == 13);
+	if (events.size() != 13) return;
+	CHECK(events[0] == std::string("P20:\x00\x00", 6));
+	CHECK(events[1] == std::string("P90:\x00\x01\x01", 7));
+	CHECK(events[2] == std::string("P30:\x00\x03" "a/bhello", 14));
+	CHECK(events[3] == std::string("P32:\x00\x13" "sensors/temperature\x12\x34" "21.5", 31));
+	CHECK(events[4] == "Pd0:");
+	CHECK(events[5] == "S34:long/qos2:48879:1000:" + payload(1000, 1));
+	CHECK(events[6] == "E");
+	CHECK(events[7] == "P62:\xbe\xef");
+	CHECK(events[8] == std::string("P30:\x00\x01t", 7) + payload(MAX_PACKET_SIZE - 3, 3));
+	CHECK(events[9] == "S30:t:0:" + std::to_string(MAX_PACKET_SIZE - 2) + ":" + payload(MAX_PACKET_SIZE - 2, 4));
+	CHECK(events[10] == "E");
+	CHECK(events[11] == std::string("P30:\x00\x05" "empty", 11));
+	CHECK(events[12] == std::string("Pb0:\x00\x07", 6));
+	CHECK(!recorder.inPublish);
+} // testCoalesced
+
+
+/**
+ * @brief Byte by byte, split at every point and in random pieces, the stream decodes the same.
+ */
+static void testSplit() {
+	std::string stream = session();
+	std::vector<std::string> expected = decode(stream, {}).events;
+
+	Recorder bytes = decode(stream, std::vector<size_t>(stream.length(), 1));
+	CHECK(bytes.events == expected);
+	CHECK(bytes.dataCalls == 1000 + MAX_PACKET_SIZE - 2);   // The long payloads are passed on as they arrive.
+
+	for (size_t split = 0; split <= stream.length(); split++) {
+		CHECK(decode(stream, { split }).events == expected);
+	}
+	for (size_t first = 0; first < 40; first++) {             // Through the fixed headers and remaining lengths.
+		for (size_t second = 1; second < 8; second++) {
+			CHECK(decode(stream, { first, second }).events == expected);
+		}
+	}
+
+	uint32_t seed = 9;
+	for (int round = 0; round < 500; round++) {
+		std::vector<size_t> pieces;
+		for (size_t total = 0; total < stream.length();) {
+			seed = seed * 1103515245 + 12345;
+			size_t length = (seed >> 16) % ((seed >> 8) % 2 == 0 ? 8 : 200);
+			pieces.push_back(length);
+			total += length;
+		}
+		CHECK(decode(stream, pieces).events == expected);
+	}
+} // testSplit
+
+
+/**
+ * @brief A PUBLISH of a megabyte passes through in the pieces it arrives in.
+ */
+static void testLongPublish() {
+	std::string data = payload(1 << 20, 5);
+	std::string stream = publish(1, "firmware/image", 7, data) + packet(0xd0, "");
+	std::vector<size_t> pieces(stream.length() / 1400 + 1, 1400);   // As TCP segments.
+	Recorder recorder = decode(stream, pieces);
+	CHECK(recorder.events.size() == 3);
+	if (recorder.events.size() != 3) return;
+	CHECK(recorder.events[0] == "S32:firmware/image:7:" + std::to_string(data.length()) + ":" + data);
+	CHECK(recorder.events[2] == "Pd0:");
+	CHECK(recorder.dataCalls >= data.length() / 1400);
+
+	std::string header = stream.substr(0, 5 + 2 + 14 + 2);          // The remaining length takes three bytes.
+	CHECK(decode(stream, std::vector<size_t>(header.length(), 1)).events == recorder.events);
+} // testLongPublish
+
+
+/**
+ * @brief Remaining lengths at the limits of their one to four bytes.
+ */
+static void testRemainingLength() {
+	const size_t lengths[] = { 0, 127, 128, 16383, 16384, 2097151, 2097152 };
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+		std::string body = payload(lengths[i], 6);
+		Recorder recorder = decode(packet(0x90, body) + packet(0xd0, ""), {});   // Skipped unless short.
+		CHECK(recorder.events.back() == "Pd0:");
+		CHECK(recorder.events.size() == (lengths[i] <= MAX_PACKET_SIZE ? 2U : 1U));
+	}
+
+	bool ok;
+	const char longest[] = { (char) 0x90, (char) 0xff, (char) 0xff, (char) 0xff, 0x7f };   // 268435455; skipping.
+	Recorder recorder = decode(std::string(longest, sizeof(longest)), {}, &ok);
+	CHECK(ok && recorder.events.empty());
+
+	const char fiveBytes[] = { 0x30, (char) 0x80, (char) 0x80, (char) 0x80, (char) 0x80, 0x01 };
+	std::string malformed(fiveBytes, sizeof(fiveBytes));
+	decode(malformed, {}, &ok);
+	CHECK(!ok);
+	decode(malformed, std::vector<size_t>(malformed.length(), 1), &ok);
+	CHECK(!ok);
+	decode(packet(0xd0, "") + malformed + packet(0xd0, ""), {}, &ok);
+	CHECK(!ok);
+
+	// After a reset the decoder starts afresh.
+	Recorder after;
+	PubSubClientDecoder decoder(&after, MAX_PACKET_SIZE);
+	std::vector<uint8_t> bad(fiveBytes, fiveBytes + sizeof(fiveBytes));
+	CHECK(!decoder.feed(bad.data(), bad.size()));
+	decoder.reset();
+	std::string good = packet(0xd0, "");
+	std::vector<uint8_t> read(good.begin(), good.end());
+	CHECK(decoder.feed(read.data(), read.size()));
+	CHECK(after.events.size() == 1 && after.events[0] == "Pd0:");
+} // testRemainingLength
+
+
+/**
+ * @brief A long PUBLISH whose topic runs past the packet or past the maximum packet size is refused.
+ */
+static void testMalformedPublish() {
+	bool ok;
+	std::string body = std::string("\x00\xff", 2) + payload(MAX_PACKET_SIZE + 10, 7);   // Topic past the packet.
+	Recorder recorder = decode(packet(0x30, body), {}, &ok);
+	CHECK(!ok && recorder.events.empty());
+
+	std::string topic(MAX_PACKET_SIZE, 't');                                           // Topic too long to gather.
+	recorder = decode(publish(0, topic, 0, payload(100, 8)), std::vector<size_t>(200, 1), &ok);
+	CHECK(!ok && recorder.events.empty());
+
+	std::string justFits(MAX_PACKET_SIZE - 4, 't');                                    // Topic and id just fit.
+	recorder = decode(publish(1, justFits, 3, payload(100, 9)), {}, &ok);
+	CHECK(ok && recorder.events.size() == 2 && recorder.events[1] == "E");
+} // testMalformedPublish
+
+
+int main() {
+	testCoalesced();
+	testSplit();
+	testLongPublish();
+	testRemainingLength();
+	testMalformedPublish();
+	return testResult("test_pubsub_client_decoder");
+} // main
@@ -0,0 +1,646 @@
+/*
+ * test_tftp.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of the TFTP server over UDP loopback.  The server runs as it does on the device, each transfer
+ * in a task of its own, with the tasks run as threads.  The test is the client and can drop any packet it
+ * receives or would send, which is how a lost block, a lost acknowledgment and a lost option acknowledgment
+ * are made.  Reads and writes with negotiated block and window sizes must transfer every byte, recover from
+ * each loss, carry on past block number 65535 and end properly on files that are empty or an exact
+ * multiple of the block size.  A request whose task can't be started must be refused and its slot freed.
+ */
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdio.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "FreeRTOS.h"
+#include "TFTP.h"
+#include "HostTest.h"
+
+static const uint16_t OP_RRQ   = 1;
+static const uint16_t OP_WRQ   = 2;
+static const uint16_t OP_DATA  = 3;
+static const uint16_t OP_ACK   = 4;
+static const uint16_t OP_ERROR = 5;
+static const uint16_t OP_OACK  = 6;
+
+static bool failStartTask = false;   // Have FreeRTOS::startTask fail, as when there is no memory for a stack.
+
+
+// FreeRTOS.cpp needs the ESP-IDF; tasks are threads here.
+struct HostTask {
+	void (*task)(void*);
+	void* param;
+};
+
+
+static void* runHostTask(void* pParam) {
+	HostTask hostTask = *(HostTask*) pParam;
+	delete (HostTask*) pParam;
+	hostTask.task(hostTask.param);
+	return nullptr;
+} // runHostTask
+
+
+bool FreeRTOS::startTask(void task(void*), std::string taskName, void* param, uint32_t stackSize) {
+	if (__atomic_load_n(&failStartTask, __ATOMIC_SEQ_CST)) return false;
+	pthread_t thread;
+	if (::pthread_create(&thread, nullptr, runHostTask, new HostTask { task, param }) != 0) return false;
+	::pthread_detach(thread);
+	return true;
+} // startTask
+
+
+void FreeRTOS::deleteTask(TaskHandle_t pTask) {
+	// The thread ends when the task function returns.
+} // deleteTask
+
+
+uint32_t FreeRTOS::getTimeSinceStart() {
+	return testNowNs() / 1000000;
+} // getTimeSinceStart
+
+
+/**
+ * @brief The statistics of the transfers that have ended, by file name.
+ */
+static pthread_mutex_t                             statsLock = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::string, TFTP::TransferStats>  statsByName;
+
+
+static bool waitForStats(const std::string& filename, TFTP::TransferStats* pStats) {
+	for (int i = 0; i < 500; i++) {
+		::pthread_mutex_lock(&statsLock);
+		auto it = statsByName.find(filename);
+		bool found = it != statsByName.end();
+		if (found) *pStats = it->second;
+		::pthread_mutex_unlock(&statsLock);
+		if (found) return true;
+		::usleep(10 * 1000);
+	}
+	return false;
+} // waitForStats
+
+
+static std::string content(size_t length, uint32_t seed) {
+	std::string result(length, 0);
+	for (size_t i = 0; i < length; i++) {
+		seed = seed * 1103515245 + 12345;
+		result[i] = (char) (seed >> 24);
+	}
+	return result;
+} // content
+
+
+static std::string baseDir;
+
+static void writeServerFile(const std::string& name, const std::string& data) {
+	FILE* file = fopen((baseDir + "/" + name).c_str(), "wb");
+	fwrite(data.data(), 1, data.length(), file);
+	fclose(file);
+} // writeServerFile
+
+
+static std::string readServerFile(const std::string& name) {
+	std::string data;
+	FILE* file = fopen((baseDir + "/" + name).c_str(), "rb");
+	if (file == nullptr) return "<missing>";
+	char buffer[4096];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) data.append(buffer, n);
+	fclose(file);
+	return data;
+} // readServerFile
+
+
+/**
+ * @brief How a transfer is to go: the options asked for and the packets to lose.
+ * Blocks are counted from 1 without rolling over; each packet listed is lost the first time only.
+ */
+struct Plan {
+	std::vector<std::pair<std::string, std::string>> options;
+	uint16_t           blockSize  = 512;  // As the server is expected to accept.
+	uint16_t           windowSize = 1;
+	bool               loseOack   = false;
+	std::set<uint32_t> loseData;          // Blocks lost on their way to the receiver.
+	std::set<uint32_t> loseAcks;          // Acknowledgments lost on their way to the sender.
+	int                timeoutMs  = 2500; // The client's, longer than the server's so the server's are exercised.
+};
+
+
+/**
+ * @brief What the client saw of a transfer.
+ */
+struct Outcome {
+	bool                               ok = false;
+	std::string                        data;       // The file read.
+	std::map<std::string, std::string> oack;       // The options acknowledged.
+	int                                oackCount = 0;
+	std::string                        error;      // The message of an error packet received.
+	std::set<uint16_t>                 serverPorts;
+	uint32_t                           duplicates = 0;
+};
+
+
+/**
+ * @brief A TFTP client that can lose packets on purpose.
+ *
+ * Each client makes one transfer, from a port of its own, as RFC 1350 has each transfer choose its own.
+ */
+class Client {
+public:
+	Client(uint16_t serverPort) {
+		m_fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+		memset(&m_server, 0, sizeof(m_server));
+		m_server.sin_family      = AF_INET;
+		m_server.sin_port        = htons(serverPort);
+		m_server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		m_peer = m_server;
+	}
+
+	~Client() {
+		::close(m_fd);
+	}
+
+	Outcome read(const std::string& filename, Plan plan) {
+		Outcome outcome;
+		setTimeout(plan.timeoutMs);
+		m_peer = m_server;
+		sendRequest(OP_RRQ, filename, plan.options);
+		bool     started     = false;   // Once the OACK or, without options, the first data block has arrived.
+		uint32_t expected    = 1;
+		uint16_t windowCount = 0;
+		bool     gapReported = false;
+		int      timeouts    = 0;
+		while (timeouts < 8) {
+			std::string packet;
+			if (!receive(&packet, &outcome)) {
+				timeouts++;
+				if (!started) {
+					sendRequest(OP_RRQ, filename, plan.options);
+				} else {
+					sendAck(expected - 1, plan);   // Our acknowledgment or a block was lost.
+				}
+				continue;
+			}
+			uint16_t opCode = opCodeOf(packet);
+			if (opCode == OP_ERROR) {
+				outcome.error = packet.substr(4, packet.find('\0', 4) - 4);
+				return outcome;
+			}
+			if (opCode == OP_OACK) {
+				outcome.oackCount++;
+				if (plan.loseOack) {
+					plan.loseOack = false;
+					continue;
+				}
+				outcome.oack = parseOack(packet);
+				applyOack(outcome.oack, &plan);
+				started = true;
+				sendAck(0, plan);
+				continue;
+			}
+			CHECK(opCode == OP_DATA);
+			uint32_t block = unwrap(blockOf(packet), expected);
+			if (plan.loseData.erase(block) > 0) continue;
+			if (block != expected) {
+				outcome.duplicates++;
+				if (!gapReported) {
+					sendAck(expected - 1, plan);
+					gapReported = true;
+					windowCount = 0;
+				}
+				continue;
+			}
+			started     = true;
+			timeouts    = 0;
+			gapReported = false;
+			outcome.data.append(packet, 4, std::string::npos);
+			expected++;
+			windowCount++;
+			if (packet.length() - 4 < plan.blockSize) {
+				sendAck(block, plan);
+				outcome.ok = true;
+				return outcome;
+			}
+			if (windowCount == plan.windowSize) {
+				sendAck(block, plan);
+				windowCount = 0;
+			}
+		}
+		return outcome;
+	}
+
+	Outcome write(const std::string& filename, const std::string& data, Plan plan) {
+		Outcome outcome;
+		setTimeout(plan.timeoutMs);
+		m_peer = m_server;
+		sendRequest(OP_WRQ, filename, plan.options);
+		uint32_t lastBlock = data.length() / plan.blockSize + 1;   // The short, maybe empty, final block.
+		uint32_t base      = 0;     // The first block not acknowledged, once the request is.
+		bool     wentBack  = false;
+		int      timeouts  = 0;
+		while (timeouts < 8) {
+			if (base > 0) sendWindow(data, base, lastBlock, &plan);
+			std::string packet;
+			if (!receive(&packet, &outcome)) {
+				timeouts++;
+				if (base == 0) sendRequest(OP_WRQ, filename, plan.options);
+				continue;
+			}
+			uint16_t opCode = opCodeOf(packet);
+			if (opCode == OP_ERROR) {
+				outcome.error = packet.substr(4, packet.find('\0', 4) - 4);
+				return outcome;
+			}
+			if (base == 0) {
+				if (opCode == OP_OACK) {
+					outcome.oackCount++;
+					if (plan.loseOack) {
+						plan.loseOack = false;
+						continue;   // Wait for the server to send it again.
+					}
+					outcome.oack = parseOack(packet);
+					applyOack(outcome.oack, &plan);
+				} else {
+					CHECK(opCode == OP_ACK && blockOf(packet) == 0);
+				}
+				base = 1;
+				continue;
+			}
+			CHECK(opCode == OP_ACK || opCode == OP_OACK);   // The OACK again stands for the acknowledgment of block 0.
+			if (!handleAck(ackOf(packet), &outcome, &base, &plan, &wentBack)) {
+				waitForAck(&outcome, &base, lastBlock, &plan, &wentBack, &timeouts);
+			}
+			if (base > lastBlock) break;
+			timeouts = 0;
+		}
+		outcome.ok = base > lastBlock;
+		return outcome;
+	}
+
+	/**
+	 * @brief Send a request and wait for the server's answer without going on with the transfer.
+	 */
+	std::string requestOnly(uint16_t opCode, const std::string& filename) {
+		setTimeout(2500);
+		m_peer = m_server;
+		sendRequest(opCode, filename, {});
+		std::string packet;
+		Outcome outcome;
+		return receive(&packet, &outcome) ? packet : "";
+	}
+
+private:
+	int                m_fd;
+	struct sockaddr_in m_server;
+	struct sockaddr_in m_peer;   // The transfer's own port on the server, once it answers.
+
+	static uint16_t opCodeOf(const std::string& packet) {
+		return packet.length() >= 2 ? (uint8_t) packet[0] << 8 | (uint8_t) packet[1] : 0;
+	}
+
+	static uint16_t blockOf(const std::string& packet) {
+		return packet.length() >= 4 ? (uint8_t) packet[2] << 8 | (uint8_t) packet[3] : 0;
+	}
+
+	static uint16_t ackOf(const std::string& packet) {
+		return opCodeOf(packet) == OP_OACK ? 0 : blockOf(packet);
+	}
+
+	// The block a 16 bit block number stands for, the nearest to the one given.
+	static uint32_t unwrap(uint16_t block, uint32_t near) {
+		return near + (int16_t) (uint16_t) (block - (uint16_t) near);
+	}
+
+	static std::map<std::string, std::string> parseOack(const std::string& packet) {
+		std::map<std::string, std::string> options;
+		size_t pos = 2;
+		while (pos < packet.length()) {
+			std::string name = packet.substr(pos, packet.find('\0', pos) - pos);
+			pos += name.length() + 1;
+			std::string value = pos < packet.length() ? packet.substr(pos, packet.find('\0', pos) - pos) : "";
+			pos += value.length() + 1;
+			options[name] = value;
+		}
+		return options;
+	}
+
+	// Go on with the block and window sizes the server accepted.
+	static void applyOack(std::map<std::string, std::string>& oack, Plan* pPlan) {
+		if (oack.count("blksize") > 0) pPlan->blockSize = std::stoi(oack["blksize"]);
+		if (oack.count("windowsize") > 0) pPlan->windowSize = std::stoi(oack["windowsize"]);
+	}
+
+	void setTimeout(int timeoutMs) {
+		struct timeval tv;
+		tv.tv_sec  = timeoutMs / 1000;
+		tv.tv_usec = (timeoutMs % 1000) * 1000;
+		::setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	}
+
+	void sendPacket(const std::string& packet) {
+		::sendto(m_fd, packet.data(), packet.length(), 0, (struct sockaddr*) &m_peer, sizeof(m_peer));
+	}
+
+	void sendRequest(uint16_t opCode, const std::string& filename, const std::vector<std::pair<std::string, std::string>>& options) {
+		std::string packet;
+		packet += (char) 0;
+		packet += (char) opCode;
+		packet += filename + '\0' + "octet" + '\0';
+		for (auto& option : options) packet += option.first + '\0' + option.second + '\0';
+		::sendto(m_fd, packet.data(), packet.length(), 0, (struct sockaddr*) &m_server, sizeof(m_server));
+	}
+
+	void sendAck(uint32_t block, Plan& plan) {
+		if (plan.loseAcks.erase(block) > 0) return;
+		std::string packet;
+		packet += (char) 0;
+		packet += (char) OP_ACK;
+		packet += (char) (block >> 8);
+		packet += (char) block;
+		sendPacket(packet);
+	}
+
+	void sendWindow(const std::string& data, uint32_t base, uint32_t lastBlock, Plan* pPlan) {
+		for (uint32_t block = base; block < base + pPlan->windowSize && block <= lastBlock; block++) {
+			if (pPlan->loseData.erase(block) > 0) continue;
+			size_t offset = (size_t) (block - 1) * pPlan->blockSize;
+			std::string packet;
+			packet += (char) 0;
+			packet += (char) OP_DATA;
+			packet += (char) (block >> 8);
+			packet += (char) block;
+			packet += data.substr(offset, pPlan->blockSize);
+			sendPacket(packet);
+		}
+	}
+
+	/**
+	 * @brief Act on an acknowledgment of a block we sent.
+	 * @return True if the window is to be sent, from the new base.
+	 */
+	bool handleAck(uint16_t ack, Outcome* pOutcome, uint32_t* pBase, Plan* pPlan, bool* pWentBack) {
+		uint32_t acked = unwrap(ack, *pBase);
+		if (pPlan->loseAcks.erase(acked) > 0) return false;
+		if (acked >= *pBase) {
+			*pBase     = acked + 1;
+			*pWentBack = false;
+			return true;
+		}
+		if (acked == *pBase - 1 && !*pWentBack) {   // The first block of the window was lost.
+			*pWentBack = true;
+			return true;
+		}
+		pOutcome->duplicates++;
+		return false;
+	}
+
+	// Wait for an acknowledgment that moves us on, sending nothing meanwhile; a timeout has us send again.
+	void waitForAck(Outcome* pOutcome, uint32_t* pBase, uint32_t lastBlock, Plan* pPlan, bool* pWentBack, int* pTimeouts) {
+		while (true) {
+			std::string packet;
+			if (!receive(&packet, pOutcome)) {
+				(*pTimeouts)++;
+				return;
+			}
+			if (handleAck(ackOf(packet), pOutcome, pBase, pPlan, pWentBack)) return;
+		}
+	}
+
+	bool receive(std::string* pPacket, Outcome* pOutcome) {
+		char buffer[70000];
+		struct sockaddr_in from;
+		socklen_t fromLength = sizeof(from);
+		ssize_t length = ::recvfrom(m_fd, buffer, sizeof(buffer), 0, (struct sockaddr*) &from, &fromLength);
+		if (length < 0) return false;
+		pOutcome->serverPorts.insert(ntohs(from.sin_port));
+		m_peer = from;
+		pPacket->assign(buffer, length);
+		return true;
+	}
+}; // Client
+
+
+static uint16_t serverPort;
+static TFTP*    pServer;
+
+
+static void* runServer(void* pParam) {
+	pServer->start(serverPort);
+	return nullptr;
+} // runServer
+
+
+static Plan options(uint16_t blockSize, uint16_t windowSize) {
+	Plan plan;
+	plan.options    = { { "blksize", std::to_string(blockSize) }, { "windowsize", std::to_string(windowSize) } };
+	plan.blockSize  = blockSize;
+	plan.windowSize = windowSize;
+	return plan;
+} // options
+
+
+/**
+ * @brief Reads of every shape of file, plain and with options, with nothing lost.
+ */
+static void testRead() {
+	const size_t lengths[] = { 0, 1, 511, 512, 1024, 3 * 512 + 100 };
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+		std::string name = "read" + std::to_string(lengths[i]);
+		std::string data = content(lengths[i], i);
+		writeServerFile(name, data);
+		Outcome outcome = Client(serverPort).read(name, Plan());
+		CHECK(outcome.ok && outcome.data == data);
+		CHECK(outcome.serverPorts.size() == 1 && outcome.serverPorts.count(serverPort) == 0);   // Its own port.
+	}
+
+	const size_t sizes[] = { 0, 1000 * 4, 1000 * 4 * 3, 12345 };   // Empty, a window and several, and ragged.
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		std::string name = "readopt" + std::to_string(sizes[i]);
+		std::string data = content(sizes[i], 100 + i);
+		writeServerFile(name, data);
+		Outcome outcome = Client(serverPort).read(name, options(1000, 4));
+		CHECK(outcome.ok && outcome.data == data);
+		CHECK(outcome.oack["blksize"] == "1000" && outcome.oack["windowsize"] == "4");
+		CHECK(outcome.duplicates == 0);
+	}
+
+	writeServerFile("readclamp", content(5000, 7));
+	Outcome clamped = Client(serverPort).read("readclamp", options(9000, 100));   // Beyond the server's limits.
+	CHECK(clamped.ok && clamped.data == content(5000, 7));
+	CHECK(clamped.oack["blksize"] == "1468" && clamped.oack["windowsize"] == "16");
+
+	Outcome missing = Client(serverPort).read("no-such-file", Plan());
+	CHECK(!missing.ok && missing.error.find("no-such-file") != std::string::npos);
+} // testRead
+
+
+/**
+ * @brief Reads losing a block, an acknowledgment and the option acknowledgment.
+ */
+static void testReadLosses() {
+	std::string data = content(20 * 700 + 3, 11);
+	writeServerFile("readloss", data);
+
+	Plan lostBlock = options(700, 4);   // The first of a window, one in the middle and the final one.
+	lostBlock.loseData = { 5, 10, 21 };
+	Outcome outcome = Client(serverPort).read("readloss", lostBlock);
+	CHECK(outcome.ok && outcome.data == data);
+
+	Plan lostAck = options(700, 4);     // The server times out and sends the window again.
+	lostAck.loseAcks = { 8 };
+	outcome = Client(serverPort).read("readloss", lostAck);
+	CHECK(outcome.ok && outcome.data == data && outcome.duplicates > 0);
+
+	Plan lostOne = Plan();              // One block at a time: the server times out and sends it again.
+	lostOne.loseData = { 3 };
+	outcome = Client(serverPort).read("readloss", lostOne);
+	CHECK(outcome.ok && outcome.data == data);
+
+	Plan lostOack = options(700, 4);    // Sent again when its acknowledgment doesn't come.
+	lostOack.loseOack = true;
+	outcome = Client(serverPort).read("readloss", lostOack);
+	CHECK(outcome.ok && outcome.data == data && outcome.oackCount == 2);
+
+	TFTP::TransferStats stats;
+	CHECK(waitForStats("readloss", &stats) && stats.success && !stats.write);
+} // testReadLosses
+
+
+/**
+ * @brief Writes of every shape of file, plain and with options, some losing packets.
+ */
+static void testWrite() {
+	const size_t lengths[] = { 0, 511, 512, 2 * 512 + 7 };
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+		std::string name = "write" + std::to_string(lengths[i]);
+		Outcome outcome = Client(serverPort).write(name, content(lengths[i], 200 + i), Plan());
+		CHECK(outcome.ok && outcome.serverPorts.size() == 1);
+	}
+
+	Outcome outcome = Client(serverPort).write("writeopt", content(8 * 600, 210), options(600, 8));   // Exactly one window.
+	CHECK(outcome.ok && outcome.oack["blksize"] == "600" && outcome.oack["windowsize"] == "8");
+
+	Plan lostBlock = options(600, 8);
+	lostBlock.loseData = { 1, 12, 20 };   // The first block of all, one in the middle and the final one.
+	outcome = Client(serverPort).write("writelostblock", content(19 * 600 + 1, 211), lostBlock);
+	CHECK(outcome.ok);
+
+	Plan lostAck = options(600, 8);       // We time out and send the window again.
+	lostAck.loseAcks = { 8 };
+	lostAck.timeoutMs = 300;
+	outcome = Client(serverPort).write("writelostack", content(30 * 600, 212), lostAck);
+	CHECK(outcome.ok);
+
+	Plan lostOack = options(600, 8);      // Sent again when no data comes.
+	lostOack.loseOack = true;
+	outcome = Client(serverPort).write("writelostoack", content(1000, 213), lostOack);
+	CHECK(outcome.ok && outcome.oackCount == 2);
+
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+		std::string name = "write" + std::to_string(lengths[i]);
+		TFTP::TransferStats stats;
+		CHECK(waitForStats(name, &stats) && stats.success && stats.write && stats.bytes == lengths[i]);
+		CHECK(readServerFile(name) == content(lengths[i], 200 + i));
+	}
+	TFTP::TransferStats stats;
+	CHECK(waitForStats("writeopt", &stats) && stats.blockSize == 600 && stats.windowSize == 8);
+	CHECK(readServerFile("writeopt") == content(8 * 600, 210));
+	CHECK(waitForStats("writelostblock", &stats) && stats.success && stats.retransmissions > 0);
+	CHECK(readServerFile("writelostblock") == content(19 * 600 + 1, 211));
+	CHECK(waitForStats("writelostack", &stats) && stats.success);
+	CHECK(readServerFile("writelostack") == content(30 * 600, 212));
+	CHECK(waitForStats("writelostoack", &stats) && stats.success);
+	CHECK(readServerFile("writelostoack") == content(1000, 213));
+} // testWrite
+
+
+/**
+ * @brief Transfers of more than 65535 blocks, losing blocks either side of the block number rolling over.
+ */
+static void testRollover() {
+	std::string data = content(65540 * 8 + 3, 300);
+	writeServerFile("rollread", data);
+	Plan readPlan = options(8, 16);
+	readPlan.loseData = { 65535, 65536, 65538 };
+	Outcome outcome = Client(serverPort).read("rollread", readPlan);
+	CHECK(outcome.ok && outcome.data == data);
+
+	Plan writePlan = options(8, 16);
+	writePlan.loseData = { 65530, 65537 };
+	outcome = Client(serverPort).write("rollwrite", data, writePlan);
+	CHECK(outcome.ok);
+	TFTP::TransferStats stats;
+	CHECK(waitForStats("rollwrite", &stats) && stats.success && stats.bytes == data.length());
+	CHECK(readServerFile("rollwrite") == data);
+} // testRollover
+
+
+/**
+ * @brief A transfer whose task can't be started is refused, and its slot and partner are freed.
+ */
+static void testStartTaskFails() {
+	Client client(serverPort);
+	writeServerFile("nostack", content(100, 400));
+	__atomic_store_n(&failStartTask, true, __ATOMIC_SEQ_CST);
+	std::string answer = client.requestOnly(OP_RRQ, "nostack");
+	__atomic_store_n(&failStartTask, false, __ATOMIC_SEQ_CST);
+	CHECK(answer.length() > 4 && answer[1] == OP_ERROR && answer.find("out of memory") != std::string::npos);
+	CHECK(pServer->getActiveCount() == 0);
+
+	// The same client from the same port is not taken for a repeat of the refused request.
+	Outcome outcome = client.read("nostack", Plan());
+	CHECK(outcome.ok && outcome.data == content(100, 400));
+} // testStartTaskFails
+
+
+int main() {
+	char dir[] = "/tmp/test_tftpXXXXXX";
+	baseDir = ::mkdtemp(dir);
+
+	// Pick a free port for the server.
+	int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	::bind(fd, (struct sockaddr*) &addr, sizeof(addr));
+	socklen_t addrLength = sizeof(addr);
+	::getsockname(fd, (struct sockaddr*) &addr, &addrLength);
+	serverPort = ntohs(addr.sin_port);
+	::close(fd);
+
+	pServer = new TFTP();
+	pServer->setBaseDir(baseDir);
+	pServer->setMaxTransactions(8);
+	pServer->setStatsHandler([](const TFTP::TransferStats& stats) {
+		::pthread_mutex_lock(&statsLock);
+		statsByName[stats.filename] = stats;
+		::pthread_mutex_unlock(&statsLock);
+	});
+	pthread_t server;
+	::pthread_create(&server, nullptr, runServer, nullptr);   // Runs until the program ends.
+	::usleep(100 * 1000);
+
+	testRead();
+	testReadLosses();
+	testWrite();
+	testRollover();
+	testStartTaskFails();
+
+	::usleep(1500 * 1000);                                      // Let the writes stop lingering.
+	CHECK(pServer->getActiveCount() == 0);
+	std::string command = "rm -rf " + baseDir;
+	CHECK(::system(command.c_str()) == 0);
+	return testResult("test_tftp");
+} // main
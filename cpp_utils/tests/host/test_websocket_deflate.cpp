@@ -0,0 +1,386 @@
+/*
+ * test_websocket_deflate.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of WebSocketDeflate against zlib, which is what browsers and most clients use.  Messages we
+ * compress must inflate with zlib at the window we agreed, and messages zlib compresses, with each kind of
+ * block and with and without context takeover, must inflate with ours.  Truncated, corrupt and oversized
+ * messages must be refused without reading or writing out of bounds, and odd Sec-WebSocket-Extensions
+ * headers must be negotiated sensibly.
+ */
+#include <string.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "GeneralUtils.h"
+#include "WebSocketDeflate.h"
+#include "HostTest.h"
+
+static const uint8_t FLUSH_TAIL[4] = { 0x00, 0x00, 0xff, 0xff };
+
+
+// GeneralUtils.cpp needs the ESP-IDF; these are the two functions negotiate() uses.
+std::vector<std::string> GeneralUtils::split(std::string source, char delimiter) {
+	std::vector<std::string> strings;
+	std::istringstream iss(source);
+	std::string s;
+	while (std::getline(iss, s, delimiter)) {
+		strings.push_back(trim(s));
+	}
+	return strings;
+} // split
+
+
+std::string GeneralUtils::trim(const std::string& str) {
+	size_t first = str.find_first_not_of(' ');
+	if (std::string::npos == first) return str;
+	size_t last = str.find_last_not_of(' ');
+	return str.substr(first, (last - first + 1));
+} // trim
+
+
+/**
+ * @brief zlib compressing messages as a client does, removing the tail of each sync flush.
+ */
+class ZlibDeflater {
+public:
+	ZlibDeflater(int level, int windowBits, int strategy, bool takeover) {
+		memset(&m_stream, 0, sizeof(m_stream));
+		CHECK(deflateInit2(&m_stream, level, Z_DEFLATED, -windowBits, 8, strategy) == Z_OK);
+		m_takeover = takeover;
+	}
+
+	~ZlibDeflater() {
+		deflateEnd(&m_stream);
+	}
+
+	std::string compress(const std::string& message) {
+		if (!m_takeover) deflateReset(&m_stream);
+		std::string out;
+		m_stream.next_in  = (Bytef*) message.data();
+		m_stream.avail_in = message.length();
+		uint8_t buffer[1024];
+		do {
+			m_stream.next_out  = buffer;
+			m_stream.avail_out = sizeof(buffer);
+			CHECK(::deflate(&m_stream, Z_SYNC_FLUSH) != Z_STREAM_ERROR);
+			out.append((const char*) buffer, sizeof(buffer) - m_stream.avail_out);
+		} while (m_stream.avail_out == 0);
+		if (out.empty()) return std::string(1, '\0');   // zlib won't flush twice running; RFC 7692 7.2.3.6 sends this.
+		CHECK(out.length() >= 4 && memcmp(out.data() + out.length() - 4, FLUSH_TAIL, 4) == 0);
+		out.resize(out.length() - 4);
+		return out;
+	}
+
+private:
+	z_stream m_stream;
+	bool     m_takeover;
+}; // ZlibDeflater
+
+
+/**
+ * @brief zlib decompressing messages as a client does, restoring the tail of each sync flush.
+ */
+class ZlibInflater {
+public:
+	ZlibInflater(int windowBits, bool takeover) {
+		memset(&m_stream, 0, sizeof(m_stream));
+		CHECK(inflateInit2(&m_stream, -windowBits) == Z_OK);
+		m_takeover = takeover;
+	}
+
+	~ZlibInflater() {
+		inflateEnd(&m_stream);
+	}
+
+	bool decompress(const std::string& data, std::string* pOut) {
+		if (!m_takeover) inflateReset(&m_stream);
+		std::string in = data + std::string((const char*) FLUSH_TAIL, 4);
+		pOut->clear();
+		m_stream.next_in  = (Bytef*) in.data();
+		m_stream.avail_in = in.length();
+		uint8_t buffer[1024];
+		do {
+			m_stream.next_out  = buffer;
+			m_stream.avail_out = sizeof(buffer);
+			int rc = ::inflate(&m_stream, Z_SYNC_FLUSH);
+			if (rc != Z_OK && rc != Z_BUF_ERROR) return false;
+			pOut->append((const char*) buffer, sizeof(buffer) - m_stream.avail_out);
+		} while (m_stream.avail_out == 0);
+		return m_stream.avail_in == 0;
+	}
+
+private:
+	z_stream m_stream;
+	bool     m_takeover;
+}; // ZlibInflater
+
+
+/**
+ * @brief Negotiate an extension from a client's offer; the test fails if none is accepted.
+ */
+static WebSocketDeflate* accept(const std::string& offers, uint8_t windowBits, bool takeover, std::string* pResponse = nullptr) {
+	WebSocketDeflateConfig config = { true, windowBits, takeover };
+	std::string response;
+	WebSocketDeflate* pDeflate = WebSocketDeflate::negotiate(offers, config, &response);
+	CHECK(pDeflate != nullptr);
+	if (pResponse != nullptr) *pResponse = response;
+	return pDeflate;
+} // accept
+
+
+static bool ourInflate(WebSocketDeflate* pDeflate, const std::string& data, std::string* pOut, size_t maxLength = 1 << 20) {
+	std::vector<uint8_t> copy(data.begin(), data.end());   // Exactly the size of the message for the sanitizer.
+	return pDeflate->inflate(copy.empty() ? nullptr : copy.data(), copy.size(), pOut, maxLength);
+} // ourInflate
+
+
+static std::string ourDeflate(WebSocketDeflate* pDeflate, const std::string& message) {
+	std::string out;
+	CHECK(pDeflate->deflate((const uint8_t*) message.data(), message.length(), &out));
+	return out;
+} // ourDeflate
+
+
+/**
+ * @brief Messages of the kinds a device sends: repetitive telemetry, random bytes, long runs and nothing.
+ */
+static std::vector<std::string> messages() {
+	std::vector<std::string> result;
+	for (int i = 0; i < 20; i++) {
+		result.push_back("{\"sensor\":\"temperature\",\"sequence\":" + std::to_string(i * 37) + ",\"value\":" +
+			std::to_string(20 + i % 7) + ".5,\"unit\":\"C\"}");
+	}
+	uint32_t seed = 5;
+	std::string random(3000, 0);
+	for (size_t i = 0; i < random.length(); i++) {
+		seed = seed * 1103515245 + 12345;
+		random[i] = (char) (seed >> 24);
+	}
+	result.push_back(random);
+	result.push_back(random.substr(100, 1500));                 // Far back in the window.
+	result.push_back(std::string(70000, 'a'));                  // Longer than any window, in the longest matches.
+	result.push_back("");
+	std::string block = random.substr(0, 600);                  // Repeats further apart than a 512 byte window.
+	result.push_back(block + std::string(50, 'z') + block + block);
+	result.push_back("x");
+	return result;
+} // messages
+
+
+/**
+ * @brief What we compress, zlib inflates at the window we agreed, with and without context takeover.
+ */
+static void testOursToZlib() {
+	std::vector<std::string> list = messages();
+	for (int bits = 9; bits <= 15; bits += 3) {
+		for (int takeover = 0; takeover <= 1; takeover++) {
+			std::string offer = "permessage-deflate; client_max_window_bits; server_max_window_bits=" + std::to_string(bits);
+			WebSocketDeflate* pDeflate = accept(offer, 15, takeover);
+			ZlibInflater zlib(bits, takeover);   // zlib refuses a distance beyond its window.
+			for (size_t i = 0; i < list.size(); i++) {
+				std::string out;
+				CHECK(zlib.decompress(ourDeflate(pDeflate, list[i]), &out));
+				CHECK(out == list[i]);
+			}
+			delete pDeflate;
+		}
+	}
+} // testOursToZlib
+
+
+/**
+ * @brief What zlib compresses, in stored, fixed and dynamic blocks, we inflate.
+ */
+static void testZlibToOurs() {
+	std::vector<std::string> list = messages();
+	const int levels[][2] = { { 0, Z_DEFAULT_STRATEGY }, { 6, Z_FIXED }, { 9, Z_DEFAULT_STRATEGY }, { 1, Z_HUFFMAN_ONLY }, { 6, Z_RLE } };
+	for (size_t level = 0; level < sizeof(levels) / sizeof(levels[0]); level++) {
+		for (int bits = 9; bits <= 15; bits += 6) {
+			for (int takeover = 0; takeover <= 1; takeover++) {
+				std::string offer = "permessage-deflate; client_max_window_bits=" + std::to_string(bits);
+				WebSocketDeflate* pDeflate = accept(offer, 15, takeover);
+				ZlibDeflater zlib(levels[level][0], bits, levels[level][1], takeover);
+				for (size_t i = 0; i < list.size(); i++) {
+					std::string out;
+					CHECK(ourInflate(pDeflate, zlib.compress(list[i]), &out));
+					CHECK(out == list[i]);
+				}
+				delete pDeflate;
+			}
+		}
+	}
+} // testZlibToOurs
+
+
+/**
+ * @brief A back reference into an earlier message is refused once that message is forgotten.
+ */
+static void testWindowLimits() {
+	uint32_t seed = 3;
+	std::string first(2000, 0);
+	for (size_t i = 0; i < first.length(); i++) {
+		seed = seed * 1103515245 + 12345;
+		first[i] = (char) ('a' + (seed >> 16) % 26);
+	}
+	std::string second = first.substr(0, 1000);
+
+	ZlibDeflater zlib(9, 15, Z_DEFAULT_STRATEGY, true);
+	std::string data1 = zlib.compress(first);
+	std::string data2 = zlib.compress(second);   // Refers back into the first message.
+	CHECK(data2.length() < 100);
+
+	std::string out;
+	WebSocketDeflate* pTakeover = accept("permessage-deflate", 15, true);
+	CHECK(ourInflate(pTakeover, data1, &out) && out == first);
+	CHECK(ourInflate(pTakeover, data2, &out) && out == second);
+	delete pTakeover;
+
+	WebSocketDeflate* pNoTakeover = accept("permessage-deflate; client_no_context_takeover", 15, true);
+	CHECK(ourInflate(pNoTakeover, data1, &out) && out == first);
+	CHECK(!ourInflate(pNoTakeover, data2, &out));   // The first message is forgotten.
+	delete pNoTakeover;
+
+	WebSocketDeflate* pSmall = accept("permessage-deflate; client_max_window_bits=9", 15, true);
+	CHECK(ourInflate(pSmall, data1, &out) && out == first);
+	CHECK(!ourInflate(pSmall, data2, &out));        // Only the last 512 bytes are kept.
+	delete pSmall;
+
+	// With nothing before it, any back reference is too far.
+	WebSocketDeflate* pFresh = accept("permessage-deflate", 15, true);
+	CHECK(!ourInflate(pFresh, data2, &out));
+	delete pFresh;
+} // testWindowLimits
+
+
+/**
+ * @brief Messages longer than the limit are refused, those up to it accepted.
+ */
+static void testMaxLength() {
+	std::string message(10000, 'q');
+	ZlibDeflater zlib(6, 15, Z_DEFAULT_STRATEGY, false);
+	std::string data = zlib.compress(message);
+	std::string stored = ZlibDeflater(0, 15, Z_DEFAULT_STRATEGY, false).compress(message);
+
+	WebSocketDeflate* pDeflate = accept("permessage-deflate", 15, false);
+	std::string out;
+	CHECK(ourInflate(pDeflate, data, &out, message.length()) && out == message);
+	CHECK(!ourInflate(pDeflate, data, &out, message.length() - 1));
+	CHECK(out.length() <= message.length());
+	CHECK(ourInflate(pDeflate, stored, &out, message.length()) && out == message);
+	CHECK(!ourInflate(pDeflate, stored, &out, 100));
+	CHECK(ourInflate(pDeflate, data, &out, message.length()) && out == message);   // Still usable afterwards.
+	delete pDeflate;
+} // testMaxLength
+
+
+/**
+ * @brief Truncated and corrupt messages are refused or decode to something, never beyond their bounds.
+ */
+static void testMalformed() {
+	std::string message;
+	for (int i = 0; i < 50; i++) message += "the quick brown fox " + std::to_string(i * i) + " ";
+	std::string data = ZlibDeflater(9, 15, Z_DEFAULT_STRATEGY, false).compress(message);
+	WebSocketDeflate* pDeflate = accept("permessage-deflate", 15, false);
+	std::string out;
+
+	for (size_t length = 0; length < data.length(); length++) {   // Every truncation.
+		bool ok = ourInflate(pDeflate, data.substr(0, length), &out, 4096);
+		CHECK(!ok || out != message);
+		CHECK(out.length() <= 4096 + 258);
+	}
+
+	uint32_t seed = 17;
+	for (int round = 0; round < 5000; round++) {                   // Bit flips and random bytes.
+		std::string corrupt = data;
+		seed = seed * 1103515245 + 12345;
+		corrupt[(seed >> 8) % corrupt.length()] ^= (char) (1 << ((seed >> 4) % 8));
+		ourInflate(pDeflate, corrupt, &out, 4096);
+		CHECK(out.length() <= 4096 + 258);
+
+		std::string random((seed >> 16) % 64, 0);
+		for (size_t i = 0; i < random.length(); i++) {
+			seed = seed * 1103515245 + 12345;
+			random[i] = (char) (seed >> 24);
+		}
+		ourInflate(pDeflate, random, &out, 4096);
+		CHECK(out.length() <= 4096 + 258);
+	}
+
+	const char reserved[] = { 0x07 };                             // BTYPE 3 is reserved.
+	CHECK(!ourInflate(pDeflate, std::string(reserved, 1), &out));
+	const char badStored[] = { 0x01, 0x05, 0x00, 0x00, 0x00, 'a' };   // LEN doesn't match NLEN.
+	CHECK(!ourInflate(pDeflate, std::string(badStored, sizeof(badStored)), &out));
+	const char longStored[] = { 0x01, 0x20, 0x00, (char) 0xdf, (char) 0xff, 'a' };   // LEN beyond the data.
+	CHECK(!ourInflate(pDeflate, std::string(longStored, sizeof(longStored)), &out));
+	CHECK(ourInflate(pDeflate, "", &out) == false || out.empty());
+	CHECK(ourInflate(pDeflate, data, &out) && out == message);
+	delete pDeflate;
+} // testMalformed
+
+
+static std::string response(const std::string& offers, uint8_t windowBits = 15, bool takeover = true, bool enabled = true) {
+	WebSocketDeflateConfig config = { enabled, windowBits, takeover };
+	std::string response = "unchanged";
+	WebSocketDeflate* pDeflate = WebSocketDeflate::negotiate(offers, config, &response);
+	if (pDeflate == nullptr) return "declined";
+	delete pDeflate;
+	return response;
+} // response
+
+
+/**
+ * @brief Sec-WebSocket-Extensions headers as clients send them, and as they shouldn't.
+ */
+static void testNegotiate() {
+	CHECK(response("permessage-deflate") == "permessage-deflate");
+	CHECK(response("permessage-deflate; client_max_window_bits") == "permessage-deflate; client_max_window_bits=15");
+	CHECK(response("permessage-deflate; client_max_window_bits", 10) ==
+		"permessage-deflate; server_max_window_bits=10; client_max_window_bits=10");
+	CHECK(response("permessage-deflate", 10) == "declined");      // The client's window can't be limited.
+	CHECK(response("permessage-deflate", 15, false) ==
+		"permessage-deflate; server_no_context_takeover; client_no_context_takeover");
+	CHECK(response("permessage-deflate", 15, true, false) == "declined");
+	CHECK(response("permessage-deflate; client_max_window_bits", 4) ==
+		"permessage-deflate; server_max_window_bits=9; client_max_window_bits=9");
+	CHECK(response("permessage-deflate; client_max_window_bits", 20) == "permessage-deflate; client_max_window_bits=15");
+	CHECK(response("permessage-deflate; server_max_window_bits=\"12\"; client_max_window_bits=8") ==
+		"permessage-deflate; server_max_window_bits=12; client_max_window_bits=8");
+
+	// Empty offers and parameters.
+	CHECK(response("") == "declined");
+	CHECK(response(",") == "declined");
+	CHECK(response(",,,") == "declined");
+	CHECK(response(" ") == "declined");
+	CHECK(response(";") == "declined");
+	CHECK(response("permessage-deflate,,x") == "permessage-deflate");
+	CHECK(response(", permessage-deflate") == "permessage-deflate");
+	CHECK(response(",,permessage-deflate,") == "permessage-deflate");
+	CHECK(response("permessage-deflate;;") == "permessage-deflate");
+	CHECK(response("permessage-deflate; ; client_max_window_bits;") == "permessage-deflate; client_max_window_bits=15");
+	CHECK(response(";permessage-deflate") == "declined");
+
+	// Unacceptable offers are passed over for the next.
+	CHECK(response("x-webkit-deflate-frame, permessage-deflate") == "permessage-deflate");
+	CHECK(response("permessage-deflate; server_max_window_bits=7, permessage-deflate") == "permessage-deflate");
+	CHECK(response("permessage-deflate; server_max_window_bits=16") == "declined");
+	CHECK(response("permessage-deflate; server_max_window_bits") == "declined");
+	CHECK(response("permessage-deflate; client_max_window_bits=0") == "declined");
+	CHECK(response("permessage-deflate; mystery, permessage-deflate; server_no_context_takeover") ==
+		"permessage-deflate; server_no_context_takeover");
+	CHECK(response("permessage-deflate=1") == "declined");
+	CHECK(response("PERMESSAGE-DEFLATE") == "declined");
+} // testNegotiate
+
+
+int main() {
+	testNegotiate();
+	testOursToZlib();
+	testZlibToOurs();
+	testWindowLimits();
+	testMaxLength();
+	testMalformed();
+	return testResult("test_websocket_deflate");
+} // main
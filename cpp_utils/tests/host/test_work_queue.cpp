@@ -0,0 +1,169 @@
+/*
+ * test_work_queue.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host load test of WorkQueue as the HTTP server uses it: a pool of workers taking items that several
+ * producers push into a small queue.  Producers must block while the queue is full, every item must be
+ * taken exactly once, closing the queue must let every worker end once the items are drained, and a
+ * producer that doesn't wait must be refused rather than block.
+ */
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <vector>
+#include "WorkQueue.h"
+#include "HostTest.h"
+
+static const int PRODUCERS          = 4;
+static const int WORKERS            = 6;
+static const int ITEMS_PER_PRODUCER = 5000;
+static const int ITEMS              = PRODUCERS * ITEMS_PER_PRODUCER;
+
+struct Pool {
+	WorkQueue*      pQueue;
+	pthread_mutex_t lock;
+	int             taken[ITEMS];   // How many times each item was taken.
+	int             workersEnded;
+};
+
+struct Producer {
+	Pool* pPool;
+	int   first;    // The first item this producer pushes.
+	int   refused;  // Pushes refused.
+};
+
+
+static void* producer(void* pParam) {
+	Producer* pProducer = (Producer*) pParam;
+	for (int i = 0; i < ITEMS_PER_PRODUCER; i++) {
+		int* pItem = new int(pProducer->first + i);
+		if (!pProducer->pPool->pQueue->push(pItem, true)) {
+			pProducer->refused++;
+			delete pItem;
+		}
+	}
+	return nullptr;
+} // producer
+
+
+static void* worker(void* pParam) {
+	Pool* pPool = (Pool*) pParam;
+	while (true) {
+		int* pItem = (int*) pPool->pQueue->pop();
+		if (pItem == nullptr) break;   // Closed and drained.
+		::pthread_mutex_lock(&pPool->lock);
+		pPool->taken[*pItem]++;
+		::pthread_mutex_unlock(&pPool->lock);
+		delete pItem;
+	}
+	::pthread_mutex_lock(&pPool->lock);
+	pPool->workersEnded++;
+	::pthread_mutex_unlock(&pPool->lock);
+	return nullptr;
+} // worker
+
+
+/**
+ * @brief Producers outrunning the workers through a queue of 4, then a shutdown.
+ */
+static void testPool() {
+	WorkQueue queue(4);
+	Pool* pPool = new Pool();
+	pPool->pQueue = &queue;
+	::pthread_mutex_init(&pPool->lock, nullptr);
+	memset(pPool->taken, 0, sizeof(pPool->taken));
+	pPool->workersEnded = 0;
+
+	pthread_t workers[WORKERS];
+	for (int i = 0; i < WORKERS; i++) ::pthread_create(&workers[i], nullptr, worker, pPool);
+	pthread_t producers[PRODUCERS];
+	Producer producerParams[PRODUCERS];
+	for (int i = 0; i < PRODUCERS; i++) {
+		producerParams[i].pPool   = pPool;
+		producerParams[i].first   = i * ITEMS_PER_PRODUCER;
+		producerParams[i].refused = 0;
+		::pthread_create(&producers[i], nullptr, producer, &producerParams[i]);
+	}
+	for (int i = 0; i < PRODUCERS; i++) ::pthread_join(producers[i], nullptr);
+
+	queue.close();   // The workers drain what is left and end.
+	for (int i = 0; i < WORKERS; i++) ::pthread_join(workers[i], nullptr);
+
+	int refused = 0;
+	for (int i = 0; i < PRODUCERS; i++) refused += producerParams[i].refused;
+	CHECK(refused == 0);                           // Waiting producers are never refused while open.
+	CHECK(queue.getRejectCount() == 0);
+	int wrong = 0;
+	for (int i = 0; i < ITEMS; i++) {
+		if (pPool->taken[i] != 1) wrong++;         // None lost, none taken twice.
+	}
+	CHECK(wrong == 0);
+	CHECK(pPool->workersEnded == WORKERS);
+	CHECK(queue.getPopCount() == (uint32_t) ITEMS);
+	CHECK(queue.getDepth() == 0);
+	CHECK(queue.getMaxDepth() <= queue.getCapacity());
+	CHECK(queue.push(pPool, true) == false);       // Closed.
+	CHECK(queue.pop() == nullptr);
+	::pthread_mutex_destroy(&pPool->lock);
+	delete pPool;
+} // testPool
+
+
+struct Blocked {
+	WorkQueue* pQueue;
+	int        item;
+	bool       pushed;
+	bool       returned;
+};
+
+
+static void* pushBlocked(void* pParam) {
+	Blocked* pBlocked = (Blocked*) pParam;
+	pBlocked->pushed = pBlocked->pQueue->push(&pBlocked->item, true);
+	__atomic_store_n(&pBlocked->returned, true, __ATOMIC_SEQ_CST);
+	return nullptr;
+} // pushBlocked
+
+
+/**
+ * @brief A producer waits on a full queue until a worker takes an item, or until the queue is closed.
+ */
+static void testBlocking() {
+	WorkQueue queue(2);
+	int items[2] = { 1, 2 };
+	CHECK(queue.push(&items[0], true));
+	CHECK(queue.push(&items[1], true));
+	CHECK(!queue.push(&items[0], false));          // Full, refused without waiting.
+	CHECK(queue.getRejectCount() == 1);
+
+	Blocked blocked = { &queue, 3, false, false };
+	pthread_t thread;
+	::pthread_create(&thread, nullptr, pushBlocked, &blocked);
+	::usleep(50 * 1000);
+	CHECK(!__atomic_load_n(&blocked.returned, __ATOMIC_SEQ_CST));   // Still waiting for space.
+	CHECK(queue.pop() == &items[0]);
+	::pthread_join(thread, nullptr);
+	CHECK(blocked.pushed);
+	CHECK(queue.pop() == &items[1]);
+	CHECK(queue.pop() == &blocked.item);           // In order.
+
+	CHECK(queue.push(&items[0], true));
+	CHECK(queue.push(&items[1], true));
+	Blocked closed = { &queue, 4, true, false };
+	::pthread_create(&thread, nullptr, pushBlocked, &closed);
+	::usleep(50 * 1000);
+	queue.close();                                 // Wakes the waiting producer, which is refused.
+	::pthread_join(thread, nullptr);
+	CHECK(!closed.pushed);
+	CHECK(queue.pop() == &items[0]);               // What was queued is still delivered.
+	CHECK(queue.pop() == &items[1]);
+	CHECK(queue.pop() == nullptr);
+} // testBlocking
+
+
+int main() {
+	testBlocking();
+	testPool();
+	return testResult("test_work_queue");
+} // main
@@ -1 +1,2 @@
-COMPONENT_ADD_INCLUDEDIRS=.
\ No newline at end of file
+COMPONENT_ADD_INCLUDEDIRS=.
+CFLAGS += -DESPFS_HEATSHRINK
@@ -45,6 +45,28 @@ struct EspFsFile {
 
 static spi_flash_mmap_handle_t handle;
 static void *espFlashPtr = NULL;
+static char *espFirstHeader = NULL;           // The header of the first file, after the index if there is one.
+static EspFsIndexEntry *espIndex = NULL;      // The index of the image, or NULL for a linear search.
+static int32_t espIndexCount = 0;
+static size_t espFsSize = 0;
+
+#ifdef ESPFS_HEATSHRINK
+// Largest window accepted, as each open heatshrink file holds a window of 2^windowBits bytes in RAM.
+#define HEATSHRINK_MAX_WINDOW_BITS 12
+
+// State of a streaming heatshrink decoder. The compressed data is read straight from the mapped flash, so
+// only the window of output already produced is kept.
+typedef struct {
+	uint8_t windowBits;
+	uint8_t lookaheadBits;
+	uint8_t bitMask;            // The next bit of currentByte to read, or 0 when a new byte is needed.
+	uint8_t currentByte;
+	uint16_t head;              // Where the next byte of output goes in the window.
+	uint16_t copyOffset;        // Distance back of the backreference being copied.
+	uint16_t copyCount;         // Bytes of the backreference still to copy.
+	uint8_t window[];
+} HeatshrinkDecoder;
+#endif
 
 EspFsInitResult espFsInit(void *flashAddress, size_t size) {
 
@@ -58,8 +80,25 @@ EspFsInitResult espFsInit(void *flashAddress, size_t size) {
 		ESP_LOGD(tag, "rc from spi_flash_mmap: %d", rc);
 	}
 
+	// an index, if there is one, comes before the first file header
+	espFirstHeader = espFlashPtr;
+	espIndex = NULL;
+	espIndexCount = 0;
+	espFsSize = size;
+	EspFsIndexHeader *indexHeader = (EspFsIndexHeader *)espFlashPtr;
+	if (indexHeader->magic == ESPFS_INDEX_MAGIC) {
+		if (indexHeader->count < 0 || sizeof(EspFsIndexHeader) + (size_t)indexHeader->count * sizeof(EspFsIndexEntry) >= size) {
+			ESP_LOGE(tag, "Index of %d entries doesn't fit the image", indexHeader->count);
+			return ESPFS_INIT_RESULT_NO_IMAGE;
+		}
+		espIndex = (EspFsIndexEntry *)(indexHeader + 1);
+		espIndexCount = indexHeader->count;
+		espFirstHeader = (char *)(espIndex + espIndexCount);
+		ESP_LOGD(tag, "Image has an index of %d files", espIndexCount);
+	}
+
 	// check if there is valid header at address
-	EspFsHeader *testHeader = (EspFsHeader *)espFlashPtr;
+	EspFsHeader *testHeader = (EspFsHeader *)espFirstHeader;
 
 	if (testHeader->magic != ESPFS_MAGIC) {
 		ESP_LOGE(tag, "No valid header at flash address.  Expected to find %x and found %x", ESPFS_MAGIC, testHeader->magic);
@@ -70,6 +109,70 @@ EspFsInitResult espFsInit(void *flashAddress, size_t size) {
 }
 
 
+// Find the header of a file through the index, by a binary search for the hash of its name. Names that
+// share a hash have adjacent entries, so each of them is compared in turn.
+static EspFsHeader *espFsFindIndexed(const char *fileName) {
+	uint32_t hash = espFsHash(fileName);
+	int32_t low = 0;
+	int32_t high = espIndexCount;
+	while (low < high) {
+		int32_t mid = low + (high - low) / 2;
+		if (espIndex[mid].hash < hash) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	for (; low < espIndexCount && espIndex[low].hash == hash; low++) {
+		if (espIndex[low].offset > espFsSize - sizeof(EspFsHeader)) {
+			ESP_LOGD(tag, "Offset out of range. EspFS index broken.");
+			return NULL;
+		}
+		EspFsHeader *header = (EspFsHeader *)((char *)espFlashPtr + espIndex[low].offset);
+		if (header->magic != ESPFS_MAGIC) {
+			ESP_LOGD(tag, "Magic mismatch. EspFS index broken.");
+			return NULL;
+		}
+		if (strcmp((char *)header + sizeof(EspFsHeader), fileName) == 0) {
+			return header;
+		}
+	}
+	ESP_LOGD(tag, "File not in index.");
+	return NULL;
+}
+
+
+// Find the header of a file by walking every header in the image, as for an image without an index.
+static EspFsHeader *espFsFindLinear(const char *fileName) {
+	char *flashAddress = espFirstHeader;
+	EspFsHeader *header;
+	//Go find that file!
+	while(1) {
+		//Grab the next file header.
+		header = (EspFsHeader *)flashAddress;
+
+		if (header->magic != ESPFS_MAGIC) {
+			ESP_LOGD(tag, "Magic mismatch. EspFS image broken.");
+			return NULL;
+		}
+		if (header->flags & FLAG_LASTFILE) {
+			ESP_LOGD(tag, "End of image.  File not found.");
+			return NULL;
+		}
+		//Grab the name of the file.
+		if (strcmp(flashAddress + sizeof(EspFsHeader), fileName) == 0) {
+			//Yay, this is the file we need!
+			return header;
+		}
+		//We don't need this file. Skip header, name and file
+		flashAddress += sizeof(EspFsHeader) + header->nameLen + header->fileLenComp;
+		if ((int)flashAddress&3) {
+			flashAddress += 4-((int)flashAddress & 3); //align to next 32bit val
+		}
+	}
+}
+
+
 
 // Returns flags of opened file.
 int espFsFlags(EspFsFile *fh) {
@@ -89,59 +192,122 @@ EspFsFile *espFsOpen(char *fileName) {
 		ESP_LOGD(tag, "Call espFsInit first!");
 		return NULL;
 	}
-	char *flashAddress = espFlashPtr;
-	char *hpos;
-	char *namebuf;
 	EspFsHeader *header;
 	EspFsFile *fileData;
 	//Strip initial slashes
 	while(fileName[0] == '/') {
 		fileName++;
 	}
-	//Go find that file!
-	while(1) {
-		hpos=flashAddress;
-		//Grab the next file header.
-		header = (EspFsHeader *)flashAddress;
-
-		if (header->magic != ESPFS_MAGIC) {
-			ESP_LOGD(tag, "Magic mismatch. EspFS image broken.");
+	header = espIndex != NULL ? espFsFindIndexed(fileName) : espFsFindLinear(fileName);
+	if (header == NULL) {
+		return NULL;
+	}
+	fileData = (EspFsFile *)malloc(sizeof(EspFsFile)); //Alloc file desc mem
+	if (fileData==NULL) {
+		return NULL;
+	}
+	fileData->header = header;
+	fileData->decompressor = header->compression;
+	fileData->posComp = (char *)header + sizeof(EspFsHeader) + header->nameLen; //Skip to content.
+	fileData->posStart = fileData->posComp;
+	fileData->posDecomp = 0;
+	fileData->decompData = NULL;
+	if (header->compression == COMPRESS_NONE) {
+		return fileData;
+#ifdef ESPFS_HEATSHRINK
+	} else if (header->compression == COMPRESS_HEATSHRINK && header->fileLenComp > 0) {
+		//Decoder parameters are stored in the first byte: window bits in the high nibble, lookahead bits in the low one.
+		uint8_t parm = (uint8_t)*fileData->posComp++;
+		uint8_t windowBits = parm >> 4;
+		uint8_t lookaheadBits = parm & 0xf;
+		if (windowBits < 4 || windowBits > HEATSHRINK_MAX_WINDOW_BITS || lookaheadBits < 3 || lookaheadBits >= windowBits) {
+			ESP_LOGD(tag, "Unsupported heatshrink parameters: %x", parm);
+			free(fileData);
 			return NULL;
 		}
-		if (header->flags & FLAG_LASTFILE) {
-			ESP_LOGD(tag, "End of image.  File not found.");
+		HeatshrinkDecoder *dec = (HeatshrinkDecoder *)calloc(1, sizeof(HeatshrinkDecoder) + (1 << windowBits));
+		if (dec == NULL) {
+			free(fileData);
 			return NULL;
 		}
-		//Grab the name of the file.
-		flashAddress += sizeof(EspFsHeader);
-		namebuf = (char *)flashAddress;
-		if (strcmp(namebuf, fileName) == 0) {
-			//Yay, this is the file we need!
-			flashAddress += header->nameLen; //Skip to content.
-			fileData = (EspFsFile *)malloc(sizeof(EspFsFile)); //Alloc file desc mem
-			if (fileData==NULL) {
-				return NULL;
+		dec->windowBits = windowBits;
+		dec->lookaheadBits = lookaheadBits;
+		fileData->decompData = dec;
+		return fileData;
+#endif
+	}
+	ESP_LOGD(tag, "Invalid compression: %d", header->compression);
+	free(fileData);
+	return NULL;
+}
+
+
+#ifdef ESPFS_HEATSHRINK
+// Read the next count bits, most significant first, of the compressed data. Returns -1 at its end.
+static int heatshrinkGetBits(EspFsFile *fh, HeatshrinkDecoder *dec, int count) {
+	int value = 0;
+	while (count-- > 0) {
+		if (dec->bitMask == 0) {
+			if (fh->posComp - fh->posStart >= fh->header->fileLenComp) {
+				return -1;
+			}
+			dec->currentByte = (uint8_t)*fh->posComp++;
+			dec->bitMask = 0x80;
+		}
+		value = (value << 1) | ((dec->currentByte & dec->bitMask) != 0);
+		dec->bitMask >>= 1;
+	}
+	return value;
+}
+
+
+// Decompress up to len bytes of a heatshrink file into buff. A backreference may be split between calls,
+// so each call carries on from where the last one stopped. Returns the number of bytes produced.
+static int heatshrinkRead(EspFsFile *fh, char *buff, int len) {
+	HeatshrinkDecoder *dec = (HeatshrinkDecoder *)fh->decompData;
+	uint16_t mask = (1 << dec->windowBits) - 1;
+	int toRead = fh->header->fileLenDecomp - fh->posDecomp;
+	if (len > toRead) {
+		len = toRead;
+	}
+	int produced = 0;
+	while (produced < len) {
+		uint8_t c;
+		if (dec->copyCount > 0) {
+			c = dec->window[(dec->head - dec->copyOffset) & mask];
+			dec->copyCount--;
+		} else {
+			int bit = heatshrinkGetBits(fh, dec, 1);
+			if (bit < 0) {
+				break;
 			}
-			fileData->header = (EspFsHeader *)hpos;
-			fileData->decompressor = header->compression;
-			fileData->posComp = flashAddress;
-			fileData->posStart = flashAddress;
-			fileData->posDecomp = 0;
-			if (header->compression == COMPRESS_NONE) {
-				fileData->decompData = NULL;
+			if (bit) {
+				//Literal byte
+				int value = heatshrinkGetBits(fh, dec, 8);
+				if (value < 0) {
+					break;
+				}
+				c = value;
 			} else {
-				ESP_LOGD(tag, "Invalid compression: %d", header->compression);
-				return NULL;
+				//Backreference: offset-1 then count-1
+				int index = heatshrinkGetBits(fh, dec, dec->windowBits);
+				int count = heatshrinkGetBits(fh, dec, dec->lookaheadBits);
+				if (index < 0 || count < 0) {
+					break;
+				}
+				dec->copyOffset = index + 1;
+				dec->copyCount = count + 1;
+				continue;
 			}
-			return fileData;
-		}
-		//We don't need this file. Skip name and file
-		flashAddress += header->nameLen+header->fileLenComp;
-		if ((int)flashAddress&3) {
-			flashAddress += 4-((int)flashAddress & 3); //align to next 32bit val
 		}
+		dec->window[dec->head & mask] = c;
+		dec->head++;
+		buff[produced++] = c;
 	}
+	fh->posDecomp += produced;
+	return produced;
 }
+#endif
 
 //Read len bytes from the given file into buff. Returns the actual amount of bytes read.
 int espFsRead(EspFsFile *fh, char *buff, int len) {
@@ -163,11 +329,23 @@ int espFsRead(EspFsFile *fh, char *buff, int len) {
 		fh->posDecomp += len;
 		fh->posComp += len;
 		return len;
+#ifdef ESPFS_HEATSHRINK
+	} else if (fh->decompressor == COMPRESS_HEATSHRINK) {
+		return heatshrinkRead(fh, buff, len);
+#endif
 	}
 	return 0;
 }
 
+//Get the content of a file in place, straight from the mapped flash. A FLAG_GZIP file is given as its gzip
+//data, to be sent with "Content-Encoding: gzip". A heatshrink file can only be read with espFsRead, so
+//this returns -1 for one.
 int espFsAccess(EspFsFile *fh, void **buf, size_t *len) {
+	if (fh->decompressor != COMPRESS_NONE) {
+		*buf = NULL;
+		*len = 0;
+		return -1;
+	}
 	*buf = fh->posStart;
 	*len = fh->header->fileLenComp;
 	return *len;
@@ -176,5 +354,6 @@ int espFsAccess(EspFsFile *fh, void **buf, size_t *len) {
 //Close the file.
 void espFsClose(EspFsFile *fh) {
 	if (fh == NULL) return;
+	free(fh->decompData);
 	free(fh);
 }
@@ -1,7 +1,7 @@
 #ifndef ESPFS_H
 #define ESPFS_H
 #include <stdlib.h>
-// This define is done in Makefile. If you do not use default Makefile, uncomment
+// This define is done in component.mk. If you do not use that component.mk, uncomment
 // to be able to use Heatshrink-compressed espfs images.
 //#define ESPFS_HEATSHRINK
 
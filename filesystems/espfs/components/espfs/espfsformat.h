@@ -1,5 +1,6 @@
 #ifndef ESPROFSFORMAT_H
 #define ESPROFSFORMAT_H
+#include <stdint.h>
 
 /*
 Stupid cpio-like tool to make read-only 'filesystems' that live on the flash SPI chip of the module.
@@ -20,6 +21,7 @@ with the FLAG_LASTFILE flag set.
 #define COMPRESS_NONE 0
 #define COMPRESS_HEATSHRINK 1
 #define ESPFS_MAGIC 0x73665345
+#define ESPFS_INDEX_MAGIC 0x78646945
 
 typedef struct {
 	int32_t magic;
@@ -30,4 +32,33 @@ typedef struct {
 	int32_t fileLenDecomp;
 } __attribute__((packed)) EspFsHeader;
 
+/*
+An image may start with an index of its files so that a file can be found without walking every header.
+The index is an EspFsIndexHeader followed by one EspFsIndexEntry per file, sorted by the hash of the file
+name and then by offset; the file headers follow the index. Different names may share a hash, so the
+name in the header found is still compared. An image without an index starts directly with a file header.
+*/
+typedef struct {
+	int32_t magic;              // ESPFS_INDEX_MAGIC
+	int32_t count;              // Number of entries.
+} __attribute__((packed)) EspFsIndexHeader;
+
+typedef struct {
+	uint32_t hash;              // espFsHash of the file name.
+	uint32_t offset;            // Offset of the file's header from the start of the image.
+} __attribute__((packed)) EspFsIndexEntry;
+
+// The hash of a file name as used by the index: 32-bit FNV-1a of the name without its leading slashes.
+static inline uint32_t espFsHash(const char *name) {
+	uint32_t hash = 2166136261u;
+	while (*name == '/') {
+		name++;
+	}
+	while (*name != 0) {
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
 #endif
\ No newline at end of file
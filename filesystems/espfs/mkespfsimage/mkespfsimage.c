@@ -0,0 +1,355 @@
+/*
+Host tool that builds an espfs image. It reads the names of the files to put in the image from stdin, one
+per line, and writes the image to stdout, for example:
+
+	find files -type f | ./mkespfsimage > espfs.img
+
+Files are compressed with heatshrink, which espFsRead decompresses as it reads, unless that doesn't make
+them smaller or -c 0 is given. Files whose extension is in the comma-separated list given with -g are
+gzipped instead and flagged FLAG_GZIP; espFsAccess hands those out as they are, for an HTTP server to send
+with "Content-Encoding: gzip".
+
+By default the image starts with an index of its files (see espfsformat.h), which lets espFsOpen find a
+file with a binary search instead of walking every header. Pass -n to leave the index out; the image is
+then readable by older versions of espfs too.
+
+Build with:
+
+	cc -O2 -o mkespfsimage mkespfsimage.c -lz
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "../components/espfs/espfsformat.h"
+
+//Heatshrink parameters: a window of 2^11 bytes, backreferences of up to 2^4 bytes
+#define HEATSHRINK_WINDOW_BITS 11
+#define HEATSHRINK_LOOKAHEAD_BITS 4
+
+typedef struct {
+	char *name;
+	uint32_t hash;
+	uint32_t offset;            // Offset of the file's header from the start of the files.
+} FileEntry;
+
+static char *image = NULL;      // The files, each header followed by its name and data.
+static size_t imageLen = 0;
+static size_t imageSize = 0;
+
+static FileEntry *entries = NULL;
+static size_t entryCount = 0;
+static size_t entrySize = 0;
+
+static int compressor = COMPRESS_HEATSHRINK;
+static char *gzipExtensions = NULL;
+
+
+typedef struct {
+	char *data;
+	size_t len;
+	size_t size;
+	int bits;                   // Bits used of the last byte, 0 when it's full.
+} Output;
+
+
+static void putBits(Output *out, int value, int count) {
+	while (count-- > 0) {
+		if (out->bits == 0) {
+			if (out->len == out->size) {
+				out->size = out->size * 2 + 64;
+				out->data = realloc(out->data, out->size);
+				if (out->data == NULL) {
+					perror("realloc");
+					exit(1);
+				}
+			}
+			out->data[out->len++] = 0;
+		}
+		if ((value >> count) & 1) {
+			out->data[out->len - 1] |= 0x80 >> out->bits;
+		}
+		out->bits = (out->bits + 1) & 7;
+	}
+}
+
+
+// Compress data with heatshrink, preceded by the byte of parameters espFsOpen expects. A greedy search of
+// the whole window is slow but the files going into an image are small.
+static char *heatshrinkCompress(const char *data, size_t len, size_t *compLen) {
+	Output out = { NULL, 0, 0, 0 };
+	const size_t window = 1 << HEATSHRINK_WINDOW_BITS;
+	const size_t lookahead = 1 << HEATSHRINK_LOOKAHEAD_BITS;
+	//A backreference is worth it when it's shorter than the literals it replaces
+	const size_t minMatch = (1 + HEATSHRINK_WINDOW_BITS + HEATSHRINK_LOOKAHEAD_BITS) / 9 + 1;
+	putBits(&out, (HEATSHRINK_WINDOW_BITS << 4) | HEATSHRINK_LOOKAHEAD_BITS, 8);
+	size_t pos = 0;
+	while (pos < len) {
+		size_t bestLen = 0;
+		size_t bestOffset = 0;
+		size_t maxLen = len - pos < lookahead ? len - pos : lookahead;
+		for (size_t offset = 1; offset <= window && offset <= pos; offset++) {
+			size_t n = 0;
+			while (n < maxLen && data[pos + n] == data[pos + n - offset]) {
+				n++;
+			}
+			if (n > bestLen) {
+				bestLen = n;
+				bestOffset = offset;
+				if (n == maxLen) {
+					break;
+				}
+			}
+		}
+		if (bestLen >= minMatch) {
+			putBits(&out, 0, 1);
+			putBits(&out, bestOffset - 1, HEATSHRINK_WINDOW_BITS);
+			putBits(&out, bestLen - 1, HEATSHRINK_LOOKAHEAD_BITS);
+			pos += bestLen;
+		} else {
+			putBits(&out, 1, 1);
+			putBits(&out, (uint8_t)data[pos], 8);
+			pos++;
+		}
+	}
+	*compLen = out.len;
+	return out.data;
+}
+
+
+// Compress data with gzip. Returns NULL on failure.
+static char *gzipCompress(const char *data, size_t len, size_t *compLen) {
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	//15 window bits plus 16 for a gzip header and trailer
+	if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return NULL;
+	}
+	size_t size = deflateBound(&stream, len);
+	char *out = malloc(size);
+	stream.next_in = (Bytef *)data;
+	stream.avail_in = len;
+	stream.next_out = (Bytef *)out;
+	stream.avail_out = size;
+	if (out == NULL || deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+		deflateEnd(&stream);
+		free(out);
+		return NULL;
+	}
+	*compLen = stream.total_out;
+	deflateEnd(&stream);
+	return out;
+}
+
+
+// Whether the extension of a file name is in the list given with -g.
+static int shouldGzip(const char *name) {
+	const char *ext = strrchr(name, '.');
+	if (gzipExtensions == NULL || ext == NULL) {
+		return 0;
+	}
+	ext++;
+	size_t extLen = strlen(ext);
+	const char *p = gzipExtensions;
+	while (*p != 0) {
+		size_t n = strcspn(p, ",");
+		if (n == extLen && strncmp(p, ext, n) == 0) {
+			return 1;
+		}
+		p += n;
+		if (*p == ',') {
+			p++;
+		}
+	}
+	return 0;
+}
+
+
+// Append to the image, padding to the next 32 bit boundary if pad is set.
+static void append(const void *data, size_t len, int pad) {
+	size_t needed = imageLen + len + 3;
+	if (needed > imageSize) {
+		imageSize = needed * 2;
+		image = realloc(image, imageSize);
+		if (image == NULL) {
+			perror("realloc");
+			exit(1);
+		}
+	}
+	memcpy(image + imageLen, data, len);
+	imageLen += len;
+	while (pad && (imageLen & 3) != 0) {
+		image[imageLen++] = 0;
+	}
+}
+
+
+// Read a whole file into memory. Returns NULL if it can't be read.
+static char *readFile(const char *name, size_t *len) {
+	FILE *f = fopen(name, "rb");
+	if (f == NULL) {
+		perror(name);
+		return NULL;
+	}
+	size_t size = 4096;
+	char *data = malloc(size);
+	*len = 0;
+	size_t n;
+	while (data != NULL && (n = fread(data + *len, 1, size - *len, f)) > 0) {
+		*len += n;
+		if (*len == size) {
+			size *= 2;
+			data = realloc(data, size);
+		}
+	}
+	fclose(f);
+	return data;
+}
+
+
+// Add a file to the image. Returns 0 if it can't be read.
+static int addFile(char *name) {
+	size_t len;
+	char *data = readFile(name, &len);
+	if (data == NULL) {
+		return 0;
+	}
+	//Strip initial slashes, as espFsOpen does
+	while (name[0] == '/') {
+		name++;
+	}
+	size_t nameLen = strlen(name) + 1;
+	size_t plainLen = len;
+	EspFsHeader header;
+	header.magic = ESPFS_MAGIC;
+	header.flags = 0;
+	header.compression = COMPRESS_NONE;
+	header.nameLen = (nameLen + 3) & ~3;
+	header.fileLenDecomp = len;
+
+	//Keep whichever of the compressed and plain data is smaller
+	size_t compLen = 0;
+	char *comp = NULL;
+	if (shouldGzip(name)) {
+		comp = gzipCompress(data, len, &compLen);
+		if (comp == NULL) {
+			fprintf(stderr, "Can't gzip %s\n", name);
+			exit(1);
+		}
+		//The gzip data is what espFsAccess hands out, so it's stored whatever its size
+		header.flags |= FLAG_GZIP;
+		header.fileLenDecomp = compLen;
+	} else if (compressor == COMPRESS_HEATSHRINK) {
+		comp = heatshrinkCompress(data, len, &compLen);
+		if (compLen < len) {
+			header.compression = COMPRESS_HEATSHRINK;
+		} else {
+			free(comp);
+			comp = NULL;
+		}
+	}
+	if (comp != NULL) {
+		free(data);
+		data = comp;
+		len = compLen;
+	}
+	header.fileLenComp = len;
+
+	if (entryCount == entrySize) {
+		entrySize = entrySize == 0 ? 64 : entrySize * 2;
+		entries = realloc(entries, entrySize * sizeof(FileEntry));
+		if (entries == NULL) {
+			perror("realloc");
+			exit(1);
+		}
+	}
+	entries[entryCount].name = strdup(name);
+	entries[entryCount].hash = espFsHash(name);
+	entries[entryCount].offset = imageLen;
+	entryCount++;
+
+	append(&header, sizeof(header), 0);
+	append(name, nameLen, 1);
+	append(data, len, 1);
+	free(data);
+	fprintf(stderr, "%s (%d%%)\n", name, plainLen == 0 ? 100 : (int)(100 * len / plainLen));
+	return 1;
+}
+
+
+static int compareEntries(const void *a, const void *b) {
+	const FileEntry *ea = a;
+	const FileEntry *eb = b;
+	if (ea->hash != eb->hash) {
+		return ea->hash < eb->hash ? -1 : 1;
+	}
+	return ea->offset < eb->offset ? -1 : ea->offset > eb->offset;
+}
+
+
+// Write the index of the files, with offsets moved past the index itself.
+static void writeIndex(void) {
+	EspFsIndexHeader indexHeader;
+	indexHeader.magic = ESPFS_INDEX_MAGIC;
+	indexHeader.count = entryCount;
+	fwrite(&indexHeader, sizeof(indexHeader), 1, stdout);
+
+	size_t indexLen = sizeof(EspFsIndexHeader) + entryCount * sizeof(EspFsIndexEntry);
+	qsort(entries, entryCount, sizeof(FileEntry), compareEntries);
+	for (size_t i = 0; i < entryCount; i++) {
+		if (i > 0 && entries[i].hash == entries[i - 1].hash) {
+			fprintf(stderr, "Note: %s and %s share a hash\n", entries[i - 1].name, entries[i].name);
+		}
+		EspFsIndexEntry entry;
+		entry.hash = entries[i].hash;
+		entry.offset = indexLen + entries[i].offset;
+		fwrite(&entry, sizeof(entry), 1, stdout);
+	}
+}
+
+
+int main(int argc, char **argv) {
+	int withIndex = 1;
+	int opt;
+	while ((opt = getopt(argc, argv, "c:g:n")) != -1) {
+		if (opt == 'c' && (atoi(optarg) == COMPRESS_NONE || atoi(optarg) == COMPRESS_HEATSHRINK)) {
+			compressor = atoi(optarg);
+		} else if (opt == 'g') {
+			gzipExtensions = optarg;
+		} else if (opt == 'n') {
+			withIndex = 0;
+		} else {
+			fprintf(stderr, "Usage: %s [-c compressor] [-g extensions] [-n] < filelist > image\n", argv[0]);
+			fprintf(stderr, "  -c  0 to store files as they are, 1 for heatshrink (the default)\n");
+			fprintf(stderr, "  -g  Gzip files with these comma-separated extensions, such as html,css,js\n");
+			fprintf(stderr, "  -n  Leave out the index of the files\n");
+			exit(1);
+		}
+	}
+
+	char line[1024];
+	while (fgets(line, sizeof(line), stdin) != NULL) {
+		line[strcspn(line, "\r\n")] = 0;
+		if (line[0] != 0) {
+			addFile(line);
+		}
+	}
+
+	//The image ends with a header that has FLAG_LASTFILE set
+	EspFsHeader last;
+	memset(&last, 0, sizeof(last));
+	last.magic = ESPFS_MAGIC;
+	last.flags = FLAG_LASTFILE;
+	append(&last, sizeof(last), 1);
+
+	if (withIndex) {
+		writeIndex();
+	}
+	fwrite(image, imageLen, 1, stdout);
+	fprintf(stderr, "%d files, %d bytes%s\n", (int)entryCount, (int)imageLen, withIndex ? " plus the index" : "");
+	return 0;
+}
@@ -0,0 +1,34 @@
+/*
+ * esp_spi_flash.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Stand-in for the ESP-IDF flash mapping in the host test of espfs.  The "flash" is an image the test has
+ * loaded into memory; mapping any address gives it.
+ */
+
+#ifndef FILESYSTEMS_ESPFS_TEST_STUBS_ESP_SPI_FLASH_H_
+#define FILESYSTEMS_ESPFS_TEST_STUBS_ESP_SPI_FLASH_H_
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef uint32_t spi_flash_mmap_handle_t;
+typedef enum { SPI_FLASH_MMAP_DATA, SPI_FLASH_MMAP_INST } spi_flash_mmap_memory_t;
+
+extern const void *stubFlashImage;   // Set by the test before espFsInit.
+
+static inline void spi_flash_init(void) {
+}
+
+static inline esp_err_t spi_flash_mmap(size_t address, size_t size, spi_flash_mmap_memory_t memory, const void **ptr,
+	spi_flash_mmap_handle_t *handle) {
+	(void) address;
+	(void) size;
+	(void) memory;
+	*ptr = stubFlashImage;
+	*handle = 1;
+	return ESP_OK;
+}
+
+#endif /* FILESYSTEMS_ESPFS_TEST_STUBS_ESP_SPI_FLASH_H_ */
@@ -0,0 +1,268 @@
+/*
+Host test and benchmark of espfs lookup. For several numbers of files it builds two images with
+mkespfsimage, one with the index and one without (-n), checks that every file opens and reads back exactly
+through both and that names not in the image aren't found, and then times espFsOpen on each. Two names with
+the same hash are put in an image too, to check that the index compares the names sharing a hash.
+
+Run with the path of mkespfsimage, as the Makefile does:
+
+	./test_espfs ./mkespfsimage
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "espfsformat.h"
+#include "espfs.h"
+
+#define FLASH_BLOCK (64*1024)
+#define OPENS 200000
+
+const void *stubFlashImage = NULL;
+
+static int failures = 0;
+static char *mkespfsimage = NULL;
+
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+		failures++; \
+	} \
+} while (0)
+
+
+static uint64_t nowNs(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+// The content of a file: text, so that some of it compresses, of a length that varies with the seed.
+static size_t fileContent(uint32_t seed, char *buf, size_t size) {
+	size_t len = 20 + seed * 7919 % 400;
+	if (len > size) {
+		len = size;
+	}
+	for (size_t i = 0; i < len; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = (seed >> 16) % 3 == 0 ? ' ' : 'a' + (seed >> 20) % 8;
+	}
+	return len;
+}
+
+
+static void writeFile(const char *name, uint32_t seed) {
+	char buf[512];
+	size_t len = fileContent(seed, buf, sizeof(buf));
+	FILE *f = fopen(name, "wb");
+	CHECK(f != NULL && fwrite(buf, 1, len, f) == len);
+	if (f != NULL) {
+		fclose(f);
+	}
+}
+
+
+// Build an image of the files listed, with or without the index, and load it into a buffer that is a
+// whole number of 64K blocks, as espFsInit maps. Returns the size of the buffer.
+static size_t buildImage(char **names, int count, int withIndex, char **image) {
+	FILE *list = fopen("files.txt", "w");
+	for (int i = 0; i < count; i++) {
+		fprintf(list, "%s\n", names[i]);
+	}
+	fclose(list);
+	char command[1024];
+	snprintf(command, sizeof(command), "%s %s < files.txt > image.bin 2> /dev/null", mkespfsimage, withIndex ? "" : "-n");
+	CHECK(system(command) == 0);
+
+	FILE *f = fopen("image.bin", "rb");
+	fseek(f, 0, SEEK_END);
+	size_t len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	size_t size = (len + FLASH_BLOCK - 1) / FLASH_BLOCK * FLASH_BLOCK;
+	*image = calloc(1, size);
+	CHECK(fread(*image, 1, len, f) == len);
+	fclose(f);
+	unlink("files.txt");
+	unlink("image.bin");
+
+	CHECK((((EspFsIndexHeader *)*image)->magic == ESPFS_INDEX_MAGIC) == withIndex);
+	stubFlashImage = *image;
+	CHECK(espFsInit(NULL, size) == ESPFS_INIT_RESULT_OK);
+	return size;
+}
+
+
+// Open a file and check that it reads back as written.
+static void checkFile(char *name, uint32_t seed) {
+	char expected[512];
+	size_t len = fileContent(seed, expected, sizeof(expected));
+	EspFsFile *fh = espFsOpen(name);
+	CHECK(fh != NULL);
+	if (fh == NULL) {
+		return;
+	}
+	char buf[600];
+	int got = 0;
+	int n;
+	while ((n = espFsRead(fh, buf + got, 7)) > 0) {   // In small pieces, across heatshrink backreferences.
+		got += n;
+	}
+	CHECK(got == (int)len && memcmp(buf, expected, len) == 0);
+	espFsClose(fh);
+}
+
+
+// Time opening (and closing) files picked at random. Returns the mean in nanoseconds.
+static double timeOpens(char **names, int count) {
+	uint32_t seed = 1;
+	uint64_t start = nowNs();
+	for (int i = 0; i < OPENS; i++) {
+		seed = seed * 1103515245 + 12345;
+		EspFsFile *fh = espFsOpen(names[(seed >> 8) % count]);
+		CHECK(fh != NULL);
+		espFsClose(fh);
+	}
+	return (double)(nowNs() - start) / OPENS;
+}
+
+
+static void testLookup(void) {
+	static const int counts[] = { 10, 100, 300, 1000, 3000 };
+	printf("  files   indexed    linear\n");
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		int count = counts[c];
+		char **names = malloc(count * sizeof(char *));
+		for (int i = 0; i < count; i++) {
+			names[i] = malloc(32);
+			snprintf(names[i], 32, "www/page%04d.html", i);
+			writeFile(names[i], i);
+		}
+
+		double ns[2];
+		for (int withIndex = 1; withIndex >= 0; withIndex--) {
+			char *image;
+			buildImage(names, count, withIndex, &image);
+			for (int i = 0; i < count; i++) {
+				checkFile(names[i], i);
+			}
+			char name[40];
+			snprintf(name, sizeof(name), "//%s", names[count / 2]);   // Leading slashes are ignored.
+			checkFile(name, count / 2);
+			CHECK(espFsOpen("www/page0001.htm") == NULL);
+			CHECK(espFsOpen("www/missing.html") == NULL);
+			CHECK(espFsOpen("") == NULL);
+			ns[withIndex] = timeOpens(names, count);
+			free(image);
+		}
+		printf("%7d %7.0f ns %7.0f ns\n", count, ns[1], ns[0]);
+		if (count >= 1000) {
+			CHECK(ns[1] < ns[0]);   // The index pays off long before this.
+		}
+
+		for (int i = 0; i < count; i++) {
+			unlink(names[i]);
+			free(names[i]);
+		}
+		free(names);
+	}
+}
+
+
+typedef struct {
+	uint32_t hash;
+	uint32_t n;
+} HashedName;
+
+
+static int compareHashed(const void *a, const void *b) {
+	const HashedName *ha = a;
+	const HashedName *hb = b;
+	return ha->hash < hb->hash ? -1 : ha->hash > hb->hash;
+}
+
+
+// Find two names that share a hash by trying enough of them that two are bound to collide.
+static void findCollision(char *first, char *second, size_t size) {
+	uint32_t tries = 1 << 20;
+	HashedName *hashed = malloc(tries * sizeof(HashedName));
+	for (uint32_t n = 0; n < tries; n++) {
+		char name[32];
+		snprintf(name, sizeof(name), "www/c%06x", n);
+		hashed[n].hash = espFsHash(name);
+		hashed[n].n = n;
+	}
+	qsort(hashed, tries, sizeof(HashedName), compareHashed);
+	for (uint32_t i = 1; i < tries; i++) {
+		if (hashed[i].hash == hashed[i - 1].hash) {
+			snprintf(first, size, "www/c%06x", hashed[i - 1].n);
+			snprintf(second, size, "www/c%06x", hashed[i].n);
+			break;
+		}
+	}
+	free(hashed);
+}
+
+
+static void testCollision(void) {
+	char first[32] = "";
+	char second[32] = "";
+	findCollision(first, second, sizeof(first));
+	CHECK(first[0] != 0 && espFsHash(first) == espFsHash(second));
+	if (first[0] == 0) {
+		return;
+	}
+
+	char *names[] = { "www/index.html", first, "www/style.css", second, "www/app.js" };
+	for (int i = 0; i < 5; i++) {
+		writeFile(names[i], 1000 + i);
+	}
+	for (int withIndex = 1; withIndex >= 0; withIndex--) {
+		char *image;
+		buildImage(names, 5, withIndex, &image);
+		for (int i = 0; i < 5; i++) {
+			checkFile(names[i], 1000 + i);
+		}
+		char *pair[] = { first, second };
+		printf("  collision %s: %.0f ns\n", withIndex ? "indexed" : "linear ", timeOpens(pair, 2));
+		free(image);
+
+		// Only the first of the pair: the second hits its entry in the index, but not its name.
+		buildImage(names, 2, withIndex, &image);
+		checkFile(first, 1001);
+		CHECK(espFsOpen(second) == NULL);
+		free(image);
+	}
+	for (int i = 0; i < 5; i++) {
+		unlink(names[i]);
+	}
+}
+
+
+int main(int argc, char **argv) {
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s mkespfsimage\n", argv[0]);
+		return 2;
+	}
+	mkespfsimage = realpath(argv[1], NULL);
+	char dir[] = "/tmp/test_espfsXXXXXX";
+	if (mkespfsimage == NULL || mkdtemp(dir) == NULL || chdir(dir) != 0 || mkdir("www", 0700) != 0) {
+		perror("setup");
+		return 2;
+	}
+
+	testLookup();
+	testCollision();
+
+	rmdir("www");
+	chdir("/");
+	rmdir(dir);
+	free(mkespfsimage);
+	printf("test_espfs: %s (%d failures)\n", failures == 0 ? "PASS" : "FAIL", failures);
+	return failures == 0 ? 0 : 1;
+}